@@ -0,0 +1,281 @@
+/*
+ * tobii_headpose_shim.c — LD_PRELOAD head_pose for unmodified Stream Engine apps
+ *
+ * The ET5's Stream Engine on Linux has no head_pose stream; squig-headtrackd
+ * computes one from gaze_origin and publishes it to /dev/shm (pose_shm.h).
+ * Preloaded into a game, this library takes over the head_pose entry
+ * points and serves that pose through the official callback:
+ *
+ *   tobii_stream_supported          reports TOBII_STREAM_HEAD_POSE as supported
+ *   tobii_head_pose_subscribe       remembers (device, callback, user data)
+ *   tobii_head_pose_unsubscribe     forgets it
+ *   tobii_device_process_callbacks  runs the real one, then, if a pose was
+ *                                   published since the last one this
+ *                                   device got, copies it out of the
+ *                                   seqlock and calls the callback, on the
+ *                                   app's own thread, inside its own call
+ *   tobii_wait_for_callbacks        returns as soon as a new pose is
+ *                                   published (the daemon's futex), or
+ *                                   after a short wait falls back to the
+ *                                   real one so the app's other streams
+ *                                   keep flowing without a daemon
+ *
+ * There is no thread, socket or queue: a pose reaches the app the next
+ * time it processes callbacks, with the timestamp_us of the gaze sample
+ * it was computed from (same Stream Engine clock as the app's own
+ * streams). Rotation is radians about the tracker's X (pitch), Y (yaw)
+ * and Z (roll) axes. The daemon's position is relative to where tracking
+ * started, so SQUIG_SHIM_ORIGIN (default "0,0,600" mm) places it in
+ * front of the tracker for apps that expect an absolute one. Poses the
+ * filter only extrapolated (no eyes) are delivered as invalid.
+ *
+ * Environment:
+ *   SQUIG_SHIM_SHM=/name          pose segment (default /squig-headpose)
+ *   SQUIG_SHIM_ORIGIN=x,y,z       mm added to the position
+ *   SQUIG_SHIM_QUIET=1            no message on stderr
+ *
+ * Build & run:
+ *   make shim
+ *   LD_PRELOAD=$PWD/build/libsquig_headpose_shim.so ./game
+ *
+ * Only apps that link libtobii_stream_engine.so (or resolve its symbols
+ * globally) are covered: a dlsym() on the library's own handle bypasses
+ * any preload.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include "../src/se_session.h"
+#include "../src/pose_shm.h"
+
+#define SHIM_EXPORT     __attribute__((visibility("default")))
+#define SHIM_MAX_SUBS   8       /* devices with a head_pose subscriber */
+#define SHIM_WAIT_MS    20      /* pose wait before the real wait (~2 poses at 90 Hz) */
+#define SHIM_REOPEN_MS  1000    /* segment missing or writer gone: look again */
+
+typedef struct {
+    tobii_device_t            *dev;
+    tobii_head_pose_callback_t cb;
+    void                      *user;
+    uint64_t                   last_ns;     /* publish_ns of the last pose delivered */
+} sub_t;
+
+static struct {
+    pthread_once_t   once;
+    pthread_mutex_t  lock;      /* subs + r */
+    sub_t            subs[SHIM_MAX_SUBS];
+    int              nsubs;     /* atomic: fast path when 0 */
+
+    pose_shm_reader_t *r;
+    int64_t          next_open_ns;
+    const char      *shm_name;
+    double           origin[3];
+    int              quiet, announced;
+
+    int (*real_process)(tobii_device_t *);
+    int (*real_wait)(int, tobii_device_t *const *);
+    int (*real_stream_supported)(tobii_device_t *, int, int *);
+} g = { .once = PTHREAD_ONCE_INIT, .lock = PTHREAD_MUTEX_INITIALIZER };
+
+/* One per thread that waits, so concurrent waiters never share state */
+static __thread pose_shm_reader_t *t_wait;
+
+static int64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void shim_init(void)
+{
+    g.real_process = (int (*)(tobii_device_t *))dlsym(RTLD_NEXT, "tobii_device_process_callbacks");
+    g.real_wait = (int (*)(int, tobii_device_t *const *))dlsym(RTLD_NEXT, "tobii_wait_for_callbacks");
+    g.real_stream_supported = (int (*)(tobii_device_t *, int, int *))
+        dlsym(RTLD_NEXT, "tobii_stream_supported");
+
+    g.shm_name = getenv("SQUIG_SHIM_SHM");
+    g.origin[2] = 600.0;
+    const char *o = getenv("SQUIG_SHIM_ORIGIN");
+    if (o && sscanf(o, "%lf,%lf,%lf", &g.origin[0], &g.origin[1], &g.origin[2]) != 3) {
+        fprintf(stderr, "[SHIM] SQUIG_SHIM_ORIGIN=%s: want x,y,z in mm\n", o);
+        g.origin[0] = g.origin[1] = 0.0;
+        g.origin[2] = 600.0;
+    }
+    const char *q = getenv("SQUIG_SHIM_QUIET");
+    g.quiet = q && *q && *q != '0';
+}
+
+/* ── Pose segment (lock held) ───────────────────────────────────────── */
+
+/* The reader, (re)opened when the segment appears or its writer is gone */
+static pose_shm_reader_t *reader(void)
+{
+    if (g.r && pose_shm_writer_alive(g.r)) return g.r;
+    int64_t now = mono_ns();
+    if (now < g.next_open_ns) return g.r;
+    g.next_open_ns = now + SHIM_REOPEN_MS * 1000000LL;
+
+    pose_shm_reader_t *r = pose_shm_open(g.shm_name);
+    if (!r) return g.r;
+    pose_shm_close(g.r);
+    g.r = r;
+    if (!g.quiet && !g.announced && pose_shm_writer_alive(r)) {
+        fprintf(stderr, "[SHIM] Serving tobii_head_pose from /dev/shm%s\n",
+                g.shm_name ? g.shm_name : POSE_SHM_DEFAULT_NAME);
+        g.announced = 1;
+    }
+    return g.r;
+}
+
+static sub_t *find_sub(tobii_device_t *dev)
+{
+    for (int i = 0; i < g.nsubs; i++)
+        if (g.subs[i].dev == dev) return &g.subs[i];
+    return NULL;
+}
+
+static void to_head_pose(const pose_shm_pose_t *p, tobii_head_pose_t *hp)
+{
+    const double d2r = M_PI / 180.0;
+    tobii_validity_t v = (p->flags & POSE_SHM_F_PREDICTED) || p->confidence <= 0.0f
+                       ? TOBII_VALIDITY_INVALID : TOBII_VALIDITY_VALID;
+    hp->timestamp_us = p->timestamp_us;
+    hp->position_validity = v;
+    hp->position_xyz[0] = (float)(g.origin[0] + p->x);
+    hp->position_xyz[1] = (float)(g.origin[1] + p->y);
+    hp->position_xyz[2] = (float)(g.origin[2] + p->z);
+    for (int k = 0; k < 3; k++) hp->rotation_validity_xyz[k] = v;
+    hp->rotation_xyz[0] = (float)(p->pitch * d2r);
+    hp->rotation_xyz[1] = (float)(p->yaw * d2r);
+    hp->rotation_xyz[2] = (float)(p->roll * d2r);
+}
+
+/* ── Subscription ───────────────────────────────────────────────────── */
+
+SHIM_EXPORT int tobii_stream_supported(tobii_device_t *dev, int stream, int *supported)
+{
+    pthread_once(&g.once, shim_init);
+    if (stream == TOBII_STREAM_HEAD_POSE && supported) {
+        *supported = TOBII_SUPPORTED;
+        return TOBII_ERROR_NO_ERROR;
+    }
+    return g.real_stream_supported ? g.real_stream_supported(dev, stream, supported)
+                                   : TOBII_ERROR_NOT_SUPPORTED;
+}
+
+SHIM_EXPORT int tobii_head_pose_subscribe(tobii_device_t *dev, tobii_head_pose_callback_t cb,
+                                          void *user)
+{
+    pthread_once(&g.once, shim_init);
+    if (!dev || !cb) return TOBII_ERROR_INVALID_PARAMETER;
+    int err = TOBII_ERROR_NO_ERROR;
+    pthread_mutex_lock(&g.lock);
+    if (find_sub(dev)) {
+        err = TOBII_ERROR_ALREADY_SUBSCRIBED;
+    } else if (g.nsubs == SHIM_MAX_SUBS) {
+        err = TOBII_ERROR_TOO_MANY_SUBSCRIBERS;
+    } else {
+        g.subs[g.nsubs] = (sub_t){ dev, cb, user, 0 };
+        /* Start from the next pose, not whatever was published long ago */
+        pose_shm_pose_t p;
+        if (reader() && pose_shm_read(g.r, &p) >= 0) g.subs[g.nsubs].last_ns = p.publish_ns;
+        __atomic_store_n(&g.nsubs, g.nsubs + 1, __ATOMIC_RELEASE);
+        if (!g.r && !g.quiet)
+            fprintf(stderr, "[SHIM] No pose segment yet (is squig-headtrackd running?)\n");
+    }
+    pthread_mutex_unlock(&g.lock);
+    return err;
+}
+
+SHIM_EXPORT int tobii_head_pose_unsubscribe(tobii_device_t *dev)
+{
+    pthread_once(&g.once, shim_init);
+    int err = TOBII_ERROR_NOT_SUBSCRIBED;
+    pthread_mutex_lock(&g.lock);
+    sub_t *s = find_sub(dev);
+    if (s) {
+        *s = g.subs[g.nsubs - 1];
+        __atomic_store_n(&g.nsubs, g.nsubs - 1, __ATOMIC_RELEASE);
+        err = TOBII_ERROR_NO_ERROR;
+    }
+    pthread_mutex_unlock(&g.lock);
+    return err;
+}
+
+/* ── Dispatch ───────────────────────────────────────────────────────── */
+
+SHIM_EXPORT int tobii_device_process_callbacks(tobii_device_t *dev)
+{
+    pthread_once(&g.once, shim_init);
+    int err = g.real_process ? g.real_process(dev) : TOBII_ERROR_NO_ERROR;
+    if (!__atomic_load_n(&g.nsubs, __ATOMIC_ACQUIRE)) return err;
+
+    /* Copy what is needed out under the lock; the callback runs without
+     * it, so it may unsubscribe */
+    tobii_head_pose_callback_t cb = NULL;
+    void *user = NULL;
+    tobii_head_pose_t hp;
+    pose_shm_pose_t p;
+    pthread_mutex_lock(&g.lock);
+    sub_t *s = find_sub(dev);
+    if (s && reader() && pose_shm_writer_alive(g.r) && pose_shm_read(g.r, &p) >= 0 &&
+        p.publish_ns != s->last_ns) {
+        s->last_ns = p.publish_ns;
+        to_head_pose(&p, &hp);
+        cb = s->cb;
+        user = s->user;
+    }
+    pthread_mutex_unlock(&g.lock);
+    if (cb) cb(&hp, user);
+    return err;
+}
+
+/* Nonzero if one of devs has a subscriber and a pose it has not had yet.
+ * *serving: one of them is subscribed and a writer is attached. */
+static int pose_pending(int n, tobii_device_t *const *devs, int *serving)
+{
+    int pending = 0;
+    *serving = 0;
+    pose_shm_pose_t p;
+    pthread_mutex_lock(&g.lock);
+    if (reader() && pose_shm_writer_alive(g.r) && pose_shm_read(g.r, &p) >= 0) {
+        for (int i = 0; i < n; i++) {
+            sub_t *s = find_sub(devs[i]);
+            if (!s) continue;
+            *serving = 1;
+            if (p.publish_ns != s->last_ns) pending = 1;
+        }
+    }
+    pthread_mutex_unlock(&g.lock);
+    return pending;
+}
+
+SHIM_EXPORT int tobii_wait_for_callbacks(int n, tobii_device_t *const *devs)
+{
+    pthread_once(&g.once, shim_init);
+    if (__atomic_load_n(&g.nsubs, __ATOMIC_ACQUIRE) && devs && n > 0) {
+        if (t_wait && !pose_shm_writer_alive(t_wait)) {
+            pose_shm_close(t_wait);
+            t_wait = NULL;
+        }
+        if (!t_wait) t_wait = pose_shm_open(g.shm_name);
+        /* Catch up before looking, so any publish after the look wakes us */
+        pose_shm_pose_t p;
+        int synced = t_wait && pose_shm_read(t_wait, &p) >= 0;
+        int serving;
+        if (pose_pending(n, devs, &serving)) return TOBII_ERROR_NO_ERROR;
+        if (serving && synced && pose_shm_wait(t_wait, SHIM_WAIT_MS) == 0)
+            return TOBII_ERROR_NO_ERROR;
+    }
+    return g.real_wait ? g.real_wait(n, devs) : TOBII_ERROR_TIMED_OUT;
+}
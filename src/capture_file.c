@@ -0,0 +1,615 @@
+/*
+ * capture_file.c — Indexed IR capture container (.sqcap) + mmap replay
+ *
+ * Writer: records are appended to a page-aligned CAPFILE_BLOCK_SIZE
+ * buffer and written out a whole block at a time, so the disk sees a few
+ * large sequential writes per second instead of one per packet. The index
+ * grows in memory and goes out behind the last record on close; the
+ * header (which sits in the first block) is patched last with pwrite().
+ *
+ * Compression happens on the writer's thread, record by record, into a
+ * scratch buffer; the block buffer only ever sees the stored form.
+ *
+ * Reader: the whole file is mapped once. Frames are addressed through
+ * the index, so seek is O(1) by number and O(log n) by time, and replay
+ * hands out pointers into the mapping without copying.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "capture_file.h"
+
+#ifdef SQUIG_HAVE_LZ4
+#  include <lz4.h>
+#endif
+#ifdef SQUIG_HAVE_ZSTD
+#  include <zstd.h>
+#endif
+
+#define CAPFILE_ALIGN       4096
+#define REC_PAD(n)          (((n) + 7u) & ~(uint64_t)7)
+#define REC_SIZE_V1         40          /* capfile_rec_t without the v2 tail */
+
+const char *const capfile_codec_names[CAPFILE_CODEC_COUNT] = { "none", "lz4", "zstd" };
+
+int capfile_codec_supported(int codec)
+{
+    switch (codec) {
+    case CAPFILE_CODEC_NONE: return 1;
+#ifdef SQUIG_HAVE_LZ4
+    case CAPFILE_CODEC_LZ4:  return 1;
+#endif
+#ifdef SQUIG_HAVE_ZSTD
+    case CAPFILE_CODEC_ZSTD: return 1;
+#endif
+    default:                 return 0;
+    }
+}
+
+static uint64_t clock_ns(clockid_t id)
+{
+    struct timespec ts;
+    clock_gettime(id, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* ── Writer ─────────────────────────────────────────────────────────── */
+
+struct capfile_writer {
+    int               fd;
+    int               failed;
+    char              path[256];
+    uint8_t          *block;        /* CAPFILE_BLOCK_SIZE, page aligned */
+    uint32_t          fill;         /* bytes pending in block */
+    uint64_t          written;      /* bytes already on disk */
+    capfile_header_t  hdr;
+    capfile_index_t  *index;
+    uint64_t          nindex, index_cap;
+    uint64_t          raw_bytes;
+
+    /* Compression (CAPFILE_CODEC_NONE = off) */
+    int               codec, level;
+    uint8_t          *zbuf;
+    size_t            zcap;
+#ifdef SQUIG_HAVE_ZSTD
+    ZSTD_CCtx        *zctx;
+#endif
+};
+
+static void writer_flush(capfile_writer_t *w)
+{
+    uint32_t done = 0;
+    while (done < w->fill && !w->failed) {
+        ssize_t r = write(w->fd, w->block + done, w->fill - done);
+        if (r < 0 && errno == EINTR) continue;
+        if (r <= 0) {
+            fprintf(stderr, "[CAPFILE] %s: write: %s\n", w->path,
+                    r < 0 ? strerror(errno) : "short write");
+            w->failed = 1;
+            break;
+        }
+        done += (uint32_t)r;
+    }
+    w->written += done;
+    w->fill = 0;
+}
+
+/* Buffered append: whole blocks go to disk as they fill */
+static void writer_put(capfile_writer_t *w, const void *src, uint64_t n)
+{
+    const uint8_t *p = src;
+    while (n > 0 && !w->failed) {
+        uint32_t room = CAPFILE_BLOCK_SIZE - w->fill;
+        uint32_t c = n < room ? (uint32_t)n : room;
+        if (p) memcpy(w->block + w->fill, p, c);
+        else   memset(w->block + w->fill, 0, c);
+        w->fill += c;
+        n -= c;
+        if (p) p += c;
+        if (w->fill == CAPFILE_BLOCK_SIZE) writer_flush(w);
+    }
+}
+
+capfile_writer_t *capfile_create(const char *path, const void *probe,
+                                 uint32_t probe_len, uint32_t frame_size)
+{
+    capfile_writer_t *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    snprintf(w->path, sizeof(w->path), "%s", path);
+    w->block = aligned_alloc(CAPFILE_ALIGN, CAPFILE_BLOCK_SIZE);
+    w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (!w->block || w->fd < 0) {
+        fprintf(stderr, "[CAPFILE] %s: %s\n", path, strerror(errno));
+        if (w->fd >= 0) close(w->fd);
+        free(w->block);
+        free(w);
+        return NULL;
+    }
+
+    capfile_header_t *h = &w->hdr;
+    memcpy(h->magic, CAPFILE_MAGIC, sizeof(CAPFILE_MAGIC));
+    h->version         = CAPFILE_VERSION;
+    h->header_size     = CAPFILE_HEADER_SIZE;
+    h->t_start_ns      = clock_ns(CLOCK_MONOTONIC);
+    h->t_start_wall_ns = clock_ns(CLOCK_REALTIME);
+    h->frame_size      = frame_size;
+    if (probe && probe_len > 0) {
+        h->probe_len = probe_len < CAPFILE_PROBE_MAX ? probe_len : CAPFILE_PROBE_MAX;
+        memcpy(h->probe, probe, h->probe_len);
+    }
+
+    /* Header padded to a full page so records start block-aligned */
+    writer_put(w, h, sizeof(*h));
+    writer_put(w, NULL, CAPFILE_HEADER_SIZE - sizeof(*h));
+    return w;
+}
+
+int capfile_writer_set_codec(capfile_writer_t *w, int codec, int level)
+{
+    if (!capfile_codec_supported(codec)) return -1;
+#ifdef SQUIG_HAVE_ZSTD
+    if (codec == CAPFILE_CODEC_ZSTD && !w->zctx && !(w->zctx = ZSTD_createCCtx())) return -1;
+#endif
+    w->codec = codec;
+    w->level = level;
+    w->hdr.codec = (uint32_t)codec;
+    return 0;
+}
+
+/* Compress src into w->zbuf. Returns the stored size, or 0 to store raw
+ * (codec off, error, or no gain). */
+static size_t compress_frame(capfile_writer_t *w, const uint8_t *src, uint32_t n)
+{
+    size_t bound = 0;
+    (void)src;                                  /* unused without codecs */
+#ifdef SQUIG_HAVE_LZ4
+    if (w->codec == CAPFILE_CODEC_LZ4) bound = (size_t)LZ4_compressBound((int)n);
+#endif
+#ifdef SQUIG_HAVE_ZSTD
+    if (w->codec == CAPFILE_CODEC_ZSTD) bound = ZSTD_compressBound(n);
+#endif
+    if (bound == 0) return 0;
+    if (bound > w->zcap) {
+        uint8_t *nb = realloc(w->zbuf, bound);
+        if (!nb) return 0;
+        w->zbuf = nb;
+        w->zcap = bound;
+    }
+
+    size_t out = 0;
+#ifdef SQUIG_HAVE_LZ4
+    if (w->codec == CAPFILE_CODEC_LZ4) {
+        int r = LZ4_compress_fast((const char *)src, (char *)w->zbuf, (int)n, (int)w->zcap,
+                                  w->level > 0 ? w->level : 1);
+        out = r > 0 ? (size_t)r : 0;
+    }
+#endif
+#ifdef SQUIG_HAVE_ZSTD
+    if (w->codec == CAPFILE_CODEC_ZSTD) {
+        size_t r = ZSTD_compressCCtx(w->zctx, w->zbuf, w->zcap, src, n,
+                                     w->level > 0 ? w->level : 1);
+        out = ZSTD_isError(r) ? 0 : r;
+    }
+#endif
+    return out < n ? out : 0;
+}
+
+int capfile_write(capfile_writer_t *w, const frame_t *f)
+{
+    if (w->failed) return -1;
+    if (w->nindex == w->index_cap) {
+        uint64_t ncap = w->index_cap ? w->index_cap * 2 : 1024;
+        capfile_index_t *ni = realloc(w->index, ncap * sizeof(*ni));
+        if (!ni) { perror("[CAPFILE] index"); w->failed = 1; return -1; }
+        w->index = ni;
+        w->index_cap = ncap;
+    }
+
+    const uint8_t *stored = f->data;
+    uint32_t slen = f->len;
+    uint8_t  codec = CAPFILE_CODEC_NONE;
+    if (w->codec != CAPFILE_CODEC_NONE) {
+        size_t z = compress_frame(w, f->data, f->len);
+        if (z > 0) { stored = w->zbuf; slen = (uint32_t)z; codec = (uint8_t)w->codec; }
+    }
+
+    capfile_rec_t rec = {
+        .magic      = CAPFILE_REC_MAGIC,
+        .len        = slen,
+        .seq        = f->seq,
+        .t_first_ns = f->t_first_ns,
+        .t_last_ns  = f->t_last_ns,
+        .pix_off    = f->stats.pix_off,
+        .npayloads  = f->npayloads,
+        .fid        = f->fid,
+        .flags      = f->flags,
+        .raw_len    = f->len,
+        .codec      = codec,
+    };
+    w->index[w->nindex++] = (capfile_index_t){
+        .off   = capfile_writer_bytes(w),
+        .t_ns  = f->t_first_ns,
+        .len   = f->len,
+        .flags = f->flags,
+    };
+
+    uint64_t n = sizeof(rec) + slen;
+    writer_put(w, &rec, sizeof(rec));
+    writer_put(w, stored, slen);
+    writer_put(w, NULL, REC_PAD(n) - n);
+    w->raw_bytes += f->len;
+    return w->failed ? -1 : 0;
+}
+
+uint64_t capfile_writer_frames(const capfile_writer_t *w)
+{
+    return w->nindex;
+}
+
+uint64_t capfile_writer_bytes(const capfile_writer_t *w)
+{
+    return w->written + w->fill;
+}
+
+uint64_t capfile_writer_raw_bytes(const capfile_writer_t *w)
+{
+    return w->raw_bytes;
+}
+
+int capfile_close(capfile_writer_t *w)
+{
+    if (!w) return 0;
+    capfile_trailer_t tr = {
+        .magic     = CAPFILE_IDX_MAGIC,
+        .version   = CAPFILE_VERSION,
+        .nframes   = w->nindex,
+        .index_off = capfile_writer_bytes(w),
+    };
+    writer_put(w, w->index, w->nindex * sizeof(*w->index));
+    writer_put(w, &tr, sizeof(tr));
+    writer_flush(w);
+
+    /* The index is in place: publish it in the header */
+    if (!w->failed) {
+        w->hdr.nframes   = tr.nframes;
+        w->hdr.index_off = tr.index_off;
+        if (pwrite(w->fd, &w->hdr, sizeof(w->hdr), 0) != (ssize_t)sizeof(w->hdr)) {
+            fprintf(stderr, "[CAPFILE] %s: header: %s\n", w->path, strerror(errno));
+            w->failed = 1;
+        }
+    }
+    if (close(w->fd) < 0) w->failed = 1;
+
+    int rc = w->failed ? -1 : 0;
+#ifdef SQUIG_HAVE_ZSTD
+    if (w->zctx) ZSTD_freeCCtx(w->zctx);
+#endif
+    free(w->zbuf);
+    free(w->index);
+    free(w->block);
+    free(w);
+    return rc;
+}
+
+/* ── Reader ─────────────────────────────────────────────────────────── */
+
+struct capfile {
+    const uint8_t          *map;
+    uint64_t                size;
+    const capfile_header_t *hdr;
+    const capfile_index_t  *index;      /* in the map, or owned copy */
+    capfile_index_t        *rebuilt;
+    uint64_t                count;
+    int                     recovered;
+    uint32_t                rec_size;   /* record header bytes (by version) */
+};
+
+/* Record header at off, v1 records padded out to the v2 layout */
+static int load_rec(const capfile_t *cf, uint64_t off, capfile_rec_t *rec)
+{
+    if (off + cf->rec_size > cf->size) return -1;
+    memset(rec, 0, sizeof(*rec));
+    memcpy(rec, cf->map + off, cf->rec_size);
+    if (rec->magic != CAPFILE_REC_MAGIC) return -1;
+    if (rec->len > cf->size - off - cf->rec_size) return -1;
+    if (cf->rec_size < sizeof(*rec)) rec->raw_len = rec->len;
+    return 0;
+}
+
+/* Unclean file: walk the records until the first one that is cut off */
+static int rebuild_index(capfile_t *cf)
+{
+    uint64_t cap = 0, off = cf->hdr->header_size;
+    capfile_rec_t rec;
+    while (load_rec(cf, off, &rec) == 0) {
+        if (cf->count == cap) {
+            cap = cap ? cap * 2 : 1024;
+            capfile_index_t *ni = realloc(cf->rebuilt, cap * sizeof(*ni));
+            if (!ni) return -1;
+            cf->rebuilt = ni;
+        }
+        cf->rebuilt[cf->count++] = (capfile_index_t){
+            .off = off, .t_ns = rec.t_first_ns, .len = rec.raw_len, .flags = rec.flags,
+        };
+        off += REC_PAD(cf->rec_size + rec.len);
+    }
+    cf->index = cf->rebuilt;
+    cf->recovered = 1;
+    return 0;
+}
+
+capfile_t *capfile_open(const char *path)
+{
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) { fprintf(stderr, "[CAPFILE] %s: %s\n", path, strerror(errno)); return NULL; }
+    struct stat sb;
+    if (fstat(fd, &sb) < 0 || (uint64_t)sb.st_size < sizeof(capfile_header_t)) {
+        fprintf(stderr, "[CAPFILE] %s: not a capture file\n", path);
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, (size_t)sb.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) { fprintf(stderr, "[CAPFILE] %s: mmap: %s\n", path, strerror(errno)); return NULL; }
+    madvise(map, (size_t)sb.st_size, MADV_SEQUENTIAL);
+
+    capfile_t *cf = calloc(1, sizeof(*cf));
+    if (!cf) { munmap(map, (size_t)sb.st_size); return NULL; }
+    cf->map  = map;
+    cf->size = (uint64_t)sb.st_size;
+    cf->hdr  = map;
+
+    const capfile_header_t *h = cf->hdr;
+    if (memcmp(h->magic, CAPFILE_MAGIC, sizeof(CAPFILE_MAGIC)) != 0 ||
+        h->version < 1 || h->version > CAPFILE_VERSION ||
+        h->header_size < offsetof(capfile_header_t, codec) ||
+        h->header_size > cf->size) {
+        fprintf(stderr, "[CAPFILE] %s: bad header (version %u)\n", path, h->version);
+        capfile_free(cf);
+        return NULL;
+    }
+    cf->rec_size = h->version >= 2 ? sizeof(capfile_rec_t) : REC_SIZE_V1;
+
+    /* Clean close: index + trailer end the file and agree with the header */
+    capfile_trailer_t tr = {0};
+    if (cf->size >= h->header_size + sizeof(tr))
+        memcpy(&tr, cf->map + cf->size - sizeof(tr), sizeof(tr));
+    if (h->index_off && tr.magic == CAPFILE_IDX_MAGIC && tr.index_off == h->index_off &&
+        tr.nframes == h->nframes &&
+        tr.index_off + tr.nframes * sizeof(capfile_index_t) + sizeof(tr) == cf->size) {
+        cf->index = (const capfile_index_t *)(cf->map + tr.index_off);
+        cf->count = tr.nframes;
+    } else if (rebuild_index(cf) < 0) {
+        perror("[CAPFILE] index");
+        capfile_free(cf);
+        return NULL;
+    } else {
+        fprintf(stderr, "[CAPFILE] %s: not closed cleanly, recovered %llu frames\n",
+                path, (unsigned long long)cf->count);
+    }
+    return cf;
+}
+
+const capfile_header_t *capfile_header(const capfile_t *cf)
+{
+    return cf->hdr;
+}
+
+uint64_t capfile_count(const capfile_t *cf)
+{
+    return cf->count;
+}
+
+int capfile_recovered(const capfile_t *cf)
+{
+    return cf->recovered;
+}
+
+int capfile_frame(const capfile_t *cf, uint64_t i, capfile_frame_t *out)
+{
+    if (i >= cf->count) return -1;
+    uint64_t off = cf->index[i].off;
+    capfile_rec_t rec;
+    if (load_rec(cf, off, &rec) < 0) return -1;
+
+    out->data       = cf->map + off + cf->rec_size;
+    out->len        = rec.len;
+    out->raw_len    = rec.raw_len;
+    out->codec      = rec.codec;
+    out->pix_off    = rec.pix_off <= rec.raw_len ? rec.pix_off : 0;
+    out->seq        = rec.seq;
+    out->t_first_ns = rec.t_first_ns;
+    out->t_last_ns  = rec.t_last_ns;
+    out->npayloads  = rec.npayloads;
+    out->fid        = rec.fid;
+    out->flags      = rec.flags;
+    return 0;
+}
+
+int capfile_decode(const capfile_frame_t *fr, uint8_t *dst, uint32_t cap)
+{
+    if (fr->raw_len > cap) return -1;
+    switch (fr->codec) {
+    case CAPFILE_CODEC_NONE:
+        memcpy(dst, fr->data, fr->len);
+        return (int)fr->len;
+#ifdef SQUIG_HAVE_LZ4
+    case CAPFILE_CODEC_LZ4: {
+        int r = LZ4_decompress_safe((const char *)fr->data, (char *)dst, (int)fr->len, (int)cap);
+        return r == (int)fr->raw_len ? r : -1;
+    }
+#endif
+#ifdef SQUIG_HAVE_ZSTD
+    case CAPFILE_CODEC_ZSTD: {
+        /* One context per thread, reused across frames */
+        static __thread ZSTD_DCtx *dctx;
+        if (!dctx && !(dctx = ZSTD_createDCtx())) return -1;
+        size_t r = ZSTD_decompressDCtx(dctx, dst, cap, fr->data, fr->len);
+        return (!ZSTD_isError(r) && r == fr->raw_len) ? (int)r : -1;
+    }
+#endif
+    default:
+        return -1;
+    }
+}
+
+uint64_t capfile_find(const capfile_t *cf, uint64_t t_ns)
+{
+    uint64_t lo = 0, hi = cf->count;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (cf->index[mid].t_ns < t_ns) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+void capfile_free(capfile_t *cf)
+{
+    if (!cf) return;
+    munmap((void *)cf->map, (size_t)cf->size);
+    free(cf->rebuilt);
+    free(cf);
+}
+
+/* ── Player ─────────────────────────────────────────────────────────── */
+
+/* Slots only carry frame_t headers; their data points into the mapping */
+#define PLAYER_SLOTS        32
+
+/* Compressed records are decoded into full-size slots instead */
+#define PLAYER_DECODE_SLOTS 8
+
+struct capfile_player {
+    const capfile_t *cf;
+    frame_pool_t    *pool;
+    frame_pool_t    *decode;        /* created on the first compressed record */
+    double           speed;
+    int              loop;
+    int              done;
+    uint64_t         pos;
+    uint64_t         base_wall_ns;  /* when frame base_t_ns is due */
+    uint64_t         base_t_ns;
+};
+
+capfile_player_t *capfile_player_create(const capfile_t *cf, double speed, int loop)
+{
+    capfile_player_t *p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    p->pool = frame_pool_create(PLAYER_SLOTS, FRAME_ALIGN);
+    if (!p->pool) { free(p); return NULL; }
+    p->cf    = cf;
+    p->speed = speed > 0 ? speed : 0;
+    p->loop  = loop;
+    p->done  = cf->count == 0;
+    return p;
+}
+
+frame_t *capfile_player_next(capfile_player_t *p, int timeout_ms)
+{
+    if (p->done) return NULL;
+    if (p->pos >= p->cf->count) {
+        if (!p->loop) { p->done = 1; return NULL; }
+        p->pos = 0;
+        p->base_wall_ns = 0;
+    }
+
+    capfile_frame_t cfr;
+    if (capfile_frame(p->cf, p->pos, &cfr) < 0) { p->done = 1; return NULL; }
+
+    /* Pace by recorded timestamps, relative to the first frame played */
+    uint64_t now = clock_ns(CLOCK_MONOTONIC);
+    uint64_t deadline = now + (uint64_t)(timeout_ms > 0 ? timeout_ms : 0) * 1000000ull;
+    if (p->speed > 0) {
+        if (p->base_wall_ns == 0) { p->base_wall_ns = now; p->base_t_ns = cfr.t_first_ns; }
+        uint64_t rel = cfr.t_first_ns > p->base_t_ns ? cfr.t_first_ns - p->base_t_ns : 0;
+        uint64_t due = p->base_wall_ns + (uint64_t)((double)rel / p->speed);
+        if (due > deadline) {
+            if (deadline > now) {
+                struct timespec ts = { (time_t)((deadline - now) / 1000000000ull),
+                                       (long)((deadline - now) % 1000000000ull) };
+                nanosleep(&ts, NULL);
+            }
+            return NULL;
+        }
+        if (due > now) {
+            struct timespec ts = { (time_t)((due - now) / 1000000000ull),
+                                   (long)((due - now) % 1000000000ull) };
+            nanosleep(&ts, NULL);
+        }
+    }
+
+    /* A free slot (the consumer may be holding several) */
+    frame_pool_t *pool = p->pool;
+    if (cfr.codec != CAPFILE_CODEC_NONE) {
+        if (!p->decode) p->decode = frame_pool_create(PLAYER_DECODE_SLOTS, CAPFILE_MAX_FRAME);
+        if (!p->decode) { p->done = 1; return NULL; }
+        pool = p->decode;
+    }
+    frame_t *f;
+    while ((f = frame_pool_get(pool)) == NULL) {
+        if (clock_ns(CLOCK_MONOTONIC) >= deadline) return NULL;
+        usleep(1000);
+    }
+
+    if (cfr.codec == CAPFILE_CODEC_NONE) {
+        f->data = (uint8_t *)cfr.data;
+        f->len  = cfr.len;
+        f->cap  = cfr.len;
+    } else {
+        int n = capfile_decode(&cfr, f->data, f->cap);
+        if (n < 0) {
+            /* Skip what this build cannot read rather than stopping */
+            fprintf(stderr, "[CAPFILE] frame %llu: cannot decode (%s)\n",
+                    (unsigned long long)p->pos,
+                    cfr.codec < CAPFILE_CODEC_COUNT ? capfile_codec_names[cfr.codec] : "?");
+            frame_unref(f);
+            p->pos++;
+            return NULL;
+        }
+        f->len = (uint32_t)n;
+    }
+    f->fid        = cfr.fid;
+    f->flags      = cfr.flags;
+    f->npayloads  = cfr.npayloads;
+    f->seq        = cfr.seq;
+    f->t_first_ns = cfr.t_first_ns;
+    f->t_last_ns  = cfr.t_last_ns;
+
+    /* Same stats the engine computed live: header known, skip detection */
+    frame_stats_compute(&f->stats, f->data + cfr.pix_off, f->len - cfr.pix_off, 0);
+    f->stats.pix_off  = cfr.pix_off;
+    f->stats.has_meta = cfr.pix_off > 0;
+
+    p->pos++;
+    return f;
+}
+
+int capfile_player_running(const capfile_player_t *p)
+{
+    return !p->done;
+}
+
+uint64_t capfile_player_position(const capfile_player_t *p)
+{
+    return p->pos;
+}
+
+void capfile_player_destroy(capfile_player_t *p)
+{
+    if (!p) return;
+    frame_pool_destroy(p->pool);
+    frame_pool_destroy(p->decode);
+    free(p);
+}
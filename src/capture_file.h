@@ -0,0 +1,201 @@
+/*
+ * capture_file.h — Indexed IR capture container (.sqcap) + mmap replay
+ *
+ * One file per recording. All fields are little-endian:
+ *
+ *   [header, CAPFILE_HEADER_SIZE bytes]  negotiated UVC probe, frame size,
+ *                                        start time, index location
+ *   [record] [record] ...                capfile_rec_t + frame bytes,
+ *                                        each padded to 8 bytes
+ *   [index]                              capfile_index_t per frame
+ *   [trailer]                            capfile_trailer_t (last bytes)
+ *
+ * A record is one frame as the capture engine reassembled it (FID/EOF
+ * boundaries, UVC_FRAME_* flags), with its CLOCK_MONOTONIC timestamps, so
+ * the index is the frame index. The writer batches records into large
+ * page-aligned blocks — one write() per CAPFILE_BLOCK_SIZE, not per USB
+ * packet — and appends the index when it is closed. A file that was never
+ * closed (crash, power loss) still opens: the reader rebuilds the index
+ * by walking the records and stops at the first torn one.
+ *
+ *   capfile_writer_t *w = capfile_create(path, &probe, sizeof(probe), fsize);
+ *   capfile_write(w, f);                        // per frame_t
+ *   capfile_close(w);
+ *
+ *   capfile_t *cf = capfile_open(path);         // mmap, read-only
+ *   capfile_frame_t fr;
+ *   capfile_frame(cf, i, &fr);                  // fr.data points into the map
+ *
+ * capfile_player_t turns a capfile_t back into a stream of frame_t (with
+ * frame_stats recomputed), paced by the recorded timestamps or as fast as
+ * the consumer takes them, so the viewer and tools run without hardware.
+ *
+ * Records may be block-compressed (CAPFILE_CODEC_LZ4 / _ZSTD, when built
+ * with SQUIG_HAVE_LZ4 / SQUIG_HAVE_ZSTD); each record says which codec it
+ * used, and frames that would not shrink are stored as they are.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_CAPTURE_FILE_H
+#define SQUIG_CAPTURE_FILE_H
+
+#include <stdint.h>
+#include "frame_pool.h"
+
+#define CAPFILE_MAGIC       "SQIRCAP"           /* 8 bytes with the NUL */
+#define CAPFILE_VERSION     2                   /* 1: no codec fields */
+#define CAPFILE_HEADER_SIZE 4096
+#define CAPFILE_PROBE_MAX   64
+#define CAPFILE_REC_MAGIC   0x30524653u         /* "SFR0" */
+#define CAPFILE_IDX_MAGIC   0x58444953u         /* "SIDX" */
+#define CAPFILE_BLOCK_SIZE  (1024 * 1024)
+#define CAPFILE_MAX_FRAME   (4u * 1024 * 1024)  /* largest record decoded */
+
+/* Record codecs */
+enum {
+    CAPFILE_CODEC_NONE = 0,
+    CAPFILE_CODEC_LZ4,
+    CAPFILE_CODEC_ZSTD,
+    CAPFILE_CODEC_COUNT
+};
+
+/* ── On-disk layout ─────────────────────────────────────────────────── */
+
+typedef struct __attribute__((packed)) {
+    char     magic[8];
+    uint32_t version;
+    uint32_t header_size;       /* offset of the first record */
+    uint64_t t_start_ns;        /* CLOCK_MONOTONIC when recording began */
+    uint64_t t_start_wall_ns;   /* CLOCK_REALTIME at the same moment */
+    uint32_t frame_size;        /* negotiated dwMaxVideoFrameSize */
+    uint32_t probe_len;         /* valid bytes in probe[] */
+    uint8_t  probe[CAPFILE_PROBE_MAX];  /* committed uvc_probe_t */
+    uint64_t nframes;           /* filled in by capfile_close() */
+    uint64_t index_off;         /* 0 = not finalized */
+    uint32_t codec;             /* codec requested for this file (v2) */
+} capfile_header_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;             /* CAPFILE_REC_MAGIC */
+    uint32_t len;               /* stored bytes after this header */
+    uint64_t seq;               /* capture sequence number */
+    uint64_t t_first_ns;        /* CLOCK_MONOTONIC of first / last byte */
+    uint64_t t_last_ns;
+    uint32_t pix_off;           /* metadata header length (frame_stats) */
+    uint16_t npayloads;
+    uint8_t  fid;
+    uint8_t  flags;             /* UVC_FRAME_* */
+    /* v2 */
+    uint32_t raw_len;           /* frame bytes after decoding */
+    uint8_t  codec;             /* CAPFILE_CODEC_* of this record */
+    uint8_t  pad[3];
+} capfile_rec_t;
+
+typedef struct __attribute__((packed)) {
+    uint64_t off;               /* file offset of the capfile_rec_t */
+    uint64_t t_ns;              /* t_first_ns, for seeking */
+    uint32_t len;               /* decoded frame bytes */
+    uint32_t flags;
+} capfile_index_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;             /* CAPFILE_IDX_MAGIC */
+    uint32_t version;
+    uint64_t nframes;
+    uint64_t index_off;
+} capfile_trailer_t;
+
+extern const char *const capfile_codec_names[CAPFILE_CODEC_COUNT];
+
+/* Nonzero if this build can write and read codec. */
+int capfile_codec_supported(int codec);
+
+/* ── Writer ─────────────────────────────────────────────────────────── */
+
+typedef struct capfile_writer capfile_writer_t;
+
+/* Create (truncate) path. probe/probe_len: the committed UVC probe as
+ * negotiated (may be NULL/0). Returns NULL with a message on failure. */
+capfile_writer_t *capfile_create(const char *path, const void *probe,
+                                 uint32_t probe_len, uint32_t frame_size);
+
+/* Compress the frames written from now on (level: codec-specific, 0 =
+ * default). Returns -1 if the codec is not compiled in. */
+int capfile_writer_set_codec(capfile_writer_t *w, int codec, int level);
+
+/* Append one frame. Returns 0, or -1 once a write has failed (the file
+ * stays readable up to the last complete block). */
+int capfile_write(capfile_writer_t *w, const frame_t *f);
+
+uint64_t capfile_writer_frames(const capfile_writer_t *w);
+uint64_t capfile_writer_bytes(const capfile_writer_t *w);    /* incl. buffered */
+uint64_t capfile_writer_raw_bytes(const capfile_writer_t *w); /* before codec */
+
+/* Flush, append index + trailer, patch the header and close.
+ * Returns 0 on success, -1 if anything failed along the way. */
+int capfile_close(capfile_writer_t *w);
+
+/* ── Reader ─────────────────────────────────────────────────────────── */
+
+typedef struct capfile capfile_t;
+
+typedef struct {
+    const uint8_t *data;        /* inside the mapping, valid until close */
+    uint32_t len;               /* stored bytes at data */
+    uint32_t raw_len;           /* frame bytes (== len unless compressed) */
+    uint8_t  codec;
+    uint32_t pix_off;
+    uint64_t seq;
+    uint64_t t_first_ns, t_last_ns;
+    uint16_t npayloads;
+    uint8_t  fid, flags;
+} capfile_frame_t;
+
+/* Map path read-only. Uses the stored index, or rebuilds it when the file
+ * was not closed cleanly. Returns NULL with a message on failure. */
+capfile_t *capfile_open(const char *path);
+
+const capfile_header_t *capfile_header(const capfile_t *cf);
+uint64_t capfile_count(const capfile_t *cf);
+int      capfile_recovered(const capfile_t *cf);     /* index was rebuilt */
+
+/* Frame i (0-based). Returns 0, or -1 if i is out of range. */
+int capfile_frame(const capfile_t *cf, uint64_t i, capfile_frame_t *out);
+
+/* Decode a compressed frame into dst (cap bytes). Returns the frame
+ * length, or -1 on a corrupt record or unsupported codec. */
+int capfile_decode(const capfile_frame_t *fr, uint8_t *dst, uint32_t cap);
+
+/* First frame with t_first_ns >= t_ns (count if none): binary search. */
+uint64_t capfile_find(const capfile_t *cf, uint64_t t_ns);
+
+void capfile_free(capfile_t *cf);
+
+/* ── Player ─────────────────────────────────────────────────────────── */
+
+typedef struct capfile_player capfile_player_t;
+
+/* speed: 1.0 = recorded pace, 2.0 = twice as fast, 0 = as fast as the
+ * consumer pulls. loop: restart at the end instead of stopping. The
+ * player borrows cf, which must outlive it. */
+capfile_player_t *capfile_player_create(const capfile_t *cf, double speed, int loop);
+
+/* Next frame, like uvc_capture_next(): NULL on timeout or at the end.
+ * Uncompressed frames own no memory of their own — data points into the
+ * mapping (read-only); compressed ones are decoded into a player slot.
+ * seq/timestamps/stats are those of the recording.
+ * The caller drops it with frame_unref(). */
+frame_t *capfile_player_next(capfile_player_t *p, int timeout_ms);
+
+/* Nonzero until the last frame has been handed out (always, with loop). */
+int capfile_player_running(const capfile_player_t *p);
+
+/* Index of the next frame to be returned. */
+uint64_t capfile_player_position(const capfile_player_t *p);
+
+/* Drop all frame references first. */
+void capfile_player_destroy(capfile_player_t *p);
+
+#endif /* SQUIG_CAPTURE_FILE_H */
@@ -0,0 +1,457 @@
+/*
+ * capture_scan.c — Parallel offline analysis of recorded IR captures
+ *
+ * See capture_scan.h. Shares are packed (lo, hi) words of global frame
+ * indices: the owner advances lo by a chunk, a thief lowers hi to the
+ * midpoint and takes the top half as its new share. Both are one CAS on
+ * the victim's word; a share only ever shrinks, so a stale (lo, hi) can
+ * never come back and a failed CAS just retries.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "capture_scan.h"
+
+const capscan_hist_def_t capscan_hist_defs[CAPSCAN_H_COUNT] = {
+    [CAPSCAN_H_MEAN]     = { "mean brightness", 4.0 },
+    [CAPSCAN_H_ND]       = { "neighbour difference", 1.0 },
+    [CAPSCAN_H_DIFF]     = { "frame-to-frame difference", 1.0 },
+    [CAPSCAN_H_INTERVAL] = { "frame interval (ms)", 0.5 },
+};
+
+typedef struct {
+    uint64_t range;             /* lo | hi << 32 */
+} __attribute__((aligned(64))) share_t;
+
+typedef struct scan scan_t;
+
+typedef struct {
+    scan_t  *s;
+    int      id;
+    pthread_t thread;
+    uint8_t *buf[2];            /* decode buffers, compressed records only */
+    frame_t  scratch;           /* stats for frame_classify() */
+    uint64_t class_count[FRAME_CLASS_COUNT + 1];
+    uint64_t lit_count, bytes;
+    uint64_t hist[CAPSCAN_H_COUNT][CAPSCAN_HIST_BINS];
+    capscan_worker_stats_t st;
+} __attribute__((aligned(64))) worker_t;
+
+struct scan {
+    capfile_t *const *files;
+    int               nfiles;
+    uint64_t         *base;     /* first global index of each file, [nfiles] = total */
+    capscan_config_t  cfg;
+    share_t          *share;
+    int               nthr;
+    capscan_result_t *r;
+};
+
+/* Previous frame, for the difference and the interval */
+typedef struct {
+    int            valid;
+    uint64_t       g;           /* its global index */
+    const uint8_t *pix;
+    uint32_t       pix_len;
+    uint64_t       t_ns;
+    int            buf;         /* decode buffer holding it, -1 = in the mapping */
+} prev_t;
+
+static uint64_t clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline uint64_t pack(uint32_t lo, uint32_t hi) { return (uint64_t)hi << 32 | lo; }
+static inline uint32_t lo_of(uint64_t v) { return (uint32_t)v; }
+static inline uint32_t hi_of(uint64_t v) { return (uint32_t)(v >> 32); }
+
+/* ── Work stealing ──────────────────────────────────────────────────── */
+
+/* Next chunk of our own share. Returns 0 when it is empty. */
+static int take_chunk(scan_t *s, int id, uint32_t *lo, uint32_t *hi)
+{
+    share_t *sh = &s->share[id];
+    uint64_t v = __atomic_load_n(&sh->range, __ATOMIC_ACQUIRE);
+    for (;;) {
+        uint32_t l = lo_of(v), h = hi_of(v);
+        if (l >= h) return 0;
+        uint32_t n = h - l < s->cfg.chunk ? h - l : s->cfg.chunk;
+        if (__atomic_compare_exchange_n(&sh->range, &v, pack(l + n, h), 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            *lo = l;
+            *hi = l + n;
+            return 1;
+        }
+    }
+}
+
+/* Top half of the largest share left becomes ours. Returns 0 when every
+ * share is empty: all work is taken. */
+static int steal_share(scan_t *s, int id)
+{
+    for (;;) {
+        int victim = -1;
+        uint64_t best = 0, v = 0;
+        for (int i = 0; i < s->nthr; i++) {
+            uint64_t r = __atomic_load_n(&s->share[i].range, __ATOMIC_ACQUIRE);
+            uint64_t left = hi_of(r) > lo_of(r) ? hi_of(r) - lo_of(r) : 0;
+            if (left > best) { best = left; victim = i; v = r; }
+        }
+        if (victim < 0) return 0;
+        uint32_t l = lo_of(v), h = hi_of(v), mid = l + (h - l) / 2;
+        if (__atomic_compare_exchange_n(&s->share[victim].range, &v, pack(l, mid), 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            __atomic_store_n(&s->share[id].range, pack(mid, h), __ATOMIC_RELEASE);
+            return 1;
+        }
+    }
+}
+
+/* ── Kernels ────────────────────────────────────────────────────────── */
+
+static inline void hist_add(worker_t *w, int h, double v)
+{
+    int b = v > 0 ? (int)(v / capscan_hist_defs[h].bin_width) : 0;
+    w->hist[h][b < CAPSCAN_HIST_BINS ? b : CAPSCAN_HIST_BINS - 1]++;
+}
+
+/* Mean |a - b| over the first n bytes */
+static double head_diff(const uint8_t *a, const uint8_t *b, uint32_t n)
+{
+    uint32_t sum = 0;
+    for (uint32_t i = 0; i < n; i++) sum += (uint32_t)abs((int)a[i] - (int)b[i]);
+    return n ? (double)sum / n : 0.0;
+}
+
+/* Frame k of file f into a decode buffer other than avoid (compressed) or
+ * straight from the mapping. Returns the frame bytes, NULL if unreadable. */
+static const uint8_t *load(worker_t *w, const capfile_frame_t *fr, int avoid, int *buf, uint32_t *len)
+{
+    if (fr->codec == CAPFILE_CODEC_NONE) {
+        *buf = -1;
+        *len = fr->len;
+        return fr->data;
+    }
+    int b = avoid == 0 ? 1 : 0;
+    if (!w->buf[b] && !(w->buf[b] = malloc(CAPFILE_MAX_FRAME))) return NULL;
+    int n = capfile_decode(fr, w->buf[b], CAPFILE_MAX_FRAME);
+    if (n < 0) return NULL;
+    *buf = b;
+    *len = (uint32_t)n;
+    return w->buf[b];
+}
+
+static void set_prev(prev_t *p, uint64_t g, const capfile_frame_t *fr, const uint8_t *data,
+                     uint32_t len, int buf)
+{
+    p->valid = 1;
+    p->g = g;
+    p->t_ns = fr->t_first_ns;
+    p->buf = buf;
+    if (!data || fr->pix_off > len) {
+        p->pix = NULL;
+        p->pix_len = 0;
+        return;
+    }
+    p->pix = data + fr->pix_off;
+    p->pix_len = len - fr->pix_off;
+}
+
+static void process(worker_t *w, int f, uint64_t k, uint64_t g, prev_t *prev)
+{
+    scan_t *s = w->s;
+    capscan_result_t *r = s->r;
+    capfile_frame_t fr;
+    capfile_frame(s->files[f], k, &fr);
+    r->file[g] = (uint16_t)f;
+    r->frame[g] = k;
+    r->seq[g] = fr.seq;
+    r->t_ns[g] = fr.t_first_ns;
+    r->diff[g] = -1.0f;
+
+    /* The previous frame of this file, unless the last one processed was it */
+    int have_prev = k > 0;
+    if (have_prev && !(prev->valid && prev->g == g - 1)) {
+        capfile_frame_t pf;
+        capfile_frame(s->files[f], k - 1, &pf);
+        int buf;
+        uint32_t len;
+        const uint8_t *d = load(w, &pf, -1, &buf, &len);
+        set_prev(prev, g - 1, &pf, d, len, buf);
+    }
+
+    int buf;
+    uint32_t len;
+    const uint8_t *data = load(w, &fr, have_prev ? prev->buf : -1, &buf, &len);
+    if (!data || fr.pix_off > len) {
+        r->cls[g] = FRAME_CLASS_COUNT;
+        w->class_count[FRAME_CLASS_COUNT]++;
+        set_prev(prev, g, &fr, NULL, 0, -1);
+        return;
+    }
+
+    /* The stats the capture engine computes live, and its classifier */
+    const uint8_t *pix = data + fr.pix_off;
+    uint32_t pix_len = len - fr.pix_off;
+    frame_stats_t *st = &w->scratch.stats;
+    frame_stats_compute(st, pix, pix_len, 0);
+    st->pix_off = fr.pix_off;
+    st->has_meta = fr.pix_off > 0;
+    frame_class_t cls = frame_classify(&w->scratch);
+
+    r->len[g] = len;
+    r->cls[g] = (uint8_t)cls;
+    r->min[g] = st->min;
+    r->max[g] = st->max;
+    r->mean[g] = (float)st->mean;
+    r->head_avg[g] = (uint8_t)st->head_avg;
+    r->nd[g] = (float)st->nd;
+    r->lit[g] = st->mean > s->cfg.lit_avg;
+    w->class_count[cls]++;
+    w->lit_count += r->lit[g];
+    w->bytes += len;
+    hist_add(w, CAPSCAN_H_MEAN, st->mean);
+    hist_add(w, CAPSCAN_H_ND, st->nd);
+
+    if (have_prev) {
+        uint32_t n = pix_len < prev->pix_len ? pix_len : prev->pix_len;
+        if (n > FRAME_STATS_WINDOW) n = FRAME_STATS_WINDOW;
+        if (prev->pix && n) {
+            r->diff[g] = (float)head_diff(pix, prev->pix, n);
+            hist_add(w, CAPSCAN_H_DIFF, r->diff[g]);
+        }
+        if (fr.t_first_ns >= prev->t_ns) hist_add(w, CAPSCAN_H_INTERVAL, (fr.t_first_ns - prev->t_ns) / 1e6);
+    }
+    set_prev(prev, g, &fr, data, len, buf);
+}
+
+static void *worker_thread(void *arg)
+{
+    worker_t *w = arg;
+    scan_t *s = w->s;
+    prev_t prev = { .valid = 0, .buf = -1 };
+    int f = 0;
+    for (;;) {
+        uint32_t lo, hi;
+        if (!take_chunk(s, w->id, &lo, &hi)) {
+            if (!steal_share(s, w->id)) break;
+            w->st.steals++;
+            continue;
+        }
+        uint64_t t0 = clock_ns();
+        for (uint64_t g = lo; g < hi; g++) {
+            /* Global index → file: chunks are ascending, so only ever move on,
+             * except after a steal from further back */
+            if (g < s->base[f]) f = 0;
+            while (g >= s->base[f + 1]) f++;
+            process(w, f, g - s->base[f], g, &prev);
+        }
+        w->st.frames += hi - lo;
+        w->st.chunks++;
+        w->st.busy_ns += clock_ns() - t0;
+    }
+    return NULL;
+}
+
+/* ── Public ─────────────────────────────────────────────────────────── */
+
+static int alloc_columns(capscan_result_t *r, uint64_t n)
+{
+    r->n = n;
+    r->file = calloc(n, sizeof(*r->file));
+    r->frame = calloc(n, sizeof(*r->frame));
+    r->seq = calloc(n, sizeof(*r->seq));
+    r->t_ns = calloc(n, sizeof(*r->t_ns));
+    r->len = calloc(n, sizeof(*r->len));
+    r->cls = calloc(n, sizeof(*r->cls));
+    r->min = calloc(n, sizeof(*r->min));
+    r->max = calloc(n, sizeof(*r->max));
+    r->mean = calloc(n, sizeof(*r->mean));
+    r->head_avg = calloc(n, sizeof(*r->head_avg));
+    r->nd = calloc(n, sizeof(*r->nd));
+    r->diff = calloc(n, sizeof(*r->diff));
+    r->lit = calloc(n, sizeof(*r->lit));
+    return r->file && r->frame && r->seq && r->t_ns && r->len && r->cls && r->min && r->max &&
+           r->mean && r->head_avg && r->nd && r->diff && r->lit ? 0 : -1;
+}
+
+int capscan_run(capfile_t *const *files, int nfiles, const capscan_config_t *cfg,
+                capscan_result_t *out)
+{
+    const capscan_config_t def = CAPSCAN_DEFAULTS;
+    memset(out, 0, sizeof(*out));
+    scan_t s = { .files = files, .nfiles = nfiles, .cfg = cfg ? *cfg : def, .r = out };
+    if (s.cfg.chunk == 0) s.cfg.chunk = def.chunk;
+    if (nfiles > UINT16_MAX + 1) {
+        fprintf(stderr, "[SCAN] At most %d files\n", UINT16_MAX + 1);
+        return -1;
+    }
+
+    s.base = malloc((size_t)(nfiles + 1) * sizeof(*s.base));
+    if (!s.base) return -1;
+    s.base[0] = 0;
+    for (int f = 0; f < nfiles; f++) s.base[f + 1] = s.base[f] + capfile_count(files[f]);
+    uint64_t n = s.base[nfiles];
+    if (n > UINT32_MAX) {
+        fprintf(stderr, "[SCAN] %llu frames: at most %u per run\n", (unsigned long long)n, UINT32_MAX);
+        free(s.base);
+        return -1;
+    }
+    if (alloc_columns(out, n) < 0) {
+        fprintf(stderr, "[SCAN] Cannot allocate results for %llu frames\n", (unsigned long long)n);
+        free(s.base);
+        return -1;
+    }
+
+    int nthr = s.cfg.threads > 0 ? s.cfg.threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthr > CAPSCAN_MAX_THREADS) nthr = CAPSCAN_MAX_THREADS;
+    if ((uint64_t)nthr > n) nthr = (int)n;
+    if (nthr < 1) nthr = 1;
+    s.nthr = nthr;
+    s.share = aligned_alloc(64, (size_t)nthr * sizeof(*s.share));
+    worker_t *w = aligned_alloc(64, (size_t)nthr * sizeof(*w));
+    if (!s.share || !w) {
+        free(s.share);
+        free(w);
+        free(s.base);
+        return -1;
+    }
+    memset(w, 0, (size_t)nthr * sizeof(*w));
+    for (int i = 0; i < nthr; i++)
+        s.share[i].range = pack((uint32_t)(n * i / nthr), (uint32_t)(n * (i + 1) / nthr));
+
+    uint64_t t0 = clock_ns();
+    int started = 0, rc = 0;
+    for (; started < nthr; started++) {
+        w[started].s = &s;
+        w[started].id = started;
+        if (pthread_create(&w[started].thread, NULL, worker_thread, &w[started]) != 0) {
+            perror("[SCAN] pthread_create");
+            break;
+        }
+    }
+    /* A worker that did not start leaves its share to be stolen */
+    if (started == 0) rc = -1;
+    for (int i = 0; i < started; i++) pthread_join(w[i].thread, NULL);
+    out->wall_ns = clock_ns() - t0;
+
+    out->threads = started;
+    for (int i = 0; i < started; i++) {
+        for (int c = 0; c <= FRAME_CLASS_COUNT; c++) out->class_count[c] += w[i].class_count[c];
+        out->lit_count += w[i].lit_count;
+        out->bytes += w[i].bytes;
+        for (int h = 0; h < CAPSCAN_H_COUNT; h++)
+            for (int b = 0; b < CAPSCAN_HIST_BINS; b++) out->hist[h][b] += w[i].hist[h][b];
+        out->worker[i] = w[i].st;
+    }
+    for (int i = 0; i < nthr; i++) {
+        free(w[i].buf[0]);
+        free(w[i].buf[1]);
+    }
+    free(w);
+    free(s.share);
+    free(s.base);
+    return rc;
+}
+
+int capscan_write_csv(const capscan_result_t *r, FILE *out)
+{
+    fprintf(out, "file,frame,seq,t_ns,len,class,min,max,mean,head_avg,nd,diff,lit\n");
+    for (uint64_t i = 0; i < r->n; i++) {
+        const char *cls = r->cls[i] < FRAME_CLASS_COUNT ? frame_class_names[r->cls[i]] : "bad";
+        fprintf(out, "%u,%llu,%llu,%llu,%u,%s,%u,%u,%.2f,%u,%.2f,", r->file[i],
+                (unsigned long long)r->frame[i], (unsigned long long)r->seq[i],
+                (unsigned long long)r->t_ns[i], r->len[i], cls, r->min[i], r->max[i],
+                r->mean[i], r->head_avg[i], r->nd[i]);
+        if (r->diff[i] >= 0) fprintf(out, "%.2f", r->diff[i]);
+        fprintf(out, ",%u\n", r->lit[i]);
+    }
+    return ferror(out) ? -1 : 0;
+}
+
+/* 16 rows of 4 bins, from the first to the last that is not empty; the
+ * bars are scaled to the fullest row */
+static void print_hist(FILE *out, int h, const uint64_t bins[CAPSCAN_HIST_BINS])
+{
+    enum { ROWS = 16, PER = CAPSCAN_HIST_BINS / ROWS, WIDTH = 40 };
+    uint64_t row[ROWS] = { 0 }, top = 0, total = 0;
+    int first = ROWS, last = -1;
+    for (int b = 0; b < CAPSCAN_HIST_BINS; b++) row[b / PER] += bins[b];
+    for (int i = 0; i < ROWS; i++) {
+        if (row[i] > top) top = row[i];
+        if (row[i] && first == ROWS) first = i;
+        if (row[i]) last = i;
+        total += row[i];
+    }
+    if (!total) return;
+    double bw = capscan_hist_defs[h].bin_width * PER;
+    fprintf(out, "\n  %s:\n", capscan_hist_defs[h].name);
+    for (int i = first; i <= last; i++) {
+        char bar[WIDTH + 1];
+        int len = (int)(row[i] * WIDTH / top);
+        memset(bar, '#', (size_t)len);
+        bar[len] = 0;
+        if (i < ROWS - 1) fprintf(out, "    %6.1f-%-6.1f", i * bw, (i + 1) * bw);
+        else fprintf(out, "    %6.1f+      ", i * bw);
+        fprintf(out, " %9llu %5.1f%% %s\n", (unsigned long long)row[i], 100.0 * row[i] / total, bar);
+    }
+}
+
+void capscan_print_summary(const capscan_result_t *r, FILE *out)
+{
+    double secs = r->wall_ns / 1e9;
+    fprintf(out, "%llu frames, %.1f MB in %.3f s on %d thread%s: %.0f frames/s, %.0f MB/s\n",
+            (unsigned long long)r->n, r->bytes / 1048576.0, secs, r->threads,
+            r->threads == 1 ? "" : "s", secs > 0 ? r->n / secs : 0.0,
+            secs > 0 ? r->bytes / 1048576.0 / secs : 0.0);
+    fprintf(out, "  classes:");
+    for (int c = 0; c <= FRAME_CLASS_COUNT; c++)
+        if (r->class_count[c])
+            fprintf(out, " %s %llu (%.1f%%)", c < FRAME_CLASS_COUNT ? frame_class_names[c] : "undecodable",
+                    (unsigned long long)r->class_count[c], r->n ? 100.0 * r->class_count[c] / r->n : 0.0);
+    fprintf(out, "\n  LEDs lit: %llu frames (%.1f%%)\n", (unsigned long long)r->lit_count,
+            r->n ? 100.0 * r->lit_count / r->n : 0.0);
+    for (int h = 0; h < CAPSCAN_H_COUNT; h++) print_hist(out, h, r->hist[h]);
+
+    uint64_t mn = UINT64_MAX, mx = 0;
+    fprintf(out, "\n  workers:\n");
+    for (int i = 0; i < r->threads; i++) {
+        const capscan_worker_stats_t *w = &r->worker[i];
+        fprintf(out, "    [%2d] %9llu frames %6llu chunks %4llu steals  busy %5.1f%%\n", i,
+                (unsigned long long)w->frames, (unsigned long long)w->chunks,
+                (unsigned long long)w->steals, r->wall_ns ? 100.0 * w->busy_ns / r->wall_ns : 0.0);
+        if (w->busy_ns < mn) mn = w->busy_ns;
+        if (w->busy_ns > mx) mx = w->busy_ns;
+    }
+    if (r->threads > 1 && mx)
+        fprintf(out, "    least busy worker at %.0f%% of the busiest\n", 100.0 * mn / mx);
+}
+
+void capscan_result_free(capscan_result_t *r)
+{
+    free(r->file);
+    free(r->frame);
+    free(r->seq);
+    free(r->t_ns);
+    free(r->len);
+    free(r->cls);
+    free(r->min);
+    free(r->max);
+    free(r->mean);
+    free(r->head_avg);
+    free(r->nd);
+    free(r->diff);
+    free(r->lit);
+    memset(r, 0, sizeof(*r));
+}
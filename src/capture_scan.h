@@ -0,0 +1,111 @@
+/*
+ * capture_scan.h — Parallel offline analysis of recorded IR captures
+ *
+ * Runs the per-frame kernels the live pipeline uses — frame_stats (min,
+ * max, mean, head brightness, neighbour difference), frame_classify, the
+ * LED-lit test ir_compare applies — over every frame of one or more
+ * .sqcap files, plus a frame-to-frame difference of the head window,
+ * on all cores at once.
+ *
+ * The files are mapped (capture_file.h) and every frame gets a global
+ * index. Each worker starts with an equal contiguous share and takes
+ * chunks from the front of it; a worker that runs dry steals the back
+ * half of the largest share left. A share is one 64-bit word (lo, hi)
+ * changed only by CAS, so the owner and thieves never lock, and the
+ * chunks a worker takes stay contiguous — compressed files decode each
+ * frame once, the previous frame is already in hand for the difference.
+ *
+ * Results are columns (one array per field, indexed by global frame), so
+ * workers write disjoint slots and the output is the same whatever the
+ * thread count or steal order. Histograms are kept per worker and merged
+ * after the join.
+ *
+ *   capscan_config_t cfg = CAPSCAN_DEFAULTS;
+ *   capscan_result_t r;
+ *   if (capscan_run(files, nfiles, &cfg, &r) == 0) {
+ *       capscan_write_csv(&r, csv);
+ *       capscan_print_summary(&r, stdout);
+ *   }
+ *   capscan_result_free(&r);
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_CAPTURE_SCAN_H
+#define SQUIG_CAPTURE_SCAN_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include "capture_file.h"
+#include "frame_demux.h"
+
+#define CAPSCAN_MAX_THREADS 256
+#define CAPSCAN_HIST_BINS   64
+
+typedef struct {
+    int      threads;           /* 0 = one per online CPU */
+    uint32_t chunk;             /* frames a worker takes at a time */
+    int      lit_avg;           /* mean above this: LEDs on (ir_compare's bright frames) */
+} capscan_config_t;
+
+#define CAPSCAN_DEFAULTS { 0, 64, 50 }
+
+/* Summary histograms, CAPSCAN_HIST_BINS linear bins, the last one open */
+enum { CAPSCAN_H_MEAN, CAPSCAN_H_ND, CAPSCAN_H_DIFF, CAPSCAN_H_INTERVAL, CAPSCAN_H_COUNT };
+
+typedef struct {
+    const char *name;
+    double      bin_width;      /* value units per bin */
+} capscan_hist_def_t;
+
+extern const capscan_hist_def_t capscan_hist_defs[CAPSCAN_H_COUNT];
+
+typedef struct {
+    uint64_t frames;            /* processed */
+    uint64_t chunks;            /* taken from a share */
+    uint64_t steals;            /* shares taken from another worker */
+    uint64_t busy_ns;
+} capscan_worker_stats_t;
+
+typedef struct {
+    uint64_t n;                 /* frames, all files */
+    /* Columns, n entries each */
+    uint16_t *file;             /* index into the files given */
+    uint64_t *frame;            /* index within its file */
+    uint64_t *seq;
+    uint64_t *t_ns;             /* t_first_ns */
+    uint32_t *len;              /* decoded frame bytes */
+    uint8_t  *cls;              /* frame_class_t, FRAME_CLASS_COUNT = undecodable */
+    uint8_t  *min, *max;
+    float    *mean;
+    uint8_t  *head_avg;
+    float    *nd;               /* neighbour difference, first FRAME_STATS_WINDOW bytes */
+    float    *diff;             /* mean |this - previous frame| over the head window, -1 = none */
+    uint8_t  *lit;
+
+    /* Summary */
+    uint64_t class_count[FRAME_CLASS_COUNT + 1];
+    uint64_t lit_count;
+    uint64_t hist[CAPSCAN_H_COUNT][CAPSCAN_HIST_BINS];
+    uint64_t bytes;             /* decoded bytes analysed */
+    int      threads;
+    capscan_worker_stats_t worker[CAPSCAN_MAX_THREADS];
+    uint64_t wall_ns;
+} capscan_result_t;
+
+/* Analyse every frame of files[0..nfiles). cfg may be NULL for
+ * CAPSCAN_DEFAULTS. Returns 0, or -1 with a message (out is then empty
+ * but safe to free). */
+int capscan_run(capfile_t *const *files, int nfiles, const capscan_config_t *cfg,
+                capscan_result_t *out);
+
+/* One row per frame, in file order; "file" is the index into files[]. */
+int capscan_write_csv(const capscan_result_t *r, FILE *out);
+
+/* Class counts, LED duty, the histograms as bars, per-worker balance. */
+void capscan_print_summary(const capscan_result_t *r, FILE *out);
+
+void capscan_result_free(capscan_result_t *r);
+
+#endif /* SQUIG_CAPTURE_SCAN_H */
@@ -0,0 +1,112 @@
+/*
+ * clock_sync.c — Online remote→host clock mapping (min-filter + regression)
+ *
+ * See clock_sync.h. The fit is done on d = host_ns - remote_us·1000
+ * against x = (remote_us - ref_us)·1000, with ref_us the newest bucket's
+ * minimum so the line is most accurate where it is used (now):
+ *
+ *   d ≈ a + b·x      host_ns = remote_us·1000 + a + b·x
+ *
+ * and then lowered by its most negative residual, so every bucket
+ * minimum lies on or above it — the envelope is a lower bound, never a
+ * mapping that makes a delay come out negative.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <string.h>
+#include <math.h>
+#include "clock_sync.h"
+
+void clock_sync_init(clock_sync_t *cs, int bucket_ms, int nbuckets)
+{
+    memset(cs, 0, sizeof(*cs));
+    if (nbuckets < 1) nbuckets = 1;
+    if (nbuckets > CLOCK_SYNC_MAX_BUCKETS) nbuckets = CLOCK_SYNC_MAX_BUCKETS;
+    cs->bucket_ms = bucket_ms > 0 ? bucket_ms : 1000;
+    cs->nbuckets = nbuckets;
+    pthread_mutex_init(&cs->lock, NULL);
+}
+
+void clock_sync_destroy(clock_sync_t *cs)
+{
+    pthread_mutex_destroy(&cs->lock);
+}
+
+static void refit(clock_sync_t *cs)
+{
+    const clock_sync_pair_t *ref = &cs->bucket[cs->head];
+    double sx = 0, sy = 0, sxx = 0, sxy = 0;
+    int n = cs->used;
+    for (int k = 0; k < n; k++) {
+        const clock_sync_pair_t *p = &cs->bucket[(cs->head - k + cs->nbuckets) % cs->nbuckets];
+        double x = (double)(p->remote_us - ref->remote_us) * 1000.0;
+        double y = (double)(p->diff_ns - ref->diff_ns);
+        sx += x;
+        sy += y;
+        sxx += x * x;
+        sxy += x * y;
+    }
+    double a = sy / n, b = 0;
+    double den = n * sxx - sx * sx;
+    if (n >= 2 && den > 0) {
+        b = (n * sxy - sx * sy) / den;
+        a = (sy - b * sx) / n;
+    }
+
+    double low = 0, ss = 0;
+    for (int k = 0; k < n; k++) {
+        const clock_sync_pair_t *p = &cs->bucket[(cs->head - k + cs->nbuckets) % cs->nbuckets];
+        double x = (double)(p->remote_us - ref->remote_us) * 1000.0;
+        double r = (double)(p->diff_ns - ref->diff_ns) - (a + b * x);
+        if (k == 0 || r < low) low = r;
+        ss += r * r;
+    }
+
+    clock_sync_model_t m = cs->model;
+    m.valid = 1;
+    m.buckets = n;
+    m.ref_us = ref->remote_us;
+    m.ref_ns = ref->remote_us * 1000 + ref->diff_ns + (int64_t)llround(a + low);
+    m.rate = b;
+    m.residual_ns = sqrt(ss / n);
+    pthread_mutex_lock(&cs->lock);
+    cs->model = m;
+    pthread_mutex_unlock(&cs->lock);
+}
+
+void clock_sync_add(clock_sync_t *cs, int64_t remote_us, int64_t host_ns)
+{
+    clock_sync_pair_t p = { remote_us, host_ns, host_ns - remote_us * 1000 };
+    int changed = 0;
+    if (!cs->used || host_ns - cs->bucket_start_ns[cs->head] >= (int64_t)cs->bucket_ms * 1000000) {
+        if (cs->used) cs->head = (cs->head + 1) % cs->nbuckets;
+        if (cs->used < cs->nbuckets) cs->used++;
+        cs->bucket[cs->head] = p;
+        cs->bucket_start_ns[cs->head] = host_ns;
+        changed = 1;
+    } else if (p.diff_ns < cs->bucket[cs->head].diff_ns) {
+        cs->bucket[cs->head] = p;
+        changed = 1;
+    }
+    if (changed) refit(cs);
+    pthread_mutex_lock(&cs->lock);
+    cs->model.pairs++;
+    pthread_mutex_unlock(&cs->lock);
+}
+
+int64_t clock_sync_to_host(const clock_sync_t *cs, int64_t remote_us)
+{
+    const clock_sync_model_t *m = &cs->model;
+    if (!m->valid) return 0;
+    double dx = (double)(remote_us - m->ref_us) * 1000.0;
+    return m->ref_ns + (int64_t)llround(dx * (1.0 + m->rate));
+}
+
+void clock_sync_get(clock_sync_t *cs, clock_sync_model_t *out)
+{
+    pthread_mutex_lock(&cs->lock);
+    *out = cs->model;
+    pthread_mutex_unlock(&cs->lock);
+}
@@ -0,0 +1,87 @@
+/*
+ * clock_sync.h — Online remote→host clock mapping (min-filter + regression)
+ *
+ * Maps timestamps from another clock (µs: a device, Stream Engine) onto
+ * this host's CLOCK_MONOTONIC (ns), tracking both offset and drift:
+ *
+ *   host_ns ≈ offset + rate · remote_us
+ *
+ * It is fed pairs (remote_us, host_ns) where host_ns was read at or after
+ * the instant remote_us describes — a clock query answered in between
+ * two host reads (pass the second), or a packet stamped on arrival.
+ * Either way host_ns − remote_us·1000 is the true offset plus a delay
+ * that is never negative, so the pairs with the smallest difference are
+ * the honest ones. The window is cut into buckets (one per bucket_ms);
+ * each keeps only its minimum, and a least-squares line through the
+ * bucket minima gives the lower envelope: offset and rate. Jitter in the
+ * delay, a scheduler hiccup during a query or a backed-up USB queue, only
+ * raises samples above the envelope and never moves it.
+ *
+ * With clock queries the remaining error is the fastest query's round
+ * trip (microseconds). With arrival stamps it is the minimum transport
+ * delay, which no one-way method can see; latencies measured through
+ * such a mapping are relative to the fastest delivery.
+ *
+ *   clock_sync_t cs;
+ *   clock_sync_init(&cs, 1000, 32);               // 1 s buckets, 32 s window
+ *   t0 = now; se_clock(&se_us); t1 = now;
+ *   clock_sync_add(&cs, se_us, t1);
+ *   int64_t host_ns = clock_sync_to_host(&cs, g->timestamp_us);
+ *
+ * One thread feeds and maps; clock_sync_get() snapshots the model from
+ * any thread.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_CLOCK_SYNC_H
+#define SQUIG_CLOCK_SYNC_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#define CLOCK_SYNC_MAX_BUCKETS  64
+
+typedef struct {
+    int     valid;              /* at least one pair seen */
+    int     buckets;            /* bucket minima in the fit */
+    int64_t ref_us;             /* fit origin, remote clock */
+    int64_t ref_ns;             /* host time of ref_us */
+    double  rate;               /* host ns per remote ns - 1, i.e. drift */
+    double  residual_ns;        /* RMS of bucket minima about the line */
+    uint64_t pairs;             /* pairs fed */
+} clock_sync_model_t;
+
+typedef struct {
+    int64_t remote_us;
+    int64_t host_ns;
+    int64_t diff_ns;            /* host_ns - remote_us*1000, minimised */
+} clock_sync_pair_t;
+
+typedef struct {
+    int                bucket_ms;
+    int                nbuckets;
+    clock_sync_pair_t  bucket[CLOCK_SYNC_MAX_BUCKETS];
+    int64_t            bucket_start_ns[CLOCK_SYNC_MAX_BUCKETS];
+    int                head, used;
+    clock_sync_model_t model;   /* feeding thread; copied under lock */
+    pthread_mutex_t    lock;
+} clock_sync_t;
+
+void clock_sync_init(clock_sync_t *cs, int bucket_ms, int nbuckets);
+void clock_sync_destroy(clock_sync_t *cs);
+
+/* Feed one pair. Refits when the pair opens a new bucket (the first pair
+ * included) or lowers the current bucket's minimum; other pairs only
+ * count. */
+void clock_sync_add(clock_sync_t *cs, int64_t remote_us, int64_t host_ns);
+
+/* Map a remote timestamp to host CLOCK_MONOTONIC ns. Returns 0 before
+ * the first pair. Feeding thread only (it reads the live model). */
+int64_t clock_sync_to_host(const clock_sync_t *cs, int64_t remote_us);
+
+/* Copy of the current model, any thread. */
+void clock_sync_get(clock_sync_t *cs, clock_sync_model_t *out);
+
+#endif /* SQUIG_CLOCK_SYNC_H */
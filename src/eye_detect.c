@@ -0,0 +1,773 @@
+/*
+ * eye_detect.c — Pupil / glint / nostril detection (scalar / SSE2 / AVX2 / NEON kernels)
+ *
+ * See eye_detect.h. Pixel coordinates are pixel centres: pixel (x, y)
+ * is at (x, y), so a 2× downsampled pixel h covers 2h and 2h + 1 and
+ * sits at 2h + 0.5.
+ *
+ * Per eye, in a window around the hint:
+ *
+ *   1. 2× downsample, threshold at min + frac · (mean - min), label; pupil
+ *      candidates are the darkest blobs of plausible size that are
+ *      compact (fill their box: not a lash or the lid line). Glint pixels
+ *      are labelled with the dark ones, so a glint on the pupil does not
+ *      cut it up
+ *   2. best candidate first, at full resolution in a box of a few pupil
+ *      radii around it: threshold dark and bright once, label dark for
+ *      the pupil and bright for the glints. The first candidate with
+ *      glints next to it is the eye (an eyebrow has none). Centroids
+ *      weight each pixel by how far it is past the threshold, which is
+ *      what makes them sub-pixel
+ *
+ * Labelling gives up (the frame counts as not found) when a window has
+ * more blobs than the fixed tables hold — that is noise, or a scrambled
+ * frame, not a face.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include "eye_detect.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define EYE_DETECT_X86 1
+#  include <immintrin.h>
+#elif defined(__aarch64__)
+#  define EYE_DETECT_NEON 1
+#  include <arm_neon.h>
+#endif
+
+#define MAX_LABELS      4096        /* provisional labels per window */
+#define MAX_BLOBS       256         /* resolved components per window */
+#define IPD_MM          63.0        /* typical, for the whole-frame pair search */
+#define NEAR_MM         350.0       /* ... over this range of distances */
+#define FAR_MM          1000.0
+
+/* ── Scalar reference ───────────────────────────────────────────────── */
+
+static int usable_always(void) { return 1; }
+
+static inline uint8_t avg_u8(uint8_t a, uint8_t b)
+{
+    return (uint8_t)((a + b + 1) >> 1);
+}
+
+static void scalar_down2(const uint8_t *r0, const uint8_t *r1, int n, uint8_t *dst)
+{
+    for (int i = 0; i < n; i++)
+        dst[i] = avg_u8(avg_u8(r0[2 * i], r1[2 * i]), avg_u8(r0[2 * i + 1], r1[2 * i + 1]));
+}
+
+static void scalar_classify(const uint8_t *src, int n, int dark, int bright, uint8_t *mask)
+{
+    for (int i = 0; i < n; i++)
+        mask[i] = (uint8_t)((src[i] <= dark) | ((src[i] >= bright) << 1));
+}
+
+static const eye_kernels_t k_scalar = {
+    "scalar", usable_always, scalar_down2, scalar_classify
+};
+
+#ifdef EYE_DETECT_X86
+
+/* ── SSE2 ───────────────────────────────────────────────────────────── */
+
+static int usable_sse2(void) { return __builtin_cpu_supports("sse2"); }
+
+/* 16 outputs from 32 bytes of each row: vertical pavgb, then the even and
+ * odd bytes as 16-bit lanes, pavgw (same rounding), pack */
+static void sse2_down2(const uint8_t *r0, const uint8_t *r1, int n, uint8_t *dst)
+{
+    const __m128i lo = _mm_set1_epi16(0x00FF);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i h[2];
+        for (int k = 0; k < 2; k++) {
+            __m128i v = _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(r0 + 2 * i + 16 * k)),
+                                     _mm_loadu_si128((const __m128i *)(r1 + 2 * i + 16 * k)));
+            h[k] = _mm_avg_epu16(_mm_and_si128(v, lo), _mm_srli_epi16(v, 8));
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(h[0], h[1]));
+    }
+    scalar_down2(r0 + 2 * i, r1 + 2 * i, n - i, dst + i);
+}
+
+/* x <= d  <=>  min(x, d) == x;  x >= b  <=>  max(x, b) == x */
+static void sse2_classify(const uint8_t *src, int n, int dark, int bright, uint8_t *mask)
+{
+    const __m128i vd = _mm_set1_epi8((char)dark), vb = _mm_set1_epi8((char)bright);
+    const __m128i one = _mm_set1_epi8(1), two = _mm_set1_epi8(2);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i d = _mm_cmpeq_epi8(_mm_min_epu8(x, vd), x);
+        __m128i b = _mm_cmpeq_epi8(_mm_max_epu8(x, vb), x);
+        _mm_storeu_si128((__m128i *)(mask + i),
+                         _mm_or_si128(_mm_and_si128(d, one), _mm_and_si128(b, two)));
+    }
+    scalar_classify(src + i, n - i, dark, bright, mask + i);
+}
+
+static const eye_kernels_t k_sse2 = {
+    "sse2", usable_sse2, sse2_down2, sse2_classify
+};
+
+/* ── AVX2 ───────────────────────────────────────────────────────────── */
+
+#define AVX2 __attribute__((target("avx2")))
+
+static int usable_avx2(void) { return __builtin_cpu_supports("avx2"); }
+
+/* 32 outputs; packus works per 128-bit lane, so the quadwords come out
+ * as 0 2 1 3 and are put back in order */
+static AVX2 void avx2_down2(const uint8_t *r0, const uint8_t *r1, int n, uint8_t *dst)
+{
+    const __m256i lo = _mm256_set1_epi16(0x00FF);
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i h[2];
+        for (int k = 0; k < 2; k++) {
+            __m256i v = _mm256_avg_epu8(_mm256_loadu_si256((const __m256i *)(r0 + 2 * i + 32 * k)),
+                                        _mm256_loadu_si256((const __m256i *)(r1 + 2 * i + 32 * k)));
+            h[k] = _mm256_avg_epu16(_mm256_and_si256(v, lo), _mm256_srli_epi16(v, 8));
+        }
+        __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi16(h[0], h[1]), 0xD8);
+        _mm256_storeu_si256((__m256i *)(dst + i), p);
+    }
+    /* 16-wide tail here rather than in sse2_down2: no switch between VEX
+     * and legacy SSE code on the short rows of a window */
+    const __m128i lo1 = _mm_set1_epi16(0x00FF);
+    for (; i + 16 <= n; i += 16) {
+        __m128i h[2];
+        for (int k = 0; k < 2; k++) {
+            __m128i v = _mm_avg_epu8(_mm_loadu_si128((const __m128i *)(r0 + 2 * i + 16 * k)),
+                                     _mm_loadu_si128((const __m128i *)(r1 + 2 * i + 16 * k)));
+            h[k] = _mm_avg_epu16(_mm_and_si128(v, lo1), _mm_srli_epi16(v, 8));
+        }
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_packus_epi16(h[0], h[1]));
+    }
+    for (; i < n; i++)
+        dst[i] = avg_u8(avg_u8(r0[2 * i], r1[2 * i]), avg_u8(r0[2 * i + 1], r1[2 * i + 1]));
+}
+
+static AVX2 void avx2_classify(const uint8_t *src, int n, int dark, int bright, uint8_t *mask)
+{
+    const __m256i vd = _mm256_set1_epi8((char)dark), vb = _mm256_set1_epi8((char)bright);
+    const __m256i one = _mm256_set1_epi8(1), two = _mm256_set1_epi8(2);
+    int i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i d = _mm256_cmpeq_epi8(_mm256_min_epu8(x, vd), x);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_max_epu8(x, vb), x);
+        _mm256_storeu_si256((__m256i *)(mask + i),
+                            _mm256_or_si256(_mm256_and_si256(d, one), _mm256_and_si256(b, two)));
+    }
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i d = _mm_cmpeq_epi8(_mm_min_epu8(x, _mm256_castsi256_si128(vd)), x);
+        __m128i b = _mm_cmpeq_epi8(_mm_max_epu8(x, _mm256_castsi256_si128(vb)), x);
+        _mm_storeu_si128((__m128i *)(mask + i),
+                         _mm_or_si128(_mm_and_si128(d, _mm256_castsi256_si128(one)),
+                                      _mm_and_si128(b, _mm256_castsi256_si128(two))));
+    }
+    for (; i < n; i++)
+        mask[i] = (uint8_t)((src[i] <= dark) | ((src[i] >= bright) << 1));
+}
+
+static const eye_kernels_t k_avx2 = {
+    "avx2", usable_avx2, avx2_down2, avx2_classify
+};
+
+#endif /* EYE_DETECT_X86 */
+
+#ifdef EYE_DETECT_NEON
+
+/* ── NEON ───────────────────────────────────────────────────────────── */
+
+/* vld2 splits even / odd bytes; vrhadd is (a + b + 1) >> 1 */
+static void neon_down2(const uint8_t *r0, const uint8_t *r1, int n, uint8_t *dst)
+{
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16x2_t a = vld2q_u8(r0 + 2 * i), c = vld2q_u8(r1 + 2 * i);
+        uint8x16_t even = vrhaddq_u8(a.val[0], c.val[0]);
+        uint8x16_t odd  = vrhaddq_u8(a.val[1], c.val[1]);
+        vst1q_u8(dst + i, vrhaddq_u8(even, odd));
+    }
+    scalar_down2(r0 + 2 * i, r1 + 2 * i, n - i, dst + i);
+}
+
+static void neon_classify(const uint8_t *src, int n, int dark, int bright, uint8_t *mask)
+{
+    const uint8x16_t vd = vdupq_n_u8((uint8_t)dark), vb = vdupq_n_u8((uint8_t)bright);
+    const uint8x16_t one = vdupq_n_u8(1), two = vdupq_n_u8(2);
+    int i = 0;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t x = vld1q_u8(src + i);
+        uint8x16_t m = vorrq_u8(vandq_u8(vcleq_u8(x, vd), one), vandq_u8(vcgeq_u8(x, vb), two));
+        vst1q_u8(mask + i, m);
+    }
+    scalar_classify(src + i, n - i, dark, bright, mask + i);
+}
+
+static const eye_kernels_t k_neon = {
+    "neon", usable_always, neon_down2, neon_classify
+};
+
+#endif /* EYE_DETECT_NEON */
+
+/* ── Dispatch ───────────────────────────────────────────────────────── */
+
+/* Worst to best */
+static const eye_kernels_t *const k_all[] = {
+    &k_scalar,
+#ifdef EYE_DETECT_X86
+    &k_sse2, &k_avx2,
+#endif
+#ifdef EYE_DETECT_NEON
+    &k_neon,
+#endif
+    NULL
+};
+
+static const eye_kernels_t *g_kern;
+
+static const eye_kernels_t *best_kernels(void)
+{
+    const eye_kernels_t *best = &k_scalar;
+    for (int i = 0; k_all[i]; i++)
+        if (k_all[i]->usable()) best = k_all[i];
+    return best;
+}
+
+const eye_kernels_t *eye_detect_kernels(void)
+{
+    const eye_kernels_t *k = __atomic_load_n(&g_kern, __ATOMIC_ACQUIRE);
+    if (!k) {
+        k = best_kernels();
+        __atomic_store_n(&g_kern, k, __ATOMIC_RELEASE);
+    }
+    return k;
+}
+
+const char *eye_detect_backend(void)
+{
+    return eye_detect_kernels()->name;
+}
+
+int eye_detect_select(const char *name)
+{
+    const eye_kernels_t *k = NULL;
+    if (!name) {
+        k = best_kernels();
+    } else {
+        for (int i = 0; k_all[i]; i++)
+            if (strcmp(k_all[i]->name, name) == 0 && k_all[i]->usable()) k = k_all[i];
+    }
+    if (!k) return -1;
+    __atomic_store_n(&g_kern, k, __ATOMIC_RELEASE);
+    return 0;
+}
+
+const eye_kernels_t *const *eye_detect_backends(void)
+{
+    return k_all;
+}
+
+/* ── Detector ───────────────────────────────────────────────────────── */
+
+typedef struct {
+    int x0, y0, w, h;
+} win_t;
+
+typedef struct {
+    int area;
+    int x0, y0, x1, y1;         /* bounding box, inclusive */
+    int sum, nsum;              /* intensity over nsum pixels (the dark ones, if labelled) */
+    double cx, cy;              /* plain centroid */
+} blob_t;
+
+struct eye_detector {
+    eye_detect_config_t cfg;
+    eye_camera_t cam;
+    int       w, h;
+    int       cap;              /* pixels the window buffers hold */
+    uint8_t  *half;             /* 2× downsampled window (or frame) */
+    uint8_t  *quarter;          /* 4× downsampled frame */
+    uint8_t  *mask;
+    uint16_t *label;            /* blob index + 1 after labelling, 0 = background */
+    uint16_t  parent[MAX_LABELS];
+    uint16_t  slot[MAX_LABELS];
+    blob_t    blob[MAX_BLOBS];
+    int       nblob;
+};
+
+eye_detector_t *eye_detect_create(const eye_detect_config_t *cfg, const eye_camera_t *cam,
+                                  int width, int height)
+{
+    static const eye_detect_config_t defaults = EYE_DETECT_DEFAULTS;
+    static const eye_camera_t cam_defaults = EYE_CAMERA_DEFAULTS;
+    if (width < 16 || height < 16) return NULL;
+    eye_detector_t *d = calloc(1, sizeof(*d));
+    if (!d) return NULL;
+    d->cfg = cfg ? *cfg : defaults;
+    d->cam = cam ? *cam : cam_defaults;
+    d->w = width;
+    d->h = height;
+    /* Largest window: the half-size frame, or twice an eye window each way */
+    int roi = 4 * d->cfg.roi_w * d->cfg.roi_h;
+    d->cap = (width / 2) * (height / 2);
+    if (d->cap < roi) d->cap = roi;
+    d->half    = malloc((size_t)d->cap);
+    d->quarter = malloc((size_t)(width / 4) * (height / 4));
+    d->mask    = malloc((size_t)d->cap);
+    d->label   = malloc((size_t)d->cap * sizeof(uint16_t));
+    if (!d->half || !d->quarter || !d->mask || !d->label) {
+        eye_detect_destroy(d);
+        return NULL;
+    }
+    return d;
+}
+
+void eye_detect_destroy(eye_detector_t *d)
+{
+    if (!d) return;
+    free(d->half);
+    free(d->quarter);
+    free(d->mask);
+    free(d->label);
+    free(d);
+}
+
+/* Window of w × h centred on (cx, cy), clipped to the frame; even = 1
+ * keeps the origin and size even for down2. Returns 0, or -1 if too
+ * little is left. */
+static int window_at(const eye_detector_t *d, double cx, double cy, int w, int h, int even, win_t *out)
+{
+    int x0 = (int)floor(cx - 0.5 * w), y0 = (int)floor(cy - 0.5 * h);
+    int x1 = x0 + w, y1 = y0 + h;
+    if (x0 < 0) x0 = 0;
+    if (y0 < 0) y0 = 0;
+    if (x1 > d->w) x1 = d->w;
+    if (y1 > d->h) y1 = d->h;
+    if (even) {
+        x0 = (x0 + 1) & ~1;
+        y0 = (y0 + 1) & ~1;
+        x1 &= ~1;
+        y1 &= ~1;
+    }
+    out->x0 = x0;
+    out->y0 = y0;
+    out->w = x1 - x0;
+    out->h = y1 - y0;
+    return out->w >= 8 && out->h >= 8 && out->w * out->h <= d->cap ? 0 : -1;
+}
+
+static void down2(const eye_kernels_t *k, const uint8_t *src, int stride, int w, int h, uint8_t *dst)
+{
+    for (int y = 0; y + 1 < h; y += 2)
+        k->down2(src + (size_t)y * stride, src + (size_t)(y + 1) * stride, w / 2, dst + (y / 2) * (w / 2));
+}
+
+static void stats(const uint8_t *p, int n, int *mn, double *mean)
+{
+    int m = 255;
+    uint32_t s = 0;
+    for (int i = 0; i < n; i++) {
+        if (p[i] < m) m = p[i];
+        s += p[i];
+    }
+    *mn = m;
+    *mean = n ? (double)s / n : 0;
+}
+
+static inline int level(double v)
+{
+    return v < 0 ? 0 : v > 255 ? 255 : (int)v;
+}
+
+static inline uint16_t find(uint16_t *parent, uint16_t a)
+{
+    while (parent[a] != a) {
+        parent[a] = parent[parent[a]];
+        a = parent[a];
+    }
+    return a;
+}
+
+/* Components of (mask & bit) in a w × h window; img (same window, its
+ * own stride) supplies the intensity sums, over the dark pixels only
+ * when bit includes them (glints labelled in would skew a pupil's).
+ * Fills d->blob and leaves blob index + 1 in d->label. Returns the blob
+ * count, or -1 if the window is too busy to be a face. */
+static int components(eye_detector_t *d, const uint8_t *mask, const uint8_t *img, int istride,
+                      int w, int h, uint8_t bit)
+{
+    uint16_t *lab = d->label, *parent = d->parent;
+    uint16_t next = 1;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int i = y * w + x;
+            if (!(mask[i] & bit)) {
+                lab[i] = 0;
+                continue;
+            }
+            uint16_t l = x > 0 ? lab[i - 1] : 0;
+            uint16_t u = y > 0 ? lab[i - w] : 0;
+            if (!l && !u) {
+                if (next == MAX_LABELS) return -1;
+                parent[next] = next;
+                lab[i] = next++;
+            } else if (l && u && l != u) {
+                uint16_t a = find(parent, l), b = find(parent, u);
+                if (a < b) parent[b] = a; else parent[a] = b;
+                lab[i] = a < b ? a : b;
+            } else {
+                lab[i] = l ? l : u;
+            }
+        }
+    }
+
+    memset(d->slot, 0, next * sizeof(d->slot[0]));
+    int n = 0;
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            int i = y * w + x;
+            if (!lab[i]) continue;
+            uint16_t r = find(parent, lab[i]);
+            if (!d->slot[r]) {
+                if (n == MAX_BLOBS) return -1;
+                d->slot[r] = (uint16_t)++n;
+                d->blob[n - 1] = (blob_t){ 0, x, y, x, y, 0, 0, 0, 0 };
+            }
+            blob_t *b = &d->blob[d->slot[r] - 1];
+            b->area++;
+            if (!(bit & 1) || (mask[i] & 1)) {
+                b->sum += img[(size_t)y * istride + x];
+                b->nsum++;
+            }
+            if (x < b->x0) b->x0 = x;
+            if (x > b->x1) b->x1 = x;
+            if (y > b->y1) b->y1 = y;
+            b->cx += x;
+            b->cy += y;
+            lab[i] = d->slot[r];
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        d->blob[i].cx /= d->blob[i].area;
+        d->blob[i].cy /= d->blob[i].area;
+    }
+    d->nblob = n;
+    return n;
+}
+
+/* Compact: fills at least 45% of its box, aspect under 2.5. A blob of a
+ * few pixels is too small to tell and passes. */
+static int compact(const blob_t *b)
+{
+    if (!b->nsum) return 0;
+    int bw = b->x1 - b->x0 + 1, bh = b->y1 - b->y0 + 1;
+    if (b->area < 6) return bw <= 3 && bh <= 3;
+    return b->area * 100 >= 45 * bw * bh && bw * 2 <= bh * 5 && bh * 2 <= bw * 5;
+}
+
+/* Weighted centroid of blob i of the last labelling (window coordinates).
+ * Dark blobs (fill >= 0): pixels weigh ref + 1 - v, and glints inside
+ * count as pupil at level fill; bright blobs (fill < 0): v - ref + 1. */
+static void centroid(const eye_detector_t *d, const uint8_t *img, int istride, int w, int i,
+                     int ref, int fill, double out[2])
+{
+    const blob_t *b = &d->blob[i];
+    double sw = 0, sx = 0, sy = 0;
+    for (int y = b->y0; y <= b->y1; y++)
+        for (int x = b->x0; x <= b->x1; x++) {
+            if (d->label[y * w + x] != i + 1) continue;
+            int v = img[(size_t)y * istride + x];
+            double wt = fill < 0 ? v - ref + 1 : v > ref ? ref + 1 - fill : ref + 1 - v;
+            sw += wt;
+            sx += wt * x;
+            sy += wt * y;
+        }
+    out[0] = sw > 0 ? sx / sw : b->cx;
+    out[1] = sw > 0 ? sy / sw : b->cy;
+}
+
+static inline double mean_of(const blob_t *b)
+{
+    return b->nsum ? (double)b->sum / b->nsum : 255;
+}
+
+#define EYE_CANDIDATES  3
+
+/* Step 2 for one coarse candidate (centre px, py and radius r, full
+ * resolution). Returns 1 with e filled if a pupil is there. */
+static int refine_eye(eye_detector_t *d, const eye_kernels_t *k, const uint8_t *pix, int stride,
+                      double px, double py, double r, int dark, eye_feature_t *e)
+{
+    const eye_detect_config_t *c = &d->cfg;
+    memset(e, 0, sizeof(*e));
+    int side = (int)(6 * r) + 8;
+    win_t f;
+    if (window_at(d, px, py, side, side, 0, &f) < 0) return 0;
+    const uint8_t *fp = pix + (size_t)f.y0 * stride + f.x0;
+    int mn = 255;
+    for (int y = 0; y < f.h; y++) {
+        double mean;
+        int m;
+        k->classify(fp + (size_t)y * stride, f.w, dark, c->glint_level, d->mask + y * f.w);
+        stats(fp + (size_t)y * stride, f.w, &m, &mean);
+        if (m < mn) mn = m;
+    }
+
+    if (components(d, d->mask, fp, stride, f.w, f.h, 3) <= 0) return 0;
+    int best = -1;
+    for (int i = 0; i < d->nblob; i++) {
+        const blob_t *b = &d->blob[i];
+        if (b->area < c->pupil_min || b->area > c->pupil_max || !b->nsum) continue;
+        if (best < 0 || b->area > d->blob[best].area) best = i;
+    }
+    if (best < 0) return 0;
+    centroid(d, fp, stride, f.w, best, dark, mn, e->pupil);
+    e->pupil_area = d->blob[best].area;
+    double lx = e->pupil[0], ly = e->pupil[1];          /* window coordinates */
+    e->pupil[0] += f.x0;
+    e->pupil[1] += f.y0;
+    e->found = 1;
+
+    /* Glints: the bright blobs nearest the pupil, within ~3 radii */
+    int ng = components(d, d->mask, fp, stride, f.w, f.h, 2);
+    double gd[EYE_DETECT_MAX_GLINTS];
+    int gi[EYE_DETECT_MAX_GLINTS];
+    for (int i = 0; i < ng; i++) {
+        const blob_t *b = &d->blob[i];
+        double dx = b->cx - lx, dy = b->cy - ly, dist = dx * dx + dy * dy;
+        if (b->area > c->glint_max || dist > 9 * r * r + 4) continue;
+        int j;
+        if (e->nglints < EYE_DETECT_MAX_GLINTS) j = e->nglints++;
+        else if (dist < gd[EYE_DETECT_MAX_GLINTS - 1]) j = EYE_DETECT_MAX_GLINTS - 1;
+        else continue;
+        for (; j > 0 && gd[j - 1] > dist; j--) {
+            gd[j] = gd[j - 1];
+            gi[j] = gi[j - 1];
+        }
+        gd[j] = dist;
+        gi[j] = i;
+    }
+    e->cornea[0] = e->pupil[0];
+    e->cornea[1] = e->pupil[1];
+    if (e->nglints) {
+        double sx = 0, sy = 0;
+        for (int j = 0; j < e->nglints; j++) {
+            centroid(d, fp, stride, f.w, gi[j], c->glint_level, -1, e->glint[j]);
+            e->glint[j][0] += f.x0;
+            e->glint[j][1] += f.y0;
+            sx += e->glint[j][0];
+            sy += e->glint[j][1];
+        }
+        e->cornea[0] = sx / e->nglints;
+        e->cornea[1] = sy / e->nglints;
+    }
+    return 1;
+}
+
+/* Pupil and glints near hint. Returns 1 if the pupil was found. */
+static int find_eye(eye_detector_t *d, const eye_kernels_t *k, const uint8_t *pix, int stride,
+                    const double hint[2], eye_feature_t *e)
+{
+    const eye_detect_config_t *c = &d->cfg;
+    memset(e, 0, sizeof(*e));
+    win_t a;
+    if (window_at(d, hint[0], hint[1], c->roi_w, c->roi_h, 1, &a) < 0) return 0;
+
+    /* 1. Coarse: the darkest compact blobs of the 2× downsampled window */
+    int hw = a.w / 2, hh = a.h / 2, mn;
+    double mean;
+    down2(k, pix + (size_t)a.y0 * stride + a.x0, stride, a.w, a.h, d->half);
+    stats(d->half, hw * hh, &mn, &mean);
+    if (mean - mn < 12) return 0;                       /* no contrast: not an eye */
+    int dark = level(mn + c->pupil_frac * (mean - mn));
+    k->classify(d->half, hw * hh, dark, c->glint_level, d->mask);
+    if (components(d, d->mask, d->half, hw, hw, hh, 3) <= 0) return 0;
+    double cand[EYE_CANDIDATES][4];                     /* score, x, y, r */
+    int nc = 0;
+    for (int i = 0; i < d->nblob; i++) {
+        const blob_t *b = &d->blob[i];
+        if (b->area * 4 < c->pupil_min || b->area * 4 > c->pupil_max || !compact(b)) continue;
+        double dx = 2 * b->cx + 0.5 - 0.5 * a.w, dy = 2 * b->cy + 0.5 - 0.5 * a.h;
+        double score = mean_of(b) + 0.1 * sqrt(dx * dx + dy * dy);
+        int j;
+        if (nc < EYE_CANDIDATES) j = nc++;
+        else if (score < cand[EYE_CANDIDATES - 1][0]) j = EYE_CANDIDATES - 1;
+        else continue;
+        for (; j > 0 && cand[j - 1][0] > score; j--) memcpy(cand[j], cand[j - 1], sizeof(cand[j]));
+        cand[j][0] = score;
+        cand[j][1] = a.x0 + 2 * b->cx + 0.5;
+        cand[j][2] = a.y0 + 2 * b->cy + 0.5;
+        cand[j][3] = sqrt(b->area * 4 / M_PI);
+    }
+
+    /* 2. Fine, best first: a pupil with glints next to it wins; one
+     * without is kept only if nothing better turns up */
+    eye_feature_t alt;
+    int have_alt = 0;
+    for (int j = 0; j < nc; j++) {
+        if (!refine_eye(d, k, pix, stride, cand[j][1], cand[j][2], cand[j][3], dark, e)) continue;
+        if (e->nglints) return 1;
+        if (!have_alt) {
+            alt = *e;
+            have_alt = 1;
+        }
+    }
+    if (have_alt) *e = alt;
+    else memset(e, 0, sizeof(*e));
+    return have_alt;
+}
+
+/* Nostrils: the best pair of dark blobs in a window below the eyes,
+ * side by side along the eye line. */
+static int find_nostrils(eye_detector_t *d, const eye_kernels_t *k, const uint8_t *pix, int stride,
+                         eye_features_t *out)
+{
+    const double *l = out->eye[0].cornea, *r = out->eye[1].cornea;
+    double ex = r[0] - l[0], ey = r[1] - l[1], dist = sqrt(ex * ex + ey * ey);
+    if (dist < 8) return 0;
+    ex /= dist;
+    ey /= dist;
+    double nx = -ey, ny = ex;                           /* across the eye line, image down */
+    if (ny < 0) {
+        nx = -nx;
+        ny = -ny;
+    }
+    double mx = 0.5 * (l[0] + r[0]), my = 0.5 * (l[1] + r[1]);
+    int ww = (int)(1.5 * dist), wh = (int)(0.8 * dist);
+    if (ww > 2 * d->cfg.roi_w) ww = 2 * d->cfg.roi_w;
+    if (wh > 2 * d->cfg.roi_h) wh = 2 * d->cfg.roi_h;
+    win_t f;
+    if (window_at(d, mx + 0.8 * dist * nx, my + 0.8 * dist * ny, ww, wh, 0, &f) < 0) return 0;
+
+    const uint8_t *fp = pix + (size_t)f.y0 * stride + f.x0;
+    int mn = 255;
+    uint32_t sum = 0;
+    for (int y = 0; y < f.h; y++) {
+        int m;
+        double mean;
+        stats(fp + (size_t)y * stride, f.w, &m, &mean);
+        if (m < mn) mn = m;
+        sum += (uint32_t)(mean * f.w + 0.5);
+    }
+    double mean = (double)sum / (f.w * f.h);
+    if (mean - mn < 12) return 0;
+    int dark = level(mn + d->cfg.pupil_frac * (mean - mn));
+    for (int y = 0; y < f.h; y++)
+        k->classify(fp + (size_t)y * stride, f.w, dark, 255, d->mask + y * f.w);
+    if (components(d, d->mask, fp, stride, f.w, f.h, 1) < 2) return 0;
+
+    double amax = 0.04 * dist * dist;
+    int bi = -1, bj = -1;
+    double best = 0;
+    for (int i = 0; i < d->nblob; i++) {
+        const blob_t *a = &d->blob[i];
+        if (a->area < 2 || a->area > amax) continue;
+        for (int j = i + 1; j < d->nblob; j++) {
+            const blob_t *b = &d->blob[j];
+            if (b->area < 2 || b->area > amax) continue;
+            double dx = b->cx - a->cx, dy = b->cy - a->cy;
+            double along = fabs(dx * ex + dy * ey), across = fabs(dx * nx + dy * ny);
+            if (along < 0.12 * dist || along > 0.5 * dist || across > 0.25 * along) continue;
+            /* Darkest pair, centred under the eyes */
+            double cx = f.x0 + 0.5 * (a->cx + b->cx) - mx, cy = f.y0 + 0.5 * (a->cy + b->cy) - my;
+            double off = fabs(cx * ex + cy * ey) / dist;
+            double score = (double)(a->sum + b->sum) / (a->area + b->area) + 50 * off;
+            if (bi < 0 || score < best) {
+                bi = i;
+                bj = j;
+                best = score;
+            }
+        }
+    }
+    if (bi < 0) return 0;
+    double p[2][2];
+    centroid(d, fp, stride, f.w, bi, dark, mn, p[0]);
+    centroid(d, fp, stride, f.w, bj, dark, mn, p[1]);
+    int s = p[0][0] > p[1][0];
+    for (int q = 0; q < 2; q++) {
+        out->nostril[q][0] = p[q ^ s][0] + f.x0;
+        out->nostril[q][1] = p[q ^ s][1] + f.y0;
+    }
+    out->nostril_mid[0] = 0.5 * (out->nostril[0][0] + out->nostril[1][0]);
+    out->nostril_mid[1] = 0.5 * (out->nostril[0][1] + out->nostril[1][1]);
+    out->nostrils_found = 1;
+    return 1;
+}
+
+/* No hint: the whole frame at 4×, the darkest compact pair at a
+ * plausible eye separation. Returns 0 with hint filled, or -1. */
+static int search_frame(eye_detector_t *d, const eye_kernels_t *k, const uint8_t *pix, int stride,
+                        double hint[2][2])
+{
+    int hw = d->w / 2, hh = d->h / 2, qw = hw / 2, qh = hh / 2, mn;
+    double mean;
+    down2(k, pix, stride, hw * 2, hh * 2, d->half);
+    down2(k, d->half, hw, qw * 2, qh * 2, d->quarter);
+    stats(d->quarter, qw * qh, &mn, &mean);
+    if (mean - mn < 12) return -1;
+    int dark = level(mn + d->cfg.pupil_frac * (mean - mn));
+    k->classify(d->quarter, qw * qh, dark, 255, d->mask);
+    if (components(d, d->mask, d->quarter, qw, qw, qh, 1) < 2) return -1;
+
+    double sep_min = d->cam.fx * IPD_MM / FAR_MM / 4, sep_max = d->cam.fx * IPD_MM / NEAR_MM / 4;
+    int amax = d->cfg.pupil_max / 16 + 2;
+    int bi = -1, bj = -1;
+    double best = 0;
+    for (int i = 0; i < d->nblob; i++) {
+        const blob_t *a = &d->blob[i];
+        if (a->area > amax || !compact(a)) continue;
+        for (int j = i + 1; j < d->nblob; j++) {
+            const blob_t *b = &d->blob[j];
+            if (b->area > amax || !compact(b)) continue;
+            double dx = fabs(b->cx - a->cx), dy = fabs(b->cy - a->cy);
+            if (dx < sep_min || dx > sep_max || dy > 0.3 * dx) continue;
+            double score = (double)(a->sum + b->sum) / (a->area + b->area);
+            if (bi < 0 || score < best) {
+                bi = i;
+                bj = j;
+                best = score;
+            }
+        }
+    }
+    if (bi < 0) return -1;
+    /* The user's left eye (-X) is image right unless the image is mirrored */
+    const blob_t *a = &d->blob[bi], *b = &d->blob[bj];
+    if ((a->cx > b->cx) == !!d->cam.mirror) {
+        const blob_t *t = a;
+        a = b;
+        b = t;
+    }
+    hint[0][0] = 4 * a->cx + 1.5;
+    hint[0][1] = 4 * a->cy + 1.5;
+    hint[1][0] = 4 * b->cx + 1.5;
+    hint[1][1] = 4 * b->cy + 1.5;
+    return 0;
+}
+
+int eye_detect_frame(eye_detector_t *d, const uint8_t *pix, int stride,
+                     const double hint[2][2], eye_features_t *out)
+{
+    const eye_kernels_t *k = eye_detect_kernels();
+    double h[2][2];
+    memset(out, 0, sizeof(*out));
+    if (!hint) {
+        out->searched = 1;
+        if (search_frame(d, k, pix, stride, h) < 0) return 0;
+        hint = (const double (*)[2])h;
+    }
+    int n = 0;
+    for (int e = 0; e < 2; e++) n += find_eye(d, k, pix, stride, hint[e], &out->eye[e]);
+    if (n == 2 && d->cfg.nostrils) find_nostrils(d, k, pix, stride, out);
+    return n;
+}
@@ -0,0 +1,165 @@
+/*
+ * eye_detect.h — Pupils, LED glints and nostrils in an IR frame
+ *
+ * gaze_origin gives two points per sample, and two points cannot tell
+ * pitch from pivot translation (head_ekf.h): the EKF's pitch is a prior
+ * pulled toward zero. The IR camera sees more of the face than that.
+ * This finds, in one 8-bit frame:
+ *
+ *   pupils    darkest compact blob in a window around each eye
+ *   glints    the LEDs' corneal reflections next to each pupil; their
+ *             centroid marks the cornea, which (unlike the pupil) does
+ *             not move with gaze
+ *   nostrils  the two dark blobs below the eye pair; their midpoint sits
+ *             below and in front of the eyes, so its height against the
+ *             eye line foreshortens with pitch (head_vision.h)
+ *
+ * The search is cheap because it is local: the eye positions the EKF (or
+ * the last gaze sample) predicts are projected into the image
+ * (eye_camera_t) and only a window around each is looked at, first 2×
+ * downsampled to find the pupil, then at full resolution for sub-pixel
+ * centroids (intensity-weighted, so they move smoothly with the head).
+ * With no prediction the whole frame is searched at 4× downsampling for
+ * a plausible pupil pair. Thresholds come from each window's own
+ * statistics, so exposure changes do not matter.
+ *
+ * Downsampling and thresholding (the only per-pixel work) have scalar,
+ * SSE2, AVX2 and NEON kernels picked like ir_render.h's; all backends
+ * are bit-identical. Connected components are 4-connected, two-pass with
+ * union-find, on fixed buffers allocated at create time.
+ *
+ *   eye_camera_t cam = EYE_CAMERA_DEFAULTS;
+ *   eye_detector_t *d = eye_detect_create(NULL, &cam, 642, 480);
+ *   double hint[2][2];                          // user's left, right eye
+ *   int have = eye_camera_project(&cam, left, hint[0]) == 0 &&
+ *              eye_camera_project(&cam, right, hint[1]) == 0;
+ *   eye_features_t e;
+ *   eye_detect_frame(d, pix, 642, have ? hint : NULL, &e);
+ *   eye_detect_destroy(d);
+ *
+ * Frames the firmware scrambles (README, section 3) simply yield nothing.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_EYE_DETECT_H
+#define SQUIG_EYE_DETECT_H
+
+#include <stdint.h>
+#include <math.h>
+
+/* ── Camera ─────────────────────────────────────────────────────────── */
+
+/* Pinhole model of the IR camera in tracker coordinates (head_ekf.h: mm,
+ * +X right, +Y up, +Z toward the user): at the tracker origin, looking
+ * at the user, tilted up by tilt. The defaults are nominal for the 642 ×
+ * 480 IS5 stream, not a calibration; the detector only needs them good
+ * to a few pixels, head_vision.h to a few percent. */
+typedef struct {
+    double fx, fy;              /* focal length, px */
+    double cx, cy;              /* principal point, px */
+    double tilt;                /* optical axis above the tracker's +Z, rad */
+    int    mirror;              /* image x grows with +X (else the user's right is image left) */
+} eye_camera_t;
+
+#define EYE_CAMERA_DEFAULTS { 900.0, 900.0, 321.0, 240.0, 0.28, 0 }
+
+/* Point (mm, tracker axes) → pixel. Returns 0, or -1 behind the camera. */
+static inline int eye_camera_project(const eye_camera_t *c, const double p[3], double uv[2])
+{
+    double ct = cos(c->tilt), st = sin(c->tilt);
+    double y = p[1] * ct - p[2] * st;
+    double z = p[1] * st + p[2] * ct;
+    if (z <= 1.0) return -1;
+    uv[0] = c->cx + (c->mirror ? 1 : -1) * c->fx * p[0] / z;
+    uv[1] = c->cy - c->fy * y / z;
+    return 0;
+}
+
+/* Pixel → point at tracker depth z (mm) on its ray. */
+static inline void eye_camera_unproject(const eye_camera_t *c, const double uv[2], double z, double p[3])
+{
+    double ct = cos(c->tilt), st = sin(c->tilt);
+    double xc = (c->mirror ? 1 : -1) * (uv[0] - c->cx) / c->fx;
+    double yc = -(uv[1] - c->cy) / c->fy;
+    double d[3] = { xc, yc * ct + st, -yc * st + ct };
+    double s = d[2] > 1e-6 ? z / d[2] : 0;
+    for (int k = 0; k < 3; k++) p[k] = d[k] * s;
+}
+
+/* ── Detector ───────────────────────────────────────────────────────── */
+
+#define EYE_DETECT_MAX_GLINTS   4
+
+typedef struct {
+    int    roi_w, roi_h;        /* eye window around a hint, px (full resolution) */
+    int    pupil_min, pupil_max;    /* pupil area, px */
+    double pupil_frac;          /* dark threshold: min + frac · (mean - min) of the window */
+    int    glint_level;         /* glint threshold, 0-255 */
+    int    glint_max;           /* glint area, px */
+    int    nostrils;            /* also look for the nostrils */
+} eye_detect_config_t;
+
+#define EYE_DETECT_DEFAULTS { 96, 64, 6, 400, 0.35, 220, 40, 1 }
+
+typedef struct {
+    int    found;
+    double pupil[2];            /* px, sub-pixel */
+    int    pupil_area;
+    int    nglints;
+    double glint[EYE_DETECT_MAX_GLINTS][2];
+    double cornea[2];           /* mean of the glints (the pupil when there are none) */
+} eye_feature_t;
+
+typedef struct {
+    eye_feature_t eye[2];       /* user's left, right (as head_ekf.h's eyes) */
+    int    nostrils_found;
+    double nostril[2][2];       /* image left, right blob */
+    double nostril_mid[2];
+    int    searched;            /* 0 = windows around the hints, 1 = whole frame */
+} eye_features_t;
+
+typedef struct eye_detector eye_detector_t;
+
+/* cfg NULL = EYE_DETECT_DEFAULTS. The camera is copied (it decides which
+ * image side is the user's left). Returns NULL on failure. */
+eye_detector_t *eye_detect_create(const eye_detect_config_t *cfg, const eye_camera_t *cam,
+                                  int width, int height);
+void            eye_detect_destroy(eye_detector_t *d);
+
+/* Detect in an 8-bit frame of the create-time size (stride bytes per
+ * row). hint: predicted pixel positions of the user's left and right
+ * eye, or NULL to search the whole frame. Returns the eyes found (0-2);
+ * out is always filled. */
+int eye_detect_frame(eye_detector_t *d, const uint8_t *pix, int stride,
+                     const double hint[2][2], eye_features_t *out);
+
+/* ── Kernels ────────────────────────────────────────────────────────── */
+
+/* One backend's per-pixel kernels.
+ *   down2     n output pixels from two rows of 2n: avg(avg(a, c), avg(b, d))
+ *             for the 2×2 block a b / c d, with avg(x, y) = (x + y + 1) >> 1
+ *             (what pavgb / vrhadd compute)
+ *   classify  mask[i] = (src[i] <= dark) | (src[i] >= bright) << 1 */
+typedef struct {
+    const char *name;
+    int  (*usable)(void);
+    void (*down2)(const uint8_t *r0, const uint8_t *r1, int n, uint8_t *dst);
+    void (*classify)(const uint8_t *src, int n, int dark, int bright, uint8_t *mask);   /* levels 0-255 */
+} eye_kernels_t;
+
+/* Kernels in use (the best usable backend on first call). */
+const eye_kernels_t *eye_detect_kernels(void);
+
+/* Name of the backend in use: "scalar", "sse2", "avx2" or "neon". */
+const char *eye_detect_backend(void);
+
+/* Force a backend by name (NULL = best available again).
+ * Returns 0, or -1 if it is unknown or not supported on this CPU. */
+int eye_detect_select(const char *name);
+
+/* All backends compiled in, usable or not, NULL-terminated (benchmarks). */
+const eye_kernels_t *const *eye_detect_backends(void);
+
+#endif /* SQUIG_EYE_DETECT_H */
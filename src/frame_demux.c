@@ -0,0 +1,143 @@
+/*
+ * frame_demux.c — Route reassembled IR frames to per-type queues
+ *
+ * See frame_demux.h. The producer is the only writer of the counters
+ * (relaxed atomics, read by anyone for the title bar); each class's ring
+ * has the producer on one side and that class's consumer on the other.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "frame_demux.h"
+#include "spsc_ring.h"
+
+#define STAT_ADD(x, n)  __atomic_store_n(&(x), (x) + (n), __ATOMIC_RELAXED)
+#define STAT_SET(x, v)  __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#define STAT_LOAD(x)    __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+#define RATE_SHIFT      3       /* interval EWMA weight 1/8 */
+
+const char *const frame_class_names[FRAME_CLASS_COUNT] = {
+    "gray8", "interleaved", "meta", "runt",
+};
+
+typedef struct {
+    spsc_ring_t q;
+    int         enabled;
+
+    /* Producer-written counters */
+    uint64_t frames, bytes, with_meta, queued, drop_full, unrouted;
+    uint32_t len_min, len_max, len_last;
+    uint64_t last_ns;           /* t_last_ns of the previous frame */
+    uint64_t interval_ns;       /* smoothed, 0 until two frames */
+} demux_class_t;
+
+struct frame_demux {
+    demux_class_t cls[FRAME_CLASS_COUNT];
+};
+
+frame_demux_t *frame_demux_create(int queue_depth)
+{
+    frame_demux_t *dm = calloc(1, sizeof(*dm));
+    if (!dm) return NULL;
+    for (int c = 0; c < FRAME_CLASS_COUNT; c++) {
+        if (spsc_ring_init(&dm->cls[c].q, queue_depth > 0 ? (uint32_t)queue_depth : 1,
+                           sizeof(frame_t *)) < 0) {
+            frame_demux_destroy(dm);
+            return NULL;
+        }
+        dm->cls[c].len_min = UINT32_MAX;
+    }
+    return dm;
+}
+
+void frame_demux_destroy(frame_demux_t *dm)
+{
+    if (!dm) return;
+    for (int c = 0; c < FRAME_CLASS_COUNT; c++) {
+        frame_t *f;
+        if (dm->cls[c].q.buf)
+            while (spsc_ring_pop(&dm->cls[c].q, &f) == 0) frame_unref(f);
+        spsc_ring_free(&dm->cls[c].q);
+    }
+    free(dm);
+}
+
+void frame_demux_enable(frame_demux_t *dm, frame_class_t cls, int on)
+{
+    if (cls == FRAME_CLASS_RUNT) return;
+    __atomic_store_n(&dm->cls[cls].enabled, on ? 1 : 0, __ATOMIC_RELAXED);
+}
+
+/* ── Producer ───────────────────────────────────────────────────────── */
+
+static void account(demux_class_t *k, const frame_t *f)
+{
+    STAT_ADD(k->frames, 1);
+    STAT_ADD(k->bytes, f->len);
+    if (f->stats.has_meta) STAT_ADD(k->with_meta, 1);
+    if (f->len < k->len_min) STAT_SET(k->len_min, f->len);
+    if (f->len > k->len_max) STAT_SET(k->len_max, f->len);
+    STAT_SET(k->len_last, f->len);
+
+    if (k->last_ns && f->t_last_ns > k->last_ns) {
+        uint64_t dt = f->t_last_ns - k->last_ns;
+        uint64_t iv = k->interval_ns;
+        STAT_SET(k->interval_ns, iv ? iv - (iv >> RATE_SHIFT) + (dt >> RATE_SHIFT) : dt);
+    }
+    k->last_ns = f->t_last_ns;
+}
+
+frame_class_t frame_demux_route(frame_demux_t *dm, frame_t *f)
+{
+    frame_class_t cls = frame_classify(f);
+    demux_class_t *k = &dm->cls[cls];
+    account(k, f);
+
+    if (!__atomic_load_n(&k->enabled, __ATOMIC_RELAXED)) {
+        STAT_ADD(k->unrouted, 1);
+        return cls;
+    }
+    frame_t *ref = frame_ref(f);
+    if (spsc_ring_push(&k->q, &ref) < 0) {
+        STAT_ADD(k->drop_full, 1);
+        frame_unref(ref);
+        return cls;
+    }
+    STAT_ADD(k->queued, 1);
+    return cls;
+}
+
+/* ── Consumers ──────────────────────────────────────────────────────── */
+
+frame_t *frame_demux_next(frame_demux_t *dm, frame_class_t cls, int timeout_ms)
+{
+    frame_t *f = NULL;
+    return spsc_ring_pop_wait(&dm->cls[cls].q, &f, timeout_ms) == 0 ? f : NULL;
+}
+
+void frame_demux_wake(frame_demux_t *dm, frame_class_t cls)
+{
+    spsc_ring_wake(&dm->cls[cls].q);
+}
+
+void frame_demux_get_stats(frame_demux_t *dm, frame_class_t cls, frame_class_stats_t *out)
+{
+    demux_class_t *k = &dm->cls[cls];
+    out->frames    = STAT_LOAD(k->frames);
+    out->bytes     = STAT_LOAD(k->bytes);
+    out->with_meta = STAT_LOAD(k->with_meta);
+    out->queued    = STAT_LOAD(k->queued);
+    out->drop_full = STAT_LOAD(k->drop_full);
+    out->unrouted  = STAT_LOAD(k->unrouted);
+    uint32_t lo = STAT_LOAD(k->len_min);
+    out->len_min   = lo == UINT32_MAX ? 0 : lo;
+    out->len_max   = STAT_LOAD(k->len_max);
+    out->len_last  = STAT_LOAD(k->len_last);
+    uint64_t iv = STAT_LOAD(k->interval_ns);
+    out->rate_hz   = iv ? 1e9 / (double)iv : 0.0;
+    out->depth     = (int)spsc_ring_count(&k->q);
+}
@@ -0,0 +1,93 @@
+/*
+ * frame_demux.h — Route reassembled IR frames to per-type queues
+ *
+ * The ET5 interleaves several kinds of sub-frame on one bulk stream
+ * (ir_viewer.c): smooth 8-bit planes, interleaved dual-channel frames
+ * and short metadata payloads. Rather than every consumer pulling the
+ * whole stream and skipping what it cannot decode, the stage that owns
+ * the source hands each frame to frame_demux_route(), which classifies
+ * it from the frame_stats the capture engine already gathered (no pass
+ * over the pixels) and pushes it onto that class's own lock-free SPSC
+ * ring. Each class has exactly one consumer thread, which only ever sees
+ * frames of its type.
+ *
+ * A class nobody consumes is counted and released on the spot, so it
+ * never holds a pool slot; enable a class before its consumer starts.
+ * Per-class rates and sizes are tracked either way.
+ *
+ *   frame_demux_t *dm = frame_demux_create(4);
+ *   frame_demux_enable(dm, FRAME_CLASS_GRAY8, 1);
+ *   frame_demux_route(dm, f);                   // producer, then frame_unref(f)
+ *   frame_t *g = frame_demux_next(dm, FRAME_CLASS_GRAY8, 100);  // consumer
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_FRAME_DEMUX_H
+#define SQUIG_FRAME_DEMUX_H
+
+#include <stdint.h>
+#include "frame_pool.h"
+#include "tobii_framing.h"
+
+typedef enum {
+    FRAME_CLASS_GRAY8,          /* smooth 8-bit plane (a metadata prefix, if any, is at pix_off) */
+    FRAME_CLASS_INTERLEAVED,    /* alternating high/low bytes (stripe pattern) */
+    FRAME_CLASS_META,           /* 10-byte metadata header with no image behind it */
+    FRAME_CLASS_RUNT,           /* too short to be either: counted, never queued */
+    FRAME_CLASS_COUNT
+} frame_class_t;
+
+extern const char *const frame_class_names[FRAME_CLASS_COUNT];
+
+/* Class of a finished frame, from its stats alone. */
+static inline frame_class_t frame_classify(const frame_t *f)
+{
+    const frame_stats_t *st = &f->stats;
+    if (st->pix_len < TOBII_MIN_FRAGMENT)
+        return st->has_meta ? FRAME_CLASS_META : FRAME_CLASS_RUNT;
+    return frame_stats_interleaved(st) ? FRAME_CLASS_INTERLEAVED : FRAME_CLASS_GRAY8;
+}
+
+typedef struct {
+    uint64_t frames;            /* classified as this type */
+    uint64_t bytes;             /* their frame_t.len */
+    uint64_t with_meta;         /* ... of which carried a metadata header */
+    uint64_t queued;            /* handed to the class consumer */
+    uint64_t drop_full;         /* consumer queue was full */
+    uint64_t unrouted;          /* no consumer enabled: released at once */
+    uint32_t len_min, len_max, len_last;
+    double   rate_hz;           /* smoothed arrival rate (capture clock) */
+    int      depth;             /* queued right now */
+} frame_class_stats_t;
+
+typedef struct frame_demux frame_demux_t;
+
+/* queue_depth: frames each class may have waiting (rounded up to 2^n).
+ * All classes start disabled. Returns NULL on failure. */
+frame_demux_t *frame_demux_create(int queue_depth);
+
+/* Drop whatever is still queued and free. Consumers must have stopped. */
+void frame_demux_destroy(frame_demux_t *dm);
+
+/* Route (any thread) class cls to its queue, or stop doing so. Frames
+ * already queued stay there for the consumer to drain. */
+void frame_demux_enable(frame_demux_t *dm, frame_class_t cls, int on);
+
+/* Producer (one thread): classify f and queue a reference to it for its
+ * class consumer. The caller keeps its own reference. Returns the class. */
+frame_class_t frame_demux_route(frame_demux_t *dm, frame_t *f);
+
+/* Consumer of cls (one thread per class): the next frame of that class,
+ * waiting up to timeout_ms. The caller owns the reference. NULL on
+ * timeout or frame_demux_wake(). */
+frame_t *frame_demux_next(frame_demux_t *dm, frame_class_t cls, int timeout_ms);
+
+/* Wake cls's consumer even though nothing was queued (shutdown). */
+void frame_demux_wake(frame_demux_t *dm, frame_class_t cls);
+
+/* Snapshot of one class's counters (any thread). */
+void frame_demux_get_stats(frame_demux_t *dm, frame_class_t cls, frame_class_stats_t *out);
+
+#endif /* SQUIG_FRAME_DEMUX_H */
@@ -0,0 +1,68 @@
+/*
+ * frame_mailbox.h — "Latest frame wins" single-slot handoff
+ *
+ * The display only ever wants the newest frame. Posting swaps the new
+ * frame into the slot and drops the reference to whatever was still
+ * sitting there unseen; taking swaps the slot with NULL. Both are one
+ * atomic exchange, so the producer never waits for a slow (vsync-bound)
+ * consumer and the consumer never sees a stale frame.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_FRAME_MAILBOX_H
+#define SQUIG_FRAME_MAILBOX_H
+
+#include "frame_pool.h"
+#include "spsc_ring.h"
+
+typedef struct {
+    frame_t  *slot;
+    uint32_t  seq;          /* bumped per post; the futex word */
+    uint32_t  waiting;
+    uint64_t  posted;
+    uint64_t  dropped;      /* overwritten before the consumer took them */
+} frame_mailbox_t;
+
+/* Producer: publish f (ownership of the caller's reference moves in). */
+static inline void frame_mailbox_post(frame_mailbox_t *mb, frame_t *f)
+{
+    frame_t *old = __atomic_exchange_n(&mb->slot, f, __ATOMIC_ACQ_REL);
+    if (old) {
+        frame_unref(old);
+        __atomic_fetch_add(&mb->dropped, 1, __ATOMIC_RELAXED);
+    }
+    __atomic_fetch_add(&mb->posted, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&mb->seq, 1, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&mb->waiting, __ATOMIC_RELAXED))
+        spsc_futex(&mb->seq, FUTEX_WAKE_PRIVATE, 1, NULL);
+}
+
+/* Consumer: take the newest frame (caller owns the reference) or NULL. */
+static inline frame_t *frame_mailbox_take(frame_mailbox_t *mb)
+{
+    return __atomic_exchange_n(&mb->slot, NULL, __ATOMIC_ACQ_REL);
+}
+
+/* Consumer: sleep until something is posted or timeout_ms elapses. */
+static inline void frame_mailbox_wait(frame_mailbox_t *mb, int timeout_ms)
+{
+    uint32_t seen = __atomic_load_n(&mb->seq, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&mb->waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&mb->slot, __ATOMIC_ACQUIRE)) {
+        struct timespec ts = { timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L };
+        spsc_futex(&mb->seq, FUTEX_WAIT_PRIVATE, seen, &ts);
+    }
+    __atomic_store_n(&mb->waiting, 0, __ATOMIC_RELAXED);
+}
+
+/* Drop whatever is still in the slot (shutdown). */
+static inline void frame_mailbox_clear(frame_mailbox_t *mb)
+{
+    frame_unref(frame_mailbox_take(mb));
+}
+
+#endif /* SQUIG_FRAME_MAILBOX_H */
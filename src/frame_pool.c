@@ -0,0 +1,130 @@
+/*
+ * frame_pool.c — Preallocated, reference-counted IR frame buffers
+ *
+ * The free list is a Treiber stack of slot indices. The head word packs
+ * a 32-bit ABA tag above the 32-bit index, so push/pop is a single 64-bit
+ * CAS with no lock between the capture thread and the consumers.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame_pool.h"
+
+#define NIL_INDEX 0xFFFFFFFFu
+
+struct frame_pool {
+    uint64_t  head;         /* (tag << 32) | index of first free slot */
+    int       nslots;
+    int       nfree;
+    size_t    slot_size;
+    uint32_t *next;         /* free-list links, one per slot */
+    frame_t  *frames;
+    uint8_t  *mem;
+};
+
+static void push_free(frame_pool_t *pool, uint32_t idx)
+{
+    uint64_t old = __atomic_load_n(&pool->head, __ATOMIC_RELAXED), nw;
+    do {
+        pool->next[idx] = (uint32_t)old;
+        nw = ((old >> 32) + 1) << 32 | idx;
+    } while (!__atomic_compare_exchange_n(&pool->head, &old, nw, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    __atomic_fetch_add(&pool->nfree, 1, __ATOMIC_RELAXED);
+}
+
+static uint32_t pop_free(frame_pool_t *pool)
+{
+    uint64_t old = __atomic_load_n(&pool->head, __ATOMIC_ACQUIRE), nw;
+    do {
+        uint32_t idx = (uint32_t)old;
+        if (idx == NIL_INDEX) return NIL_INDEX;
+        nw = ((old >> 32) + 1) << 32 | pool->next[idx];
+    } while (!__atomic_compare_exchange_n(&pool->head, &old, nw, 1,
+                                          __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE));
+    __atomic_fetch_sub(&pool->nfree, 1, __ATOMIC_RELAXED);
+    return (uint32_t)old;
+}
+
+frame_pool_t *frame_pool_create(int nslots, size_t slot_size)
+{
+    if (nslots <= 0 || slot_size == 0) return NULL;
+    frame_pool_t *pool = calloc(1, sizeof(*pool));
+    if (!pool) return NULL;
+
+    slot_size = (slot_size + FRAME_ALIGN - 1) & ~(size_t)(FRAME_ALIGN - 1);
+    pool->nslots    = nslots;
+    pool->slot_size = slot_size;
+    pool->head      = NIL_INDEX;
+    pool->next      = calloc(nslots, sizeof(*pool->next));
+    pool->frames    = aligned_alloc(FRAME_ALIGN, sizeof(frame_t) * nslots);
+    pool->mem       = aligned_alloc(FRAME_ALIGN, slot_size * nslots);
+    if (!pool->next || !pool->frames || !pool->mem) {
+        perror("[POOL] alloc");
+        frame_pool_destroy(pool);
+        return NULL;
+    }
+    memset(pool->frames, 0, sizeof(frame_t) * nslots);
+
+    for (int i = nslots - 1; i >= 0; i--) {
+        frame_t *f = &pool->frames[i];
+        f->index = (uint32_t)i;
+        f->pool  = pool;
+        f->cap   = (uint32_t)slot_size;
+        f->data  = pool->mem + slot_size * i;
+        push_free(pool, (uint32_t)i);
+    }
+    return pool;
+}
+
+void frame_pool_destroy(frame_pool_t *pool)
+{
+    if (!pool) return;
+    int nfree = __atomic_load_n(&pool->nfree, __ATOMIC_RELAXED);
+    if (pool->frames && nfree != pool->nslots)
+        fprintf(stderr, "[POOL] destroyed with %d of %d slots still referenced\n",
+                pool->nslots - nfree, pool->nslots);
+    free(pool->next);
+    free(pool->frames);
+    free(pool->mem);
+    free(pool);
+}
+
+frame_t *frame_pool_get(frame_pool_t *pool)
+{
+    uint32_t idx = pop_free(pool);
+    if (idx == NIL_INDEX) return NULL;
+    frame_t *f = &pool->frames[idx];
+    f->data   = pool->mem + pool->slot_size * idx;
+    f->len    = 0;
+    f->cap    = (uint32_t)pool->slot_size;
+    f->flags  = 0;
+    __atomic_store_n(&f->refcnt, 1, __ATOMIC_RELAXED);
+    return f;
+}
+
+void frame_unref(frame_t *f)
+{
+    if (!f) return;
+    if (__atomic_sub_fetch(&f->refcnt, 1, __ATOMIC_ACQ_REL) == 0)
+        push_free(f->pool, f->index);
+}
+
+int frame_pool_available(const frame_pool_t *pool)
+{
+    return __atomic_load_n(&pool->nfree, __ATOMIC_RELAXED);
+}
+
+int frame_pool_size(const frame_pool_t *pool)
+{
+    return pool->nslots;
+}
+
+size_t frame_pool_slot_size(const frame_pool_t *pool)
+{
+    return pool->slot_size;
+}
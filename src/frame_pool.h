@@ -0,0 +1,74 @@
+/*
+ * frame_pool.h — Preallocated, reference-counted IR frame buffers
+ *
+ * All frame memory is allocated once up front as fixed-size, cache-line
+ * aligned slots. A frame handle carries a reference count, so the capture
+ * engine, frame-hold, accumulation, save and render stages can all point
+ * at the same bytes instead of copying them between private buffers. The
+ * last frame_unref() puts the slot back on the pool's lock-free free list.
+ *
+ *   frame_pool_t *pool = frame_pool_create(16, MAX_FRAME_SIZE);
+ *   frame_t *f = frame_pool_get(pool);     // refcnt = 1, or NULL if empty
+ *   frame_t *keep = frame_ref(f);          // refcnt = 2
+ *   frame_unref(f);                        // refcnt = 1
+ *   frame_unref(keep);                     // back in the pool
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_FRAME_POOL_H
+#define SQUIG_FRAME_POOL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame_stats.h"
+
+#define FRAME_ALIGN 64
+
+typedef struct frame_pool frame_pool_t;
+
+typedef struct frame {
+    uint8_t  *data;         /* start of valid bytes */
+    uint32_t  len;          /* bytes valid in data */
+    uint32_t  cap;          /* slot capacity */
+
+    /* Capture metadata (filled by the producer) */
+    uint8_t   fid;          /* UVC frame-id bit */
+    uint8_t   flags;        /* producer-specific (UVC_FRAME_*) */
+    uint16_t  npayloads;    /* bulk payloads that made up this frame */
+    uint64_t  seq;          /* producer sequence number */
+    uint64_t  t_first_ns;   /* CLOCK_MONOTONIC of first byte */
+    uint64_t  t_last_ns;    /* CLOCK_MONOTONIC of last byte */
+
+    /* Filled in by the producer while it writes data (one pass) */
+    frame_stats_t stats;
+
+    /* Pool bookkeeping — do not touch */
+    int           refcnt;
+    uint32_t      index;
+    frame_pool_t *pool;
+} __attribute__((aligned(FRAME_ALIGN))) frame_t;
+
+/* Allocate nslots slots of slot_size bytes (rounded up to FRAME_ALIGN). */
+frame_pool_t *frame_pool_create(int nslots, size_t slot_size);
+void          frame_pool_destroy(frame_pool_t *pool);
+
+/* Take a free slot with refcnt = 1 and len = 0. NULL if the pool is empty.
+ * Safe to call from any thread. */
+frame_t *frame_pool_get(frame_pool_t *pool);
+
+/* Slots currently free (racy snapshot, for stats only). */
+int    frame_pool_available(const frame_pool_t *pool);
+int    frame_pool_size(const frame_pool_t *pool);
+size_t frame_pool_slot_size(const frame_pool_t *pool);
+
+static inline frame_t *frame_ref(frame_t *f)
+{
+    if (f) __atomic_fetch_add(&f->refcnt, 1, __ATOMIC_RELAXED);
+    return f;
+}
+
+void frame_unref(frame_t *f);
+
+#endif /* SQUIG_FRAME_POOL_H */
@@ -0,0 +1,200 @@
+/*
+ * frame_stats.c — Single-pass IR frame statistics
+ *
+ * The main loop walks byte pairs so the even/odd and 16-bit statistics
+ * fall out of the same loads; the overall min, max and sum are derived
+ * from those and the histogram at the end instead of being tracked per
+ * byte. Chunks may split a pair: the pending low byte is carried in st.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include "frame_stats.h"
+#include "tobii_framing.h"
+
+#include <string.h>
+
+#ifdef __SSE2__
+#  include <emmintrin.h>
+#endif
+
+/* Histogram over a chunk. Alternating between two tables keeps runs of
+ * equal bytes (flat IR regions) from serializing on one counter; the
+ * second table is folded in by frame_stats_end(). */
+static void hist_chunk(frame_stats_t *st, const uint8_t *p, uint32_t n)
+{
+    uint32_t *h0 = st->hist, *h1 = st->hist_b;
+    uint32_t i = 0;
+    for (; i + 2 <= n; i += 2) {
+        h0[p[i]]++;
+        h1[p[i + 1]]++;
+    }
+    if (i < n) h0[p[i]]++;
+}
+
+void frame_stats_begin(frame_stats_t *st, int detect_meta)
+{
+    memset(st, 0, sizeof(*st));
+    st->min_even = st->min_odd = 255;
+    st->min16 = 65535;
+    st->detect_meta = detect_meta ? 1 : 0;
+}
+
+/* Neighbour difference + brightness over the head window */
+static void feed_head(frame_stats_t *st, const uint8_t *p, uint32_t n)
+{
+    uint32_t room = FRAME_STATS_WINDOW - st->head_n;
+    if (n > room) n = room;
+    uint32_t i = 0;
+    if (st->head_n == 0 && n > 0) {
+        st->head_sum = p[0];
+        st->last = p[0];
+        i = 1;
+    }
+    uint32_t sum = 0, diff = 0;
+    uint8_t last = st->last;
+    for (; i < n; i++) {
+        int d = (int)p[i] - (int)last;
+        diff += (uint32_t)(d < 0 ? -d : d);
+        sum += p[i];
+        last = p[i];
+    }
+    st->head_sum += sum;
+    st->diff_sum += diff;
+    st->last = last;
+    st->head_n += n;
+}
+
+static inline void feed_even(frame_stats_t *st, uint8_t b)
+{
+    if (b < st->min_even) st->min_even = b;
+    if (b > st->max_even) st->max_even = b;
+}
+
+static inline void feed_odd(frame_stats_t *st, uint8_t b)
+{
+    if (b < st->min_odd) st->min_odd = b;
+    if (b > st->max_odd) st->max_odd = b;
+    uint16_t w = (uint16_t)st->lo | ((uint16_t)b << 8);
+    if (w < st->min16) st->min16 = w;
+    if (w > st->max16) st->max16 = w;
+}
+
+void frame_stats_feed(frame_stats_t *st, const uint8_t *p, uint32_t n)
+{
+    if (st->detect_meta) {
+        st->detect_meta = 0;
+        if (st->pix_len == 0 && tobii_has_meta_header(p, n)) {
+            st->has_meta = 1;
+            st->pix_off = TOBII_META_LEN;
+            p += TOBII_META_LEN;
+            n -= TOBII_META_LEN;
+        }
+    }
+    if (n == 0) return;
+    if (st->head_n < FRAME_STATS_WINDOW) feed_head(st, p, n);
+
+    hist_chunk(st, p, n);
+
+    uint32_t i = 0;
+
+    /* Finish a word split across chunks */
+    if (st->pix_len & 1) {
+        feed_odd(st, p[0]);
+        i = 1;
+    }
+
+    /* Whole words. Byte lanes keep even and odd bytes apart for free, so
+     * one vector min/max pair per width covers all three display modes. */
+    uint8_t  mne = st->min_even, mxe = st->max_even;
+    uint8_t  mno = st->min_odd,  mxo = st->max_odd;
+    uint16_t mnw = st->min16,    mxw = st->max16;
+#ifdef __SSE2__
+    if (i + 16 <= n) {
+        /* No unsigned 16-bit min/max in SSE2: bias to signed */
+        const __m128i bias = _mm_set1_epi16((short)0x8000);
+        __m128i bmin = _mm_set1_epi8((char)0xFF), bmax = _mm_setzero_si128();
+        __m128i wmin = _mm_set1_epi16(0x7FFF), wmax = _mm_set1_epi16((short)0x8000);
+        for (; i + 16 <= n; i += 16) {
+            __m128i v = _mm_loadu_si128((const __m128i *)(p + i));
+            bmin = _mm_min_epu8(bmin, v);
+            bmax = _mm_max_epu8(bmax, v);
+            v = _mm_xor_si128(v, bias);
+            wmin = _mm_min_epi16(wmin, v);
+            wmax = _mm_max_epi16(wmax, v);
+        }
+        uint8_t  b0[16], b1[16];
+        uint16_t w0[8], w1[8];
+        _mm_storeu_si128((__m128i *)b0, bmin);
+        _mm_storeu_si128((__m128i *)b1, bmax);
+        _mm_storeu_si128((__m128i *)w0, _mm_xor_si128(wmin, bias));
+        _mm_storeu_si128((__m128i *)w1, _mm_xor_si128(wmax, bias));
+        for (int k = 0; k < 8; k++) {
+            if (b0[2 * k] < mne)     mne = b0[2 * k];
+            if (b1[2 * k] > mxe)     mxe = b1[2 * k];
+            if (b0[2 * k + 1] < mno) mno = b0[2 * k + 1];
+            if (b1[2 * k + 1] > mxo) mxo = b1[2 * k + 1];
+            if (w0[k] < mnw)         mnw = w0[k];
+            if (w1[k] > mxw)         mxw = w1[k];
+        }
+    }
+#endif
+    for (; i + 2 <= n; i += 2) {
+        uint16_t w = (uint16_t)(p[i] | (p[i + 1] << 8));
+        uint8_t  a = (uint8_t)w, b = (uint8_t)(w >> 8);
+        mne = a < mne ? a : mne;
+        mxe = a > mxe ? a : mxe;
+        mno = b < mno ? b : mno;
+        mxo = b > mxo ? b : mxo;
+        mnw = w < mnw ? w : mnw;
+        mxw = w > mxw ? w : mxw;
+    }
+    st->min_even = mne; st->max_even = mxe;
+    st->min_odd  = mno; st->max_odd  = mxo;
+    st->min16    = mnw; st->max16    = mxw;
+
+    /* Odd byte out starts the next word */
+    if (i < n) {
+        feed_even(st, p[i]);
+        st->lo = p[i];
+    }
+    st->pix_len += n;
+}
+
+void frame_stats_end(frame_stats_t *st)
+{
+    st->detect_meta = 0;
+    for (int v = 0; v < 256; v++) {
+        st->hist[v] += st->hist_b[v];
+        st->hist_b[v] = 0;
+    }
+    uint64_t sum = 0;
+    for (int v = 1; v < 256; v++) sum += (uint64_t)st->hist[v] * (uint64_t)v;
+    st->sum = sum;
+    st->mean = st->pix_len ? (double)sum / st->pix_len : 0.0;
+
+    if (st->pix_len == 0) {
+        st->min_even = st->min_odd = 0;
+        st->min16 = 0;
+    }
+    if (st->pix_len < 2) {
+        st->min_odd = st->max_odd = 0;
+        st->min16 = st->max16 = 0;
+        st->min = st->min_even;
+        st->max = st->max_even;
+    } else {
+        st->min = st->min_even < st->min_odd ? st->min_even : st->min_odd;
+        st->max = st->max_even > st->max_odd ? st->max_even : st->max_odd;
+    }
+
+    st->head_avg = st->head_n ? (int)(st->head_sum / st->head_n) : 0;
+    st->nd = (st->head_n < 2) ? 0.0 : (double)st->diff_sum / (st->head_n - 1);
+}
+
+void frame_stats_compute(frame_stats_t *st, const uint8_t *p, uint32_t n, int detect_meta)
+{
+    frame_stats_begin(st, detect_meta);
+    frame_stats_feed(st, p, n);
+    frame_stats_end(st);
+}
@@ -0,0 +1,83 @@
+/*
+ * frame_stats.h — Single-pass IR frame statistics
+ *
+ * Everything the viewer's filters and renderers used to rescan the frame
+ * for — min/max, brightness, histogram, neighbour difference, metadata
+ * header — gathered in one pass. The capture engine feeds each payload
+ * through frame_stats_feed() right after copying it into the frame slot,
+ * while the bytes are still in cache, so consumers get a finished record
+ * in frame_t.stats without touching the pixels again.
+ *
+ *   frame_stats_begin(&st, 1);                  // detect meta header
+ *   frame_stats_feed(&st, chunk, n);            // any number of times
+ *   frame_stats_end(&st);
+ *   if (st.nd > 25.0) ...                       // interleaved frame
+ *
+ * Or for a whole buffer: frame_stats_compute(&st, data, len, 1).
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_FRAME_STATS_H
+#define SQUIG_FRAME_STATS_H
+
+#include <stdint.h>
+
+/* Head window for the neighbour-difference and brightness samples (the
+ * filter thresholds were tuned on the first 4000 bytes of each frame) */
+#define FRAME_STATS_WINDOW  4000
+
+/* nd above this means interleaved/alternating data (vertical stripes) */
+#define FRAME_STATS_ND_INTERLEAVED  25.0
+
+typedef struct {
+    /* Pixel region (after the metadata header, if one was detected) */
+    uint32_t pix_off;
+    uint32_t pix_len;
+    int      has_meta;
+
+    /* Whole pixel region */
+    uint8_t  min, max;
+    uint64_t sum;
+    double   mean;
+    uint32_t hist[256];
+
+    /* Per display mode: even/odd-index bytes, little-endian words */
+    uint8_t  min_even, max_even;
+    uint8_t  min_odd, max_odd;
+    uint16_t min16, max16;
+
+    /* First FRAME_STATS_WINDOW pixel bytes */
+    uint32_t head_n;
+    int      head_avg;      /* mean brightness (integer, as the filter uses) */
+    double   nd;            /* mean |p[i] - p[i-1]|: >25 interleaved, <15 smooth */
+
+    /* Streaming state */
+    uint32_t head_sum;
+    uint32_t diff_sum;
+    uint8_t  last;          /* previous byte (neighbour difference) */
+    uint8_t  lo;            /* pending low byte of a 16-bit word */
+    uint8_t  detect_meta;   /* still looking for the header */
+    uint32_t hist_b[256];   /* second histogram bank, merged by end() */
+} frame_stats_t;
+
+/* Reset st. detect_meta: strip a metadata header found at the very start
+ * (off for streams whose headers were removed already). */
+void frame_stats_begin(frame_stats_t *st, int detect_meta);
+
+/* Account for the next n bytes of the frame. */
+void frame_stats_feed(frame_stats_t *st, const uint8_t *p, uint32_t n);
+
+/* Derive min/max/mean/nd; st can still be read but not fed afterwards. */
+void frame_stats_end(frame_stats_t *st);
+
+/* begin + feed + end over one buffer. */
+void frame_stats_compute(frame_stats_t *st, const uint8_t *p, uint32_t n, int detect_meta);
+
+static inline int frame_stats_interleaved(const frame_stats_t *st)
+{
+    return st->nd > FRAME_STATS_ND_INTERLEAVED;
+}
+
+#endif /* SQUIG_FRAME_STATS_H */
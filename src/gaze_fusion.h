@@ -0,0 +1,186 @@
+/*
+ * gaze_fusion.h — Align gaze_point and eye_position_normalized to gaze_origin
+ *
+ * Stream Engine delivers each stream through its own callback with its
+ * own timestamp_us. Feeding the EKF once per callback would mean three
+ * predict/update rounds per ~11 ms, two of them for weak or merely
+ * confirming information. Instead the secondary streams are only queued
+ * here, each on its own SPSC ring (callback side: a copy, no locks), and
+ * the filter thread, when a gaze_origin sample comes up, takes from each
+ * ring what has arrived up to that sample's timestamp_us:
+ *
+ *   gaze_point               interpolated to timestamp_us between the
+ *                            samples either side; the nearest one if the
+ *                            later one has not arrived yet
+ *   eye_position_normalized  the nearest sample; per eye it reports,
+ *                            inside the track box (with a small margin)
+ *                            or not
+ *
+ * Either is used only within max_skew_us of the gaze_origin sample. The
+ * result is one head_tracker_sample_t — a single measurement vector for
+ * one batched EKF update (head_tracker.h) per gaze_origin sample.
+ *
+ *   gaze_fusion_t gf;
+ *   gaze_fusion_init(&gf, NULL, 64);
+ *   gaze_fusion_push_point(&gf, gp);            // gaze_point callback
+ *   gaze_fusion_push_eyes(&gf, ep);             // eye_position_normalized callback
+ *   gaze_fusion_align(&gf, &sample);            // filter thread, per gaze_origin
+ *
+ * One producer thread (the SE thread) and one consumer (the filter).
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_GAZE_FUSION_H
+#define SQUIG_GAZE_FUSION_H
+
+#include <stdint.h>
+#include <string.h>
+#include "spsc_ring.h"
+#include "se_session.h"
+#include "head_tracker.h"
+
+typedef struct {
+    int64_t max_skew_us;        /* farther from the gaze_origin sample: not used */
+    double  box_margin;         /* eye_position_normalized slack outside 0..1 */
+} gaze_fusion_config_t;
+
+#define GAZE_FUSION_DEFAULTS { 20000, 0.02 }
+
+/* One secondary stream: its ring and, on the consumer side, the newest
+ * sample at or before the current timestamp_us and the first one after */
+typedef struct {
+    spsc_ring_t ring;
+    int         have_prev, have_next;
+    uint64_t    drop_full;      /* producer: ring full */
+} gaze_fusion_stream_t;
+
+typedef struct {
+    gaze_fusion_config_t cfg;
+    gaze_fusion_stream_t point, eyes;
+    tobii_gaze_point_t   gp_prev, gp_next;
+    tobii_eye_position_normalized_t ep_prev, ep_next;
+    /* Consumer counters */
+    uint64_t aligned;           /* gaze_origin samples */
+    uint64_t with_gaze;         /* ... given a gaze point */
+    uint64_t with_box;          /* ... given a track-box check */
+    uint64_t outside;           /* ... with a valid eye outside the box */
+} gaze_fusion_t;
+
+/* capacity: samples per ring (rounded up to 2^n). Returns 0 or -1. */
+static inline int gaze_fusion_init(gaze_fusion_t *gf, const gaze_fusion_config_t *cfg,
+                                   uint32_t capacity)
+{
+    const gaze_fusion_config_t def = GAZE_FUSION_DEFAULTS;
+    memset(gf, 0, sizeof(*gf));
+    gf->cfg = cfg ? *cfg : def;
+    if (spsc_ring_init(&gf->point.ring, capacity, sizeof(tobii_gaze_point_t)) < 0) return -1;
+    if (spsc_ring_init(&gf->eyes.ring, capacity, sizeof(tobii_eye_position_normalized_t)) < 0) {
+        spsc_ring_free(&gf->point.ring);
+        return -1;
+    }
+    return 0;
+}
+
+static inline void gaze_fusion_free(gaze_fusion_t *gf)
+{
+    spsc_ring_free(&gf->point.ring);
+    spsc_ring_free(&gf->eyes.ring);
+}
+
+/* ── Producer (the SE callbacks) ────────────────────────────────────── */
+
+static inline void gaze_fusion_push_point(gaze_fusion_t *gf, const tobii_gaze_point_t *gp)
+{
+    if (spsc_ring_push(&gf->point.ring, gp) < 0)
+        __atomic_fetch_add(&gf->point.drop_full, 1, __ATOMIC_RELAXED);
+}
+
+static inline void gaze_fusion_push_eyes(gaze_fusion_t *gf, const tobii_eye_position_normalized_t *ep)
+{
+    if (spsc_ring_push(&gf->eyes.ring, ep) < 0)
+        __atomic_fetch_add(&gf->eyes.drop_full, 1, __ATOMIC_RELAXED);
+}
+
+/* ── Consumer (the filter thread) ───────────────────────────────────── */
+
+/* Pop until next is the first sample after t (or the ring is empty);
+ * every sample at or before t becomes prev in turn. Both element types
+ * start with timestamp_us. */
+static inline void gaze_fusion__advance(gaze_fusion_stream_t *st, void *prev, void *next,
+                                        size_t size, int64_t t)
+{
+    for (;;) {
+        if (!st->have_next) {
+            if (spsc_ring_pop(&st->ring, next) < 0) return;
+            st->have_next = 1;
+        }
+        int64_t ts;
+        memcpy(&ts, next, sizeof(ts));
+        if (ts > t) return;
+        memcpy(prev, next, size);
+        st->have_prev = 1;
+        st->have_next = 0;
+    }
+}
+
+static inline int gaze_fusion__near(int64_t ts, int64_t t, int64_t skew)
+{
+    return ts - t <= skew && t - ts <= skew;
+}
+
+static inline int gaze_fusion__in_box(const float xyz[3], double margin)
+{
+    for (int k = 0; k < 3; k++)
+        if (xyz[k] < -margin || xyz[k] > 1.0 + margin) return 0;
+    return 1;
+}
+
+/* Fill s's gaze and box fields from what the secondary streams have
+ * delivered up to s->timestamp_us (cleared if nothing is close enough). */
+static inline void gaze_fusion_align(gaze_fusion_t *gf, head_tracker_sample_t *s)
+{
+    const int64_t t = s->timestamp_us, skew = gf->cfg.max_skew_us;
+    s->gaze_valid = 0;
+    s->box_left = s->box_right = 0;
+    gf->aligned++;
+
+    /* Gaze point: interpolate across t, else the nearest valid one */
+    gaze_fusion__advance(&gf->point, &gf->gp_prev, &gf->gp_next, sizeof(gf->gp_prev), t);
+    const tobii_gaze_point_t *a = gf->point.have_prev ? &gf->gp_prev : NULL;
+    const tobii_gaze_point_t *b = gf->point.have_next ? &gf->gp_next : NULL;
+    if (a && (a->validity != TOBII_VALIDITY_VALID || !gaze_fusion__near(a->timestamp_us, t, skew))) a = NULL;
+    if (b && (b->validity != TOBII_VALIDITY_VALID || !gaze_fusion__near(b->timestamp_us, t, skew))) b = NULL;
+    if (a && b && b->timestamp_us > a->timestamp_us) {
+        double w = (double)(t - a->timestamp_us) / (double)(b->timestamp_us - a->timestamp_us);
+        for (int k = 0; k < 2; k++)
+            s->gaze[k] = a->position_xy[k] + w * (b->position_xy[k] - a->position_xy[k]);
+        s->gaze_valid = 1;
+    } else if (a || b) {
+        const tobii_gaze_point_t *p = a ? a : b;
+        s->gaze[0] = p->position_xy[0];
+        s->gaze[1] = p->position_xy[1];
+        s->gaze_valid = 1;
+    }
+    if (s->gaze_valid) gf->with_gaze++;
+
+    /* Track box: the nearest eye_position_normalized sample */
+    gaze_fusion__advance(&gf->eyes, &gf->ep_prev, &gf->ep_next, sizeof(gf->ep_prev), t);
+    const tobii_eye_position_normalized_t *ep = NULL;
+    if (gf->eyes.have_prev && gaze_fusion__near(gf->ep_prev.timestamp_us, t, skew))
+        ep = &gf->ep_prev;
+    if (gf->eyes.have_next && gaze_fusion__near(gf->ep_next.timestamp_us, t, skew) &&
+        (!ep || gf->ep_next.timestamp_us - t < t - ep->timestamp_us))
+        ep = &gf->ep_next;
+    if (!ep) return;
+    double m = gf->cfg.box_margin;
+    if (ep->left_validity == TOBII_VALIDITY_VALID)
+        s->box_left = gaze_fusion__in_box(ep->left_xyz, m) ? 1 : -1;
+    if (ep->right_validity == TOBII_VALIDITY_VALID)
+        s->box_right = gaze_fusion__in_box(ep->right_xyz, m) ? 1 : -1;
+    gf->with_box++;
+    if ((s->left_valid && s->box_left < 0) || (s->right_valid && s->box_right < 0)) gf->outside++;
+}
+
+#endif /* SQUIG_GAZE_FUSION_H */
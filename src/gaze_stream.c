@@ -0,0 +1,211 @@
+/*
+ * gaze_stream.c — Stream Engine gaze_origin on a thread, on the host clock
+ *
+ * See gaze_stream.h. Each history slot is a seqlock (the pose_shm.c
+ * recipe, per slot): the SE thread makes the slot's word odd, stores the
+ * sample words, makes it even, then advances head. A reader takes head,
+ * walks back from the newest slot and keeps a copy only if the word was
+ * even and unchanged across the read and the sample's own seq is the one
+ * it expected there; anything else means the slot was (being) lapped, and
+ * everything older is gone too.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "gaze_stream.h"
+#include "se_session.h"
+
+#define CLOCK_PROBE_MS      250         /* tobii_system_clock() query interval */
+#define SAMPLE_WORDS        (sizeof(gaze_sample_t) / sizeof(uint64_t))
+
+_Static_assert(sizeof(gaze_sample_t) % sizeof(uint64_t) == 0, "samples are copied as words");
+
+typedef struct {
+    uint32_t lock;              /* odd while the SE thread writes */
+    uint32_t pad;
+    uint64_t w[SAMPLE_WORDS];
+} slot_t;
+
+struct gaze_stream {
+    se_session_t *se;
+    gaze_stream_config_t cfg;
+    slot_t       *ring;
+    uint32_t      mask;
+    uint64_t      head;         /* samples stored; release-published */
+    pthread_t     thread;
+    int           stopping;
+    clock_sync_t  clock;        /* SE thread feeds and maps */
+    uint64_t      reconnects;
+};
+
+static int64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* ── SE thread ──────────────────────────────────────────────────────── */
+
+static void store(gaze_stream_t *gs, const gaze_sample_t *s)
+{
+    slot_t *slot = &gs->ring[s->seq & gs->mask];
+    uint64_t w[SAMPLE_WORDS];
+    memcpy(w, s, sizeof(w));
+    uint32_t q = __atomic_load_n(&slot->lock, __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->lock, q + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 0; i < SAMPLE_WORDS; i++) __atomic_store_n(&slot->w[i], w[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&slot->lock, q + 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&gs->head, s->seq + 1, __ATOMIC_RELEASE);
+}
+
+static void gaze_origin_callback(tobii_gaze_origin_t const *g, void *user)
+{
+    gaze_stream_t *gs = user;
+    gaze_sample_t s = {
+        .dev_ns = clock_sync_to_host(&gs->clock, g->timestamp_us),
+        .recv_ns = mono_ns(),
+        .timestamp_us = g->timestamp_us,
+        .seq = gs->head,        /* SE thread is the only writer */
+        .valid = (g->left_validity == TOBII_VALIDITY_VALID ? GAZE_STREAM_LEFT : 0) |
+                 (g->right_validity == TOBII_VALIDITY_VALID ? GAZE_STREAM_RIGHT : 0),
+    };
+    memcpy(s.left_xyz, g->left_xyz, sizeof(s.left_xyz));
+    memcpy(s.right_xyz, g->right_xyz, sizeof(s.right_xyz));
+    store(gs, &s);
+    if (gs->cfg.tap) gs->cfg.tap(gs->cfg.tap_arg, &s);
+}
+
+static void probe_clock(gaze_stream_t *gs)
+{
+    int64_t us = se_session_clock_us(gs->se);
+    int64_t t1 = mono_ns();
+    if (us) clock_sync_add(&gs->clock, us, t1);
+}
+
+static void *se_thread(void *arg)
+{
+    gaze_stream_t *gs = arg;
+    int64_t next_probe = 0;
+    while (!__atomic_load_n(&gs->stopping, __ATOMIC_ACQUIRE)) {
+        /* SE clock against ours; the host read after the query bounds it */
+        if (mono_ns() >= next_probe) {
+            probe_clock(gs);
+            next_probe = mono_ns() + CLOCK_PROBE_MS * 1000000LL;
+        }
+        if (se_session_pump(gs->se) == SE_PUMP_RECONNECTED)
+            __atomic_fetch_add(&gs->reconnects, 1, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+/* ── Lifecycle ──────────────────────────────────────────────────────── */
+
+gaze_stream_t *gaze_stream_start(const gaze_stream_config_t *cfg)
+{
+    static const gaze_stream_config_t defaults = GAZE_STREAM_DEFAULTS;
+    gaze_stream_t *gs = calloc(1, sizeof(*gs));
+    if (!gs) return NULL;
+    gs->cfg = cfg ? *cfg : defaults;
+    uint32_t n = 2;
+    while (n < (uint32_t)gs->cfg.history && n < (1u << 20)) n <<= 1;
+    gs->mask = n - 1;
+    gs->ring = calloc(n, sizeof(slot_t));
+    if (!gs->ring) {
+        free(gs);
+        return NULL;
+    }
+    clock_sync_init(&gs->clock, 1000, 32);      /* 1 s buckets, 32 s of drift */
+
+    if (!(gs->se = se_session_open(gs->cfg.url, "[GAZE]"))) goto fail;
+    probe_clock(gs);                            /* a mapping before the first sample */
+    int err = se_session_gaze_origin(gs->se, gaze_origin_callback, gs);
+    if (err) {
+        fprintf(stderr, "[GAZE] gaze_origin_subscribe: %d - %s\n", err, se_error(err));
+        goto fail_se;
+    }
+    if (pthread_create(&gs->thread, NULL, se_thread, gs) != 0) {
+        perror("[GAZE] pthread_create");
+        goto fail_se;
+    }
+    return gs;
+
+fail_se:
+    se_session_close(gs->se);
+fail:
+    clock_sync_destroy(&gs->clock);
+    free(gs->ring);
+    free(gs);
+    return NULL;
+}
+
+void gaze_stream_stop(gaze_stream_t *gs)
+{
+    if (!gs) return;
+    __atomic_store_n(&gs->stopping, 1, __ATOMIC_RELEASE);
+    pthread_join(gs->thread, NULL);
+    se_session_close(gs->se);
+    clock_sync_destroy(&gs->clock);
+    free(gs->ring);
+    free(gs);
+}
+
+/* ── Readers ────────────────────────────────────────────────────────── */
+
+/* Copy sample seq out of its slot. Returns 0, or -1 if it was lapped. */
+static int load(gaze_stream_t *gs, uint64_t seq, gaze_sample_t *out)
+{
+    slot_t *slot = &gs->ring[seq & gs->mask];
+    uint64_t w[SAMPLE_WORDS];
+    for (;;) {
+        uint32_t s1 = __atomic_load_n(&slot->lock, __ATOMIC_ACQUIRE);
+        if (s1 & 1) continue;
+        for (size_t i = 0; i < SAMPLE_WORDS; i++) w[i] = __atomic_load_n(&slot->w[i], __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&slot->lock, __ATOMIC_RELAXED) == s1) break;
+    }
+    memcpy(out, w, sizeof(w));
+    return out->seq == seq ? 0 : -1;
+}
+
+int gaze_stream_latest(gaze_stream_t *gs, gaze_sample_t *out)
+{
+    uint64_t head = __atomic_load_n(&gs->head, __ATOMIC_ACQUIRE);
+    return head ? load(gs, head - 1, out) : -1;
+}
+
+int gaze_stream_nearest(gaze_stream_t *gs, int64_t host_ns, gaze_sample_t *out)
+{
+    uint64_t head = __atomic_load_n(&gs->head, __ATOMIC_ACQUIRE);
+    uint64_t oldest = head > gs->mask + 1 ? head - (gs->mask + 1) : 0;
+    gaze_sample_t cur, after;
+    int have = 0;
+    /* Newest first: pairing is nearly always asked about the last few ms */
+    for (uint64_t seq = head; seq-- > oldest; ) {
+        if (load(gs, seq, &cur) < 0) break;
+        if (cur.dev_ns <= host_ns) {
+            if (have && after.dev_ns - host_ns < host_ns - cur.dev_ns) cur = after;
+            *out = cur;
+            return 0;
+        }
+        after = cur;
+        have = 1;
+    }
+    if (!have) return -1;
+    *out = after;               /* host_ns is older than the whole history */
+    return 0;
+}
+
+void gaze_stream_get_stats(gaze_stream_t *gs, gaze_stream_stats_t *out)
+{
+    out->samples = __atomic_load_n(&gs->head, __ATOMIC_ACQUIRE);
+    out->reconnects = __atomic_load_n(&gs->reconnects, __ATOMIC_RELAXED);
+    clock_sync_get(&gs->clock, &out->clock);
+}
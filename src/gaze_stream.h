@@ -0,0 +1,88 @@
+/*
+ * gaze_stream.h — Stream Engine gaze_origin on a thread, on the host clock
+ *
+ * Runs one se_session (se_session.h) on its own thread inside the
+ * capture process, next to uvc_capture's event thread, so IR frames and
+ * gaze samples share an address space and a clock: every sample's
+ * timestamp_us is mapped onto CLOCK_MONOTONIC by a clock_sync.h model
+ * the thread keeps fed with tobii_system_clock() queries, the same clock
+ * frame_t.t_first_ns / t_last_ns are stamped on. No child process, no
+ * pipe, no re-synchronisation afterwards.
+ *
+ * Samples land in a fixed history ring (one writer, any number of
+ * readers). Each slot is its own seqlock, so a reader on the display or
+ * analysis thread copies a sample out without ever blocking the SE
+ * thread, and a slot that was overwritten while it looked is detected
+ * and skipped. Frames are not copied either: pairing takes a frame's
+ * timestamp and returns the nearest gaze sample, the frame stays where
+ * the capture engine put it.
+ *
+ *   gaze_stream_config_t cfg = GAZE_STREAM_DEFAULTS;
+ *   gaze_stream_t *gs = gaze_stream_start(&cfg);
+ *   frame_t *f = uvc_capture_next(cap, 500);
+ *   gaze_sample_t g;
+ *   if (gaze_stream_nearest(gs, (int64_t)f->t_first_ns, &g) == 0)
+ *       dt = (int64_t)f->t_first_ns - g.dev_ns;     // same timeline
+ *   gaze_stream_stop(gs);
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_GAZE_STREAM_H
+#define SQUIG_GAZE_STREAM_H
+
+#include <stdint.h>
+#include "clock_sync.h"
+
+/* gaze_sample_t.valid */
+#define GAZE_STREAM_LEFT    0x01u
+#define GAZE_STREAM_RIGHT   0x02u
+
+typedef struct {
+    int64_t  dev_ns;            /* timestamp_us on CLOCK_MONOTONIC (clock_sync) */
+    int64_t  recv_ns;           /* CLOCK_MONOTONIC in the callback */
+    int64_t  timestamp_us;      /* Stream Engine clock, as delivered */
+    uint64_t seq;               /* 0, 1, 2, ... per stream */
+    float    left_xyz[3];       /* mm, tracker coordinates */
+    float    right_xyz[3];
+    uint32_t valid;             /* GAZE_STREAM_LEFT | GAZE_STREAM_RIGHT */
+    uint32_t reserved;
+} gaze_sample_t;
+
+typedef struct {
+    const char *url;            /* NULL = first enumerated tracker */
+    int         history;        /* samples kept (rounded up to 2^n) */
+    /* Called on the SE thread with every sample after it is stored (e.g.
+     * a fusion stage). Must not block. */
+    void (*tap)(void *arg, const gaze_sample_t *s);
+    void *tap_arg;
+} gaze_stream_config_t;
+
+#define GAZE_STREAM_DEFAULTS { NULL, 256, NULL, NULL }   /* ~2.8 s at 90 Hz */
+
+typedef struct {
+    uint64_t           samples;
+    uint64_t           reconnects;
+    clock_sync_model_t clock;
+} gaze_stream_stats_t;
+
+typedef struct gaze_stream gaze_stream_t;
+
+/* Open the session, subscribe to gaze_origin and start the SE thread.
+ * cfg may be NULL for GAZE_STREAM_DEFAULTS. Returns NULL on failure. */
+gaze_stream_t *gaze_stream_start(const gaze_stream_config_t *cfg);
+
+/* Join the thread and close the session (the tracker stops tracking). */
+void gaze_stream_stop(gaze_stream_t *gs);
+
+/* Sample nearest to host_ns (CLOCK_MONOTONIC) still in the history.
+ * Returns 0 (out filled), -1 if there is none yet. Any thread. */
+int  gaze_stream_nearest(gaze_stream_t *gs, int64_t host_ns, gaze_sample_t *out);
+
+/* Newest sample. Returns 0, or -1 if there is none yet. Any thread. */
+int  gaze_stream_latest(gaze_stream_t *gs, gaze_sample_t *out);
+
+void gaze_stream_get_stats(gaze_stream_t *gs, gaze_stream_stats_t *out);
+
+#endif /* SQUIG_GAZE_STREAM_H */
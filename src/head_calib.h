@@ -0,0 +1,271 @@
+/*
+ * head_calib.h — Streaming head-model calibration (header-only)
+ *
+ * Option C's calibration step (docs/TOBII_HEAD_TRACKING_OPTION_C.md)
+ * measures the user's head model: IPD and where the eyes sit relative to
+ * the neck pivot. Instead of a "look straight / turn left slowly" routine
+ * refitted from scratch on every start, this solves it incrementally from
+ * the ordinary gaze_origin stream, at O(1) cost per binocular sample:
+ *
+ *   ipd      |right - left| is the eye separation whatever the pose; a
+ *            scalar Kalman filter (a running mean that can drift)
+ *   pivot    the mid-eye point m rides on a sphere around the neck pivot
+ *            c: m = c + R(yaw, pitch, roll) · (0, eye_up, -eye_fwd), with
+ *            yaw and roll read off the eye vector and pitch the EKF's
+ *            estimate. That is linear in [c, eye_up, eye_fwd], so it is
+ *            solved by recursive least squares (a 5-state linear Kalman
+ *            filter, 3 rows per sample). The pivot carries a random walk
+ *            of half a millimetre per sample, loose enough that head
+ *            translation is tracked by the pivot instead of leaking into
+ *            the offsets. Head turns and tilts are what separate the
+ *            eye offsets from it. A sphere fit with forgetting, in other
+ *            words, with the radius split into the two offsets the EKF
+ *            uses.
+ *
+ * Pitch is not observable from two points, so the fit takes it from the
+ * EKF (0 before it is seeded). Left at 0, a head nodding ±15° shows its
+ * eyes at eye_up·cos(pitch) on average and the fit learns an eye_up
+ * several mm short. What the EKF gets wrong of it is residual noise; the
+ * χ² gate drops samples that fit badly (a jump, a glint on glasses).
+ * Each parameter is reported with its σ, and only parameters that are
+ * well determined and plausible are handed to the EKF
+ * (head_calib_apply()), so a session with little head movement leaves the
+ * defaults — or the loaded profile (head_profile.h) — alone.
+ *
+ *   head_calib_t c;
+ *   head_calib_init(&c, NULL, &ekf_cfg, profile_or_NULL);
+ *   head_calib_add(&c, left, right, pitch);   // each binocular sample
+ *   head_calib_apply(&c, &ekf_cfg);           // now and then
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_HEAD_CALIB_H
+#define SQUIG_HEAD_CALIB_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "head_ekf.h"
+
+enum { HEAD_CALIB_CX, HEAD_CALIB_CY, HEAD_CALIB_CZ, HEAD_CALIB_UP, HEAD_CALIB_FWD, HEAD_CALIB_N };
+
+#define HEAD_CALIB_RESTART      90      /* consecutive gated samples: re-anchor the pivot */
+
+typedef struct {
+    double q_model;             /* head-model random walk per sample, mm² */
+    double q_pivot;             /* pivot random walk per sample, mm² (follows translation) */
+    double r_mid;               /* mid-eye residual variance, mm² (mostly unmodelled pitch) */
+    double r_ipd;               /* eye-separation measurement variance, mm² */
+    double gate;                /* χ² (3 dof) above which a sample is skipped */
+    double max_sigma;           /* apply a parameter once its σ is below, mm */
+    double apply_delta;         /* ... and it has moved by more than, mm */
+    double p0_model;            /* σ of the starting model without a profile, mm */
+} head_calib_config_t;
+
+#define HEAD_CALIB_DEFAULTS { 1e-4, 0.3, 400.0, 1.0, 50.0, 2.5, 0.25, 30.0 }
+
+/* Plausible head models; estimates outside are never applied */
+#define HEAD_CALIB_IPD_MIN      50.0
+#define HEAD_CALIB_IPD_MAX      80.0
+#define HEAD_CALIB_UP_MIN       60.0
+#define HEAD_CALIB_UP_MAX       250.0
+#define HEAD_CALIB_FWD_MIN      -30.0
+#define HEAD_CALIB_FWD_MAX      100.0
+
+/* A head model and how well it is known (what a profile stores) */
+typedef struct {
+    double   ipd, eye_up, eye_fwd;  /* mm */
+    double   var[3];                /* variances of the three, mm² */
+    uint64_t samples;               /* binocular samples behind it */
+} head_calib_model_t;
+
+typedef struct {
+    head_calib_config_t cfg;
+    double   x[HEAD_CALIB_N];       /* pivot xyz, eye_up, eye_fwd */
+    double   P[HEAD_CALIB_N][HEAD_CALIB_N];
+    double   ipd, ipd_var;
+    int      anchored;              /* pivot initialised */
+    int      misfit;                /* consecutive gated samples */
+    uint64_t samples;               /* accepted */
+    uint64_t prior;                 /* samples inherited from a profile */
+    uint64_t gated;
+} head_calib_t;
+
+static inline void head_calib_init(head_calib_t *c, const head_calib_config_t *cfg,
+                                   const head_ekf_config_t *model, const head_calib_model_t *profile)
+{
+    const head_calib_config_t def = HEAD_CALIB_DEFAULTS;
+    const head_ekf_config_t mdef = HEAD_EKF_DEFAULTS;
+    memset(c, 0, sizeof(*c));
+    c->cfg = cfg ? *cfg : def;
+    if (!model) model = &mdef;
+    double v0 = c->cfg.p0_model * c->cfg.p0_model;
+    if (profile) {
+        /* Inflated: glasses, seating, another tracker mount since */
+        c->ipd = profile->ipd;
+        c->x[HEAD_CALIB_UP] = profile->eye_up;
+        c->x[HEAD_CALIB_FWD] = profile->eye_fwd;
+        c->ipd_var = 4.0 * profile->var[0] + 0.25;
+        c->P[HEAD_CALIB_UP][HEAD_CALIB_UP] = 4.0 * profile->var[1] + 1.0;
+        c->P[HEAD_CALIB_FWD][HEAD_CALIB_FWD] = 4.0 * profile->var[2] + 1.0;
+        c->prior = profile->samples;
+    } else {
+        c->ipd = model->ipd;
+        c->x[HEAD_CALIB_UP] = model->eye_up;
+        c->x[HEAD_CALIB_FWD] = model->eye_fwd;
+        c->ipd_var = v0;
+        c->P[HEAD_CALIB_UP][HEAD_CALIB_UP] = v0;
+        c->P[HEAD_CALIB_FWD][HEAD_CALIB_FWD] = v0;
+    }
+}
+
+/* Yaw/roll from the eye vector (as head_ekf_seed), with the given pitch,
+ * and the mid-eye point */
+static inline void head_calib__view(const double left[3], const double right[3], double pitch,
+                                    head_real_t R[3][3], double mid[3], double *sep)
+{
+    double v[3];
+    for (int k = 0; k < 3; k++) {
+        v[k] = right[k] - left[k];
+        mid[k] = 0.5 * (left[k] + right[k]);
+    }
+    double h = sqrt(v[0] * v[0] + v[2] * v[2]);
+    const head_real_t ang[3] = { atan2(v[2], v[0]), pitch, atan2(v[1], h) };
+    head_ekf_rotation(ang, R, NULL);
+    *sep = sqrt(h * h + v[1] * v[1]);
+}
+
+/* One binocular sample, at the head pitch the EKF has for it (rad).
+ * Returns 1 if it was used, 0 if gated or implausible. */
+static inline int head_calib_add(head_calib_t *c, const double left[3], const double right[3],
+                                 double pitch)
+{
+    const head_calib_config_t *k = &c->cfg;
+    head_real_t R[3][3];
+    double m[3], sep;
+    head_calib__view(left, right, pitch, R, m, &sep);
+    if (!(sep > 0.5 * HEAD_CALIB_IPD_MIN && sep < 1.5 * HEAD_CALIB_IPD_MAX)) return 0;
+
+    double *x = c->x;
+    double (*P)[HEAD_CALIB_N] = c->P;
+    /* Model column a of H for the offsets: ∂m/∂up = R[:,1], ∂m/∂fwd = -R[:,2] */
+    if (!c->anchored) {
+        for (int i = 0; i < 3; i++) {
+            x[i] = m[i] - (R[i][1] * x[HEAD_CALIB_UP] - R[i][2] * x[HEAD_CALIB_FWD]);
+            for (int j = 0; j < HEAD_CALIB_N; j++) P[i][j] = P[j][i] = 0;
+            P[i][i] = 1e4;
+        }
+        c->anchored = 1;
+        c->misfit = 0;
+        return 0;
+    }
+
+    for (int i = 0; i < 3; i++) P[i][i] += k->q_pivot;
+    P[HEAD_CALIB_UP][HEAD_CALIB_UP] += k->q_model;
+    P[HEAD_CALIB_FWD][HEAD_CALIB_FWD] += k->q_model;
+
+    double y[3], H[3][HEAD_CALIB_N];
+    for (int i = 0; i < 3; i++) {
+        memset(H[i], 0, sizeof(H[i]));
+        H[i][i] = 1;
+        H[i][HEAD_CALIB_UP] = R[i][1];
+        H[i][HEAD_CALIB_FWD] = -R[i][2];
+        y[i] = m[i] - (x[i] + R[i][1] * x[HEAD_CALIB_UP] - R[i][2] * x[HEAD_CALIB_FWD]);
+    }
+
+    /* PHt = P Hᵀ (5×3), S = H P Hᵀ + r I (3×3) */
+    double PHt[HEAD_CALIB_N][3], S[3][3], Si[3][3];
+    for (int i = 0; i < HEAD_CALIB_N; i++)
+        for (int j = 0; j < 3; j++) {
+            double s = 0;
+            for (int l = 0; l < HEAD_CALIB_N; l++) s += P[i][l] * H[j][l];
+            PHt[i][j] = s;
+        }
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) {
+            double s = i == j ? k->r_mid : 0;
+            for (int l = 0; l < HEAD_CALIB_N; l++) s += H[i][l] * PHt[l][j];
+            S[i][j] = s;
+        }
+    double det = S[0][0] * (S[1][1] * S[2][2] - S[1][2] * S[2][1]) -
+                 S[0][1] * (S[1][0] * S[2][2] - S[1][2] * S[2][0]) +
+                 S[0][2] * (S[1][0] * S[2][1] - S[1][1] * S[2][0]);
+    if (!(det > 0)) return 0;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) {
+            int i1 = (j + 1) % 3, i2 = (j + 2) % 3, j1 = (i + 1) % 3, j2 = (i + 2) % 3;
+            Si[i][j] = (S[i1][j1] * S[i2][j2] - S[i1][j2] * S[i2][j1]) / det;
+        }
+    double chi2 = 0;
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++) chi2 += y[i] * Si[i][j] * y[j];
+    if (k->gate > 0 && chi2 > k->gate) {
+        c->gated++;
+        if (++c->misfit >= HEAD_CALIB_RESTART) c->anchored = 0;    /* the head moved away */
+        return 0;
+    }
+    c->misfit = 0;
+
+    /* K = PHt S⁻¹; x += K y; P -= K PHtᵀ (mirrored so P stays symmetric) */
+    double K[HEAD_CALIB_N][3];
+    for (int i = 0; i < HEAD_CALIB_N; i++)
+        for (int j = 0; j < 3; j++)
+            K[i][j] = PHt[i][0] * Si[0][j] + PHt[i][1] * Si[1][j] + PHt[i][2] * Si[2][j];
+    for (int i = 0; i < HEAD_CALIB_N; i++) x[i] += K[i][0] * y[0] + K[i][1] * y[1] + K[i][2] * y[2];
+    for (int i = 0; i < HEAD_CALIB_N; i++)
+        for (int j = i; j < HEAD_CALIB_N; j++) {
+            double d = K[i][0] * PHt[j][0] + K[i][1] * PHt[j][1] + K[i][2] * PHt[j][2];
+            P[i][j] -= d;
+            P[j][i] = P[i][j];
+        }
+
+    /* Eye separation */
+    c->ipd_var += k->q_model;
+    double g = c->ipd_var / (c->ipd_var + k->r_ipd);
+    c->ipd += g * (sep - c->ipd);
+    c->ipd_var *= 1.0 - g;
+    c->samples++;
+    return 1;
+}
+
+/* Current estimate and its variances */
+static inline void head_calib_model(const head_calib_t *c, head_calib_model_t *out)
+{
+    out->ipd = c->ipd;
+    out->eye_up = c->x[HEAD_CALIB_UP];
+    out->eye_fwd = c->x[HEAD_CALIB_FWD];
+    out->var[0] = c->ipd_var;
+    out->var[1] = c->P[HEAD_CALIB_UP][HEAD_CALIB_UP];
+    out->var[2] = c->P[HEAD_CALIB_FWD][HEAD_CALIB_FWD];
+    out->samples = c->prior + c->samples;
+}
+
+/* Bits of head_calib_apply()'s result */
+#define HEAD_CALIB_F_IPD    0x01u
+#define HEAD_CALIB_F_UP     0x02u
+#define HEAD_CALIB_F_FWD    0x04u
+
+/* Copy each well-determined, plausible parameter into the EKF model when
+ * it differs from it by more than apply_delta. Returns the fields changed. */
+static inline unsigned head_calib_apply(const head_calib_t *c, head_ekf_config_t *model)
+{
+    const head_calib_config_t *k = &c->cfg;
+    const double lo[3] = { HEAD_CALIB_IPD_MIN, HEAD_CALIB_UP_MIN, HEAD_CALIB_FWD_MIN };
+    const double hi[3] = { HEAD_CALIB_IPD_MAX, HEAD_CALIB_UP_MAX, HEAD_CALIB_FWD_MAX };
+    head_calib_model_t m;
+    head_calib_model(c, &m);
+    const double est[3] = { m.ipd, m.eye_up, m.eye_fwd };
+    head_real_t *dst[3] = { &model->ipd, &model->eye_up, &model->eye_fwd };
+    unsigned changed = 0;
+    for (int i = 0; i < 3; i++) {
+        if (m.var[i] > k->max_sigma * k->max_sigma || est[i] < lo[i] || est[i] > hi[i]) continue;
+        if (fabs(est[i] - *dst[i]) <= k->apply_delta) continue;
+        *dst[i] = est[i];
+        changed |= 1u << i;
+    }
+    return changed;
+}
+
+#endif /* SQUIG_HEAD_CALIB_H */
@@ -0,0 +1,436 @@
+/*
+ * head_ekf.h — 12-state extended Kalman filter for head pose (header-only)
+ *
+ * Option C, phase 4 (docs/TOBII_HEAD_TRACKING_OPTION_C.md):
+ *
+ *   x = [tx, ty, tz, yaw, pitch, roll, dtx, dty, dtz, dyaw, dpitch, droll]
+ *
+ * t is the head origin in tracker coordinates (mm, +X right, +Y up, +Z
+ * toward the user), angles are radians, velocities per second. The
+ * process model is constant velocity with white acceleration noise; the
+ * measurement is the two gaze_origin eye positions as predicted by a
+ * rigid head model (each eye at a fixed offset from the head origin):
+ *
+ *   eye = t + R(yaw, pitch, roll) · offset,   R = Ry(yaw) · Rx(pitch) · Rz(roll)
+ *
+ * The default origin is the neck pivot (eyes ~150 mm above, ~20 mm in
+ * front), so rotation moves the eyes on an arc while pivot translation
+ * is slow — that is what separates the two.
+ *
+ * Yaw and roll follow the usual inter-eye atan2 conventions (yaw =
+ * atan2(dz, dx), roll = atan2(dy, dx) of right - left); positive pitch
+ * raises the eyes.
+ *
+ * Everything is fixed-size and lives in head_ekf_t or on the stack — no
+ * allocation, no loops with runtime bounds beyond the 3/6 measurement
+ * rows. The structure is exploited rather than multiplied out:
+ *
+ *   predict  F = [I dt·I; 0 I], so F P Fᵀ is three 6×6 block updates
+ *            (O(n²), not O(n³)) on the upper triangle, mirrored
+ *   update   H = [I₃ J 0] per eye: P Hᵀ reads only 6 of the 12 columns;
+ *            the innovation covariance is Cholesky-factored and the gain
+ *            applied as a symmetric rank-m downdate P -= W Wᵀ with
+ *            W = P Hᵀ L⁻ᵀ, so P stays symmetric by construction and no
+ *            inverse or explicit gain is formed
+ *
+ * Rows of P are contiguous 12-element runs (3 AVX / 6 SSE2 vectors of
+ * doubles, half that in float) so the inner loops vectorize. `make bench`
+ * reports ns/step and tracking error on a synthetic head trajectory
+ * (src/tools/ekf_bench.c).
+ *
+ * State, covariance and model are head_real_t (head_math.h): double, or
+ * float with polynomial trig in a `make FLOAT32=1` build. Measurements
+ * come in as double either way.
+ *
+ *   head_ekf_t f;
+ *   head_ekf_config_t cfg = HEAD_EKF_DEFAULTS;
+ *   head_ekf_init(&f, &cfg);
+ *   head_ekf_seed(&f, left, right);              // first binocular sample
+ *   ...
+ *   head_ekf_predict(&f, dt);
+ *   head_ekf_update(&f, left_or_NULL, right_or_NULL);
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_HEAD_EKF_H
+#define SQUIG_HEAD_EKF_H
+
+#include <math.h>
+#include <string.h>
+#include "head_math.h"
+
+#define HEAD_EKF_N      12      /* state */
+#define HEAD_EKF_M      6       /* measurement: two eyes × xyz */
+
+enum {
+    HEAD_EKF_TX, HEAD_EKF_TY, HEAD_EKF_TZ,
+    HEAD_EKF_YAW, HEAD_EKF_PITCH, HEAD_EKF_ROLL,
+    HEAD_EKF_DTX, HEAD_EKF_DTY, HEAD_EKF_DTZ,
+    HEAD_EKF_DYAW, HEAD_EKF_DPITCH, HEAD_EKF_DROLL
+};
+
+typedef struct {
+    /* Head model: eye offsets from the head origin (mm) */
+    head_real_t ipd;            /* eye separation */
+    head_real_t eye_fwd;        /* eyes in front of the origin (toward the tracker) */
+    head_real_t eye_up;         /* eyes above the origin */
+    /* Noise */
+    head_real_t q_pos;          /* translation accel. spectral density, mm²/s³ */
+    head_real_t q_ang;          /* rotation accel. spectral density, rad²/s³ */
+    head_real_t r_eye;          /* eye position variance per axis, mm² */
+    head_real_t gate;           /* reject updates with innovation χ² above (0 = off) */
+    head_real_t pitch_prior;    /* σ of a zero-pitch pseudo-measurement, rad (0 = off) */
+    /* Initial uncertainty after head_ekf_seed() (standard deviations) */
+    head_real_t p0_pos;         /* mm */
+    head_real_t p0_ang;         /* rad */
+    head_real_t p0_vel;         /* mm/s, and the same number × 0.01 rad/s */
+} head_ekf_config_t;
+
+#define HEAD_EKF_DEFAULTS { 63.0, 20.0, 150.0, \
+                            200.0, 10.0, 1.0, 0.0, 0.6, \
+                            20.0, 0.2, 100.0 }
+
+typedef struct {
+    head_real_t x[HEAD_EKF_N] __attribute__((aligned(64)));
+    head_real_t P[HEAD_EKF_N][HEAD_EKF_N] __attribute__((aligned(64)));  /* symmetric; both halves valid */
+    head_ekf_config_t cfg;
+    int seeded;
+} head_ekf_t;
+
+/* ── Head model ─────────────────────────────────────────────────────── */
+
+static inline void head_ekf__mul3(const head_real_t a[3][3], const head_real_t b[3][3],
+                                  head_real_t out[3][3])
+{
+    for (int i = 0; i < 3; i++)
+        for (int j = 0; j < 3; j++)
+            out[i][j] = a[i][0] * b[0][j] + a[i][1] * b[1][j] + a[i][2] * b[2][j];
+}
+
+/* R(yaw, pitch, roll) and, if dR is non-NULL, ∂R/∂yaw, ∂R/∂pitch, ∂R/∂roll. */
+static inline void head_ekf_rotation(const head_real_t ang[3], head_real_t R[3][3],
+                                     head_real_t dR[3][3][3])
+{
+    head_real_t cy, sy, cp, sp, cr, sr;
+    head_sincos(ang[0], &sy, &cy);
+    head_sincos(ang[1], &sp, &cp);
+    head_sincos(ang[2], &sr, &cr);
+    const head_real_t Y[3][3]  = { { cy, 0, -sy }, { 0, 1, 0 }, { sy, 0, cy } };
+    const head_real_t X[3][3]  = { { 1, 0, 0 }, { 0, cp, -sp }, { 0, sp, cp } };
+    const head_real_t Z[3][3]  = { { cr, -sr, 0 }, { sr, cr, 0 }, { 0, 0, 1 } };
+    head_real_t YX[3][3], XZ[3][3];
+    head_ekf__mul3(Y, X, YX);
+    head_ekf__mul3(YX, Z, R);
+    if (!dR) return;
+
+    const head_real_t dY[3][3] = { { -sy, 0, -cy }, { 0, 0, 0 }, { cy, 0, -sy } };
+    const head_real_t dX[3][3] = { { 0, 0, 0 }, { 0, -sp, -cp }, { 0, cp, -sp } };
+    const head_real_t dZ[3][3] = { { -sr, -cr, 0 }, { cr, -sr, 0 }, { 0, 0, 0 } };
+    head_real_t t[3][3];
+    head_ekf__mul3(X, Z, XZ);
+    head_ekf__mul3(dY, XZ, dR[0]);
+    head_ekf__mul3(Y, dX, t);
+    head_ekf__mul3(t, Z, dR[1]);
+    head_ekf__mul3(YX, dZ, dR[2]);
+}
+
+/* Offset of eye e (0 = left, 1 = right) from the head origin, head frame */
+static inline void head_ekf_eye_offset(const head_ekf_config_t *c, int e, head_real_t o[3])
+{
+    o[0] = e ? c->ipd / 2 : -c->ipd / 2;
+    o[1] = c->eye_up;
+    o[2] = -c->eye_fwd;
+}
+
+/* Predicted eye positions for state x (either output may be NULL). */
+static inline void head_ekf_eyes(const head_ekf_config_t *c, const head_real_t *x,
+                                 double left[3], double right[3])
+{
+    head_real_t R[3][3];
+    head_ekf_rotation(x + HEAD_EKF_YAW, R, NULL);
+    for (int e = 0; e < 2; e++) {
+        double *out = e ? right : left;
+        if (!out) continue;
+        head_real_t o[3];
+        head_ekf_eye_offset(c, e, o);
+        for (int k = 0; k < 3; k++)
+            out[k] = x[k] + R[k][0] * o[0] + R[k][1] * o[1] + R[k][2] * o[2];
+    }
+}
+
+/* ── Filter ─────────────────────────────────────────────────────────── */
+
+static inline void head_ekf_init(head_ekf_t *f, const head_ekf_config_t *cfg)
+{
+    const head_ekf_config_t def = HEAD_EKF_DEFAULTS;
+    memset(f, 0, sizeof(*f));
+    f->cfg = cfg ? *cfg : def;
+}
+
+/* P diagonal from the config's initial uncertainty */
+static inline void head_ekf__p0(head_ekf_t *f)
+{
+    const head_ekf_config_t *c = &f->cfg;
+    memset(f->P, 0, sizeof(f->P));
+    for (int i = 0; i < 3; i++) {
+        f->P[i][i]         = c->p0_pos * c->p0_pos;
+        f->P[i + 3][i + 3] = c->p0_ang * c->p0_ang;
+        f->P[i + 6][i + 6] = c->p0_vel * c->p0_vel;
+        f->P[i + 9][i + 9] = 1e-4 * c->p0_vel * c->p0_vel;
+    }
+}
+
+/* Pose from one binocular sample by inversion of the model, at the
+ * given pitch (the eyes do not show it); velocities 0. */
+static inline void head_ekf__place(head_ekf_t *f, const double left[3], const double right[3],
+                                   head_real_t pitch)
+{
+    const head_ekf_config_t *c = &f->cfg;
+    head_real_t v[3], mid[3];
+    for (int k = 0; k < 3; k++) {
+        v[k] = right[k] - left[k];
+        mid[k] = (left[k] + right[k]) / 2;
+    }
+    memset(f->x, 0, sizeof(f->x));
+    f->x[HEAD_EKF_YAW]   = head_atan2(v[2], v[0]);
+    f->x[HEAD_EKF_PITCH] = pitch;
+    f->x[HEAD_EKF_ROLL]  = head_atan2(v[1], head_sqrt(v[0] * v[0] + v[2] * v[2]));
+
+    head_real_t R[3][3];
+    head_ekf_rotation(f->x + HEAD_EKF_YAW, R, NULL);
+    for (int k = 0; k < 3; k++)                 /* mid-eye offset is (0, up, -fwd) */
+        f->x[k] = mid[k] - (R[k][1] * c->eye_up - R[k][2] * c->eye_fwd);
+}
+
+/* Start from one binocular sample: pose by inversion of the model with
+ * pitch 0, velocities 0, P diagonal from the config. */
+static inline void head_ekf_seed(head_ekf_t *f, const double left[3], const double right[3])
+{
+    head_ekf__place(f, left, right, 0);
+    head_ekf__p0(f);
+    f->seeded = 1;
+}
+
+/* Resume after a long pause (the user stepped away and is back) from
+ * the pitch estimate held before it, pitch_var its variance inflated for
+ * the time away (capped at the seed's). Two eye points give yaw, roll
+ * and position at once, so those are placed from the sample with the
+ * seed's uncertainty, and the velocities restart at 0; pitch is seen
+ * only slowly, so the held estimate and its confidence carry over. */
+static inline void head_ekf_rewarm(head_ekf_t *f, const double left[3], const double right[3],
+                                   head_real_t pitch, head_real_t pitch_var)
+{
+    const head_real_t p0 = f->cfg.p0_ang * f->cfg.p0_ang;
+    head_ekf__place(f, left, right, pitch);
+    head_ekf__p0(f);
+    f->P[HEAD_EKF_PITCH][HEAD_EKF_PITCH] = pitch_var < p0 ? pitch_var : p0;
+}
+
+/* Advance by dt_s seconds: x = F x, P = F P Fᵀ + Q. With P = [A B; Bᵀ C]:
+ *   A' = A + dt (B + Bᵀ) + dt² C + dt³/3 q
+ *   B' = B + dt C              + dt²/2 q
+ *   C' = C                     + dt q */
+static inline void head_ekf_predict(head_ekf_t *f, double dt_s)
+{
+    if (dt_s <= 0) return;
+    const head_real_t dt = dt_s;
+    head_real_t *x = f->x;
+    head_real_t (*P)[HEAD_EKF_N] = f->P;
+
+    for (int i = 0; i < 6; i++) x[i] += dt * x[i + 6];
+
+    head_real_t dt2 = dt * dt;
+    for (int i = 0; i < 6; i++)
+        for (int j = i; j < 6; j++) {
+            head_real_t a = P[i][j] + dt * (P[i][j + 6] + P[j][i + 6]) + dt2 * P[i + 6][j + 6];
+            P[i][j] = a;
+            P[j][i] = a;
+        }
+    for (int i = 0; i < 6; i++)
+        for (int j = 0; j < 6; j++) {
+            head_real_t b = P[i][j + 6] + dt * P[i + 6][j + 6];
+            P[i][j + 6] = b;
+            P[j + 6][i] = b;
+        }
+
+    head_real_t q3 = dt2 * dt / 3, q2 = dt2 / 2;
+    for (int i = 0; i < 6; i++) {
+        head_real_t q = i < 3 ? f->cfg.q_pos : f->cfg.q_ang;
+        P[i][i]         += q3 * q;
+        P[i][i + 6]     += q2 * q;
+        P[i + 6][i]     += q2 * q;
+        P[i + 6][i + 6] += dt * q;
+    }
+}
+
+/* One EKF update over m rows (m ≤ HEAD_EKF_ROWS). Row r measures
+ * x[axis[r]] + J[r] · (yaw, pitch, roll) to first order; y is the
+ * innovation, var[r] its noise. Always inlined so that every call site
+ * below gets loops with constant bounds. Returns the innovation χ², or -1
+ * if gated out or S is not positive definite (state unchanged). */
+#define HEAD_EKF_ROWS   (HEAD_EKF_M + 2)        /* eyes + pitch prior + one scalar */
+
+static inline __attribute__((always_inline))
+double head_ekf__update_rows(head_ekf_t *f, const int m, const int *axis,
+                             const head_real_t (*J)[3], const head_real_t *y,
+                             const head_real_t *var)
+{
+    head_real_t (*P)[HEAD_EKF_N] = f->P;
+    head_real_t PHt[HEAD_EKF_N][HEAD_EKF_ROWS];
+    head_real_t L[HEAD_EKF_ROWS][HEAD_EKF_ROWS];
+    head_real_t W[HEAD_EKF_N][HEAD_EKF_ROWS];
+    head_real_t u[HEAD_EKF_ROWS];
+
+    /* P Hᵀ: H is nonzero only in columns axis[s] and 3-5 */
+    for (int i = 0; i < HEAD_EKF_N; i++)
+        for (int s = 0; s < m; s++)
+            PHt[i][s] = P[i][axis[s]] + P[i][3] * J[s][0] + P[i][4] * J[s][1] + P[i][5] * J[s][2];
+
+    /* S = H P Hᵀ + R (lower triangle), factored in place: S = L Lᵀ */
+    for (int s = 0; s < m; s++)
+        for (int t = 0; t <= s; t++)
+            L[s][t] = PHt[axis[s]][t] + J[s][0] * PHt[3][t] + J[s][1] * PHt[4][t] +
+                      J[s][2] * PHt[5][t] + (s == t ? var[s] : 0);
+    head_real_t inv[HEAD_EKF_ROWS];
+    for (int j = 0; j < m; j++) {
+        head_real_t d = L[j][j];
+        for (int k = 0; k < j; k++) d -= L[j][k] * L[j][k];
+        if (!(d > 0)) return -1;
+        d = head_sqrt(d);
+        L[j][j] = d;
+        inv[j] = 1 / d;
+        for (int i = j + 1; i < m; i++) {
+            head_real_t v = L[i][j];
+            for (int k = 0; k < j; k++) v -= L[i][k] * L[j][k];
+            L[i][j] = v * inv[j];
+        }
+    }
+
+    /* u = L⁻¹ y; χ² = |u|² */
+    head_real_t chi2 = 0;
+    for (int s = 0; s < m; s++) {
+        head_real_t v = y[s];
+        for (int k = 0; k < s; k++) v -= L[s][k] * u[k];
+        u[s] = v * inv[s];
+        chi2 += u[s] * u[s];
+    }
+    if (f->cfg.gate > 0 && chi2 > f->cfg.gate) return -1;
+
+    /* W = P Hᵀ L⁻ᵀ (row-wise forward substitution) */
+    for (int i = 0; i < HEAD_EKF_N; i++)
+        for (int s = 0; s < m; s++) {
+            head_real_t v = PHt[i][s];
+            for (int k = 0; k < s; k++) v -= L[s][k] * W[i][k];
+            W[i][s] = v * inv[s];
+        }
+
+    /* x += W u;  P -= W Wᵀ (upper triangle, mirrored) */
+    for (int i = 0; i < HEAD_EKF_N; i++) {
+        head_real_t dx = 0;
+        for (int s = 0; s < m; s++) dx += W[i][s] * u[s];
+        f->x[i] += dx;
+    }
+    for (int i = 0; i < HEAD_EKF_N; i++)
+        for (int j = i; j < HEAD_EKF_N; j++) {
+            head_real_t v = 0;
+            for (int s = 0; s < m; s++) v += W[i][s] * W[j][s];
+            P[i][j] -= v;
+            P[j][i] = P[i][j];
+        }
+    return chi2;
+}
+
+/* The row counts that occur: one eye / two eyes, each with or without the
+ * pitch prior and a batched scalar, and single-variable measurements. */
+static inline double head_ekf__update(head_ekf_t *f, int m, const int *axis,
+                                      const head_real_t (*J)[3], const head_real_t *y,
+                                      const head_real_t *var)
+{
+    switch (m) {
+    case 1: return head_ekf__update_rows(f, 1, axis, J, y, var);
+    case 3: return head_ekf__update_rows(f, 3, axis, J, y, var);
+    case 4: return head_ekf__update_rows(f, 4, axis, J, y, var);
+    case 5: return head_ekf__update_rows(f, 5, axis, J, y, var);
+    case 6: return head_ekf__update_rows(f, 6, axis, J, y, var);
+    case 7: return head_ekf__update_rows(f, 7, axis, J, y, var);
+    case 8: return head_ekf__update_rows(f, 8, axis, J, y, var);
+    default: return -1;
+    }
+}
+
+/* Direct measurement of one state variable (a pitch estimate, ...):
+ * z = x[idx] with variance var. Returns χ² (1 dof) or -1. */
+static inline double head_ekf_update_scalar(head_ekf_t *f, int idx, double z, double var)
+{
+    const int axis[1] = { idx };
+    const head_real_t J[1][3] = { { 0, 0, 0 } };
+    head_real_t y = z - f->x[idx], r = var;
+    return head_ekf__update(f, 1, axis, J, &y, &r);
+}
+
+/* A direct measurement of one state variable, for head_ekf_update_batch() */
+typedef struct {
+    int    idx;                 /* HEAD_EKF_* */
+    double z, var;
+} head_ekf_scalar_t;
+
+/* Fuse one gaze_origin sample and, in the same update, an optional scalar
+ * measurement taken at the same instant (extra NULL: none) — one
+ * Cholesky factorisation and one covariance downdate instead of one per
+ * stream. Either eye may be NULL (not tracked); with both NULL nothing
+ * happens. Returns the innovation χ² (3 or 6 degrees of freedom, +1 with
+ * the pitch prior, +1 with extra), or -1 if the sample was rejected. */
+static inline double head_ekf_update_batch(head_ekf_t *f, const double left[3], const double right[3],
+                                           const head_ekf_scalar_t *extra)
+{
+    const head_ekf_config_t *c = &f->cfg;
+    head_real_t R[3][3], dR[3][3][3];
+    head_ekf_rotation(f->x + HEAD_EKF_YAW, R, dR);
+
+    int axis[HEAD_EKF_ROWS];
+    head_real_t J[HEAD_EKF_ROWS][3], y[HEAD_EKF_ROWS], var[HEAD_EKF_ROWS];
+    int m = 0;
+    for (int e = 0; e < 2; e++) {
+        const double *z = e ? right : left;
+        if (!z) continue;
+        head_real_t o[3];
+        head_ekf_eye_offset(c, e, o);
+        for (int k = 0; k < 3; k++, m++) {
+            head_real_t h = f->x[k] + R[k][0] * o[0] + R[k][1] * o[1] + R[k][2] * o[2];
+            axis[m] = k;
+            y[m] = z[k] - h;
+            var[m] = c->r_eye;
+            for (int a = 0; a < 3; a++)
+                J[m][a] = dR[a][k][0] * o[0] + dR[a][k][1] * o[1] + dR[a][k][2] * o[2];
+        }
+    }
+    if (m == 0) return -1;
+
+    /* Two points leave rotation about the inter-eye axis unobserved (pitch
+     * trades against pivot translation); without a prior it random-walks. */
+    if (c->pitch_prior > 0) {
+        axis[m] = HEAD_EKF_PITCH;
+        J[m][0] = J[m][1] = J[m][2] = 0;
+        y[m] = -f->x[HEAD_EKF_PITCH];
+        var[m] = c->pitch_prior * c->pitch_prior;
+        m++;
+    }
+    if (extra) {
+        axis[m] = extra->idx;
+        J[m][0] = J[m][1] = J[m][2] = 0;
+        y[m] = extra->z - f->x[extra->idx];
+        var[m] = extra->var;
+        m++;
+    }
+    return head_ekf__update(f, m, axis, (const head_real_t (*)[3])J, y, var);
+}
+
+/* head_ekf_update_batch() without a scalar: just the eyes. */
+static inline double head_ekf_update(head_ekf_t *f, const double left[3], const double right[3])
+{
+    return head_ekf_update_batch(f, left, right, NULL);
+}
+
+#endif /* SQUIG_HEAD_EKF_H */
@@ -0,0 +1,99 @@
+/*
+ * head_gaze.h — gaze_point → a weak head-pitch measurement (header-only)
+ *
+ * Eyes lead and the head follows: when the user looks up or down the
+ * screen, the head takes a share of the movement. gaze_point's Y says
+ * where on the display the eyes went, and the mid-eye position from the
+ * EKF state says where they are, so their elevation angle is
+ *
+ *   e = atan2(s_y - m_y, m_z),  s_y = screen_up + (1 - gaze_y) · screen_h
+ *
+ * with the tracker under the display's bottom edge (tracker axes: +Y up,
+ * +Z toward the user, the display in the Z = 0 plane). The head's pitch
+ * is then about gain · (e - e₀), where e₀ is where this user habitually
+ * looks — learned over the first samples as a running mean and frozen,
+ * the same way head_vision.h learns the nose (the habitual head position
+ * is pitch 0). The eyes also move on their own, so the measurement is
+ * weak (sigma of several degrees): it steadies the pitch the EKF cannot
+ * see in two eye points rather than overriding it.
+ *
+ *   head_gaze_t g;
+ *   head_gaze_init(&g, NULL);
+ *   head_ekf_scalar_t m;
+ *   if (head_gaze_pitch(&g, &ekf, gaze_xy, &m))
+ *       head_ekf_update_batch(&ekf, left, right, &m);
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_HEAD_GAZE_H
+#define SQUIG_HEAD_GAZE_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "head_ekf.h"
+
+typedef struct {
+    double screen_h;            /* display height, mm */
+    double screen_up;           /* tracker to the bottom of the picture, mm */
+    double gain;                /* head pitch per unit of gaze elevation */
+    double sigma;               /* measurement σ, rad */
+    int    warmup;              /* samples that learn e₀ before pitch is fused */
+    double max_elev;            /* |e - e₀| beyond this is not the screen, rad */
+} head_gaze_config_t;
+
+/* 27" 16:9 display, head takes ~30% of a vertical gaze shift, σ 8°,
+ * warmup ~10 s at 90 Hz */
+#define HEAD_GAZE_DEFAULTS { 336.0, 10.0, 0.3, 0.14, 900, 0.6 }
+
+typedef struct {
+    head_gaze_config_t cfg;
+    double   e0;                /* habitual elevation, rad */
+    int      n;                 /* samples learned from */
+    uint64_t updates;           /* measurements handed out */
+    uint64_t rejected;          /* off the screen */
+} head_gaze_t;
+
+static inline void head_gaze_init(head_gaze_t *g, const head_gaze_config_t *cfg)
+{
+    const head_gaze_config_t def = HEAD_GAZE_DEFAULTS;
+    memset(g, 0, sizeof(*g));
+    g->cfg = cfg ? *cfg : def;
+}
+
+/* The pitch measurement for a gaze point (0..1 on the display) at the
+ * filter's current state. Returns 1 with *out filled, 0 while learning
+ * e₀ or if the point is implausible. */
+static inline int head_gaze_pitch(head_gaze_t *g, const head_ekf_t *f, const double gaze[2],
+                                  head_ekf_scalar_t *out)
+{
+    const head_gaze_config_t *c = &g->cfg;
+    if (gaze[1] < 0.0 || gaze[1] > 1.0) {
+        g->rejected++;
+        return 0;
+    }
+    double l[3], r[3];
+    head_ekf_eyes(&f->cfg, f->x, l, r);
+    double my = 0.5 * (l[1] + r[1]), mz = 0.5 * (l[2] + r[2]);
+    if (mz <= 0.0) return 0;
+    double sy = c->screen_up + (1.0 - gaze[1]) * c->screen_h;
+    double e = atan2(sy - my, mz);
+
+    if (g->n < c->warmup) {
+        g->e0 += (e - g->e0) / ++g->n;
+        return 0;
+    }
+    if (fabs(e - g->e0) > c->max_elev) {
+        g->rejected++;
+        return 0;
+    }
+    out->idx = HEAD_EKF_PITCH;
+    out->z = c->gain * (e - g->e0);
+    out->var = c->sigma * c->sigma;
+    g->updates++;
+    return 1;
+}
+
+#endif /* SQUIG_HEAD_GAZE_H */
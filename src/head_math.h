@@ -0,0 +1,110 @@
+/*
+ * head_math.h — Scalar type and trig for the head model and EKF (header-only)
+ *
+ * head_real_t is what head_ekf.h keeps its state, covariance and model
+ * in. It is double by default. Built with -DSQUIG_HEAD_FLOAT32 (`make
+ * FLOAT32=1`) it is float, for small ARM/Atom hosts where double math
+ * and libm trig are what the filter spends its time on: the 12×12
+ * covariance halves to 576 bytes (9 cache lines), its rows become 3 SSE
+ * / 1.5 AVX / 3 NEON vectors, and head_sincos / head_atan2 are the
+ * polynomials below instead of libm calls.
+ *
+ * The polynomials are branch-free (selects, no table, no errno), so they
+ * inline and vectorise. Cephes-style minimax on a reduced range:
+ *
+ *   sin, cos   x - k·π/2 in three steps (Cody-Waite), k from a rounding
+ *              add, then degree 7 / 8 on [-π/4, π/4] and a quadrant
+ *              select; |error| ≤ 2e-7 for |x| ≤ 100 rad
+ *   atan2      min/max ratio in [0, 1], folded about tan(π/8), degree 9
+ *              on [-0.42, 0.42], octant select; |error| ≤ 3e-7 rad,
+ *              atan2(0, 0) = 0
+ *
+ * That is four orders of magnitude inside the tracking targets (±2° is
+ * 0.035 rad); `make bench` (head_f32_bench) checks the bounds against
+ * libm and the float32 tracker against the double one.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_HEAD_MATH_H
+#define SQUIG_HEAD_MATH_H
+
+#include <math.h>
+
+/* ── Polynomial approximations (float, always available) ───────────── */
+
+#define HEAD_MATH_PI_2f     1.57079632679489661923f
+#define HEAD_MATH_PI_4f     0.78539816339744830962f
+
+/* sin x and cos x at once, the rotation needs both */
+static inline void head_fast_sincosf(float x, float *s, float *c)
+{
+    /* k = nearest integer to x / (π/2): adding 1.5·2²³ rounds it into the
+     * mantissa (valid for |x| < 2²² · π/2) */
+    const float magic = 12582912.0f;
+    float kf = (x * 0.63661977236758134308f + magic) - magic;
+    int k = (int)kf;
+    float r = x - kf * 1.5703125f;
+    r -= kf * 4.837512969970703125e-4f;
+    r -= kf * 7.54978995489188216e-8f;
+
+    float z = r * r;
+    float sr = ((-1.9515295891e-4f * z + 8.3321608736e-3f) * z - 1.6666654611e-1f) * z * r + r;
+    float cr = ((2.443315711809948e-5f * z - 1.388731625493765e-3f) * z + 4.166664568298827e-2f) * z * z -
+               0.5f * z + 1.0f;
+
+    /* Quadrant: sin = (s, c, -s, -c)[k & 3], cos = (c, -s, -c, s)[k & 3] */
+    float so = (k & 1) ? cr : sr;
+    float co = (k & 1) ? sr : cr;
+    *s = (k & 2) ? -so : so;
+    *c = ((k + 1) & 2) ? -co : co;
+}
+
+static inline float head_fast_atan2f(float y, float x)
+{
+    float ax = fabsf(x), ay = fabsf(y);
+    float mx = ax > ay ? ax : ay, mn = ax > ay ? ay : ax;
+    float a = mx > 0 ? mn / mx : 0.0f;                  /* [0, 1] */
+
+    /* Above tan(π/8): atan a = π/4 + atan((a - 1) / (a + 1)) */
+    int fold = a > 0.41421356237309504880f;
+    float t = fold ? (a - 1.0f) / (a + 1.0f) : a;
+    float z = t * t;
+    float r = (((8.05374449538e-2f * z - 1.38776856032e-1f) * z + 1.99777106478e-1f) * z -
+               3.33329491539e-1f) * z * t + t;
+    r += fold ? HEAD_MATH_PI_4f : 0.0f;
+
+    r = ay > ax ? HEAD_MATH_PI_2f - r : r;
+    r = x < 0 ? 2.0f * HEAD_MATH_PI_2f - r : r;
+    return y < 0 ? -r : r;
+}
+
+/* ── head_real_t ────────────────────────────────────────────────────── */
+
+#ifdef SQUIG_HEAD_FLOAT32
+
+typedef float head_real_t;
+
+static inline void head_sincos(head_real_t x, head_real_t *s, head_real_t *c)
+{
+    head_fast_sincosf(x, s, c);
+}
+static inline head_real_t head_atan2(head_real_t y, head_real_t x) { return head_fast_atan2f(y, x); }
+static inline head_real_t head_sqrt(head_real_t x) { return sqrtf(x); }
+
+#else
+
+typedef double head_real_t;
+
+static inline void head_sincos(head_real_t x, head_real_t *s, head_real_t *c)
+{
+    *s = sin(x);
+    *c = cos(x);
+}
+static inline head_real_t head_atan2(head_real_t y, head_real_t x) { return atan2(y, x); }
+static inline head_real_t head_sqrt(head_real_t x) { return sqrt(x); }
+
+#endif
+
+#endif /* SQUIG_HEAD_MATH_H */
@@ -0,0 +1,104 @@
+/*
+ * head_profile.c — Per-user head model, persisted between sessions
+ *
+ * See head_profile.h. Fields are packed with memcpy at fixed offsets
+ * (little-endian hosts, as everywhere else in this tree), not written as
+ * a struct, so padding never reaches the file.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "head_profile.h"
+#include "state_file.h"
+
+#define PROFILE_BYTES   (4 + 2 + 2 + 8 + 6 * 8 + 8 + 4)
+#define PROFILE_DIR     "squig-headtrack"
+
+const char *head_profile_default_user(void)
+{
+    const char *u = getenv("SUDO_USER");
+    if (!u || !*u) u = getenv("USER");
+    return u && *u ? u : "default";
+}
+
+int head_profile_path(const char *user, char *buf, size_t size)
+{
+    if (!*user || user[0] == '.') return -1;
+    for (const char *c = user; *c; c++)
+        if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') ||
+              *c == '.' || *c == '_' || *c == '-'))
+            return -1;
+
+    const char *dir = getenv("SQUIG_PROFILE_DIR"), *xdg = getenv("XDG_CONFIG_HOME");
+    const char *home = getenv("HOME");
+    int n;
+    if (dir && *dir) n = snprintf(buf, size, "%s/%s.profile", dir, user);
+    else if (xdg && *xdg) n = snprintf(buf, size, "%s/" PROFILE_DIR "/%s.profile", xdg, user);
+    else if (home && *home) n = snprintf(buf, size, "%s/.config/" PROFILE_DIR "/%s.profile", home, user);
+    else return -1;
+    return n > 0 && (size_t)n < size ? 0 : -1;
+}
+
+int head_profile_load(const char *path, head_calib_model_t *m)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        if (errno == ENOENT) return 1;
+        fprintf(stderr, "[CALIB] %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    uint8_t b[PROFILE_BYTES + 1];
+    size_t n = fread(b, 1, sizeof(b), f);
+    fclose(f);
+
+    uint32_t magic, sum;
+    uint16_t version, size;
+    memcpy(&magic, b, 4);
+    memcpy(&version, b + 4, 2);
+    memcpy(&size, b + 6, 2);
+    memcpy(&sum, b + PROFILE_BYTES - 4, 4);
+    if (n != PROFILE_BYTES || magic != HEAD_PROFILE_MAGIC || version != HEAD_PROFILE_VERSION ||
+        size != PROFILE_BYTES || sum != state_file_fnv1a(b, PROFILE_BYTES - 4)) {
+        fprintf(stderr, "[CALIB] %s: not a version %d profile, ignored\n", path, HEAD_PROFILE_VERSION);
+        return -1;
+    }
+    const uint8_t *p = b + 16;
+    memcpy(&m->ipd, p, 8);
+    memcpy(&m->eye_up, p + 8, 8);
+    memcpy(&m->eye_fwd, p + 16, 8);
+    memcpy(m->var, p + 24, 24);
+    memcpy(&m->samples, p + 48, 8);
+    return 0;
+}
+
+int head_profile_save(const char *path, const head_calib_model_t *m)
+{
+    uint8_t b[PROFILE_BYTES] = { 0 };
+    uint32_t magic = HEAD_PROFILE_MAGIC;
+    uint16_t version = HEAD_PROFILE_VERSION, size = PROFILE_BYTES;
+    int64_t saved = (int64_t)time(NULL);
+    memcpy(b, &magic, 4);
+    memcpy(b + 4, &version, 2);
+    memcpy(b + 6, &size, 2);
+    memcpy(b + 8, &saved, 8);
+    uint8_t *p = b + 16;
+    memcpy(p, &m->ipd, 8);
+    memcpy(p + 8, &m->eye_up, 8);
+    memcpy(p + 16, &m->eye_fwd, 8);
+    memcpy(p + 24, m->var, 24);
+    memcpy(p + 48, &m->samples, 8);
+    uint32_t sum = state_file_fnv1a(b, PROFILE_BYTES - 4);
+    memcpy(b + PROFILE_BYTES - 4, &sum, 4);
+
+    if (state_file_write(path, b, sizeof(b)) < 0) {
+        fprintf(stderr, "[CALIB] %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,57 @@
+/*
+ * head_profile.h — Per-user head model, persisted between sessions
+ *
+ * The streaming calibration (head_calib.h) needs a minute or two of
+ * ordinary head movement to pin a new user's head model down. A profile
+ * keeps what it found, so the next session starts tracking with that
+ * model from the first sample and only refines it.
+ *
+ * A profile is a small binary file, one per user:
+ *
+ *   $SQUIG_PROFILE_DIR/<user>.profile, else
+ *   $XDG_CONFIG_HOME/squig-headtrack/<user>.profile, else
+ *   ~/.config/squig-headtrack/<user>.profile
+ *
+ *   "SQHP" u32 magic, u16 version, u16 size, i64 saved (Unix seconds),
+ *   f64 ipd, eye_up, eye_fwd (mm), f64 their variances (mm²),
+ *   u64 samples, u32 FNV-1a of everything before it
+ *
+ * Saves go to a temporary file that is renamed over the old one, so a
+ * crash mid-save leaves the previous profile intact. A file with the
+ * wrong magic, version, size or checksum is ignored (with a message) and
+ * overwritten by the next save.
+ *
+ *   char path[512];
+ *   head_calib_model_t m;
+ *   head_profile_path(user, path, sizeof(path));
+ *   if (head_profile_load(path, &m) == 0) head_tracker_calibrate(&t, NULL, &m);
+ *   ...
+ *   head_profile_save(path, &m);
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_HEAD_PROFILE_H
+#define SQUIG_HEAD_PROFILE_H
+
+#include <stddef.h>
+#include "head_calib.h"
+
+#define HEAD_PROFILE_MAGIC      0x50485153u     /* "SQHP" */
+#define HEAD_PROFILE_VERSION    1
+
+/* The user a profile is keyed on by default: $SUDO_USER, $USER, "default" */
+const char *head_profile_default_user(void);
+
+/* Profile path for user (letters, digits, '.', '_', '-'). Returns 0, or
+ * -1 if the name is not usable or the path does not fit. */
+int head_profile_path(const char *user, char *buf, size_t size);
+
+/* Returns 0 (m filled), 1 if there is no profile yet, -1 if it is unreadable. */
+int head_profile_load(const char *path, head_calib_model_t *m);
+
+/* Create the directory if needed, write, rename into place. Returns 0 or -1. */
+int head_profile_save(const char *path, const head_calib_model_t *m);
+
+#endif /* SQUIG_HEAD_PROFILE_H */
@@ -0,0 +1,295 @@
+/*
+ * head_tracker.h — gaze_origin samples → head pose (header-only)
+ *
+ * The per-sample pipeline of squig-headtrackd, shared with the replay
+ * bench so both run exactly the same code:
+ *
+ *   calib    head_calib.h (optional): refine the head model from each
+ *            binocular sample, at the filter's pitch; once a second,
+ *            hand what is well determined to the EKF, moving its pivot
+ *            (and the output origin) to match, so the eyes and the pose
+ *            do not jump
+ *   filter   head_ekf.h: (re)seed on the first binocular sample or after
+ *            a gap (after a head_tracker_resume() pause: resume warm
+ *            instead), predict to the sample's timestamp_us, update with
+ *            whichever eyes are valid and, in the same batched update,
+ *            the gaze_point pitch measurement (head_gaze.h) when the
+ *            sample carries one
+ *   output   pose_predict.h look-ahead to now_us (optional), translation
+ *            relative to where the pivot was at seeding, degrees, flags
+ *            and confidence
+ *
+ * The stages are separate calls so a bench can time them apart;
+ * head_tracker_update() runs them all. Where IR frames are available,
+ * head_tracker_vision() adds each frame's pupil / glint / nostril
+ * features (eye_detect.h) as pitch and roll measurements (head_vision.h)
+ * between samples, on the same thread.
+ *
+ * A sample is gaze_origin plus whatever gaze_fusion.h aligned to its
+ * timestamp_us from the other streams: the gaze point, and per eye
+ * whether eye_position_normalized puts it inside the track box. An eye
+ * that gaze_origin reports but eye_position_normalized has outside the
+ * box is left out of the update: the two streams
+ * disagree, and it is usually the edge-of-box eye that is wrong.
+ *
+ *   head_tracker_t t;
+ *   head_tracker_init(&t, NULL, &predict_cfg);    // NULL predict_cfg: no look-ahead
+ *   head_tracker_calibrate(&t, NULL, profile);    // optional; NULL profile: defaults
+ *   head_tracker_update(&t, &sample, now_us, &pose);
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_HEAD_TRACKER_H
+#define SQUIG_HEAD_TRACKER_H
+
+#include <stdint.h>
+#include <string.h>
+#include "head_ekf.h"
+#include "head_calib.h"
+#include "head_vision.h"
+#include "head_gaze.h"
+#include "pose_predict.h"
+
+#define HEAD_TRACKER_RESEED_GAP_US  500000      /* longer gaps restart the filter */
+#define HEAD_TRACKER_CALIB_EVERY    90          /* binocular samples between model updates */
+#define HEAD_TRACKER_AWAY_PITCH_VAR 2e-5        /* rad²/s: held pitch variance growth while away */
+
+/* head_tracker_pose_t.flags (same bits as POSE_SHM_F_*) */
+#define HEAD_TRACKER_F_LEFT         0x01u
+#define HEAD_TRACKER_F_RIGHT        0x02u
+#define HEAD_TRACKER_F_PREDICTED    0x04u
+
+typedef struct {
+    int64_t timestamp_us;
+    int     left_valid, right_valid;
+    double  left[3], right[3];  /* mm, tracker axes */
+    /* Aligned from the other streams (gaze_fusion.h); zero = not known */
+    int     gaze_valid;
+    double  gaze[2];            /* gaze_point, 0..1 on the display */
+    int     box_left, box_right;    /* 1 inside the track box, -1 outside */
+} head_tracker_sample_t;
+
+typedef struct {
+    double   x, y, z;           /* mm from the starting pivot position, tracker axes */
+    double   base[3];           /* that position (x + base[0]...: the pivot), changes on a reseed */
+    double   yaw, pitch, roll;  /* degrees */
+    int      eyes;              /* valid eyes this sample (0-2) */
+    float    confidence;        /* 0 (no eyes) .. 1 (both eyes, in the gate) */
+    uint32_t flags;             /* HEAD_TRACKER_F_* */
+} head_tracker_pose_t;
+
+typedef struct {
+    head_ekf_t     ekf;
+    pose_predict_t pred;
+    int            predict;     /* 0 = emit the EKF state as is */
+    head_real_t    base[3];     /* pivot position when the filter was seeded */
+    head_real_t    base_ang[3]; /* yaw, pitch, roll then */
+    int64_t        last_us;     /* timestamp_us of the last sample filtered */
+    int            accepted;    /* last update passed the gate */
+    uint64_t       reseeds;
+    uint64_t       rejected;    /* updates refused by the filter */
+    head_calib_t   calib;
+    int            calibrate;   /* run the calib stage */
+    uint32_t       calib_n;
+    uint64_t       model_updates;   /* head_calib_apply() changed the model */
+    head_vision_t  vision;
+    int            use_vision;  /* head_tracker_vision() fuses */
+    head_gaze_t    gaze;
+    int            use_gaze;    /* batch the gaze_point pitch into updates */
+    uint64_t       inconsistent;    /* samples with an eye dropped by the box check */
+    double         held_pitch;  /* after the last update with eyes */
+    double         held_pitch_var;  /* ... and its variance */
+    int            resume;      /* next binocular sample resumes warm (head_tracker_resume) */
+    uint64_t       resumes;     /* ... and did */
+} head_tracker_t;
+
+static inline void head_tracker_init(head_tracker_t *t, const head_ekf_config_t *ekf_cfg,
+                                     const pose_predict_config_t *predict_cfg)
+{
+    memset(t, 0, sizeof(*t));
+    head_ekf_init(&t->ekf, ekf_cfg);
+    pose_predict_init(&t->pred, predict_cfg);
+    t->predict = predict_cfg != NULL;
+    t->accepted = 1;
+}
+
+/* Turn on the calib stage, starting from a stored model or, with profile
+ * NULL, from the EKF's own. The EKF adopts the stored parameters that
+ * were well determined (head_calib_apply()'s test) right away. */
+static inline void head_tracker_calibrate(head_tracker_t *t, const head_calib_config_t *cfg,
+                                          const head_calib_model_t *profile)
+{
+    head_calib_init(&t->calib, cfg, &t->ekf.cfg, profile);
+    t->calibrate = 1;
+    if (!profile) return;
+    const double ms = t->calib.cfg.max_sigma;
+    if (profile->var[0] <= ms * ms) t->ekf.cfg.ipd = profile->ipd;
+    if (profile->var[1] <= ms * ms) t->ekf.cfg.eye_up = profile->eye_up;
+    if (profile->var[2] <= ms * ms) t->ekf.cfg.eye_fwd = profile->eye_fwd;
+}
+
+/* Accept IR-frame features from head_tracker_vision(), seen through cam
+ * (NULL for EYE_CAMERA_DEFAULTS). */
+static inline void head_tracker_use_vision(head_tracker_t *t, const head_vision_config_t *cfg,
+                                           const eye_camera_t *cam)
+{
+    head_vision_init(&t->vision, cfg, cam);
+    t->use_vision = 1;
+}
+
+/* Batch each sample's gaze point into its update as a pitch measurement
+ * (cfg NULL for HEAD_GAZE_DEFAULTS). */
+static inline void head_tracker_use_gaze(head_tracker_t *t, const head_gaze_config_t *cfg)
+{
+    head_gaze_init(&t->gaze, cfg);
+    t->use_gaze = 1;
+}
+
+/* The user was away and the samples stopped. Instead of the reseed a
+ * gap normally causes, the next binocular sample resumes the filter
+ * warm (head_ekf_rewarm): yaw, roll and position placed from that
+ * sample, the pitch and pitch variance of the last update that had eyes
+ * (not wherever prediction drifted them once they were gone), the
+ * variance grown by HEAD_TRACKER_AWAY_PITCH_VAR per second away — a
+ * seated user comes back within a few degrees, where the motion model
+ * would forget pitch in a fraction of a second. The output origin, head
+ * model, calibration and learned references (head_vision.h,
+ * head_gaze.h) are kept, so the pose continues in the same frame and
+ * pitch, the slow one, need not re-converge. */
+static inline void head_tracker_resume(head_tracker_t *t)
+{
+    if (t->ekf.seeded) t->resume = 1;
+}
+
+/* Eye e of s, unless eye_position_normalized contradicts gaze_origin */
+static inline int head_tracker__eye(const head_tracker_sample_t *s, int e)
+{
+    return e ? s->right_valid && s->box_right >= 0 : s->left_valid && s->box_left >= 0;
+}
+
+/* Calib stage. Returns the HEAD_CALIB_F_* fields changed in the EKF model. */
+static inline unsigned head_tracker_calib(head_tracker_t *t, const head_tracker_sample_t *s)
+{
+    if (!t->calibrate || !head_tracker__eye(s, 0) || !head_tracker__eye(s, 1)) return 0;
+    head_calib_add(&t->calib, s->left, s->right, t->ekf.seeded ? t->ekf.x[HEAD_EKF_PITCH] : 0);
+    if (++t->calib_n < HEAD_TRACKER_CALIB_EVERY) return 0;
+    t->calib_n = 0;
+
+    head_ekf_t *f = &t->ekf;
+    const double up = f->cfg.eye_up, fwd = f->cfg.eye_fwd;
+    unsigned changed = head_calib_apply(&t->calib, &f->cfg);
+    if (!changed) return 0;
+    t->model_updates++;
+    if (f->seeded) {
+        /* Same mid-eye point under the new offsets: pivot += R (o_old - o_new),
+         * now and (for the output origin) at seeding */
+        head_real_t R[3][3], R0[3][3];
+        double du = up - f->cfg.eye_up, df = -(fwd - f->cfg.eye_fwd);
+        head_ekf_rotation(f->x + HEAD_EKF_YAW, R, NULL);
+        head_ekf_rotation(t->base_ang, R0, NULL);
+        for (int k = 0; k < 3; k++) {
+            f->x[k] += R[k][1] * du + R[k][2] * df;
+            t->base[k] += R0[k][1] * du + R0[k][2] * df;
+        }
+    }
+    return changed;
+}
+
+/* Filter stage. Returns 1 while the filter holds a state. */
+static inline int head_tracker_filter(head_tracker_t *t, const head_tracker_sample_t *s)
+{
+    head_ekf_t *f = &t->ekf;
+    int lv = head_tracker__eye(s, 0), rv = head_tracker__eye(s, 1);
+    if (lv != s->left_valid || rv != s->right_valid) t->inconsistent++;
+    int64_t dt_us = s->timestamp_us - t->last_us;
+    int warm = 0;
+    if (t->resume) {
+        if (!lv || !rv) return f->seeded;      /* hold it until both eyes are back */
+        t->resume = 0;
+        warm = f->seeded && dt_us > 0;
+    }
+    if (warm) {
+        head_ekf_rewarm(f, s->left, s->right, t->held_pitch,
+                        t->held_pitch_var + HEAD_TRACKER_AWAY_PITCH_VAR * (dt_us * 1e-6));
+        pose_predict_reset(&t->pred);
+        t->resumes++;
+    } else if (f->seeded && (dt_us <= 0 || dt_us > HEAD_TRACKER_RESEED_GAP_US)) {
+        f->seeded = 0;
+    }
+    if (!f->seeded && lv && rv) {
+        head_ekf_seed(f, s->left, s->right);
+        memcpy(t->base, f->x, sizeof(t->base));
+        memcpy(t->base_ang, f->x + HEAD_EKF_YAW, sizeof(t->base_ang));
+        pose_predict_reset(&t->pred);
+        t->reseeds++;
+        t->last_us = s->timestamp_us;
+        t->held_pitch = 0;
+        t->held_pitch_var = f->P[HEAD_EKF_PITCH][HEAD_EKF_PITCH];
+    }
+    t->accepted = 1;
+    if (f->seeded && (warm || t->last_us != s->timestamp_us)) {
+        if (!warm) head_ekf_predict(f, dt_us * 1e-6);   /* nothing to predict across a pause */
+        t->last_us = s->timestamp_us;
+        head_ekf_scalar_t gz;
+        const head_ekf_scalar_t *extra = t->use_gaze && s->gaze_valid && (lv || rv) &&
+                                         head_gaze_pitch(&t->gaze, f, s->gaze, &gz) ? &gz : NULL;
+        if ((lv || rv) &&
+            head_ekf_update_batch(f, lv ? s->left : NULL, rv ? s->right : NULL, extra) < 0) {
+            t->rejected++;
+            t->accepted = 0;
+        } else if (lv || rv) {
+            t->held_pitch = f->x[HEAD_EKF_PITCH];
+            t->held_pitch_var = f->P[HEAD_EKF_PITCH][HEAD_EKF_PITCH];
+        }
+    }
+    return f->seeded;
+}
+
+/* Vision stage: one frame's features, frame_us on the timestamp_us clock.
+ * Frames usually trail the last sample (a lagged measurement); one that
+ * is slightly ahead is taken back to it the same way, so the sample
+ * timeline, which reseeds on a step backwards, is left alone. Returns
+ * HEAD_VISION_F_*. */
+static inline unsigned head_tracker_vision(head_tracker_t *t, const eye_features_t *e, int64_t frame_us)
+{
+    if (!t->use_vision || !t->ekf.seeded) return 0;
+    return head_vision_update(&t->vision, &t->ekf, e, (t->last_us - frame_us) * 1e-6);
+}
+
+/* Output stage for the sample just filtered. now_us: same clock as
+ * timestamp_us, when the pose will be emitted (look-ahead target). */
+static inline void head_tracker_output(head_tracker_t *t, const head_tracker_sample_t *s,
+                                       int64_t now_us, head_tracker_pose_t *out)
+{
+    const head_ekf_t *f = &t->ekf;
+    double x[6];
+    if (t->predict && f->seeded)
+        pose_predict_step(&t->pred, f->x, s->timestamp_us, now_us, x);
+    else
+        for (int k = 0; k < 6; k++) x[k] = f->x[k];
+    const double r2d = 180.0 / M_PI;
+    int lv = head_tracker__eye(s, 0), rv = head_tracker__eye(s, 1);
+    out->x = x[HEAD_EKF_TX] - t->base[0];
+    out->y = x[HEAD_EKF_TY] - t->base[1];
+    out->z = x[HEAD_EKF_TZ] - t->base[2];
+    for (int k = 0; k < 3; k++) out->base[k] = t->base[k];
+    out->yaw   = x[HEAD_EKF_YAW]   * r2d;
+    out->pitch = x[HEAD_EKF_PITCH] * r2d;
+    out->roll  = x[HEAD_EKF_ROLL]  * r2d;
+    out->eyes  = lv + rv;
+    out->flags = (lv ? HEAD_TRACKER_F_LEFT : 0) | (rv ? HEAD_TRACKER_F_RIGHT : 0);
+    if (!lv && !rv) out->flags |= HEAD_TRACKER_F_PREDICTED;
+    out->confidence = f->seeded ? (float)out->eyes * (t->accepted ? 0.5f : 0.25f) : 0.0f;
+}
+
+static inline void head_tracker_update(head_tracker_t *t, const head_tracker_sample_t *s,
+                                       int64_t now_us, head_tracker_pose_t *out)
+{
+    head_tracker_calib(t, s);
+    head_tracker_filter(t, s);
+    head_tracker_output(t, s, now_us, out);
+}
+
+#endif /* SQUIG_HEAD_TRACKER_H */
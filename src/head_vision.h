@@ -0,0 +1,172 @@
+/*
+ * head_vision.h — IR-frame features → pitch and roll measurements (header-only)
+ *
+ * head_ekf.h's pitch is a prior: two eye points say nothing about
+ * rotation about the line through them. eye_detect.h finds what does,
+ * and this turns it into single-variable EKF measurements
+ * (head_ekf_update_scalar) for one frame:
+ *
+ *   roll   the line through the two corneas (glint centroids, which do
+ *          not move with gaze), back-projected at the eyes' depth. Its
+ *          slope T = dy / dx is cos p sin r / (cos y cos r - sin y sin p
+ *          sin r) for R = Ry Rx Rz, so roll = atan2(T cos y, cos p +
+ *          T sin y sin p): exact for any yaw, and a few times finer than
+ *          gaze_origin's millimetres over the IPD
+ *   pitch  the nostril midpoint sits k below and a·k in front of the eye
+ *          line (head frame). Seen by the camera, its drop below the
+ *          mid-eye point is h = k (cos r cos p - a sin p), which pitch
+ *          shortens; h is measured in mm by back-projecting both points
+ *          at their model depths. Linearised about the predicted pitch
+ *          (an EKF update on the pitch row alone), with the variance the
+ *          pixel noise gives through dh/dp
+ *
+ * k is the user's face, not a constant: it is learned during the first
+ * frames (the running mean of h / (cos r cos p - a sin p) with the
+ * EKF's prior pitch, i.e. the user's habitual head position is pitch 0)
+ * and frozen after, so pitch does not absorb itself back into k. a only
+ * shapes the curve and stays at its default.
+ *
+ * Frames arrive later than the gaze samples of the same instant (capture
+ * + detection). Given the lag since the frame, the state is rolled back
+ * along its velocity for the model, the result rolled forward again, and
+ * the measurement variance grows by lag² times the rate's variance (a
+ * frame a little newer than the state is handled the same way).
+ *
+ *   head_vision_t v;
+ *   head_vision_init(&v, NULL, &cam);
+ *   head_vision_update(&v, &ekf, &features, lag_s);     // each frame
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_HEAD_VISION_H
+#define SQUIG_HEAD_VISION_H
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+#include "head_ekf.h"
+#include "eye_detect.h"
+
+/* head_vision_update() result */
+#define HEAD_VISION_F_ROLL      0x01u
+#define HEAD_VISION_F_PITCH     0x02u
+
+typedef struct {
+    double nose_down;           /* starting k: nostrils below the eye line, mm */
+    double nose_fwd;            /* a: ... and in front of it, as a fraction of k */
+    double sigma_px;            /* centroid noise, px */
+    int    warmup;              /* frames that learn k before pitch is fused */
+    double max_lag;             /* older frames are dropped, s */
+    double gate;                /* χ² (1 dof) above which a measurement is dropped */
+    int    roll;                /* fuse roll as well */
+} head_vision_config_t;
+
+#define HEAD_VISION_DEFAULTS { 45.0, 0.45, 0.3, 300, 0.1, 16.0, 1 }   /* warmup ~10 s at 30 fps */
+
+typedef struct {
+    head_vision_config_t cfg;
+    eye_camera_t cam;
+    double   k;                 /* learned nose_down, mm */
+    int      n;                 /* frames learned from */
+    uint64_t roll_updates, pitch_updates;
+    uint64_t rejected;          /* gated, implausible or refused by the filter */
+} head_vision_t;
+
+static inline void head_vision_init(head_vision_t *v, const head_vision_config_t *cfg,
+                                    const eye_camera_t *cam)
+{
+    const head_vision_config_t def = HEAD_VISION_DEFAULTS;
+    const eye_camera_t cam_def = EYE_CAMERA_DEFAULTS;
+    memset(v, 0, sizeof(*v));
+    v->cfg = cfg ? *cfg : def;
+    v->cam = cam ? *cam : cam_def;
+    v->k = v->cfg.nose_down;
+}
+
+/* Gate, then z (at the frame) moved forward by lag along state rate ri. */
+static inline int head_vision__fuse(head_vision_t *v, head_ekf_t *f, int idx, double z, double var,
+                                    double lag)
+{
+    int ri = idx + 6;
+    z += lag * f->x[ri];
+    var += lag * lag * f->P[ri][ri];
+    double y = z - f->x[idx];
+    if (y * y > v->cfg.gate * (var + f->P[idx][idx]) || head_ekf_update_scalar(f, idx, z, var) < 0) {
+        v->rejected++;
+        return 0;
+    }
+    return 1;
+}
+
+/* Fuse one frame's features into f (predicted to the newest sample);
+ * lag: seconds from the frame to f's time (negative if the frame is
+ * newer). Returns HEAD_VISION_F_*. */
+static inline unsigned head_vision_update(head_vision_t *v, head_ekf_t *f, const eye_features_t *e,
+                                          double lag)
+{
+    const head_vision_config_t *c = &v->cfg;
+    if (!f->seeded || fabs(lag) > c->max_lag) return 0;
+    const eye_feature_t *el = &e->eye[0], *er = &e->eye[1];
+    if (!el->found || !er->found || !el->nglints || !er->nglints) return 0;
+
+    /* State at the frame */
+    head_real_t x[HEAD_EKF_N] = { 0 };
+    for (int k = 0; k < 6; k++) x[k] = f->x[k] - lag * f->x[k + 6];
+    double L[3], R[3];
+    head_real_t P[3][3];
+    head_ekf_eyes(&f->cfg, x, L, R);
+    head_ekf_rotation(x + HEAD_EKF_YAW, P, NULL);
+    double cy = cos(x[HEAD_EKF_YAW]), sy = sin(x[HEAD_EKF_YAW]);
+    double cp = cos(x[HEAD_EKF_PITCH]), sp = sin(x[HEAD_EKF_PITCH]);
+    double cr = cos(x[HEAD_EKF_ROLL]);
+
+    double pl[3], pr[3], vx[3];
+    eye_camera_unproject(&v->cam, el->cornea, L[2], pl);
+    eye_camera_unproject(&v->cam, er->cornea, R[2], pr);
+    for (int k = 0; k < 3; k++) vx[k] = pr[k] - pl[k];
+    if (vx[0] <= 0) return 0;                           /* eyes swapped: not this user */
+    double mm = c->sigma_px * 0.5 * (L[2] + R[2]) / v->cam.fx;     /* 1σ, mm at the eyes */
+
+    unsigned done = 0;
+    if (c->roll) {
+        double T = vx[1] / vx[0];
+        double z = atan2(T * cy, cp + T * sy * sp);
+        double s = M_SQRT2 * mm / hypot(vx[0], vx[1]);
+        if (head_vision__fuse(v, f, HEAD_EKF_ROLL, z, s * s, lag)) {
+            v->roll_updates++;
+            done |= HEAD_VISION_F_ROLL;
+        }
+    }
+    if (!e->nostrils_found) return done;
+
+    /* Nostril midpoint at its model depth, drop below the mid-eye point */
+    const double a = c->nose_fwd;
+    double mid[3], n[3];
+    for (int k = 0; k < 3; k++) mid[k] = 0.5 * (pl[k] + pr[k]);
+    double nz = 0.5 * (L[2] + R[2]) - v->k * (P[2][1] + a * P[2][2]);
+    eye_camera_unproject(&v->cam, e->nostril_mid, nz, n);
+    double h = mid[1] - n[1];
+    double shape = cr * cp - a * sp;                    /* h / k */
+
+    if (v->n < c->warmup) {
+        double k_obs = h / shape;
+        if (shape > 0.3 && k_obs > 0.4 * c->nose_down && k_obs < 2.5 * c->nose_down) {
+            v->n++;
+            v->k += (k_obs - v->k) / v->n;
+        }
+        return done;
+    }
+    double H = -v->k * (cr * sp + a * cp);              /* dh / dpitch */
+    if (fabs(H) < 1e-3 * v->k) return done;
+    double z = x[HEAD_EKF_PITCH] + (h - v->k * shape) / H;
+    double s = 1.2 * mm / fabs(H);
+    if (head_vision__fuse(v, f, HEAD_EKF_PITCH, z, s * s, lag)) {
+        v->pitch_updates++;
+        done |= HEAD_VISION_F_PITCH;
+    }
+    return done;
+}
+
+#endif /* SQUIG_HEAD_VISION_H */
@@ -0,0 +1,1021 @@
+/*
+ * headtrackd.c — squig-headtrackd: headless gaze_origin → head pose daemon
+ *
+ * The Option C pipeline (docs/TOBII_HEAD_TRACKING_OPTION_C.md) as a
+ * long-running process with a real-time acquisition loop:
+ *
+ *   acquisition  tobii_wait_for_callbacks() → tobii_device_process_callbacks()
+ *                gaze_origin callback → SPSC ring (no locks, no allocation);
+ *                gaze_point and eye_position_normalized → their own rings
+ *                optionally SCHED_FIFO and pinned to one CPU (--fifo, --cpu)
+ *   filter       ring → align the other streams → pose → emit;
+ *                per-sample latency accounting
+ *   main         signals, once-a-second status line
+ *
+ * The acquisition thread sleeps inside Stream Engine until a packet
+ * arrives instead of polling process_callbacks() on a usleep() (the test
+ * tools do that, adding up to a poll period of jitter to every sample).
+ * The callback only stamps the sample with tobii_system_clock() — the
+ * one SE call allowed inside a callback, on the same clock as
+ * timestamp_us — and pushes it; everything else runs on the filter
+ * thread, so a slow consumer can only overflow the ring (counted), never
+ * stall the device. A lost connection is recovered on the same thread
+ * by the shared session layer (se_session.h): tobii_device_reconnect()
+ * first, then a fresh device from the cached URL on the same API.
+ *
+ * Latency is measured per sample on the SE clock:
+ *   acq    timestamp_us → callback          (device, USB, SE)
+ *   filter callback     → pose emitted      (ring handoff, pose)
+ *   total  timestamp_us → pose emitted
+ * The status line shows the mean and worst total per second; --latency-log
+ * writes every sample as CSV.
+ *
+ * The same path is also timed on the host clock, stage by stage: device
+ * sample (timestamp_us mapped to CLOCK_MONOTONIC by clock_sync.h, fed
+ * with a tobii_system_clock() query every 250 ms), callback arrival,
+ * filter done, output sent. Each stage and the end-to-end total go into
+ * lat_hist.h histograms; SIGUSR1 (and exit) prints their p50/p99/p99.9,
+ * the clock model and the share of poses over the 15 ms target.
+ *
+ * Pose comes from the 12-state EKF in head_ekf.h (rigid head on a neck
+ * pivot, constant velocity), predicted to each sample's timestamp_us and
+ * updated with whichever eyes are valid; translation is reported relative
+ * to where the pivot was when tracking (re)started. A look-ahead stage
+ * (pose_predict.h) then extrapolates the filtered state from timestamp_us
+ * to the moment of emission plus --lookahead ms, with motion-adaptive
+ * smoothing: heavy while the head is still, light during fast turns
+ * (--no-predict emits the bare EKF state).
+ *
+ * gaze_point and eye_position_normalized are not filtered on their own:
+ * their callbacks only queue them (gaze_fusion.h), and the filter thread
+ * aligns them to each gaze_origin sample's timestamp_us, so one EKF
+ * update per sample carries the gaze point's pitch (head_gaze.h) next to
+ * the eyes, and an eye the track box contradicts is left out of it
+ * (--origin-only: gaze_origin alone, the other streams not subscribed).
+ *
+ * While the user is away the pipeline idles (presence_gate.h): after 3 s
+ * of user_presence AWAY each tracker's acquisition thread unsubscribes
+ * its gaze streams and only wakes for presence updates, ~10 Hz, and its
+ * filter thread parks on the gate with no clock probes or ring
+ * time-outs. On PRESENT the streams come back and the filter resumes
+ * warm (head_tracker_resume): the pitch estimate and its variance, head
+ * model, learned references and output origin from before, so tracking
+ * is back to quality within a sample or two instead of re-converging
+ * from a seed.
+ * Without user_presence, or with --no-presence, nothing is gated.
+ *
+ * --metrics unix:PATH | PORT | HOST:PORT serves Prometheus text
+ * (metrics.h): per tracker the sample, pose and drop counters above, the
+ * presence gate, rejected updates, and histograms of the filter step and
+ * the end-to-end latency; the fused and per-UDP-destination counts. The
+ * filter threads record into shards of their own (a few ns per sample);
+ * the counters that already exist are read at scrape time.
+ *
+ * The head model the EKF uses (IPD, eye offsets from the neck pivot) is
+ * calibrated while tracking, from the same samples (head_calib.h, a few
+ * hundred ns per sample on the filter thread), and kept per user in a
+ * small profile (head_profile.h; --user NAME, default the login user, or
+ * --profile FILE). A known user starts with their model from the first
+ * sample; a new one starts from the defaults and converges over a minute
+ * or two of normal head movement. The filter thread hands each model
+ * update to the main thread, which does the file I/O (--no-calib: fixed
+ * default model, no profile). Every pose is
+ * published to a /dev/shm seqlock segment (pose_shm.h, default
+ * /squig-headpose, readable by this user only, or --shm-group's members)
+ * for games and other local readers, and optionally
+ * sent over UDP (pose_udp.h) — opentrack on port 4242 and/or our
+ * extended packet, each destination at its own rate (--udp, repeatable,
+ * or a file of destinations with --udp-config). UDP sends are batched,
+ * non-blocking and drop on a full socket buffer: the filter thread is
+ * never held up by the network.
+ *
+ * Every tracker Stream Engine enumerates is opened (or each --url given),
+ * and each gets its own acquisition and filter threads, SPSC ring, clock
+ * model, head_tracker and latency histograms, so trackers share nothing
+ * on the per-sample path until their poses meet in the fusion stage
+ * (pose_fusion.h): each filtered pose is blended with the other trackers'
+ * fresh poses by confidence, and the result is what the outputs get.
+ * Translation is fused as absolute pivot positions with a learned
+ * per-tracker offset, so a tracker that (re)seeds keeps the shared
+ * origin; it rejoins the blend once its pitch has settled.
+ * --cpu ACQ[,FILTER] (repeatable, in tracker order) pins each tracker's
+ * threads; their filter state is allocated on the pinned thread, so it
+ * lands on that CPU's NUMA node. --mount DEG gives a tracker's yaw
+ * relative to the user. Tracker 0 owns the head-model profile.
+ *
+ * Build:
+ *   make build/squig-headtrackd
+ *
+ * Run:
+ *   ./squig-headtrackd [--url URL]... [--fifo PRIO] [--cpu ACQ[,FILTER]]... [--mount DEG]...
+ *                      [--latency-log file.csv] [--print] [--ring N]
+ *                      [--shm NAME | --no-shm] [--shm-group GROUP]
+ *                      [--lookahead MS | --no-predict]
+ *                      [--udp HOST[:PORT][@HZ][/opentrack|squig]]...
+ *                      [--udp-config FILE] [--user NAME | --profile FILE | --no-calib]
+ *                      [--origin-only] [--no-presence] [--metrics ADDR]
+ *   (--fifo needs CAP_SYS_NICE or an rtprio limit, e.g. in limits.conf)
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include "spsc_ring.h"
+#include "head_tracker.h"
+#include "gaze_fusion.h"
+#include "presence_gate.h"
+#include "pose_shm.h"
+#include "pose_udp.h"
+#include "clock_sync.h"
+#include "lat_hist.h"
+#include "head_profile.h"
+#include "se_session.h"
+#include "pose_fusion.h"
+#include "metrics.h"
+
+#define STAT_INC(x)     __atomic_fetch_add(&(x), 1, __ATOMIC_RELAXED)
+#define STAT_ADD(x, v)  __atomic_fetch_add(&(x), (v), __ATOMIC_RELAXED)
+#define STAT_LOAD(x)    __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define STAT_TAKE(x)    __atomic_exchange_n(&(x), 0, __ATOMIC_RELAXED)
+
+#define RING_DEFAULT        256         /* samples, ~2.8 s at 90 Hz */
+#define CLOCK_PROBE_MS      250         /* tobii_system_clock() query interval */
+#define E2E_TARGET_NS       15000000    /* Option C: < 15 ms end-to-end */
+#define PROFILE_SAVE_S      60          /* at most one profile write per minute */
+#define MAX_TRACKERS        POSE_FUSION_MAX
+#define FUSION_STALE_MS     50.0        /* a tracker silent this long leaves the blend */
+
+/* ── Shared state ───────────────────────────────────────────────────── */
+
+typedef struct {
+    tobii_gaze_origin_t g;
+    int64_t  recv_us;           /* SE clock, stamped in the callback */
+    int64_t  cb_ns;             /* CLOCK_MONOTONIC, stamped in the callback */
+    uint32_t seq;
+} sample_t;
+
+_Static_assert(HEAD_TRACKER_F_LEFT == POSE_SHM_F_LEFT && HEAD_TRACKER_F_RIGHT == POSE_SHM_F_RIGHT &&
+               HEAD_TRACKER_F_PREDICTED == POSE_SHM_F_PREDICTED, "pose flags are passed through");
+
+/* Host-clock latency stages (lat_hist_t per entry) */
+enum { LAT_ACQ, LAT_FILTER, LAT_OUTPUT, LAT_E2E, LAT_STAGES };
+
+static const char *const lat_stage_names[LAT_STAGES] = {
+    [LAT_ACQ]    = "device -> callback",
+    [LAT_FILTER] = "callback -> filtered",
+    [LAT_OUTPUT] = "filtered -> sent",
+    [LAT_E2E]    = "device -> sent",
+};
+
+/* Per-tracker metrics (tracker="k"); the filter thread records
+ * TM_REJECTED and TM_RESUMES, the collector sets the others */
+enum {
+    TM_SAMPLES, TM_DROPS, TM_GAZE_DROPS, TM_RECONNECTS, TM_POSES,
+    TM_REJECTED, TM_RESUMES, TM_AWAY, TM_DEPARTURES, TM_COUNT
+};
+
+static const struct {
+    const char *name, *help;
+    int gauge;
+} tracker_metrics[TM_COUNT] = {
+    [TM_SAMPLES]    = { "samples_total", "gaze_origin callbacks", 0 },
+    [TM_DROPS]      = { "ring_drops_total", "Samples dropped: filter behind (ring full)", 0 },
+    [TM_GAZE_DROPS] = { "gaze_ring_drops_total", "gaze_point / eye_position_normalized dropped (ring full)", 0 },
+    [TM_RECONNECTS] = { "reconnects_total", "Stream Engine connections recovered", 0 },
+    [TM_POSES]      = { "poses_total", "Filtered poses into the fusion stage", 0 },
+    [TM_REJECTED]   = { "rejected_updates_total", "EKF updates refused by the gate", 0 },
+    [TM_RESUMES]    = { "warm_resumes_total", "Filter resumed warm after the user was away", 0 },
+    [TM_AWAY]       = { "user_away", "1 while the presence gate is closed", 1 },
+    [TM_DEPARTURES] = { "departures_total", "Presence gate closings", 0 },
+};
+
+typedef struct daemon daemon_t;
+
+/* One tracker: its own session, ring, threads, clock model and counters.
+ * Cache-line aligned so two trackers' threads never share a line. */
+typedef struct {
+    daemon_t       *d;
+    int             index;
+    char            tag[16];        /* "[HTD]", or "[HTD0]", "[HTD1]", ... */
+    char            url[SE_URL_MAX];
+    int             acq_cpu;        /* -1 = not pinned */
+    int             filter_cpu;     /* -1 = not pinned */
+    double          mount_yaw;      /* degrees, pose_fusion_mount() */
+
+    se_session_t   *se;
+    spsc_ring_t     ring;
+    gaze_fusion_t   gaze;           /* gaze_point / eye_position_normalized rings */
+    int             gaze_streams;   /* ...subscribed (gaze_fusion_align runs) */
+    presence_gate_t presence;
+    int             gated;          /* user_presence subscribed: the gate runs */
+    pthread_t       acq_thread, filter_thread;
+    int             acq_started, filter_started;
+    clock_sync_t    clock;          /* SE clock -> CLOCK_MONOTONIC, filter thread feeds */
+    lat_hist_t      hist[LAT_STAGES];
+    int             mid[TM_COUNT];  /* metrics ids (--metrics) */
+    int             mh_step, mh_e2e;
+
+    /* Acquisition thread only */
+    uint32_t seq;
+
+    /* Counters (read and reset by the status line) */
+    uint64_t samples;           /* callbacks */
+    uint64_t drop_full;         /* ring full: filter behind */
+    uint64_t reconnects;
+    uint64_t filtered;          /* poses into the fusion stage */
+    uint64_t lat_n, lat_sum_us; /* this status period */
+    uint64_t lat_max_us;
+    uint32_t queue_max;
+} __attribute__((aligned(64))) tracker_t;
+
+struct daemon {
+    /* Configuration */
+    int         fifo_prio;      /* 0 = SCHED_OTHER */
+    uint32_t    ring_size;
+    const char *latency_log;
+    int         print;
+    const char *shm_name;       /* NULL = no shared-memory output */
+    const char *shm_group;      /* NULL = segment readable by this user only */
+    int         predict;        /* run the look-ahead stage */
+    double      lookahead_ms;   /* beyond emission time */
+    int         calibrate;      /* streaming head-model calibration */
+    int         fuse_gaze;      /* subscribe and align gaze_point / eye_position_normalized */
+    int         use_presence;   /* idle while user_presence says away */
+    char        profile_path[512];  /* "" = not persisted */
+    const char *metrics_addr;   /* NULL = no metrics endpoint */
+
+    tracker_t   trk[MAX_TRACKERS];
+    int         ntrk;
+    int         stopping;
+
+    /* Fusion and output: every tracker's filter thread, one at a time */
+    pthread_mutex_t    out_lock;
+    pose_fusion_t      fusion;
+    pose_shm_writer_t *shm;
+    pose_udp_t        *udp;     /* NULL = no UDP destinations */
+    uint64_t           emitted; /* fused poses sent */
+    uint64_t           blended; /* ... that merged more than one tracker */
+
+    /* Head model: loaded at start; tracker 0's filter hands updates to main */
+    head_calib_model_t profile;
+    int                have_profile;
+    pthread_mutex_t    calib_lock;
+    head_calib_model_t calib_model;
+    int                calib_dirty; /* calib_model not saved yet */
+
+    /* Metrics: registered before the threads start */
+    metrics_t         *metrics;
+    int                m_emitted, m_blended;
+    int                m_udp[POSE_UDP_MAX_DEST][3];     /* sent, dropped, errors */
+};
+
+static volatile sig_atomic_t g_running = 1;
+static volatile sig_atomic_t g_dump;
+static void sig_handler(int s) { (void)s; g_running = 0; }
+static void dump_handler(int s) { (void)s; g_dump = 1; }
+
+static int64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int64_t se_now_us(tracker_t *t)
+{
+    return se_session_clock_us(t->se);
+}
+
+/* NUMA node of a CPU from sysfs, -1 if the kernel does not say */
+static int cpu_node(int cpu)
+{
+    char path[64];
+    snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", cpu);
+    DIR *dir = opendir(path);
+    if (!dir) return -1;
+    int node = -1;
+    struct dirent *e;
+    while ((e = readdir(dir)))
+        if (sscanf(e->d_name, "node%d", &node) == 1) break;
+    closedir(dir);
+    return node;
+}
+
+/* Pin the calling thread (cpu < 0: leave it) and optionally make it
+ * SCHED_FIFO. Whatever the thread allocates and touches afterwards is
+ * placed on that CPU's node by the kernel's first-touch policy. */
+static void thread_setup(tracker_t *t, const char *what, int cpu, int fifo_prio)
+{
+    if (cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cpu, &set);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        int node = cpu_node(cpu);
+        if (rc) fprintf(stderr, "%s Cannot pin %s to CPU %d: %s\n", t->tag, what, cpu, strerror(rc));
+        else if (node >= 0) printf("%s %s pinned to CPU %d (node %d)\n", t->tag, what, cpu, node);
+        else printf("%s %s pinned to CPU %d\n", t->tag, what, cpu);
+    }
+    if (fifo_prio > 0) {
+        struct sched_param sp = { .sched_priority = fifo_prio };
+        int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp);
+        if (rc) fprintf(stderr, "%s SCHED_FIFO %d refused (%s), running SCHED_OTHER\n",
+                        t->tag, fifo_prio, strerror(rc));
+        else printf("%s %s at SCHED_FIFO %d\n", t->tag, what, fifo_prio);
+    }
+}
+
+/* ── Acquisition thread (one per tracker) ───────────────────────────── */
+
+static void gaze_origin_callback(tobii_gaze_origin_t const *g, void *user)
+{
+    tracker_t *t = user;
+    sample_t s;
+    s.g = *g;
+    s.recv_us = se_now_us(t);
+    s.cb_ns = mono_ns();
+    s.seq = t->seq++;
+    STAT_INC(t->samples);
+    if (spsc_ring_push(&t->ring, &s) < 0) {
+        STAT_INC(t->drop_full);
+        return;
+    }
+    uint32_t depth = spsc_ring_count(&t->ring);
+    if (depth > STAT_LOAD(t->queue_max)) __atomic_store_n(&t->queue_max, depth, __ATOMIC_RELAXED);
+}
+
+static void gaze_point_callback(tobii_gaze_point_t const *gp, void *user)
+{
+    tracker_t *t = user;
+    gaze_fusion_push_point(&t->gaze, gp);
+}
+
+static void eye_pos_callback(tobii_eye_position_normalized_t const *ep, void *user)
+{
+    tracker_t *t = user;
+    gaze_fusion_push_eyes(&t->gaze, ep);
+}
+
+static void presence_callback(tobii_user_presence_status_t status, int64_t timestamp_us, void *user)
+{
+    (void)timestamp_us;
+    tracker_t *t = user;
+    presence_gate_report(&t->presence, status, mono_ns());
+}
+
+static void *acq_thread(void *arg)
+{
+    tracker_t *t = arg;
+    thread_setup(t, "Acquisition", t->acq_cpu, t->d->fifo_prio);
+
+    /* se_session_pump paces its own recovery attempts */
+    while (!__atomic_load_n(&t->d->stopping, __ATOMIC_ACQUIRE)) {
+        if (se_session_pump(t->se) == SE_PUMP_RECONNECTED) STAT_INC(t->reconnects);
+        if (!t->gated) continue;
+        int err = 0;
+        switch (presence_gate_poll(&t->presence, mono_ns())) {
+        case PRESENCE_GATE_LEFT:
+            printf("%s User away: gaze streams paused, filter parked\n", t->tag);
+            err = se_session_pause(t->se, 1);
+            break;
+        case PRESENCE_GATE_RETURNED:
+            printf("%s User back after %.1f s: resuming\n", t->tag,
+                   (mono_ns() - t->presence.left_ns) / 1e9);
+            err = se_session_pause(t->se, 0);
+            break;
+        }
+        if (err) fprintf(stderr, "%s (un)subscribe: %d - %s\n", t->tag, err, se_error(err));
+    }
+    return NULL;
+}
+
+/* ── Filter thread (one per tracker) ────────────────────────────────── */
+
+static void to_tracker_sample(const tobii_gaze_origin_t *g, head_tracker_sample_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->timestamp_us = g->timestamp_us;
+    out->left_valid  = g->left_validity == TOBII_VALIDITY_VALID;
+    out->right_valid = g->right_validity == TOBII_VALIDITY_VALID;
+    for (int k = 0; k < 3; k++) {
+        out->left[k]  = g->left_xyz[k];
+        out->right[k] = g->right_xyz[k];
+    }
+}
+
+/* Fuse with the other trackers' latest poses and send (reseeded: this
+ * tracker's filter restarted on this sample). out_lock serialises the
+ * fusion, the shared-memory publish (single writer, and readers must
+ * never see an older pose replace a newer one; it is stores plus a wake
+ * that never blocks) and the UDP rate / sequence bookkeeping, so a second
+ * tracker waits a few hundred ns at most. The datagrams go out and the
+ * line is printed after unlocking: those are syscalls, and stdout can
+ * block on a slow terminal or pipe. */
+static void emit_pose(tracker_t *t, const sample_t *s, const head_tracker_pose_t *tp, int reseeded)
+{
+    daemon_t *d = t->d;
+    head_tracker_pose_t fp;
+    const head_tracker_pose_t *p = &fp;
+    pose_udp_batch_t batch;
+
+    pthread_mutex_lock(&d->out_lock);
+    if (reseeded) pose_fusion_reseeded(&d->fusion, t->index);
+    int used = pose_fusion_update(&d->fusion, t->index, tp, mono_ns(), &fp);
+    if (d->shm) {
+        pose_shm_pose_t sp = {
+            .x = p->x, .y = p->y, .z = p->z,
+            .yaw = p->yaw, .pitch = p->pitch, .roll = p->roll,
+            .timestamp_us = s->g.timestamp_us,
+            .confidence = p->confidence, .flags = p->flags,
+        };
+        pose_shm_publish(d->shm, &sp);
+    }
+    if (d->udp) {
+        pose_udp_pose_t up = {
+            .x = p->x, .y = p->y, .z = p->z,
+            .yaw = p->yaw, .pitch = p->pitch, .roll = p->roll,
+            .timestamp_us = s->g.timestamp_us,
+            .confidence = p->confidence, .flags = p->flags,
+        };
+        pose_udp_prepare(d->udp, &up, (uint64_t)s->g.timestamp_us * 1000u, &batch);
+    }
+    pthread_mutex_unlock(&d->out_lock);
+
+    if (d->udp) pose_udp_flush(d->udp, &batch);
+    if (d->print)
+        printf("%s[%8u] x=%7.1f y=%7.1f z=%7.1f  yaw=%6.1f pitch=%6.1f roll=%6.1f  eyes=%d ts=%lld"
+               "%s\n", d->ntrk > 1 ? t->tag : "",
+               s->seq, p->x, p->y, p->z, p->yaw, p->pitch, p->roll, p->eyes,
+               (long long)s->g.timestamp_us, used > 1 ? "  (fused)" : "");
+    STAT_INC(d->emitted);
+    if (used > 1) STAT_INC(d->blended);
+    STAT_INC(t->filtered);
+}
+
+static FILE *open_latency_log(tracker_t *t)
+{
+    char path[600];
+    if (t->d->ntrk > 1) snprintf(path, sizeof(path), "%s.%d", t->d->latency_log, t->index);
+    else snprintf(path, sizeof(path), "%s", t->d->latency_log);
+    FILE *log = fopen(path, "w");
+    if (!log) {
+        fprintf(stderr, "%s latency log %s: %s\n", t->tag, path, strerror(errno));
+        return NULL;
+    }
+    setvbuf(log, NULL, _IOFBF, 1 << 16);
+    fprintf(log, "seq,timestamp_us,recv_us,emit_us,acq_us,filter_us,total_us,eyes\n");
+    return log;
+}
+
+static void *filter_thread(void *arg)
+{
+    tracker_t *t = arg;
+    daemon_t *d = t->d;
+    thread_setup(t, "Filter", t->filter_cpu, 0);
+
+    /* Allocated here, after pinning, so the filter state is node-local */
+    head_tracker_t *ht = malloc(sizeof(*ht));
+    if (!ht) {
+        fprintf(stderr, "%s Cannot allocate the filter\n", t->tag);
+        return NULL;
+    }
+    pose_predict_config_t pc = POSE_PREDICT_DEFAULTS;
+    pc.lookahead_ms = d->lookahead_ms;
+    head_tracker_init(ht, NULL, d->predict ? &pc : NULL);
+    if (d->calibrate) head_tracker_calibrate(ht, NULL, d->have_profile ? &d->profile : NULL);
+    if (t->gaze_streams) head_tracker_use_gaze(ht, NULL);
+    metrics_shard_t *ms = d->metrics ? metrics_shard(d->metrics) : NULL;
+    int owns_model = d->calibrate && t->index == 0;    /* one tracker persists the model */
+    uint64_t model_seen = 0;
+    int64_t next_probe = 0;
+    FILE *log = d->latency_log ? open_latency_log(t) : NULL;
+
+    for (;;) {
+        /* SE clock against ours; the host read after the query bounds it */
+        if (mono_ns() >= next_probe) {
+            int64_t us = se_now_us(t);
+            int64_t t1 = mono_ns();
+            clock_sync_add(&t->clock, us, t1);
+            next_probe = t1 + CLOCK_PROBE_MS * 1000000LL;
+        }
+
+        sample_t s;
+        if (spsc_ring_pop_wait(&t->ring, &s, 200) < 0) {
+            if (__atomic_load_n(&d->stopping, __ATOMIC_ACQUIRE) && spsc_ring_count(&t->ring) == 0)
+                break;
+            /* Drained and nobody there: sleep until they are, then carry on warm */
+            if (presence_gate_park(&t->presence, &d->stopping)) head_tracker_resume(ht);
+            continue;
+        }
+        head_tracker_sample_t hs;
+        head_tracker_pose_t p;
+        to_tracker_sample(&s.g, &hs);
+        if (t->gaze_streams) gaze_fusion_align(&t->gaze, &hs);
+        uint64_t rejected = ht->rejected, resumes = ht->resumes, reseeds = ht->reseeds;
+        int64_t step_ns = mono_ns();
+        head_tracker_update(ht, &hs, se_now_us(t), &p);
+        int64_t filt_ns = mono_ns();
+        emit_pose(t, &s, &p, ht->reseeds != reseeds);
+        int64_t out_ns = mono_ns();
+
+        /* New head model for main to save; never wait for it */
+        if (owns_model && ht->model_updates != model_seen &&
+            pthread_mutex_trylock(&d->calib_lock) == 0) {
+            head_calib_model(&ht->calib, &d->calib_model);
+            d->calib_dirty = 1;
+            pthread_mutex_unlock(&d->calib_lock);
+            model_seen = ht->model_updates;
+        }
+
+        int64_t dev_ns = clock_sync_to_host(&t->clock, s.g.timestamp_us);
+        lat_hist_record(&t->hist[LAT_ACQ], s.cb_ns - dev_ns);
+        lat_hist_record(&t->hist[LAT_FILTER], filt_ns - s.cb_ns);
+        lat_hist_record(&t->hist[LAT_OUTPUT], out_ns - filt_ns);
+        lat_hist_record(&t->hist[LAT_E2E], out_ns - dev_ns);
+        if (ms) {
+            metrics_observe_ns(ms, t->mh_step, filt_ns - step_ns);
+            metrics_observe_ns(ms, t->mh_e2e, out_ns - dev_ns);
+            metrics_add(ms, t->mid[TM_REJECTED], ht->rejected - rejected);
+            metrics_add(ms, t->mid[TM_RESUMES], ht->resumes - resumes);
+        }
+
+        int64_t emit_us = se_now_us(t);
+        int64_t total = emit_us - s.g.timestamp_us;
+        uint64_t tot = total > 0 ? (uint64_t)total : 0;
+        STAT_INC(t->lat_n);
+        STAT_ADD(t->lat_sum_us, tot);
+        if (tot > STAT_LOAD(t->lat_max_us)) __atomic_store_n(&t->lat_max_us, tot, __ATOMIC_RELAXED);
+        if (log)
+            fprintf(log, "%u,%lld,%lld,%lld,%lld,%lld,%lld,%d\n", s.seq,
+                    (long long)s.g.timestamp_us, (long long)s.recv_us, (long long)emit_us,
+                    (long long)(s.recv_us - s.g.timestamp_us), (long long)(emit_us - s.recv_us),
+                    (long long)total, p.eyes);
+    }
+    if (log) fclose(log);
+    printf("%s Filter: %llu (re)starts, %llu warm resumes, %llu rejected updates\n", t->tag,
+           (unsigned long long)ht->reseeds, (unsigned long long)ht->resumes,
+           (unsigned long long)ht->rejected);
+    if (t->gaze_streams)
+        printf("%s Gaze fusion: %llu of %llu samples with a gaze point, %llu pitch rows, "
+               "%llu with an eye outside the track box, %llu + %llu dropped (ring full)\n", t->tag,
+               (unsigned long long)t->gaze.with_gaze, (unsigned long long)t->gaze.aligned,
+               (unsigned long long)ht->gaze.updates, (unsigned long long)ht->inconsistent,
+               (unsigned long long)t->gaze.point.drop_full, (unsigned long long)t->gaze.eyes.drop_full);
+    if (owns_model && ht->model_updates) {
+        pthread_mutex_lock(&d->calib_lock);
+        head_calib_model(&ht->calib, &d->calib_model);
+        d->calib_dirty = 1;
+        pthread_mutex_unlock(&d->calib_lock);
+    }
+    free(ht);
+    return NULL;
+}
+
+/* ── Trackers ───────────────────────────────────────────────────────── */
+
+/* Session, ring and subscription; threads are started separately. */
+static int tracker_open(tracker_t *t)
+{
+    if (!(t->se = se_session_open(t->url, t->tag))) return -1;
+    /* An enumerated URL is pinned, so recovery never picks up another unit */
+    snprintf(t->url, sizeof(t->url), "%s", se_session_url(t->se));
+    printf("%s Device: %s\n", t->tag, t->url);
+    if (spsc_ring_init(&t->ring, t->d->ring_size, sizeof(sample_t)) < 0) {
+        fprintf(stderr, "%s Cannot allocate %u-sample ring\n", t->tag, t->d->ring_size);
+        return -1;
+    }
+    int err = se_session_gaze_origin(t->se, gaze_origin_callback, t);
+    if (err) {
+        fprintf(stderr, "%s gaze_origin_subscribe: %d - %s\n", t->tag, err, se_error(err));
+        return -1;
+    }
+    if (!t->d->fuse_gaze) return 0;
+
+    /* The secondary streams are optional: without them, gaze_origin alone */
+    if (gaze_fusion_init(&t->gaze, NULL, t->d->ring_size) < 0) {
+        fprintf(stderr, "%s Cannot allocate the gaze fusion rings\n", t->tag);
+        return -1;
+    }
+    if ((err = se_session_gaze_point(t->se, gaze_point_callback, t)) ||
+        (err = se_session_eye_position_normalized(t->se, eye_pos_callback, t))) {
+        fprintf(stderr, "%s gaze_point / eye_position_normalized: %d - %s; gaze_origin only\n",
+                t->tag, err, se_error(err));
+        return 0;
+    }
+    t->gaze_streams = 1;
+    return 0;
+}
+
+/* user_presence drives the gate; a tracker without it is never gated */
+static void tracker_presence(tracker_t *t)
+{
+    presence_gate_init(&t->presence, NULL);
+    if (!t->d->use_presence) return;
+    int err = se_session_user_presence(t->se, presence_callback, t);
+    if (err) {
+        fprintf(stderr, "%s user_presence: %d - %s; not idling while away\n", t->tag, err, se_error(err));
+        return;
+    }
+    t->gated = 1;
+}
+
+static int tracker_start(tracker_t *t)
+{
+    if (pthread_create(&t->filter_thread, NULL, filter_thread, t) != 0) {
+        perror("[HTD] pthread_create");
+        return -1;
+    }
+    t->filter_started = 1;
+    if (pthread_create(&t->acq_thread, NULL, acq_thread, t) != 0) {
+        perror("[HTD] pthread_create");
+        return -1;
+    }
+    t->acq_started = 1;
+    return 0;
+}
+
+/* Acquisition first, so the filter drains everything that was pushed.
+ * d->stopping must already be set. */
+static void tracker_join(tracker_t *t)
+{
+    if (t->acq_started) pthread_join(t->acq_thread, NULL);
+    t->acq_started = 0;
+    if (t->filter_started) {
+        spsc_ring_wake(&t->ring);
+        presence_gate_wake(&t->presence);
+        pthread_join(t->filter_thread, NULL);
+    }
+    t->filter_started = 0;
+}
+
+static void tracker_close(tracker_t *t)
+{
+    se_session_close(t->se);        /* unsubscribes */
+    t->se = NULL;
+    spsc_ring_free(&t->ring);
+    gaze_fusion_free(&t->gaze);
+    clock_sync_destroy(&t->clock);
+}
+
+/* --url given: those trackers; otherwise every one Stream Engine finds */
+static int find_trackers(daemon_t *d, char urls[][SE_URL_MAX], int nurl)
+{
+    if (nurl == 0) {
+        nurl = se_enumerate_urls(urls, MAX_TRACKERS);
+        if (nurl < 0) return -1;
+        if (nurl == 0) {
+            fprintf(stderr, "[HTD] No tracker found\n");
+            return -1;
+        }
+        if (nurl > MAX_TRACKERS) {
+            fprintf(stderr, "[HTD] %d trackers found, using the first %d\n", nurl, MAX_TRACKERS);
+            nurl = MAX_TRACKERS;
+        }
+    }
+    d->ntrk = nurl;
+    for (int i = 0; i < nurl; i++) {
+        tracker_t *t = &d->trk[i];
+        t->d = d;
+        t->index = i;
+        clock_sync_init(&t->clock, 1000, 32);   /* 1 s buckets, 32 s of drift */
+        memcpy(t->url, urls[i], SE_URL_MAX);
+        if (nurl > 1) snprintf(t->tag, sizeof(t->tag), "[HTD%d]", i);
+        else snprintf(t->tag, sizeof(t->tag), "[HTD]");
+    }
+    return 0;
+}
+
+/* ── Metrics ────────────────────────────────────────────────────────── */
+
+/* Exporter thread, at each scrape: the counters the pipeline keeps anyway */
+static void collect_metrics(metrics_t *m, void *arg)
+{
+    daemon_t *d = arg;
+    for (int k = 0; k < d->ntrk; k++) {
+        tracker_t *t = &d->trk[k];
+        metrics_set(m, t->mid[TM_SAMPLES], (int64_t)STAT_LOAD(t->samples));
+        metrics_set(m, t->mid[TM_DROPS], (int64_t)STAT_LOAD(t->drop_full));
+        metrics_set(m, t->mid[TM_GAZE_DROPS],
+                    (int64_t)(STAT_LOAD(t->gaze.point.drop_full) + STAT_LOAD(t->gaze.eyes.drop_full)));
+        metrics_set(m, t->mid[TM_RECONNECTS], (int64_t)STAT_LOAD(t->reconnects));
+        metrics_set(m, t->mid[TM_POSES], (int64_t)STAT_LOAD(t->filtered));
+        metrics_set(m, t->mid[TM_AWAY], presence_gate_closed(&t->presence));
+        metrics_set(m, t->mid[TM_DEPARTURES], (int64_t)STAT_LOAD(t->presence.departures));
+    }
+    metrics_set(m, d->m_emitted, (int64_t)STAT_LOAD(d->emitted));
+    metrics_set(m, d->m_blended, (int64_t)STAT_LOAD(d->blended));
+    for (int i = 0; d->udp && i < pose_udp_count(d->udp); i++) {
+        pose_udp_stats_t st;
+        pose_udp_get_stats(d->udp, i, &st);
+        metrics_set(m, d->m_udp[i][0], (int64_t)st.sent);
+        metrics_set(m, d->m_udp[i][1], (int64_t)st.dropped);
+        metrics_set(m, d->m_udp[i][2], (int64_t)st.errors);
+    }
+}
+
+/* Register everything and start serving; before the threads start */
+static int start_metrics(daemon_t *d)
+{
+    metrics_t *m = d->metrics = metrics_create("squig_headtrack");
+    if (!m) return -1;
+    char lb[128];
+    for (int k = 0; k < d->ntrk; k++) {
+        tracker_t *t = &d->trk[k];
+        snprintf(lb, sizeof(lb), "tracker=\"%d\"", k);
+        for (int i = 0; i < TM_COUNT; i++)
+            t->mid[i] = tracker_metrics[i].gauge
+                      ? metrics_gauge(m, tracker_metrics[i].name, lb, tracker_metrics[i].help)
+                      : metrics_counter(m, tracker_metrics[i].name, lb, tracker_metrics[i].help);
+        t->mh_step = metrics_histogram(m, "filter_step_seconds", lb,
+                                       "head_tracker_update: EKF predict/update, calibration, look-ahead");
+        t->mh_e2e = metrics_histogram(m, "latency_seconds", lb, "Device sample to pose sent (host clock)");
+    }
+    d->m_emitted = metrics_counter(m, "fused_poses_total", NULL, "Poses sent to the outputs");
+    d->m_blended = metrics_counter(m, "blended_poses_total", NULL, "... merged from several trackers");
+    for (int i = 0; d->udp && i < pose_udp_count(d->udp); i++) {
+        pose_udp_stats_t st;
+        pose_udp_get_stats(d->udp, i, &st);
+        snprintf(lb, sizeof(lb), "dest=\"%.110s\"", st.name);
+        d->m_udp[i][0] = metrics_counter(m, "udp_sent_total", lb, "UDP packets sent");
+        d->m_udp[i][1] = metrics_counter(m, "udp_dropped_total", lb, "UDP packets dropped: socket buffer full");
+        d->m_udp[i][2] = metrics_counter(m, "udp_errors_total", lb, "UDP send errors");
+    }
+    metrics_collector(m, collect_metrics, d);
+    if (metrics_serve(m, d->metrics_addr) < 0) return -1;
+    printf("[HTD] Metrics on %s\n", d->metrics_addr);
+    return 0;
+}
+
+/* ── Main ───────────────────────────────────────────────────────────── */
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr,
+            "Usage: %s [--url URL]... [--fifo PRIO] [--cpu ACQ[,FILTER]]... [--mount DEG]...\n"
+            "          [--latency-log file.csv] [--print] [--ring N] [--shm NAME | --no-shm]\n"
+            "          [--shm-group GROUP] [--lookahead MS | --no-predict]\n"
+            "          [--udp HOST[:PORT][@HZ][/opentrack|squig]]... [--udp-config FILE]\n"
+            "          [--user NAME | --profile FILE | --no-calib] [--origin-only] [--no-presence]\n"
+            "          [--metrics unix:PATH | PORT | HOST:PORT]\n",
+            argv0);
+}
+
+/* Main thread: write the latest head model handed over by the filter */
+static void save_profile(daemon_t *d)
+{
+    head_calib_model_t m;
+    pthread_mutex_lock(&d->calib_lock);
+    int dirty = d->calib_dirty;
+    m = d->calib_model;
+    d->calib_dirty = 0;
+    pthread_mutex_unlock(&d->calib_lock);
+    if (!dirty || !d->profile_path[0]) return;
+    if (head_profile_save(d->profile_path, &m) == 0)
+        printf("[CALIB] Saved %s: ipd %.1f, eye_up %.1f, eye_fwd %.1f mm (%llu samples)\n",
+               d->profile_path, m.ipd, m.eye_up, m.eye_fwd, (unsigned long long)m.samples);
+}
+
+static void dump_latency(daemon_t *d, FILE *out)
+{
+    for (int k = 0; k < d->ntrk; k++) {
+        tracker_t *t = &d->trk[k];
+        clock_sync_model_t m;
+        clock_sync_get(&t->clock, &m);
+        fprintf(out, "%s Latency since start (host clock):\n", t->tag);
+        for (int i = 0; i < LAT_STAGES; i++) lat_hist_print(out, lat_stage_names[i], &t->hist[i]);
+        fprintf(out, "  over %d ms end-to-end: %.3f%%\n", E2E_TARGET_NS / 1000000,
+                100.0 * lat_hist_over(&t->hist[LAT_E2E], E2E_TARGET_NS));
+        if (m.valid)
+            fprintf(out, "  clock: SE -> monotonic offset %+.3f ms, drift %+.2f ppm, "
+                    "fit residual %.1f us over %d buckets (%llu queries)\n",
+                    (m.ref_ns - m.ref_us * 1000) / 1e6, m.rate * 1e6, m.residual_ns / 1e3,
+                    m.buckets, (unsigned long long)m.pairs);
+    }
+    fflush(out);
+}
+
+static void print_status(daemon_t *d, double secs)
+{
+    for (int k = 0; k < d->ntrk; k++) {
+        tracker_t *t = &d->trk[k];
+        uint64_t n   = STAT_TAKE(t->lat_n);
+        uint64_t sum = STAT_TAKE(t->lat_sum_us);
+        uint64_t mx  = STAT_TAKE(t->lat_max_us);
+        uint32_t qm  = __atomic_exchange_n(&t->queue_max, 0, __ATOMIC_RELAXED);
+        printf("%s %5.1f Hz  latency avg %5.2f ms  max %5.2f ms  queue max %u  "
+               "drop %llu  reconnects %llu",
+               t->tag, n / secs, n ? sum / 1000.0 / n : 0.0, mx / 1000.0, qm,
+               (unsigned long long)STAT_LOAD(t->drop_full),
+               (unsigned long long)STAT_LOAD(t->reconnects));
+        if (k < d->ntrk - 1) printf("\n");
+    }
+    if (d->ntrk > 1)
+        printf("\n[HTD] fused: %llu poses, %llu merged from several trackers",
+               (unsigned long long)STAT_LOAD(d->emitted), (unsigned long long)STAT_LOAD(d->blended));
+    if (d->udp) {
+        uint64_t sent = 0, lost = 0;
+        for (int i = 0; i < pose_udp_count(d->udp); i++) {
+            pose_udp_stats_t st;
+            pose_udp_get_stats(d->udp, i, &st);
+            sent += st.sent;
+            lost += st.dropped + st.errors;
+        }
+        printf("  udp %llu sent %llu lost", (unsigned long long)sent, (unsigned long long)lost);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+int main(int argc, char **argv)
+{
+    static daemon_t dm;
+    static char urls[MAX_TRACKERS][SE_URL_MAX];
+    daemon_t *d = &dm;
+    int nurl = 0, ncpu = 0, nmount = 0;
+    int acq_cpu[MAX_TRACKERS], filter_cpu[MAX_TRACKERS];
+    double mount[MAX_TRACKERS] = { 0 };
+    d->ring_size = RING_DEFAULT;
+    d->shm_name = POSE_SHM_DEFAULT_NAME;
+    d->predict = 1;
+    d->calibrate = 1;
+    d->fuse_gaze = 1;
+    d->use_presence = 1;
+    const char *user = head_profile_default_user();
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--url") && i + 1 < argc) {
+            if (nurl == MAX_TRACKERS) {
+                fprintf(stderr, "[HTD] At most %d trackers\n", MAX_TRACKERS);
+                return 1;
+            }
+            snprintf(urls[nurl++], SE_URL_MAX, "%s", argv[++i]);
+        } else if (!strcmp(argv[i], "--fifo") && i + 1 < argc) {
+            d->fifo_prio = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--cpu") && i + 1 < argc && ncpu < MAX_TRACKERS) {
+            const char *c = argv[++i], *comma = strchr(c, ',');
+            acq_cpu[ncpu] = atoi(c);
+            filter_cpu[ncpu++] = comma ? atoi(comma + 1) : -1;
+        } else if (!strcmp(argv[i], "--mount") && i + 1 < argc && nmount < MAX_TRACKERS) {
+            mount[nmount++] = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--latency-log") && i + 1 < argc) {
+            d->latency_log = argv[++i];
+        } else if (!strcmp(argv[i], "--shm") && i + 1 < argc) {
+            d->shm_name = argv[++i];
+        } else if (!strcmp(argv[i], "--no-shm")) {
+            d->shm_name = NULL;
+        } else if (!strcmp(argv[i], "--shm-group") && i + 1 < argc) {
+            d->shm_group = argv[++i];
+        } else if ((!strcmp(argv[i], "--udp") || !strcmp(argv[i], "--udp-config")) &&
+                   i + 1 < argc) {
+            if (!d->udp && !(d->udp = pose_udp_create())) return 1;
+            int ok = !strcmp(argv[i], "--udp") ? pose_udp_add(d->udp, argv[i + 1])
+                                               : pose_udp_add_file(d->udp, argv[i + 1]);
+            if (ok < 0) return 1;
+            i++;
+        } else if (!strcmp(argv[i], "--lookahead") && i + 1 < argc) {
+            d->lookahead_ms = atof(argv[++i]);
+        } else if (!strcmp(argv[i], "--no-predict")) {
+            d->predict = 0;
+        } else if (!strcmp(argv[i], "--user") && i + 1 < argc) {
+            user = argv[++i];
+        } else if (!strcmp(argv[i], "--profile") && i + 1 < argc) {
+            snprintf(d->profile_path, sizeof(d->profile_path), "%s", argv[++i]);
+        } else if (!strcmp(argv[i], "--no-calib")) {
+            d->calibrate = 0;
+        } else if (!strcmp(argv[i], "--origin-only")) {
+            d->fuse_gaze = 0;
+        } else if (!strcmp(argv[i], "--no-presence")) {
+            d->use_presence = 0;
+        } else if (!strcmp(argv[i], "--metrics") && i + 1 < argc) {
+            d->metrics_addr = argv[++i];
+        } else if (!strcmp(argv[i], "--print")) {
+            d->print = 1;
+        } else if (!strcmp(argv[i], "--ring") && i + 1 < argc) {
+            d->ring_size = (uint32_t)atoi(argv[++i]);
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (d->fifo_prio > 0) {
+        int mx = sched_get_priority_max(SCHED_FIFO);
+        if (d->fifo_prio > mx) d->fifo_prio = mx;
+        /* No page faults in the RT path once running */
+        if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0)
+            fprintf(stderr, "[HTD] mlockall: %s (continuing)\n", strerror(errno));
+    }
+    if (d->ring_size < 2) d->ring_size = 2;
+
+    signal(SIGINT, sig_handler);
+    signal(SIGTERM, sig_handler);
+    signal(SIGUSR1, dump_handler);
+    pthread_mutex_init(&d->calib_lock, NULL);
+    pthread_mutex_init(&d->out_lock, NULL);
+
+    if (d->calibrate) {
+        if (!d->profile_path[0] && head_profile_path(user, d->profile_path, sizeof(d->profile_path)) < 0)
+            fprintf(stderr, "[CALIB] No profile location for user '%s'; not persisted\n", user);
+        int pr = d->profile_path[0] ? head_profile_load(d->profile_path, &d->profile) : 1;
+        d->have_profile = pr == 0;
+        if (d->have_profile)
+            printf("[CALIB] Profile %s: ipd %.1f, eye_up %.1f, eye_fwd %.1f mm (%llu samples)\n",
+                   d->profile_path, d->profile.ipd, d->profile.eye_up, d->profile.eye_fwd,
+                   (unsigned long long)d->profile.samples);
+        else if (pr > 0 && d->profile_path[0])
+            printf("[CALIB] No profile at %s yet: starting from the default head model\n",
+                   d->profile_path);
+    }
+
+    int rc = 1;
+    if (find_trackers(d, urls, nurl) < 0) goto out;
+    pose_fusion_init(&d->fusion, d->ntrk, FUSION_STALE_MS);
+    for (int k = 0; k < d->ntrk; k++) {
+        tracker_t *t = &d->trk[k];
+        t->acq_cpu = k < ncpu ? acq_cpu[k] : -1;
+        t->filter_cpu = k < ncpu ? filter_cpu[k] : -1;
+        t->mount_yaw = mount[k];
+        pose_fusion_mount(&d->fusion, k, t->mount_yaw);
+        if (tracker_open(t) < 0) goto out;
+        tracker_presence(t);
+    }
+    if (d->shm_name && !(d->shm = pose_shm_create(d->shm_name, d->shm_group)))
+        goto out;
+    if (d->metrics_addr && start_metrics(d) < 0)
+        goto out;
+    for (int k = 0; k < d->ntrk; k++)
+        if (tracker_start(&d->trk[k]) < 0) goto out_threads;
+    printf("[HTD] Running (%d tracker%s, ring %u samples%s%s)\n", d->ntrk, d->ntrk > 1 ? "s" : "",
+           spsc_ring_capacity(&d->trk[0].ring),
+           d->latency_log ? ", latency log " : "", d->latency_log ? d->latency_log : "");
+
+    struct timespec last, last_save;
+    clock_gettime(CLOCK_MONOTONIC, &last);
+    last_save = last;
+    while (g_running) {
+        struct timespec ts = { 0, 100 * 1000000L };
+        nanosleep(&ts, NULL);
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double secs = (now.tv_sec - last.tv_sec) + (now.tv_nsec - last.tv_nsec) / 1e9;
+        if (secs >= 1.0) {
+            print_status(d, secs);
+            last = now;
+        }
+        if (g_dump) {
+            g_dump = 0;
+            dump_latency(d, stdout);
+        }
+        if (now.tv_sec - last_save.tv_sec >= PROFILE_SAVE_S) {
+            save_profile(d);
+            last_save = now;
+        }
+    }
+    rc = 0;
+
+out_threads:
+    __atomic_store_n(&d->stopping, 1, __ATOMIC_RELEASE);
+    for (int k = 0; k < d->ntrk; k++) tracker_join(&d->trk[k]);
+    if (rc == 0) {
+        for (int k = 0; k < d->ntrk; k++) {
+            tracker_t *t = &d->trk[k];
+            printf("%s %llu samples, %llu poses, %llu dropped (ring full), %llu reconnects\n", t->tag,
+                   (unsigned long long)t->samples, (unsigned long long)t->filtered,
+                   (unsigned long long)t->drop_full, (unsigned long long)t->reconnects);
+        }
+        if (d->ntrk > 1)
+            printf("[HTD] %llu fused poses sent, %llu merged from several trackers\n",
+                   (unsigned long long)d->emitted, (unsigned long long)d->blended);
+        for (int i = 0; d->udp && i < pose_udp_count(d->udp); i++) {
+            pose_udp_stats_t st;
+            pose_udp_get_stats(d->udp, i, &st);
+            printf("[UDP] %s: %llu sent, %llu dropped (buffer full), %llu errors\n", st.name,
+                   (unsigned long long)st.sent, (unsigned long long)st.dropped,
+                   (unsigned long long)st.errors);
+        }
+        dump_latency(d, stdout);
+        save_profile(d);
+    }
+
+out:
+    metrics_destroy(d->metrics);    /* its collector reads the trackers */
+    pose_shm_destroy(d->shm, 0);
+    for (int k = 0; k < d->ntrk; k++) tracker_close(&d->trk[k]);
+    pose_udp_destroy(d->udp);
+    pthread_mutex_destroy(&d->out_lock);
+    pthread_mutex_destroy(&d->calib_lock);
+    return rc;
+}
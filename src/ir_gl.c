@@ -0,0 +1,348 @@
+/*
+ * ir_gl.c — GPU render backend: raw 8-bit plane texture + GLSL decode/LUT
+ *
+ * The raw frame is uploaded as a PLANE_ROW-wide GL_LUMINANCE texture,
+ * i.e. byte o lives at texel (o % PLANE_ROW, o / PLANE_ROW). For output
+ * pixel i the shader fetches byte start + i * stride (plus the next byte
+ * in 16-bit mode), stretches it with the uniforms lo / scale and looks the
+ * result up in a 256-entry palette texture. Pixels past the end of the
+ * data are black, exactly like the CPU path.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include "ir_gl.h"
+#include "ir_render.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <SDL_opengl.h>
+
+#define PLANE_ROW       1024                /* texels per texture row */
+#define PLANE_ROWS      1024                /* 1 MiB = MAX_FRAME_SIZE */
+#define PLANE_BYTES     (PLANE_ROW * PLANE_ROWS)
+
+const char *const ir_palette_names[IR_PALETTE_COUNT] = {
+    "gray", "heat", "rainbow"
+};
+
+/* ── GL entry points (resolved at runtime) ──────────────────────────── */
+
+#define IR_GL_FUNCS(X) \
+    X(void,   Viewport,           (GLint, GLint, GLsizei, GLsizei)) \
+    X(void,   ClearColor,         (GLfloat, GLfloat, GLfloat, GLfloat)) \
+    X(void,   Clear,              (GLbitfield)) \
+    X(GLenum, GetError,           (void)) \
+    X(void,   PixelStorei,        (GLenum, GLint)) \
+    X(void,   GenTextures,        (GLsizei, GLuint *)) \
+    X(void,   DeleteTextures,     (GLsizei, const GLuint *)) \
+    X(void,   BindTexture,        (GLenum, GLuint)) \
+    X(void,   TexParameteri,      (GLenum, GLenum, GLint)) \
+    X(void,   TexImage2D,         (GLenum, GLint, GLint, GLsizei, GLsizei, GLint, \
+                                   GLenum, GLenum, const void *)) \
+    X(void,   TexSubImage2D,      (GLenum, GLint, GLint, GLint, GLsizei, GLsizei, \
+                                   GLenum, GLenum, const void *)) \
+    X(void,   ActiveTexture,      (GLenum)) \
+    X(void,   Begin,              (GLenum)) \
+    X(void,   End,                (void)) \
+    X(void,   TexCoord2f,         (GLfloat, GLfloat)) \
+    X(void,   Vertex2f,           (GLfloat, GLfloat)) \
+    X(GLuint, CreateShader,       (GLenum)) \
+    X(void,   DeleteShader,       (GLuint)) \
+    X(void,   ShaderSource,       (GLuint, GLsizei, const GLchar *const *, const GLint *)) \
+    X(void,   CompileShader,      (GLuint)) \
+    X(void,   GetShaderiv,        (GLuint, GLenum, GLint *)) \
+    X(void,   GetShaderInfoLog,   (GLuint, GLsizei, GLsizei *, GLchar *)) \
+    X(GLuint, CreateProgram,      (void)) \
+    X(void,   DeleteProgram,      (GLuint)) \
+    X(void,   AttachShader,       (GLuint, GLuint)) \
+    X(void,   LinkProgram,        (GLuint)) \
+    X(void,   GetProgramiv,       (GLuint, GLenum, GLint *)) \
+    X(void,   GetProgramInfoLog,  (GLuint, GLsizei, GLsizei *, GLchar *)) \
+    X(void,   UseProgram,         (GLuint)) \
+    X(GLint,  GetUniformLocation, (GLuint, const GLchar *)) \
+    X(void,   Uniform1i,          (GLint, GLint)) \
+    X(void,   Uniform1f,          (GLint, GLfloat)) \
+    X(void,   Uniform2f,          (GLint, GLfloat, GLfloat))
+
+typedef struct {
+#define X(ret, name, args) ret (APIENTRY *name) args;
+    IR_GL_FUNCS(X)
+#undef X
+} gl_api_t;
+
+static int load_gl(gl_api_t *gl)
+{
+#define X(ret, name, args) \
+    gl->name = (ret (APIENTRY *) args)SDL_GL_GetProcAddress("gl" #name); \
+    if (!gl->name) { fprintf(stderr, "[GL] Missing gl" #name "\n"); return -1; }
+    IR_GL_FUNCS(X)
+#undef X
+    return 0;
+}
+
+/* ── Shaders ────────────────────────────────────────────────────────── */
+
+static const char *vs_src =
+    "#version 120\n"
+    "varying vec2 uv;\n"
+    "void main() {\n"
+    "    uv = gl_MultiTexCoord0.xy;\n"
+    "    gl_Position = gl_Vertex;\n"
+    "}\n";
+
+static const char *fs_src =
+    "#version 120\n"
+    "uniform sampler2D plane;\n"    /* raw bytes, PLANE_ROW per row */
+    "uniform sampler2D lut;\n"      /* 256×1 palette */
+    "uniform vec2  plane_size;\n"
+    "uniform vec2  out_size;\n"     /* display width, height */
+    "uniform float len;\n"          /* valid bytes */
+    "uniform float start;\n"        /* first byte (deint-odd: 1) */
+    "uniform float stride;\n"       /* bytes per sample step */
+    "uniform float wide;\n"         /* 1 = 16-bit LE */
+    "uniform float lo;\n"           /* stretch window min */
+    "uniform float scale;\n"        /* 255 / range */
+    "uniform float bias;\n"         /* 0.5 / range: keeps floor() exact */
+    "varying vec2 uv;\n"
+    "float fetch(float o) {\n"
+    "    float y = floor(o / plane_size.x);\n"
+    "    float x = o - y * plane_size.x;\n"
+    "    return floor(texture2D(plane, (vec2(x, y) + 0.5) / plane_size).r * 255.0 + 0.5);\n"
+    "}\n"
+    "void main() {\n"
+    "    vec2 p = min(floor(uv * out_size), out_size - 1.0);\n"
+    "    float o = start + (p.y * out_size.x + p.x) * stride;\n"
+    "    if (o + wide >= len) { gl_FragColor = vec4(0.0, 0.0, 0.0, 1.0); return; }\n"
+    "    float s = fetch(o);\n"
+    "    if (wide > 0.5) s += fetch(o + 1.0) * 256.0;\n"
+    "    float v = clamp(floor((s - lo) * scale + bias), 0.0, 255.0);\n"
+    "    gl_FragColor = texture2D(lut, vec2((v + 0.5) / 256.0, 0.5));\n"
+    "}\n";
+
+struct ir_gl {
+    SDL_Window   *win;
+    SDL_GLContext ctx;
+    gl_api_t      gl;
+    GLuint        prog;
+    GLuint        tex_plane;
+    GLuint        tex_lut;
+    int           last_upload;
+    struct {
+        GLint plane, lut, plane_size, out_size, len, start, stride, wide, lo, scale, bias;
+    } u;
+};
+
+static GLuint compile(gl_api_t *gl, GLenum type, const char *src)
+{
+    GLuint s = gl->CreateShader(type);
+    GLint ok = 0;
+    gl->ShaderSource(s, 1, &src, NULL);
+    gl->CompileShader(s);
+    gl->GetShaderiv(s, GL_COMPILE_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        gl->GetShaderInfoLog(s, sizeof(log), NULL, log);
+        fprintf(stderr, "[GL] Shader compile failed: %s\n", log);
+        gl->DeleteShader(s);
+        return 0;
+    }
+    return s;
+}
+
+/* ── Palettes ───────────────────────────────────────────────────────── */
+
+static void build_palette(int palette, uint8_t rgba[256 * 4])
+{
+    for (int i = 0; i < 256; i++) {
+        float t = i / 255.0f, r, g, b;
+        switch (palette) {
+        case IR_PALETTE_HEAT:
+            r = fminf(1.0f, t * 3.0f);
+            g = fminf(1.0f, fmaxf(0.0f, t * 3.0f - 1.0f));
+            b = fmaxf(0.0f, t * 3.0f - 2.0f);
+            break;
+        case IR_PALETTE_RAINBOW:
+            r = fminf(1.0f, fmaxf(0.0f, 1.5f - fabsf(4.0f * t - 3.0f)));
+            g = fminf(1.0f, fmaxf(0.0f, 1.5f - fabsf(4.0f * t - 2.0f)));
+            b = fminf(1.0f, fmaxf(0.0f, 1.5f - fabsf(4.0f * t - 1.0f)));
+            break;
+        default:
+            r = g = b = t;
+            break;
+        }
+        rgba[i * 4 + 0] = (uint8_t)(r * 255.0f + 0.5f);
+        rgba[i * 4 + 1] = (uint8_t)(g * 255.0f + 0.5f);
+        rgba[i * 4 + 2] = (uint8_t)(b * 255.0f + 0.5f);
+        rgba[i * 4 + 3] = 0xFF;
+    }
+}
+
+void ir_gl_set_palette(ir_gl_t *g, int palette)
+{
+    uint8_t rgba[256 * 4];
+    build_palette(palette, rgba);
+    g->gl.ActiveTexture(GL_TEXTURE1);
+    g->gl.BindTexture(GL_TEXTURE_2D, g->tex_lut);
+    g->gl.TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 256, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba);
+    g->gl.ActiveTexture(GL_TEXTURE0);
+}
+
+/* ── Lifecycle ──────────────────────────────────────────────────────── */
+
+static GLuint new_texture(gl_api_t *gl, GLint ifmt, int w, int h, GLenum fmt)
+{
+    GLuint t;
+    gl->GenTextures(1, &t);
+    gl->BindTexture(GL_TEXTURE_2D, t);
+    gl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    gl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    gl->TexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    gl->TexImage2D(GL_TEXTURE_2D, 0, ifmt, w, h, 0, fmt, GL_UNSIGNED_BYTE, NULL);
+    return t;
+}
+
+ir_gl_t *ir_gl_create(SDL_Window *win)
+{
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER, 1);
+
+    ir_gl_t *g = calloc(1, sizeof(*g));
+    if (!g) return NULL;
+    g->win = win;
+    g->ctx = SDL_GL_CreateContext(win);
+    if (!g->ctx) {
+        fprintf(stderr, "[GL] No OpenGL context: %s\n", SDL_GetError());
+        free(g);
+        return NULL;
+    }
+    if (load_gl(&g->gl) < 0) goto fail;
+    gl_api_t *gl = &g->gl;
+
+    GLuint vs = compile(gl, GL_VERTEX_SHADER, vs_src);
+    GLuint fs = compile(gl, GL_FRAGMENT_SHADER, fs_src);
+    if (!vs || !fs) {
+        if (vs) gl->DeleteShader(vs);
+        if (fs) gl->DeleteShader(fs);
+        goto fail;
+    }
+    g->prog = gl->CreateProgram();
+    gl->AttachShader(g->prog, vs);
+    gl->AttachShader(g->prog, fs);
+    gl->LinkProgram(g->prog);
+    gl->DeleteShader(vs);
+    gl->DeleteShader(fs);
+    GLint ok = 0;
+    gl->GetProgramiv(g->prog, GL_LINK_STATUS, &ok);
+    if (!ok) {
+        char log[1024];
+        gl->GetProgramInfoLog(g->prog, sizeof(log), NULL, log);
+        fprintf(stderr, "[GL] Shader link failed: %s\n", log);
+        goto fail;
+    }
+
+#define U(name) g->u.name = gl->GetUniformLocation(g->prog, #name)
+    U(plane); U(lut); U(plane_size); U(out_size); U(len); U(start);
+    U(stride); U(wide); U(lo); U(scale); U(bias);
+#undef U
+
+    gl->PixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    gl->ActiveTexture(GL_TEXTURE1);
+    g->tex_lut = new_texture(gl, GL_RGBA, 256, 1, GL_RGBA);
+    gl->ActiveTexture(GL_TEXTURE0);
+    g->tex_plane = new_texture(gl, GL_LUMINANCE, PLANE_ROW, PLANE_ROWS, GL_LUMINANCE);
+    if (gl->GetError() != GL_NO_ERROR) {
+        fprintf(stderr, "[GL] Texture allocation failed\n");
+        goto fail;
+    }
+
+    gl->UseProgram(g->prog);
+    gl->Uniform1i(g->u.plane, 0);
+    gl->Uniform1i(g->u.lut, 1);
+    gl->Uniform2f(g->u.plane_size, PLANE_ROW, PLANE_ROWS);
+    ir_gl_set_palette(g, IR_PALETTE_GRAY);
+
+    SDL_GL_SetSwapInterval(1);  /* vsync, like SDL_RENDERER_PRESENTVSYNC */
+    printf("[GL] GPU render path active (8-bit plane upload, shader decode)\n");
+    return g;
+
+fail:
+    ir_gl_destroy(g);
+    return NULL;
+}
+
+void ir_gl_destroy(ir_gl_t *g)
+{
+    if (!g) return;
+    if (g->gl.DeleteTextures) {
+        if (g->tex_plane) g->gl.DeleteTextures(1, &g->tex_plane);
+        if (g->tex_lut)   g->gl.DeleteTextures(1, &g->tex_lut);
+    }
+    if (g->prog && g->gl.DeleteProgram) g->gl.DeleteProgram(g->prog);
+    if (g->ctx) SDL_GL_DeleteContext(g->ctx);
+    free(g);
+}
+
+int ir_gl_last_upload(const ir_gl_t *g)
+{
+    return g->last_upload;
+}
+
+/* ── Drawing ────────────────────────────────────────────────────────── */
+
+void ir_gl_draw(ir_gl_t *g, const uint8_t *src, int srclen, const frame_stats_t *st,
+                int width, int height, int mode)
+{
+    gl_api_t *gl = &g->gl;
+    int dw, dh;
+    SDL_GL_GetDrawableSize(g->win, &dw, &dh);
+    gl->Viewport(0, 0, dw, dh);
+    gl->ClearColor(0, 0, 0, 1);
+    gl->Clear(GL_COLOR_BUFFER_BIT);
+
+    if (srclen > PLANE_BYTES) srclen = PLANE_BYTES;
+    if (srclen < 2) srclen = 0;
+
+    /* Stretch window from the frame stats; everything else is on the GPU */
+    int mn = 0, mx = 0;
+    if (st && (int)st->pix_len == srclen)
+        ir_render_window(st, src, width * height, mode, &mn, &mx);
+    else
+        ir_render_minmax(src, srclen, width * height, mode, &mn, &mx);
+    int range = (mx - mn > 0) ? (mx - mn) : 1;
+
+    /* Only the bytes the frame actually has: whole rows, then the rest */
+    int rows = srclen / PLANE_ROW, rest = srclen % PLANE_ROW;
+    gl->ActiveTexture(GL_TEXTURE0);
+    gl->BindTexture(GL_TEXTURE_2D, g->tex_plane);
+    if (rows > 0)
+        gl->TexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, PLANE_ROW, rows,
+                          GL_LUMINANCE, GL_UNSIGNED_BYTE, src);
+    if (rest > 0)
+        gl->TexSubImage2D(GL_TEXTURE_2D, 0, 0, rows, rest, 1,
+                          GL_LUMINANCE, GL_UNSIGNED_BYTE, src + rows * PLANE_ROW);
+    g->last_upload = srclen;
+
+    gl->UseProgram(g->prog);
+    gl->Uniform2f(g->u.out_size, (float)width, (float)height);
+    gl->Uniform1f(g->u.len, (float)srclen);
+    gl->Uniform1f(g->u.start, (mode == IR_MODE_DEINT_ODD) ? 1.0f : 0.0f);
+    gl->Uniform1f(g->u.stride, (mode == IR_MODE_RAW) ? 1.0f : 2.0f);
+    gl->Uniform1f(g->u.wide, (mode == IR_MODE_16BIT_LE) ? 1.0f : 0.0f);
+    gl->Uniform1f(g->u.lo, (float)mn);
+    gl->Uniform1f(g->u.scale, 255.0f / range);
+    gl->Uniform1f(g->u.bias, 0.5f / range);
+
+    /* Full-window quad; uv (0,0) is the top-left pixel */
+    gl->Begin(GL_QUADS);
+    gl->TexCoord2f(0, 1); gl->Vertex2f(-1, -1);
+    gl->TexCoord2f(1, 1); gl->Vertex2f( 1, -1);
+    gl->TexCoord2f(1, 0); gl->Vertex2f( 1,  1);
+    gl->TexCoord2f(0, 0); gl->Vertex2f(-1,  1);
+    gl->End();
+}
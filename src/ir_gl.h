@@ -0,0 +1,61 @@
+/*
+ * ir_gl.h — GPU render backend for the IR viewer (OpenGL 2.1 + GLSL 1.20)
+ *
+ * Instead of expanding every frame into a 4-byte-per-pixel ARGB buffer on
+ * the CPU and uploading that, this backend uploads the raw frame bytes as
+ * a single-channel texture (1 byte per pixel, 2 in 16-bit mode) and lets
+ * a fragment shader do the rest: linear-index addressing (so width changes
+ * cost nothing), de-interleave, 16-bit LE assembly, contrast stretch and
+ * a palette lookup for false colour. The min/max stretch window comes
+ * from the frame's frame_stats (or a SIMD rescan from ir_render.c).
+ *
+ *   SDL_Window *win = SDL_CreateWindow(..., SDL_WINDOW_OPENGL | ...);
+ *   ir_gl_t *gl = ir_gl_create(win);            // NULL → use SDL_Renderer
+ *   ir_gl_draw(gl, pix, pixlen, &f->stats, 642, 480, IR_MODE_RAW);
+ *   SDL_GL_SwapWindow(win);
+ *
+ * All GL entry points are looked up with SDL_GL_GetProcAddress, so there
+ * is no link-time libGL dependency beyond SDL2 itself.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_IR_GL_H
+#define SQUIG_IR_GL_H
+
+#include <stdint.h>
+#include <SDL.h>
+#include "frame_stats.h"
+
+/* False-colour palettes (ir_gl_set_palette) */
+enum {
+    IR_PALETTE_GRAY = 0,
+    IR_PALETTE_HEAT,        /* black → red → yellow → white */
+    IR_PALETTE_RAINBOW,     /* blue → green → red */
+    IR_PALETTE_COUNT
+};
+
+extern const char *const ir_palette_names[IR_PALETTE_COUNT];
+
+typedef struct ir_gl ir_gl_t;
+
+/* Create a GL context on win (which needs SDL_WINDOW_OPENGL), compile the
+ * shader and allocate textures. Returns NULL (with a message) if OpenGL
+ * 2.1 / GLSL 1.20 is not available. */
+ir_gl_t *ir_gl_create(SDL_Window *win);
+
+/* Upload src and draw it over the whole drawable, as width×height pixels
+ * decoded with the given IR_MODE_*. st (may be NULL) supplies the stretch
+ * window for src without a rescan. Call SDL_GL_SwapWindow() afterwards. */
+void ir_gl_draw(ir_gl_t *gl, const uint8_t *src, int srclen, const frame_stats_t *st,
+                int width, int height, int mode);
+
+void ir_gl_set_palette(ir_gl_t *gl, int palette);
+
+/* Bytes uploaded by the last ir_gl_draw() (for the title bar). */
+int  ir_gl_last_upload(const ir_gl_t *gl);
+
+void ir_gl_destroy(ir_gl_t *gl);
+
+#endif /* SQUIG_IR_GL_H */
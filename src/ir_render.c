@@ -0,0 +1,795 @@
+/*
+ * ir_render.c — Contrast-stretch + gray→ARGB kernels (scalar / SSE2 / AVX2 / NEON)
+ *
+ * The scalar kernels are the reference. The vector kernels must match them
+ * bit for bit, which is why the per-pixel divide is never approximated:
+ *
+ *   8-bit:  (x * 255) / range with 0 <= x <= range <= 255 equals
+ *           (x * M) >> 16 for M = ceil(255 * 65536 / range), because the
+ *           rounding error x / 65536 stays below 1 / range. M is split into
+ *           M >> 16 and M & 0xffff so it runs in 16-bit lanes
+ *           (mullo + mulhi), 8 or 16 pixels per instruction.
+ *   16-bit: x * 255 < 2^24, so it is exact in float. trunc(q * 1/range) is
+ *           off by at most one and a single multiply-compare corrects it.
+ *
+ * Samples outside [mn, mx] are clamped first so the same holds for any
+ * mn/mx a caller passes in.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include "ir_render.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#  define IR_RENDER_X86 1
+#  include <immintrin.h>
+#elif defined(__aarch64__)
+#  define IR_RENDER_NEON 1
+#  include <arm_neon.h>
+#endif
+
+#define FORMAT_DESC(arg, id, name, bytes, planes, plane, header, w, h) \
+    { name, bytes, planes, plane, header, w, h },
+const ir_format_t ir_formats[IR_MODE_COUNT] = { IR_FORMATS(FORMAT_DESC, _) };
+
+#define FORMAT_NAME(arg, id, name, ...) name,
+const char *const ir_mode_names[IR_MODE_COUNT] = { IR_FORMATS(FORMAT_NAME, _) };
+
+int ir_format_find(const char *name)
+{
+    for (int m = 0; m < IR_MODE_COUNT; m++)
+        if (strcmp(ir_formats[m].name, name) == 0) return m;
+    return -1;
+}
+
+static inline uint32_t gray_argb(uint8_t v)
+{
+    return 0xFF000000u | ((uint32_t)v << 16) | ((uint32_t)v << 8) | v;
+}
+
+static inline int stretch_range(int mn, int mx)
+{
+    return (mx - mn > 0) ? (mx - mn) : 1;
+}
+
+/* Fixed-point multiplier for the 8-bit stretch (see top of file) */
+static inline uint32_t scale8_mul(int range)
+{
+    return (255u * 65536u + (uint32_t)range - 1) / (uint32_t)range;
+}
+
+static inline uint16_t load_le16(const uint8_t *p)
+{
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+/* ── Format decoders ────────────────────────────────────────────────── */
+
+/* Samples a format has in len pixel bytes (a partial sample does not
+ * count; fewer than 2 bytes is an empty frame). */
+static inline int format_samples(int len, int bytes, int planes, int plane, int header)
+{
+    int avail = len - header - plane * bytes;
+    if (len < 2 || avail < bytes) return 0;
+    return (avail - bytes) / (planes * bytes) + 1;
+}
+
+/* Stretch window straight from the frame stats, for the layouts they
+ * cover. With constant arguments this folds to two loads or to 0. */
+static inline int format_stats_window(const frame_stats_t *st, int bytes, int planes,
+                                      int plane, int header, int *mn, int *mx)
+{
+    if (header) return 0;
+    if (bytes == 2 && planes == 1) { *mn = st->min16; *mx = st->max16; return 1; }
+    if (bytes == 1 && planes == 1) { *mn = st->min; *mx = st->max; return 1; }
+    if (bytes == 1 && planes == 2) {
+        *mn = plane ? st->min_odd : st->min_even;
+        *mx = plane ? st->max_odd : st->max_even;
+        return 1;
+    }
+    return 0;
+}
+
+/* One decoder per (backend B, format row). Every layout parameter is a
+ * literal, and flatten pulls the kernels (and their scalar tails) into
+ * the body compiled for B's target, so the stride folds into the loads
+ * and the fast-path choice is made at compile time. B##_TARGET carries
+ * the backend's target attribute. */
+#define IR_DECODER(B, id, name, bytes, planes, plane, header, w, h)                 \
+_Static_assert((bytes) == 1 || ((bytes) == 2 && (planes) == 1),                    \
+               name ": 16-bit formats must be single-plane");                      \
+static B##_TARGET __attribute__((flatten)) void                                     \
+B##_decode_##id(const frame_stats_t *st, const uint8_t *pix,                        \
+                uint32_t *dst, int width, int height)                               \
+{                                                                                   \
+    const uint8_t *src = pix + (header) + (plane) * (bytes);                        \
+    int npix = width * height, mn = 0, mx = 0;                                      \
+    int all = format_samples((int)st->pix_len, bytes, planes, plane, header);       \
+    int n = (all < npix) ? all : npix;                                              \
+    if (n > 0) {                                                                    \
+        if (n < all || !format_stats_window(st, bytes, planes, plane, header, &mn, &mx)) { \
+            if ((bytes) == 2) B##_minmax16(src, n, &mn, &mx);                       \
+            else              B##_minmax8(src, planes, n, &mn, &mx);                \
+        }                                                                           \
+        if ((bytes) == 2) B##_stretch16(src, n, mn, mx, dst);                       \
+        else              B##_stretch8(src, planes, n, mn, mx, dst);                \
+    }                                                                               \
+    if (n < npix) memset(dst + n, 0, (size_t)(npix - n) * sizeof(uint32_t));        \
+}
+
+#define IR_DECODER_REF(B, id, ...) B##_decode_##id,
+
+/* Kernel table entry for backend B, after its kernels */
+#define IR_KERNELS(B, usable)                                                       \
+    IR_FORMATS(IR_DECODER, B)                                                       \
+    static const ir_kernels_t k_##B = {                                             \
+        #B, usable, B##_minmax8, B##_stretch8, B##_minmax16, B##_stretch16,         \
+        { IR_FORMATS(IR_DECODER_REF, B) }                                           \
+    };
+
+/* ── Scalar reference ───────────────────────────────────────────────── */
+
+static int usable_always(void) { return 1; }
+
+static void scalar_minmax8(const uint8_t *src, int stride, int n, int *mn, int *mx)
+{
+    int lo = 255, hi = 0;
+    for (int i = 0; i < n; i++) {
+        int b = src[i * stride];
+        if (b < lo) lo = b;
+        if (b > hi) hi = b;
+    }
+    *mn = lo; *mx = hi;
+}
+
+static void scalar_stretch8(const uint8_t *src, int stride, int n,
+                            int mn, int mx, uint32_t *dst)
+{
+    int range = stretch_range(mn, mx);
+    for (int i = 0; i < n; i++) {
+        int s = ((int)src[i * stride] - mn) * 255 / range;
+        uint8_t v = (s < 0) ? 0 : (s > 255) ? 255 : (uint8_t)s;
+        dst[i] = gray_argb(v);
+    }
+}
+
+static void scalar_minmax16(const uint8_t *src, int n, int *mn, int *mx)
+{
+    int lo = 65535, hi = 0;
+    for (int i = 0; i < n; i++) {
+        int val = load_le16(src + i * 2);
+        if (val < lo) lo = val;
+        if (val > hi) hi = val;
+    }
+    *mn = lo; *mx = hi;
+}
+
+static void scalar_stretch16(const uint8_t *src, int n, int mn, int mx, uint32_t *dst)
+{
+    int range = stretch_range(mn, mx);
+    for (int i = 0; i < n; i++) {
+        int s = ((int)load_le16(src + i * 2) - mn) * 255 / range;
+        uint8_t v = (s < 0) ? 0 : (s > 255) ? 255 : (uint8_t)s;
+        dst[i] = gray_argb(v);
+    }
+}
+
+#define scalar_TARGET
+IR_KERNELS(scalar, usable_always)
+
+/* Vector loops for stride 2 stop one sample early: the last load of a
+ * block reads the byte after its last sample, which may be past the end.
+ * Tails (and that last sample) go to the scalar kernels. */
+static inline int vec_limit8(int stride, int n)
+{
+    return (stride == 1) ? n : n - 1;
+}
+
+#ifdef IR_RENDER_X86
+
+/* ── SSE2 ───────────────────────────────────────────────────────────── */
+
+static int usable_sse2(void) { return __builtin_cpu_supports("sse2"); }
+
+/* 16 samples; stride 2 packs the even bytes of 32 */
+static inline __m128i sse2_load8(const uint8_t *p, int stride)
+{
+    if (stride == 1) return _mm_loadu_si128((const __m128i *)p);
+    const __m128i lo = _mm_set1_epi16(0x00FF);
+    __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i *)p), lo);
+    __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i *)(p + 16)), lo);
+    return _mm_packus_epi16(a, b);
+}
+
+/* 16 gray bytes → 16 ARGB pixels: interleave g,g and g,0xFF, then the pairs */
+static inline void sse2_store_argb(uint32_t *d, __m128i g)
+{
+    const __m128i a = _mm_set1_epi8((char)0xFF);
+    __m128i gg_lo = _mm_unpacklo_epi8(g, g), gg_hi = _mm_unpackhi_epi8(g, g);
+    __m128i ga_lo = _mm_unpacklo_epi8(g, a), ga_hi = _mm_unpackhi_epi8(g, a);
+    _mm_storeu_si128((__m128i *)(d +  0), _mm_unpacklo_epi16(gg_lo, ga_lo));
+    _mm_storeu_si128((__m128i *)(d +  4), _mm_unpackhi_epi16(gg_lo, ga_lo));
+    _mm_storeu_si128((__m128i *)(d +  8), _mm_unpacklo_epi16(gg_hi, ga_hi));
+    _mm_storeu_si128((__m128i *)(d + 12), _mm_unpackhi_epi16(gg_hi, ga_hi));
+}
+
+static inline int sse2_hmin_epu8(__m128i v)
+{
+    v = _mm_min_epu8(v, _mm_srli_si128(v, 8));
+    v = _mm_min_epu8(v, _mm_srli_si128(v, 4));
+    v = _mm_min_epu8(v, _mm_srli_si128(v, 2));
+    v = _mm_min_epu8(v, _mm_srli_si128(v, 1));
+    return _mm_cvtsi128_si32(v) & 0xFF;
+}
+
+static inline int sse2_hmax_epu8(__m128i v)
+{
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 8));
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 4));
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 2));
+    v = _mm_max_epu8(v, _mm_srli_si128(v, 1));
+    return _mm_cvtsi128_si32(v) & 0xFF;
+}
+
+/* (x * M) >> 16 in 16-bit lanes, x already clamped to [0, range] */
+static inline __m128i sse2_scale8(__m128i x, __m128i mhi, __m128i mlo)
+{
+    return _mm_add_epi16(_mm_mullo_epi16(x, mhi), _mm_mulhi_epu16(x, mlo));
+}
+
+/* floor(x * 255 / range) for 4 int32 lanes, 0 <= x <= range <= 65535 */
+static inline __m128i sse2_scale16(__m128i x, __m128 frange, __m128 finv)
+{
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 q = _mm_mul_ps(_mm_cvtepi32_ps(x), _mm_set1_ps(255.0f));
+    __m128 r = _mm_cvtepi32_ps(_mm_cvttps_epi32(_mm_mul_ps(q, finv)));
+    __m128 up = _mm_cmple_ps(_mm_mul_ps(_mm_add_ps(r, one), frange), q);
+    r = _mm_add_ps(r, _mm_and_ps(up, one));
+    __m128 dn = _mm_cmpgt_ps(_mm_mul_ps(r, frange), q);
+    r = _mm_sub_ps(r, _mm_and_ps(dn, one));
+    return _mm_cvttps_epi32(r);
+}
+
+static void sse2_minmax8(const uint8_t *src, int stride, int n, int *mn, int *mx)
+{
+    int nv = vec_limit8(stride, n), i = 0;
+    int lo = 255, hi = 0;
+    if (nv >= 16) {
+        __m128i vmin = _mm_set1_epi8((char)0xFF), vmax = _mm_setzero_si128();
+        for (; i + 16 <= nv; i += 16) {
+            __m128i g = sse2_load8(src + i * stride, stride);
+            vmin = _mm_min_epu8(vmin, g);
+            vmax = _mm_max_epu8(vmax, g);
+        }
+        lo = sse2_hmin_epu8(vmin);
+        hi = sse2_hmax_epu8(vmax);
+    }
+    if (i < n) {
+        int tlo, thi;
+        scalar_minmax8(src + i * stride, stride, n - i, &tlo, &thi);
+        if (tlo < lo) lo = tlo;
+        if (thi > hi) hi = thi;
+    }
+    *mn = lo; *mx = hi;
+}
+
+static void sse2_stretch8(const uint8_t *src, int stride, int n,
+                          int mn, int mx, uint32_t *dst)
+{
+    int range = stretch_range(mn, mx);
+    uint32_t m = scale8_mul(range);
+    const __m128i vmn = _mm_set1_epi8((char)mn), vrange = _mm_set1_epi8((char)range);
+    const __m128i mhi = _mm_set1_epi16((short)(m >> 16));
+    const __m128i mlo = _mm_set1_epi16((short)(m & 0xFFFF));
+    const __m128i z = _mm_setzero_si128();
+    int nv = vec_limit8(stride, n), i = 0;
+
+    if (mn >= 0 && mn + range <= 255) {
+        for (; i + 16 <= nv; i += 16) {
+            __m128i x = _mm_subs_epu8(sse2_load8(src + i * stride, stride), vmn);
+            x = _mm_min_epu8(x, vrange);
+            __m128i yl = sse2_scale8(_mm_unpacklo_epi8(x, z), mhi, mlo);
+            __m128i yh = sse2_scale8(_mm_unpackhi_epi8(x, z), mhi, mlo);
+            sse2_store_argb(dst + i, _mm_packus_epi16(yl, yh));
+        }
+    }
+    scalar_stretch8(src + i * stride, stride, n - i, mn, mx, dst + i);
+}
+
+static void sse2_minmax16(const uint8_t *src, int n, int *mn, int *mx)
+{
+    int i = 0, lo = 65535, hi = 0;
+    if (n >= 8) {
+        /* No unsigned 16-bit min/max in SSE2: bias to signed */
+        const __m128i bias = _mm_set1_epi16((short)0x8000);
+        __m128i vmin = _mm_set1_epi16(0x7FFF), vmax = _mm_set1_epi16((short)0x8000);
+        for (; i + 8 <= n; i += 8) {
+            __m128i v = _mm_xor_si128(_mm_loadu_si128((const __m128i *)(src + i * 2)), bias);
+            vmin = _mm_min_epi16(vmin, v);
+            vmax = _mm_max_epi16(vmax, v);
+        }
+        vmin = _mm_min_epi16(vmin, _mm_srli_si128(vmin, 8));
+        vmin = _mm_min_epi16(vmin, _mm_srli_si128(vmin, 4));
+        vmin = _mm_min_epi16(vmin, _mm_srli_si128(vmin, 2));
+        vmax = _mm_max_epi16(vmax, _mm_srli_si128(vmax, 8));
+        vmax = _mm_max_epi16(vmax, _mm_srli_si128(vmax, 4));
+        vmax = _mm_max_epi16(vmax, _mm_srli_si128(vmax, 2));
+        lo = (_mm_extract_epi16(vmin, 0) ^ 0x8000) & 0xFFFF;
+        hi = (_mm_extract_epi16(vmax, 0) ^ 0x8000) & 0xFFFF;
+    }
+    if (i < n) {
+        int tlo, thi;
+        scalar_minmax16(src + i * 2, n - i, &tlo, &thi);
+        if (tlo < lo) lo = tlo;
+        if (thi > hi) hi = thi;
+    }
+    *mn = lo; *mx = hi;
+}
+
+static void sse2_stretch16(const uint8_t *src, int n, int mn, int mx, uint32_t *dst)
+{
+    int range = stretch_range(mn, mx);
+    const __m128i vmn = _mm_set1_epi16((short)mn), vrange = _mm_set1_epi16((short)range);
+    const __m128 frange = _mm_set1_ps((float)range), finv = _mm_set1_ps(1.0f / range);
+    const __m128i z = _mm_setzero_si128();
+    int i = 0;
+
+    if (mn >= 0 && mn + range <= 65535) {
+        for (; i + 16 <= n; i += 16) {
+            __m128i w[2];
+            for (int h = 0; h < 2; h++) {
+                __m128i x = _mm_loadu_si128((const __m128i *)(src + (i + h * 8) * 2));
+                x = _mm_subs_epu16(x, vmn);
+                x = _mm_sub_epi16(vrange, _mm_subs_epu16(vrange, x));  /* min(x, range) */
+                __m128i rl = sse2_scale16(_mm_unpacklo_epi16(x, z), frange, finv);
+                __m128i rh = sse2_scale16(_mm_unpackhi_epi16(x, z), frange, finv);
+                w[h] = _mm_packs_epi32(rl, rh);
+            }
+            sse2_store_argb(dst + i, _mm_packus_epi16(w[0], w[1]));
+        }
+    }
+    scalar_stretch16(src + i * 2, n - i, mn, mx, dst + i);
+}
+
+#define sse2_TARGET
+IR_KERNELS(sse2, usable_sse2)
+
+/* ── AVX2 ───────────────────────────────────────────────────────────── */
+
+#define AVX2 __attribute__((target("avx2")))
+
+static int usable_avx2(void) { return __builtin_cpu_supports("avx2"); }
+
+/* 32 samples; stride 2 packs the even bytes of 64. unordered = 1 skips
+ * the cross-lane fix-up (fine for min/max). */
+static AVX2 inline __m256i avx2_load8(const uint8_t *p, int stride, int unordered)
+{
+    if (stride == 1) return _mm256_loadu_si256((const __m256i *)p);
+    const __m256i lo = _mm256_set1_epi16(0x00FF);
+    __m256i a = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)p), lo);
+    __m256i b = _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(p + 32)), lo);
+    __m256i g = _mm256_packus_epi16(a, b);
+    return unordered ? g : _mm256_permute4x64_epi64(g, 0xD8);
+}
+
+/* 16 gray bytes → 16 ARGB pixels with two byte shuffles */
+static AVX2 inline void avx2_store_argb16(uint32_t *d, __m128i g)
+{
+    const __m256i m0 = _mm256_setr_epi8(
+        0, 0, 0, -1,  1, 1, 1, -1,  2, 2, 2, -1,  3, 3, 3, -1,
+        4, 4, 4, -1,  5, 5, 5, -1,  6, 6, 6, -1,  7, 7, 7, -1);
+    const __m256i m1 = _mm256_setr_epi8(
+        8, 8, 8, -1,  9, 9, 9, -1, 10,10,10, -1, 11,11,11, -1,
+       12,12,12, -1, 13,13,13, -1, 14,14,14, -1, 15,15,15, -1);
+    const __m256i a = _mm256_set1_epi32((int)0xFF000000u);
+    __m256i b = _mm256_broadcastsi128_si256(g);
+    _mm256_storeu_si256((__m256i *)(d + 0), _mm256_or_si256(_mm256_shuffle_epi8(b, m0), a));
+    _mm256_storeu_si256((__m256i *)(d + 8), _mm256_or_si256(_mm256_shuffle_epi8(b, m1), a));
+}
+
+static AVX2 inline __m256i avx2_scale8(__m256i x, __m256i mhi, __m256i mlo)
+{
+    return _mm256_add_epi16(_mm256_mullo_epi16(x, mhi), _mm256_mulhi_epu16(x, mlo));
+}
+
+static AVX2 inline __m256i avx2_scale16(__m256i x, __m256 frange, __m256 finv)
+{
+    const __m256 one = _mm256_set1_ps(1.0f);
+    __m256 q = _mm256_mul_ps(_mm256_cvtepi32_ps(x), _mm256_set1_ps(255.0f));
+    __m256 r = _mm256_round_ps(_mm256_mul_ps(q, finv), _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC);
+    __m256 up = _mm256_cmp_ps(_mm256_mul_ps(_mm256_add_ps(r, one), frange), q, _CMP_LE_OQ);
+    r = _mm256_add_ps(r, _mm256_and_ps(up, one));
+    __m256 dn = _mm256_cmp_ps(_mm256_mul_ps(r, frange), q, _CMP_GT_OQ);
+    r = _mm256_sub_ps(r, _mm256_and_ps(dn, one));
+    return _mm256_cvttps_epi32(r);
+}
+
+static AVX2 void avx2_minmax8(const uint8_t *src, int stride, int n, int *mn, int *mx)
+{
+    int nv = vec_limit8(stride, n), i = 0;
+    int lo = 255, hi = 0;
+    if (nv >= 32) {
+        __m256i vmin = _mm256_set1_epi8((char)0xFF), vmax = _mm256_setzero_si256();
+        for (; i + 32 <= nv; i += 32) {
+            __m256i g = avx2_load8(src + i * stride, stride, 1);
+            vmin = _mm256_min_epu8(vmin, g);
+            vmax = _mm256_max_epu8(vmax, g);
+        }
+        lo = sse2_hmin_epu8(_mm_min_epu8(_mm256_castsi256_si128(vmin),
+                                         _mm256_extracti128_si256(vmin, 1)));
+        hi = sse2_hmax_epu8(_mm_max_epu8(_mm256_castsi256_si128(vmax),
+                                         _mm256_extracti128_si256(vmax, 1)));
+    }
+    if (i < n) {
+        int tlo, thi;
+        scalar_minmax8(src + i * stride, stride, n - i, &tlo, &thi);
+        if (tlo < lo) lo = tlo;
+        if (thi > hi) hi = thi;
+    }
+    *mn = lo; *mx = hi;
+}
+
+static AVX2 void avx2_stretch8(const uint8_t *src, int stride, int n,
+                               int mn, int mx, uint32_t *dst)
+{
+    int range = stretch_range(mn, mx);
+    uint32_t m = scale8_mul(range);
+    const __m256i vmn = _mm256_set1_epi8((char)mn), vrange = _mm256_set1_epi8((char)range);
+    const __m256i mhi = _mm256_set1_epi16((short)(m >> 16));
+    const __m256i mlo = _mm256_set1_epi16((short)(m & 0xFFFF));
+    const __m256i z = _mm256_setzero_si256();
+    int nv = vec_limit8(stride, n), i = 0;
+
+    if (mn >= 0 && mn + range <= 255) {
+        for (; i + 32 <= nv; i += 32) {
+            __m256i x = _mm256_subs_epu8(avx2_load8(src + i * stride, stride, 0), vmn);
+            x = _mm256_min_epu8(x, vrange);
+            /* unpack/pack are both per 128-bit lane, so order survives */
+            __m256i yl = avx2_scale8(_mm256_unpacklo_epi8(x, z), mhi, mlo);
+            __m256i yh = avx2_scale8(_mm256_unpackhi_epi8(x, z), mhi, mlo);
+            __m256i g = _mm256_packus_epi16(yl, yh);
+            avx2_store_argb16(dst + i,      _mm256_castsi256_si128(g));
+            avx2_store_argb16(dst + i + 16, _mm256_extracti128_si256(g, 1));
+        }
+    }
+    scalar_stretch8(src + i * stride, stride, n - i, mn, mx, dst + i);
+}
+
+static AVX2 void avx2_minmax16(const uint8_t *src, int n, int *mn, int *mx)
+{
+    int i = 0, lo = 65535, hi = 0;
+    if (n >= 16) {
+        __m256i vmin = _mm256_set1_epi16(-1), vmax = _mm256_setzero_si256();
+        for (; i + 16 <= n; i += 16) {
+            __m256i v = _mm256_loadu_si256((const __m256i *)(src + i * 2));
+            vmin = _mm256_min_epu16(vmin, v);
+            vmax = _mm256_max_epu16(vmax, v);
+        }
+        __m128i a = _mm_min_epu16(_mm256_castsi256_si128(vmin), _mm256_extracti128_si256(vmin, 1));
+        __m128i b = _mm_max_epu16(_mm256_castsi256_si128(vmax), _mm256_extracti128_si256(vmax, 1));
+        lo = _mm_extract_epi16(_mm_minpos_epu16(a), 0);
+        /* max(x) = ~min(~x) */
+        hi = 0xFFFF & ~_mm_extract_epi16(_mm_minpos_epu16(_mm_xor_si128(b, _mm_set1_epi16(-1))), 0);
+    }
+    if (i < n) {
+        int tlo, thi;
+        scalar_minmax16(src + i * 2, n - i, &tlo, &thi);
+        if (tlo < lo) lo = tlo;
+        if (thi > hi) hi = thi;
+    }
+    *mn = lo; *mx = hi;
+}
+
+static AVX2 void avx2_stretch16(const uint8_t *src, int n, int mn, int mx, uint32_t *dst)
+{
+    int range = stretch_range(mn, mx);
+    const __m256i vmn = _mm256_set1_epi16((short)mn), vrange = _mm256_set1_epi16((short)range);
+    const __m256 frange = _mm256_set1_ps((float)range), finv = _mm256_set1_ps(1.0f / range);
+    /* low byte of each dword → g,g,g,0 (alpha ORed in) */
+    const __m256i spread = _mm256_setr_epi8(
+        0, 0, 0, -1,  4, 4, 4, -1,  8, 8, 8, -1, 12,12,12, -1,
+        0, 0, 0, -1,  4, 4, 4, -1,  8, 8, 8, -1, 12,12,12, -1);
+    const __m256i a = _mm256_set1_epi32((int)0xFF000000u);
+    int i = 0;
+
+    if (mn >= 0 && mn + range <= 65535) {
+        for (; i + 16 <= n; i += 16) {
+            __m256i x = _mm256_loadu_si256((const __m256i *)(src + i * 2));
+            x = _mm256_min_epu16(_mm256_subs_epu16(x, vmn), vrange);
+            __m256i rl = avx2_scale16(_mm256_cvtepu16_epi32(_mm256_castsi256_si128(x)), frange, finv);
+            __m256i rh = avx2_scale16(_mm256_cvtepu16_epi32(_mm256_extracti128_si256(x, 1)), frange, finv);
+            _mm256_storeu_si256((__m256i *)(dst + i),     _mm256_or_si256(_mm256_shuffle_epi8(rl, spread), a));
+            _mm256_storeu_si256((__m256i *)(dst + i + 8), _mm256_or_si256(_mm256_shuffle_epi8(rh, spread), a));
+        }
+    }
+    scalar_stretch16(src + i * 2, n - i, mn, mx, dst + i);
+}
+
+#define avx2_TARGET AVX2
+IR_KERNELS(avx2, usable_avx2)
+
+#endif /* IR_RENDER_X86 */
+
+#ifdef IR_RENDER_NEON
+
+/* ── NEON (AArch64) ─────────────────────────────────────────────────── */
+
+/* 16 samples; stride 2 is a de-interleaving load of 32 */
+static inline uint8x16_t neon_load8(const uint8_t *p, int stride)
+{
+    return (stride == 1) ? vld1q_u8(p) : vld2q_u8(p).val[0];
+}
+
+/* 16 gray bytes → 16 ARGB pixels with one interleaving store */
+static inline void neon_store_argb(uint32_t *d, uint8x16_t g)
+{
+    uint8x16x4_t o = { { g, g, g, vdupq_n_u8(0xFF) } };
+    vst4q_u8((uint8_t *)d, o);
+}
+
+static inline uint16x8_t neon_scale8(uint16x8_t x, uint16_t mhi, uint16x4_t mlo)
+{
+    uint16x4_t hl = vshrn_n_u32(vmull_u16(vget_low_u16(x), mlo), 16);
+    uint16x4_t hh = vshrn_n_u32(vmull_u16(vget_high_u16(x), mlo), 16);
+    return vaddq_u16(vmulq_n_u16(x, mhi), vcombine_u16(hl, hh));
+}
+
+static inline uint16x4_t neon_scale16(uint32x4_t x, uint32_t range, float inv)
+{
+    uint32x4_t q = vmulq_n_u32(x, 255);
+    uint32x4_t r = vcvtq_u32_f32(vmulq_n_f32(vcvtq_f32_u32(q), inv));
+    /* masks are all-ones (-1): subtracting adds one, adding subtracts one */
+    r = vsubq_u32(r, vcleq_u32(vmulq_n_u32(vaddq_u32(r, vdupq_n_u32(1)), range), q));
+    r = vaddq_u32(r, vcgtq_u32(vmulq_n_u32(r, range), q));
+    return vmovn_u32(r);
+}
+
+static void neon_minmax8(const uint8_t *src, int stride, int n, int *mn, int *mx)
+{
+    int nv = vec_limit8(stride, n), i = 0;
+    int lo = 255, hi = 0;
+    if (nv >= 16) {
+        uint8x16_t vmin = vdupq_n_u8(0xFF), vmax = vdupq_n_u8(0);
+        for (; i + 16 <= nv; i += 16) {
+            uint8x16_t g = neon_load8(src + i * stride, stride);
+            vmin = vminq_u8(vmin, g);
+            vmax = vmaxq_u8(vmax, g);
+        }
+        lo = vminvq_u8(vmin);
+        hi = vmaxvq_u8(vmax);
+    }
+    if (i < n) {
+        int tlo, thi;
+        scalar_minmax8(src + i * stride, stride, n - i, &tlo, &thi);
+        if (tlo < lo) lo = tlo;
+        if (thi > hi) hi = thi;
+    }
+    *mn = lo; *mx = hi;
+}
+
+static void neon_stretch8(const uint8_t *src, int stride, int n,
+                          int mn, int mx, uint32_t *dst)
+{
+    int range = stretch_range(mn, mx);
+    uint32_t m = scale8_mul(range);
+    const uint8x16_t vmn = vdupq_n_u8((uint8_t)mn), vrange = vdupq_n_u8((uint8_t)range);
+    const uint16_t mhi = (uint16_t)(m >> 16);
+    const uint16x4_t mlo = vdup_n_u16((uint16_t)(m & 0xFFFF));
+    int nv = vec_limit8(stride, n), i = 0;
+
+    if (mn >= 0 && mn + range <= 255) {
+        for (; i + 16 <= nv; i += 16) {
+            uint8x16_t x = vminq_u8(vqsubq_u8(neon_load8(src + i * stride, stride), vmn), vrange);
+            uint16x8_t yl = neon_scale8(vmovl_u8(vget_low_u8(x)), mhi, mlo);
+            uint16x8_t yh = neon_scale8(vmovl_high_u8(x), mhi, mlo);
+            neon_store_argb(dst + i, vcombine_u8(vmovn_u16(yl), vmovn_u16(yh)));
+        }
+    }
+    scalar_stretch8(src + i * stride, stride, n - i, mn, mx, dst + i);
+}
+
+static void neon_minmax16(const uint8_t *src, int n, int *mn, int *mx)
+{
+    int i = 0, lo = 65535, hi = 0;
+    if (n >= 8) {
+        uint16x8_t vmin = vdupq_n_u16(0xFFFF), vmax = vdupq_n_u16(0);
+        for (; i + 8 <= n; i += 8) {
+            uint16x8_t v = vreinterpretq_u16_u8(vld1q_u8(src + i * 2));
+            vmin = vminq_u16(vmin, v);
+            vmax = vmaxq_u16(vmax, v);
+        }
+        lo = vminvq_u16(vmin);
+        hi = vmaxvq_u16(vmax);
+    }
+    if (i < n) {
+        int tlo, thi;
+        scalar_minmax16(src + i * 2, n - i, &tlo, &thi);
+        if (tlo < lo) lo = tlo;
+        if (thi > hi) hi = thi;
+    }
+    *mn = lo; *mx = hi;
+}
+
+static void neon_stretch16(const uint8_t *src, int n, int mn, int mx, uint32_t *dst)
+{
+    int range = stretch_range(mn, mx);
+    const uint16x8_t vmn = vdupq_n_u16((uint16_t)mn), vrange = vdupq_n_u16((uint16_t)range);
+    const float inv = 1.0f / range;
+    int i = 0;
+
+    if (mn >= 0 && mn + range <= 65535) {
+        for (; i + 16 <= n; i += 16) {
+            uint8x8_t g[2];
+            for (int h = 0; h < 2; h++) {
+                uint16x8_t x = vreinterpretq_u16_u8(vld1q_u8(src + (i + h * 8) * 2));
+                x = vminq_u16(vqsubq_u16(x, vmn), vrange);
+                uint16x4_t rl = neon_scale16(vmovl_u16(vget_low_u16(x)), (uint32_t)range, inv);
+                uint16x4_t rh = neon_scale16(vmovl_high_u16(x), (uint32_t)range, inv);
+                g[h] = vmovn_u16(vcombine_u16(rl, rh));
+            }
+            neon_store_argb(dst + i, vcombine_u8(g[0], g[1]));
+        }
+    }
+    scalar_stretch16(src + i * 2, n - i, mn, mx, dst + i);
+}
+
+#define neon_TARGET
+IR_KERNELS(neon, usable_always)
+
+#endif /* IR_RENDER_NEON */
+
+/* ── Dispatch ───────────────────────────────────────────────────────── */
+
+/* Worst to best */
+static const ir_kernels_t *const k_all[] = {
+    &k_scalar,
+#ifdef IR_RENDER_X86
+    &k_sse2, &k_avx2,
+#endif
+#ifdef IR_RENDER_NEON
+    &k_neon,
+#endif
+    NULL
+};
+
+static const ir_kernels_t *g_kern;
+
+static const ir_kernels_t *best_kernels(void)
+{
+    const ir_kernels_t *best = &k_scalar;
+    for (int i = 0; k_all[i]; i++)
+        if (k_all[i]->usable()) best = k_all[i];
+    return best;
+}
+
+const ir_kernels_t *ir_render_kernels(void)
+{
+    const ir_kernels_t *k = __atomic_load_n(&g_kern, __ATOMIC_ACQUIRE);
+    if (!k) {
+        k = best_kernels();
+        __atomic_store_n(&g_kern, k, __ATOMIC_RELEASE);
+    }
+    return k;
+}
+
+const char *ir_render_backend(void)
+{
+    return ir_render_kernels()->name;
+}
+
+int ir_render_select(const char *name)
+{
+    const ir_kernels_t *k = NULL;
+    if (!name) {
+        k = best_kernels();
+    } else {
+        for (int i = 0; k_all[i]; i++)
+            if (strcmp(k_all[i]->name, name) == 0 && k_all[i]->usable()) k = k_all[i];
+    }
+    if (!k) return -1;
+    __atomic_store_n(&g_kern, k, __ATOMIC_RELEASE);
+    return 0;
+}
+
+const ir_kernels_t *const *ir_render_backends(void)
+{
+    return k_all;
+}
+
+/* ── Frame rendering ────────────────────────────────────────────────── */
+
+int ir_render_minmax(const uint8_t *src, int srclen, int npix, int mode,
+                     int *mn, int *mx)
+{
+    const ir_kernels_t *k = ir_render_kernels();
+    int n = 0;
+
+    *mn = *mx = 0;
+    if (srclen < 2) return 0;
+    switch (mode) {
+    case IR_MODE_RAW:
+        n = (srclen < npix) ? srclen : npix;
+        k->minmax8(src, 1, n, mn, mx);
+        break;
+    case IR_MODE_DEINT_EVEN:
+    case IR_MODE_DEINT_ODD: {
+        int start = (mode == IR_MODE_DEINT_ODD) ? 1 : 0;
+        int halflen = (srclen - start + 1) / 2;
+        n = (halflen < npix) ? halflen : npix;
+        k->minmax8(src + start, 2, n, mn, mx);
+        break;
+    }
+    case IR_MODE_16BIT_LE:
+        n = srclen / 2;
+        if (n > npix) n = npix;
+        k->minmax16(src, n, mn, mx);
+        break;
+    }
+    return n;
+}
+
+int ir_render_window(const frame_stats_t *st, const uint8_t *pix, int npix, int mode,
+                     int *mn, int *mx)
+{
+    int len = (int)st->pix_len;
+    if (len < 2) { *mn = *mx = 0; return 0; }
+
+    switch (mode) {
+    case IR_MODE_RAW:
+        if (len > npix) break;
+        *mn = st->min; *mx = st->max;
+        return len;
+    case IR_MODE_DEINT_EVEN:
+        if ((len + 1) / 2 > npix) break;
+        *mn = st->min_even; *mx = st->max_even;
+        return (len + 1) / 2;
+    case IR_MODE_DEINT_ODD:
+        if (len / 2 > npix) break;
+        *mn = st->min_odd; *mx = st->max_odd;
+        return len / 2;
+    case IR_MODE_16BIT_LE:
+        if (len / 2 > npix) break;
+        *mn = st->min16; *mx = st->max16;
+        return len / 2;
+    }
+    /* Only part of the frame is on screen: window over what is shown */
+    return ir_render_minmax(pix, len, npix, mode, mn, mx);
+}
+
+static void render_window(const uint8_t *src, int n, int mn, int mx,
+                          uint32_t *dst, int npix, int mode)
+{
+    const ir_kernels_t *k = ir_render_kernels();
+    if (n > 0) {
+        if (mode == IR_MODE_16BIT_LE)
+            k->stretch16(src, n, mn, mx, dst);
+        else
+            k->stretch8(src + (mode == IR_MODE_DEINT_ODD), (mode == IR_MODE_RAW) ? 1 : 2,
+                        n, mn, mx, dst);
+    }
+    /* black background where there is no data */
+    if (n < npix) memset(dst + n, 0, (size_t)(npix - n) * sizeof(uint32_t));
+}
+
+void ir_render(const uint8_t *src, int srclen,
+               uint32_t *dst, int width, int height, int mode)
+{
+    int npix = width * height;
+    int mn, mx;
+    int n = ir_render_minmax(src, srclen, npix, mode, &mn, &mx);
+    render_window(src, n, mn, mx, dst, npix, mode);
+}
+
+ir_decode_fn ir_render_decoder(int mode)
+{
+    return ir_render_kernels()->decode[mode];
+}
+
+void ir_render_stats(const frame_stats_t *st, const uint8_t *pix,
+                     uint32_t *dst, int width, int height, int mode)
+{
+    ir_render_kernels()->decode[mode](st, pix, dst, width, height);
+}
@@ -0,0 +1,130 @@
+/*
+ * ir_render.h — IR frame → ARGB8888 conversion with auto-contrast stretch
+ *
+ * Every display mode is the same two steps: find the min/max of the
+ * samples, then map each sample to (v - min) * 255 / (max - min) and pack
+ * it as opaque gray. Both steps have scalar, SSE2, AVX2 and NEON kernels;
+ * the best one the CPU supports is picked on first use. All backends
+ * produce bit-identical output (the divide is replaced by an exact
+ * fixed-point / float reciprocal with correction, not an approximation).
+ *
+ *   ir_render(pix, pixlen, argb, 642, 480, IR_MODE_RAW);
+ *   ir_decode_fn dec = ir_render_decoder(IR_MODE_RAW);
+ *   dec(&f->stats, pix, argb, 642, 480);         // hot path
+ *   printf("%s\n", ir_render_backend());        // "avx2"
+ *   ir_render_select("scalar");                  // force a backend
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_IR_RENDER_H
+#define SQUIG_IR_RENDER_H
+
+#include <stdint.h>
+#include "frame_stats.h"
+
+/* ── Sensor formats ─────────────────────────────────────────────────── */
+
+/* One row per way of reading a frame's pixel bytes. Everything a decoder
+ * needs is fixed here, so each row is compiled into its own decoder per
+ * backend (ir_render_decoder()) with no mode switch or stride argument
+ * left in the loop. Adding a layout is one row.
+ *
+ *   X(arg, ID, name, bytes, planes, plane, header, width, height)
+ *
+ *   bytes    bytes per sample: 1 (8-bit) or 2 (16-bit little-endian)
+ *   planes   interleaved channels; a sample is every planes*bytes bytes
+ *   plane    which channel is displayed (0 .. planes-1)
+ *   header   bytes to skip before the first sample
+ *   width, height  native geometry (the viewer's default window)
+ *
+ * 16-bit formats must be single-plane (there is no strided 16-bit kernel).
+ * arg is passed through untouched, for tables generated per backend. */
+#define IR_FORMATS(X, arg) \
+    X(arg, RAW,        "raw-8bit",   1, 1, 0, 0, 642, 480)  /* bytes as 8-bit gray */     \
+    X(arg, DEINT_EVEN, "deint-even", 1, 2, 0, 0, 642, 480)  /* even-index bytes only */   \
+    X(arg, DEINT_ODD,  "deint-odd",  1, 2, 1, 0, 642, 480)  /* odd-index bytes only */    \
+    X(arg, 16BIT_LE,   "16bit-LE",   2, 1, 0, 0, 642, 480)  /* 16-bit LE, scaled */
+
+#define IR_FORMAT_ENUM(arg, id, ...) IR_MODE_##id,
+enum {
+    IR_FORMATS(IR_FORMAT_ENUM, _)
+    IR_MODE_COUNT
+};
+#undef IR_FORMAT_ENUM
+
+typedef struct {
+    const char *name;
+    int bytes, planes, plane, header;
+    int width, height;
+} ir_format_t;
+
+/* Descriptors, indexed by IR_MODE_*. */
+extern const ir_format_t ir_formats[IR_MODE_COUNT];
+extern const char *const ir_mode_names[IR_MODE_COUNT];
+
+/* IR_MODE_* for a format name, or -1. */
+int ir_format_find(const char *name);
+
+/* Display decoder: stretch window from st (or a rescan when only part of
+ * the frame fits width*height) and ARGB out, black past the samples. st
+ * describes the pix_len bytes at pix. */
+typedef void (*ir_decode_fn)(const frame_stats_t *st, const uint8_t *pix,
+                             uint32_t *dst, int width, int height);
+
+/* The active backend's decoder specialised for mode. Cache it for as long
+ * as neither the mode nor ir_render_select() changes. */
+ir_decode_fn ir_render_decoder(int mode);
+
+/* Render src (srclen bytes) into dst (width*height ARGB pixels) using the
+ * given mode. Pixels beyond the available samples are black. */
+void ir_render(const uint8_t *src, int srclen,
+               uint32_t *dst, int width, int height, int mode);
+
+/* Min/max of the samples mode would display in npix pixels (the
+ * contrast-stretch window). Returns the number of samples. */
+int ir_render_minmax(const uint8_t *src, int srclen, int npix, int mode,
+                     int *mn, int *mx);
+
+/* Stretch window for the samples mode displays, taken from precomputed
+ * frame stats when they cover exactly those samples (the frame fits in
+ * npix pixels), otherwise rescanned with ir_render_minmax(). st describes
+ * the pix_len bytes at pix. Returns the number of samples. */
+int ir_render_window(const frame_stats_t *st, const uint8_t *pix, int npix, int mode,
+                     int *mn, int *mx);
+
+/* ir_render() for a frame that already has stats: no min/max pass.
+ * Same as ir_render_decoder(mode)(st, pix, dst, width, height). */
+void ir_render_stats(const frame_stats_t *st, const uint8_t *pix,
+                     uint32_t *dst, int width, int height, int mode);
+
+/* ── Kernels ────────────────────────────────────────────────────────── */
+
+/* One backend's kernels. 8-bit kernels read n samples at src[i * stride]
+ * (stride 1 or 2); 16-bit kernels read n little-endian words. */
+typedef struct {
+    const char *name;
+    int  (*usable)(void);
+    void (*minmax8)(const uint8_t *src, int stride, int n, int *mn, int *mx);
+    void (*stretch8)(const uint8_t *src, int stride, int n,
+                     int mn, int mx, uint32_t *dst);
+    void (*minmax16)(const uint8_t *src, int n, int *mn, int *mx);
+    void (*stretch16)(const uint8_t *src, int n, int mn, int mx, uint32_t *dst);
+    ir_decode_fn decode[IR_MODE_COUNT];     /* per-format, kernels inlined */
+} ir_kernels_t;
+
+/* Kernels in use (selects the best usable backend on first call). */
+const ir_kernels_t *ir_render_kernels(void);
+
+/* Name of the backend in use: "scalar", "sse2", "avx2" or "neon". */
+const char *ir_render_backend(void);
+
+/* Force a backend by name (NULL = best available again).
+ * Returns 0, or -1 if it is unknown or not supported on this CPU. */
+int ir_render_select(const char *name);
+
+/* All backends compiled in, usable or not, NULL-terminated (benchmarks). */
+const ir_kernels_t *const *ir_render_backends(void);
+
+#endif /* SQUIG_IR_RENDER_H */
@@ -19,11 +19,14 @@
  *   M         Cycle display mode (raw / deinterleave-even / odd / 16-bit)
  *   +/-       Adjust display width ±1  (Shift: ±10)
  *   R         Reset width to 642
- *   S         Toggle stripe filter (skip interleaved frames)
+ *   S         Switch the displayed frame type (8-bit / interleaved)
  *   A         Toggle frame accumulation (concat fragments → full frame)
  *   H         Toggle frame-hold (only update on consistent frames)
  *   L         Lock onto current frame's size band
+ *   P         Cycle false-colour palette (GPU path only)
+ *   E         Toggle pupil / glint / nostril detection (eye_detect.c)
  *   D         Save next displayed frame as /tmp/tobii_frame.raw
+ *   Space     Pause/resume (--replay)
  *   B         Lower brightness threshold
  *   Q/Esc     Quit
  *
@@ -32,13 +35,67 @@
  *   IF1 = Video Control   (0x0E/0x01) — UVC control (we claim this)
  *   IF2 = Video Streaming (0x0E/0x02) — UVC bulk frames (we read this)
  *
+ * Frames come from the asynchronous capture engine (uvc_capture.c), which
+ * keeps several bulk transfers queued so the endpoint never sits idle
+ * while this thread is busy rendering. Frame memory lives in a shared
+ * frame_pool; hold and accumulation keep references instead of copies.
+ * The engine is owned by uvc_device.c: bring-up commits the probe cached
+ * for this tracker's serial, and unplugging the tracker pauses the window
+ * ("tracker away") until it is plugged back in on any port. The window
+ * alone asks for a preview (the slowest frame interval the tracker
+ * offers) and drops even that while minimised; --dump, --rawdump,
+ * --record and --full-rate ask for the fastest, and so does eye
+ * detection while it is on (it subscribes and unsubscribes at runtime).
+ *
+ * Pipeline (one thread per stage, no locks between them):
+ *   capture   libusb event thread → SPSC ring of finished frames
+ *   demux     sorts frames by type (frame_demux.h) onto per-type queues;
+ *             types nobody displays are only counted
+ *   classify  size / brightness filters and frame-hold on the displayed
+ *             type → "latest wins" mailbox (stale frames are dropped,
+ *             counted)
+ *             and, with E, eye_detect.c on each full 8-bit plane
+ *   render    SDL events, decode, present (vsync-bound)
+ * The title bar shows every stage's queue depth (capture ring, each
+ * type's queue, the mailbox, the recorder backlog) and what each stage
+ * dropped, and the rate of each frame type.
+ * --metrics unix:PATH | PORT | HOST:PORT serves the same counters, and
+ * more, as Prometheus text (metrics.h), with or without the window: USB
+ * transfer completions, errors and time-outs, frames and drops per
+ * handoff, frames per type, filter skips, recorder drops, and a histogram
+ * of last byte → classified. They are published once a second from the
+ * thread that consumes the capture engine.
+ * With --replay the capture stage is a capfile_player over a recording
+ * made with --rawdump (capture_file.h) and no USB device is opened.
+ * --record adds recorder.c on the capture side: every finished frame is
+ * copied into the recorder's ring from the event thread and written out
+ * (rotated, optionally compressed) by its own thread, with or without the
+ * window.
+ * Decoding uses the SIMD kernels in ir_render.c (SSE2/AVX2/NEON, picked
+ * at runtime) through the decoder generated for the current format, so
+ * the per-frame call has no mode switch; `make bench` times them against
+ * the scalar reference.
+ *
  * Build:
- *   gcc -O2 -o ir_viewer ir_viewer.c $(pkg-config --cflags --libs libusb-1.0 sdl2)
+ *   make    (or: gcc -O2 -pthread -o ir_viewer ir_viewer.c uvc_capture.c uvc_device.c
+ *                frame_pool.c frame_stats.c capture_file.c recorder.c frame_demux.c
+ *                ir_render.c ir_gl.c metrics.c eye_detect.c
+ *                $(pkg-config --cflags --libs libusb-1.0 sdl2))
  *
  * Run:
  *   sudo -E ./ir_viewer              # SDL2 window
  *   sudo -E ./ir_viewer --dump       # text stats + analysis
- *   sudo -E ./ir_viewer --rawdump    # save raw USB packet stream
+ *   sudo -E ./ir_viewer --rawdump [file]   # record frames (.sqcap, indexed)
+ *   sudo -E ./ir_viewer --record /data/ir/night --rotate-mb 2048 \
+ *                       --compress lz4 [--no-window]   # long sessions
+ *   sudo -E ./ir_viewer --gl         # GPU decode (8-bit texture + shader)
+ *   ./ir_viewer --replay file [--speed x] [--loop]   # no hardware needed
+ *                                    (--speed 0 = as fast as possible)
+ *   sudo -E ./ir_viewer --list-devices             # every ET5, by USB path
+ *   sudo -E ./ir_viewer --device 1-4.2 --cpu 2     # one of several, capture pinned
+ *   sudo -E ./ir_viewer --full-rate                # preview at the fastest interval
+ *   sudo -E ./ir_viewer --eyes                     # pupils / glints / nostrils, full rate
+ *   sudo -E ./ir_viewer --record /data/ir/x --no-window --metrics 9465   # monitored
  *
  * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
  * See LICENSE file for details.
@@ -49,248 +106,434 @@
 #include <string.h>
 #include <stdint.h>
 #include <signal.h>
+#include <time.h>
 #include <unistd.h>
 #include <math.h>
 #include <libusb.h>
+#include <pthread.h>
 #include <SDL.h>
-
-/* ── Tobii USB constants ────────────────────────────────────────────── */
-#define TOBII_VID           0x2104
-#define TOBII_PID           0x0313
-#define IF_VIDEO_CONTROL    1
-#define IF_VIDEO_STREAM     2
-#define EP_BULK_IN          0x82
+#include "uvc_capture.h"
+#include "uvc_device.h"
+#include "capture_file.h"
+#include "recorder.h"
+#include "frame_mailbox.h"
+#include "frame_demux.h"
+#include "ir_render.h"
+#include "ir_gl.h"
+#include "metrics.h"
+#include "eye_detect.h"
+
+/* ── Viewer geometry ────────────────────────────────────────────────── */
 #define FRAME_W_DEFAULT     642
 #define FRAME_H_DEFAULT     480
-#define MAX_FRAME_SIZE      (1024 * 1024)
-
-/* ── UVC Protocol ───────────────────────────────────────────────────── */
-#define VS_PROBE_CONTROL    0x01
-#define VS_COMMIT_CONTROL   0x02
-#define UVC_SET_CUR         0x01
-#define UVC_GET_CUR         0x81
-#define UVC_GET_MAX         0x83
-
-typedef struct __attribute__((packed)) {
-    uint16_t bmHint;
-    uint8_t  bFormatIndex;
-    uint8_t  bFrameIndex;
-    uint32_t dwFrameInterval;
-    uint16_t wKeyFrameRate;
-    uint16_t wPFrameRate;
-    uint16_t wCompQuality;
-    uint16_t wCompWindowSize;
-    uint16_t wDelay;
-    uint32_t dwMaxVideoFrameSize;
-    uint32_t dwMaxPayloadTransferSize;
-} uvc_probe_t;
-
-#define BFH_FID     0x01
-#define BFH_EOF     0x02
-#define BFH_ERR     0x40
+#define VIEWER_POOL_SLOTS   16
+#define VIEWER_DEMUX_DEPTH  4        /* per frame type; only displayed types hold slots */
+#define RAWDUMP_PATH        "/tmp/tobii_capture.sqcap"
+#define RAWDUMP_MAX_BYTES   (256u * 1024 * 1024)
 
 /* ── Globals ────────────────────────────────────────────────────────── */
 static volatile int g_running = 1;
 static void sig_handler(int s) { (void)s; g_running = 0; }
 
-/* ── Display modes ──────────────────────────────────────────────────── */
-enum {
-    MODE_RAW = 0,       /* render bytes directly as 8-bit grayscale */
-    MODE_DEINT_EVEN,    /* de-interleave: even-index bytes only */
-    MODE_DEINT_ODD,     /* de-interleave: odd-index bytes only  */
-    MODE_16BIT_LE,      /* interpret as 16-bit LE, display scaled */
-    MODE_COUNT
-};
-static const char *mode_names[] = {
-    "raw-8bit", "deint-even", "deint-odd", "16bit-LE"
-};
-
-/* ── UVC control transfers ──────────────────────────────────────────── */
-
-static int uvc_ctrl(libusb_device_handle *d, uint8_t req, uint8_t cs,
-                    uint8_t intf, void *buf, uint16_t len)
+/* ── Analysis helpers ───────────────────────────────────────────────── */
+
+static void hexdump(const uint8_t *p, int n) {
+    for (int i = 0; i < n; i++) printf("%02x ", p[i]);
+    printf("\n");
+}
+
+/* "lz4", "zstd:9", ... → CAPFILE_CODEC_*, or -1 */
+static int parse_codec(const char *s, int *level)
 {
-    uint8_t rt = (req & 0x80)
-        ? (LIBUSB_ENDPOINT_IN  | LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE)
-        : (LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE);
-    return libusb_control_transfer(d, rt, req, (uint16_t)(cs << 8), intf, buf, len, 2000);
+    for (int c = 0; c < CAPFILE_CODEC_COUNT; c++) {
+        size_t n = strlen(capfile_codec_names[c]);
+        if (strncmp(s, capfile_codec_names[c], n) == 0 && (s[n] == 0 || s[n] == ':')) {
+            *level = s[n] ? atoi(s + n + 1) : 0;
+            return c;
+        }
+    }
+    return -1;
 }
 
-static uint32_t negotiated_frame_size = 0;
+static void print_rec_status(recorder_t *rec)
+{
+    recorder_stats_t rs;
+    char path[256];
+    recorder_get_stats(rec, &rs);
+    recorder_current_file(rec, path, sizeof(path));
+    printf("\r[REC] %s  %llu frames  %.1f MB  backlog %d (max %u)  drop=%llu   ",
+           path, (unsigned long long)rs.written, rs.bytes_disk / 1048576.0,
+           rs.queued, rs.queue_max,
+           (unsigned long long)(rs.drop_nobuf + rs.drop_toobig + rs.drop_error));
+    fflush(stdout);
+}
 
-static int uvc_start(libusb_device_handle *d)
+/* Per-type totals: how the stream's bandwidth splits between the types */
+static void print_demux_stats(frame_demux_t *dm)
 {
-    uvc_probe_t p;
-    int r;
-
-    memset(&p, 0, sizeof(p));
-    r = uvc_ctrl(d, UVC_GET_MAX, VS_PROBE_CONTROL, IF_VIDEO_STREAM, &p, sizeof(p));
-    if (r >= 0)
-        printf("[UVC] GET_MAX: fmt=%d frm=%d interval=%u maxframe=%u maxpayload=%u\n",
-               p.bFormatIndex, p.bFrameIndex, p.dwFrameInterval,
-               p.dwMaxVideoFrameSize, p.dwMaxPayloadTransferSize);
-
-    memset(&p, 0, sizeof(p));
-    p.bmHint = 0x0001; p.bFormatIndex = 1; p.bFrameIndex = 1;
-    p.dwFrameInterval = 416667;
-
-    r = uvc_ctrl(d, UVC_SET_CUR, VS_PROBE_CONTROL, IF_VIDEO_STREAM, &p, sizeof(p));
-    if (r < 0) { printf("[UVC] PROBE SET: %s\n", libusb_strerror(r)); return -1; }
-
-    memset(&p, 0, sizeof(p));
-    r = uvc_ctrl(d, UVC_GET_CUR, VS_PROBE_CONTROL, IF_VIDEO_STREAM, &p, sizeof(p));
-    if (r >= 0) {
-        printf("[UVC] Negotiated: fmt=%d frm=%d interval=%u maxframe=%u payload=%u\n",
-               p.bFormatIndex, p.bFrameIndex, p.dwFrameInterval,
-               p.dwMaxVideoFrameSize, p.dwMaxPayloadTransferSize);
-        negotiated_frame_size = p.dwMaxVideoFrameSize;
-    }
-
-    r = uvc_ctrl(d, UVC_SET_CUR, VS_COMMIT_CONTROL, IF_VIDEO_STREAM, &p, sizeof(p));
-    if (r < 0) { printf("[UVC] COMMIT: %s\n", libusb_strerror(r)); return -1; }
-    printf("[UVC] Stream committed — EP 0x%02X\n", EP_BULK_IN);
-    return 0;
+    for (int c = 0; c < FRAME_CLASS_COUNT; c++) {
+        frame_class_stats_t ks;
+        frame_demux_get_stats(dm, (frame_class_t)c, &ks);
+        if (!ks.frames) continue;
+        printf("[TYPES] %-11s %7llu frames %8.1f MB  %5.1f/s  %u-%u B (meta %llu)  "
+               "routed %llu, full %llu\n",
+               frame_class_names[c], (unsigned long long)ks.frames, ks.bytes / 1048576.0,
+               ks.rate_hz, ks.len_min, ks.len_max, (unsigned long long)ks.with_meta,
+               (unsigned long long)ks.queued, (unsigned long long)ks.drop_full);
+    }
 }
 
-/* ── Frame reader (UVC bulk) ────────────────────────────────────────── */
+/* ── Frame source: live capture engine or recording ────────────────── */
+
+typedef struct {
+    uvc_device_t     *dev;         /* re-armed across unplug / replug */
+    capfile_player_t *player;      /* --replay */
+} source_t;
 
-static int read_frame(libusb_device_handle *d, uint8_t *buf, int bufsz)
+static frame_t *source_next(const source_t *s, int timeout_ms)
 {
-    uint8_t pkt[65536];
-    int xferred, off = 0, fid = -1;
-
-    while (off < bufsz && g_running) {
-        int r = libusb_bulk_transfer(d, EP_BULK_IN, pkt, sizeof(pkt), &xferred, 500);
-        if (r == LIBUSB_ERROR_TIMEOUT) continue;
-        if (r == LIBUSB_ERROR_OVERFLOW) continue;
-        if (r < 0) return -1;
-        if (xferred < 2) continue;
-
-        uint8_t hlen = pkt[0], bfh = pkt[1];
-
-        if (hlen < 2 || hlen > xferred) {
-            /* Not a valid UVC header — copy raw */
-            int n = (off + xferred <= bufsz) ? xferred : (bufsz - off);
-            memcpy(buf + off, pkt, n); off += n;
-            continue;
-        }
-        if (bfh & BFH_ERR) { off = 0; fid = -1; continue; }
+    return s->player ? capfile_player_next(s->player, timeout_ms)
+                     : uvc_device_next(s->dev, timeout_ms);
+}
 
-        int cfid = bfh & BFH_FID;
-        if (fid >= 0 && cfid != fid && off > 0) return off;
-        fid = cfid;
+static int source_running(const source_t *s)
+{
+    return s->player ? capfile_player_running(s->player) : uvc_device_running(s->dev);
+}
 
-        int plen = xferred - hlen;
-        if (plen > 0) {
-            int n = (off + plen <= bufsz) ? plen : (bufsz - off);
-            memcpy(buf + off, pkt + hlen, n); off += n;
-        }
-        if (bfh & BFH_EOF) return off;
-    }
-    return off;
+/* The recorder needs the committed probe, which exists only once the
+ * device is up; frames tapped before it starts are not recorded. */
+static void rec_tap(void *slot, const frame_t *f)
+{
+    recorder_t *r = __atomic_load_n((recorder_t **)slot, __ATOMIC_ACQUIRE);
+    if (r) recorder_tap(r, f);
 }
 
-/* ── Analysis helpers ───────────────────────────────────────────────── */
+/* ── Classification / filter stage ──────────────────────────────────── */
+
+#define RD(x)       __atomic_load_n(&(x), __ATOMIC_RELAXED)
+#define WR(x, v)    __atomic_store_n(&(x), (v), __ATOMIC_RELAXED)
+#define BUMP(x)     __atomic_fetch_add(&(x), 1, __ATOMIC_RELAXED)
+
+/* State shared by the viewer stages:
+ *   capture  (uvc_capture event thread) → SPSC ring → demux
+ *   demux    (demux_thread)             → per-type rings → classify
+ *   classify (classify_thread)          → mailbox   → render (main thread)
+ * Settings are written by the render thread (key presses) and read by
+ * classify; counters go the other way. Everything else belongs to the
+ * classify thread alone. */
+typedef struct {
+    source_t         src;
+    frame_demux_t   *demux;
+    frame_mailbox_t  display;
+    recorder_t      *rec;          /* --record, or NULL */
+    uint32_t         accum_target;
+
+    /* Settings (render → classify) */
+    int show;            /* frame_class_t on screen (S: 8-bit / interleaved) */
+    int accumulate;
+    int frame_hold;      /* lock onto consistent frames */
+    int bright_thresh;
+    int lock_req;        /* L pressed: lock/clear size band */
+    int paused;          /* replay: stop pulling frames */
+    int detect;          /* E: eye_detect on full 8-bit planes */
+
+    /* Frame-hold state (classify only) */
+    int locked_size;     /* 0 = not locked; >0 = target frame size */
+    int size_tolerance;  /* percent tolerance for size matching */
+    int last_avg;        /* brightness of last displayed frame */
+    int avg_tolerance;   /* max brightness jump between frames */
+    frame_t *hold;       /* reference to last good frame (no copy) */
+    int hold_len;        /* length of held frame's pixel data */
+    int replay_done;
+
+    /* Eye detection (classify only; eyes_lock guards eyes_last for render) */
+    eye_detector_t  *eyes;
+    double           eye_hint[2][2];    /* pupils of the last frame with both */
+    int              have_hint;
+    pthread_mutex_t  eyes_lock;
+    eye_features_t   eyes_last;         /* the last frame searched */
+
+    /* Counters (classify → render) */
+    int frames;
+    int skip_dark, skip_size, skip_bright;
+    int eyes_searched, eyes_found;      /* planes searched, with both pupils */
+    int eyes_small;                     /* 8-bit frames short of a plane */
+} viewer_t;
+
+/* ── Metrics (--metrics) ────────────────────────────────────────────── */
+
+/* The thread that consumes the device (demux_thread, or main without a
+ * window) publishes everything once a second, so the render thread never
+ * waits on the recorder or the demux locks; the classify thread records
+ * its latency histogram itself. */
+typedef struct {
+    metrics_t *m;
+    int xfer_done, xfer_errors, xfer_timeouts, payload_errs, frames, drop_nobuf, drop_queue;
+    int losses, bringups;
+    int cls_frames[FRAME_CLASS_COUNT], cls_drops[FRAME_CLASS_COUNT];
+    int passed, skip_dark, skip_size, skip_bright, disp_drops;
+    int rec_written, rec_drops;
+    int h_classify;
+} viewer_metrics_t;
+
+static viewer_metrics_t g_vm;
+
+static int viewer_metrics_start(const char *where)
+{
+    metrics_t *m = g_vm.m = metrics_create("squig_ir");
+    if (!m) return -1;
+    g_vm.xfer_done     = metrics_counter(m, "usb_transfers_total", NULL, "Bulk transfer completions");
+    g_vm.xfer_errors   = metrics_counter(m, "usb_transfer_errors_total", NULL, "Completions with an error status");
+    g_vm.xfer_timeouts = metrics_counter(m, "usb_transfer_timeouts_total", NULL, "Completions that timed out");
+    g_vm.payload_errs  = metrics_counter(m, "uvc_payload_errors_total", NULL, "Payloads with the UVC ERR bit");
+    g_vm.frames        = metrics_counter(m, "frames_total", NULL, "Frames handed on by the capture engine");
+    g_vm.drop_nobuf    = metrics_counter(m, "capture_drops_total", "reason=\"nobuf\"", "Frames lost in capture");
+    g_vm.drop_queue    = metrics_counter(m, "capture_drops_total", "reason=\"queue\"", "Frames lost in capture");
+    g_vm.losses        = metrics_counter(m, "device_losses_total", NULL, "Unplug / reset / transfer ring died");
+    g_vm.bringups      = metrics_counter(m, "device_bringups_total", NULL, "Successful bring-ups");
+    for (int c = 0; c < FRAME_CLASS_COUNT; c++) {
+        char lb[48];
+        snprintf(lb, sizeof(lb), "class=\"%s\"", frame_class_names[c]);
+        g_vm.cls_frames[c] = metrics_counter(m, "class_frames_total", lb, "Frames per type (frame_demux)");
+        g_vm.cls_drops[c]  = metrics_counter(m, "class_drops_total", lb, "Type queue full");
+    }
+    g_vm.passed      = metrics_counter(m, "filter_passed_total", NULL, "Frames through the display filters");
+    g_vm.skip_dark   = metrics_counter(m, "filter_skips_total", "filter=\"dark\"", "Frames the display filters skipped");
+    g_vm.skip_size   = metrics_counter(m, "filter_skips_total", "filter=\"size\"", "Frames the display filters skipped");
+    g_vm.skip_bright = metrics_counter(m, "filter_skips_total", "filter=\"bright\"", "Frames the display filters skipped");
+    g_vm.disp_drops  = metrics_counter(m, "display_drops_total", NULL, "Classified frames replaced before shown");
+    g_vm.rec_written = metrics_counter(m, "recorder_frames_total", NULL, "Frames written by --record");
+    g_vm.rec_drops   = metrics_counter(m, "recorder_drops_total", NULL, "Frames --record dropped");
+    g_vm.h_classify  = metrics_histogram(m, "classify_latency_seconds", NULL, "Last byte to classified (live only)");
+    if (metrics_serve(m, where) < 0) return -1;
+    printf("[METRICS] Serving on %s\n", where);
+    return 0;
+}
 
-static void hexdump(const uint8_t *p, int n) {
-    for (int i = 0; i < n; i++) printf("%02x ", p[i]);
-    printf("\n");
+/* Consumer thread. dm / v NULL: no window (nothing classified). */
+static void viewer_metrics_publish(uvc_device_t *dev, frame_demux_t *dm, viewer_t *v, recorder_t *rec)
+{
+    metrics_t *m = g_vm.m;
+    if (!m) return;
+    if (dev) {
+        uvc_device_stats_t ds;
+        uvc_device_get_stats(dev, &ds);
+        const uvc_capture_stats_t cs = ds.capture;       /* every engine so far */
+        metrics_set(m, g_vm.xfer_done, (int64_t)cs.xfer_done);
+        metrics_set(m, g_vm.xfer_errors, (int64_t)cs.xfer_errors);
+        metrics_set(m, g_vm.xfer_timeouts, (int64_t)cs.xfer_timeouts);
+        metrics_set(m, g_vm.payload_errs, (int64_t)cs.payload_errs);
+        metrics_set(m, g_vm.frames, (int64_t)cs.frames);
+        metrics_set(m, g_vm.drop_nobuf, (int64_t)cs.drop_nobuf);
+        metrics_set(m, g_vm.drop_queue, (int64_t)cs.drop_queue);
+        metrics_set(m, g_vm.losses, (int64_t)ds.losses);
+        metrics_set(m, g_vm.bringups, (int64_t)ds.bringups);
+    }
+    for (int c = 0; dm && c < FRAME_CLASS_COUNT; c++) {
+        frame_class_stats_t ks;
+        frame_demux_get_stats(dm, (frame_class_t)c, &ks);
+        metrics_set(m, g_vm.cls_frames[c], (int64_t)ks.frames);
+        metrics_set(m, g_vm.cls_drops[c], (int64_t)ks.drop_full);
+    }
+    if (v) {
+        metrics_set(m, g_vm.passed, RD(v->frames));
+        metrics_set(m, g_vm.skip_dark, RD(v->skip_dark));
+        metrics_set(m, g_vm.skip_size, RD(v->skip_size));
+        metrics_set(m, g_vm.skip_bright, RD(v->skip_bright));
+        metrics_set(m, g_vm.disp_drops, (int64_t)RD(v->display.dropped));
+    }
+    if (rec) {
+        recorder_stats_t rs;
+        recorder_get_stats(rec, &rs);
+        metrics_set(m, g_vm.rec_written, (int64_t)rs.written);
+        metrics_set(m, g_vm.rec_drops, (int64_t)(rs.drop_nobuf + rs.drop_toobig + rs.drop_error));
+    }
 }
 
-/* Compute average absolute difference between adjacent bytes.
- * High values (>25) indicate interleaved/alternating data (vertical stripes).
- * Low values (<15) indicate smooth spatial image data (real images). */
-static double neighbor_diff(const uint8_t *p, int n)
+static uint64_t mono_ns(void)
 {
-    if (n < 2) return 0;
-    int check = (n < 4000) ? n : 4000;
-    long sum = 0;
-    for (int i = 1; i < check; i++)
-        sum += abs((int)p[i] - (int)p[i-1]);
-    return (double)sum / (check - 1);
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
 }
 
-/* Strip Tobii 10-byte metadata header if present.
- * Pattern: [seq 1B] [00] [e8 03] [00 00] [size 2B LE] [00 00] */
-static int strip_meta_header(uint8_t **pix, int *pixlen)
+/* One frame of the displayed type (the demux already dropped runts and
+ * the other types) */
+static void classify_frame(viewer_t *v, frame_t *fr)
 {
-    if (*pixlen > 12 && (*pix)[1] == 0x00 &&
-        (*pix)[2] == 0xe8 && (*pix)[3] == 0x03) {
-        *pix += 10;
-        *pixlen -= 10;
-        return 1;
+    int stitched = (fr->flags & UVC_FRAME_STITCHED) != 0;
+
+    /* ── Accumulation mode: the engine stitches fragments in place ─ */
+    if (RD(v->accumulate) && v->accum_target > 0 && !stitched)
+        return;     /* sub-frame queued before the mode switch */
+
+    /* Everything below reads the stats the capture engine gathered while
+     * reassembling (metadata header already located, stitched frames had
+     * it removed per fragment) — no pass over the pixels here. */
+    const frame_stats_t *st = &fr->stats;
+    const uint8_t *pix = fr->data + st->pix_off;
+    int pixlen = (int)st->pix_len;
+    double nd = st->nd;
+
+    /* ── Size-band filter (when locked) ─────────────────────────── */
+    int frame_hold = RD(v->frame_hold);
+    if (frame_hold && v->locked_size > 0) {
+        int lo = v->locked_size * (100 - v->size_tolerance) / 100;
+        int hi = v->locked_size * (100 + v->size_tolerance) / 100;
+        if (pixlen < lo || pixlen > hi) {
+            BUMP(v->skip_size);
+            return;
+        }
     }
-    return 0;
+
+    /* ── Brightness filter ──────────────────────────────────────── */
+    int qavg = st->head_avg;
+
+    if (qavg < RD(v->bright_thresh)) {
+        BUMP(v->skip_dark);
+        return;
+    }
+
+    /* ── Brightness consistency (frame-hold) ────────────────────── */
+    if (frame_hold && v->last_avg >= 0) {
+        int diff = abs(qavg - v->last_avg);
+        if (diff > v->avg_tolerance) {
+            BUMP(v->skip_bright);
+            return;
+        }
+    }
+
+    /* ── This frame passed all filters — update hold reference ──── */
+    int passed = RD(v->frames);
+    if (frame_hold) {
+        frame_unref(v->hold);
+        v->hold = frame_ref(fr);
+        v->hold_len = pixlen;
+        v->last_avg = qavg;
+        /* Auto-lock onto first good frame's size if not locked yet */
+        if (v->locked_size == 0 && passed == 0) {
+            v->locked_size = pixlen;
+            printf("[HOLD] Auto-locked to size band: %d +/-%d%%\n",
+                   v->locked_size, v->size_tolerance);
+        }
+    }
+
+    BUMP(v->frames);
+    if (passed < 5) {
+        printf("[Frame %d] %d bytes, avg=%d, nd=%.1f, first 20: ",
+               passed + 1, pixlen, qavg, nd);
+        hexdump(pix, pixlen < 20 ? pixlen : 20);
+    }
+
+    /* ── Hand to the display (latest frame wins) ────────────────── */
+    frame_mailbox_post(&v->display, frame_ref(fr));
 }
 
-/* ── Rendering ──────────────────────────────────────────────────────── */
+/* Pupils, glints and nostrils in one 8-bit frame. Only a whole plane
+ * can be searched; the tracker mostly sends sub-frames, which
+ * accumulation (A) stitches into planes. The search follows the pupils
+ * of the last frame that had both, or covers the whole frame. */
+static void detect_eyes(viewer_t *v, const frame_t *fr)
+{
+    const frame_stats_t *st = &fr->stats;
+    if (st->pix_len < (uint32_t)(FRAME_W_DEFAULT * FRAME_H_DEFAULT)) {
+        BUMP(v->eyes_small);
+        return;
+    }
+    eye_features_t e;
+    int n = eye_detect_frame(v->eyes, fr->data + st->pix_off, FRAME_W_DEFAULT,
+                             v->have_hint ? (const double (*)[2])v->eye_hint : NULL, &e);
+    v->have_hint = n == 2;
+    for (int i = 0; n == 2 && i < 2; i++) {
+        v->eye_hint[i][0] = e.eye[i].pupil[0];
+        v->eye_hint[i][1] = e.eye[i].pupil[1];
+    }
+    BUMP(v->eyes_searched);
+    if (n == 2) BUMP(v->eyes_found);
+    pthread_mutex_lock(&v->eyes_lock);
+    v->eyes_last = e;
+    pthread_mutex_unlock(&v->eyes_lock);
+}
 
-/* Render pixel data into ARGB buffer with auto-contrast stretch.
- * src: source pixel data, srclen: source byte count
- * dst: output ARGB buffer, width/height: output dimensions
- * mode: display mode enum */
-static void render_frame(const uint8_t *src, int srclen,
-                         uint32_t *dst, int width, int height, int mode)
+/* Source → per-type queues */
+static void *demux_thread(void *arg)
 {
-    int npix = width * height;
-    memset(dst, 0, npix * 4); /* black background */
-    if (srclen < 2) return;
-
-    switch (mode) {
-    case MODE_RAW: {
-        int limit = (srclen < npix) ? srclen : npix;
-        int mn = 255, mx = 0;
-        for (int i = 0; i < limit; i++) {
-            if (src[i] < mn) mn = src[i];
-            if (src[i] > mx) mx = src[i];
-        }
-        int range = (mx - mn > 0) ? (mx - mn) : 1;
-        for (int i = 0; i < limit; i++) {
-            int s = (int)(src[i] - mn) * 255 / range;
-            uint8_t v = (s < 0) ? 0 : (s > 255) ? 255 : (uint8_t)s;
-            dst[i] = 0xFF000000u | ((uint32_t)v << 16) | ((uint32_t)v << 8) | v;
+    viewer_t *v = arg;
+    uint64_t next_publish = 0;
+    while (g_running) {
+        uint64_t now = (uint64_t)time(NULL);
+        if (now >= next_publish) {
+            viewer_metrics_publish(v->src.dev, v->demux, v, v->rec);
+            next_publish = now + 1;
         }
-        break;
-    }
-    case MODE_DEINT_EVEN:
-    case MODE_DEINT_ODD: {
-        int start = (mode == MODE_DEINT_ODD) ? 1 : 0;
-        int halflen = (srclen - start + 1) / 2;
-        int limit = (halflen < npix) ? halflen : npix;
-        int mn = 255, mx = 0;
-        for (int i = 0; i < limit; i++) {
-            uint8_t b = src[start + i * 2];
-            if (b < mn) mn = b;
-            if (b > mx) mx = b;
+        if (RD(v->paused)) { usleep(10000); continue; }
+        frame_t *fr = source_next(&v->src, 100);
+        if (!fr) {
+            if (source_running(&v->src)) continue;
+            if (!v->src.player) {
+                fprintf(stderr, "[CAPTURE] Stream lost\n");
+                g_running = 0;
+            } else if (!v->replay_done) {
+                /* Keep the last frame on screen until the user quits */
+                printf("[REPLAY] End of recording\n");
+                v->replay_done = 1;
+            }
+            usleep(10000);
+            continue;
         }
-        int range = (mx - mn > 0) ? (mx - mn) : 1;
-        for (int i = 0; i < limit; i++) {
-            uint8_t b = src[start + i * 2];
-            int s = (int)(b - mn) * 255 / range;
-            uint8_t v = (s < 0) ? 0 : (s > 255) ? 255 : (uint8_t)s;
-            dst[i] = 0xFF000000u | ((uint32_t)v << 16) | ((uint32_t)v << 8) | v;
+        frame_demux_route(v->demux, fr);
+        frame_unref(fr);
+    }
+    return NULL;
+}
+
+/* Consumer of the displayed type. Switching types moves the route first,
+ * then drains what the old type still had queued. */
+static void *classify_thread(void *arg)
+{
+    viewer_t *v = arg;
+    metrics_shard_t *ms = g_vm.m ? metrics_shard(g_vm.m) : NULL;
+    frame_class_t cur = (frame_class_t)RD(v->show);
+    frame_demux_enable(v->demux, cur, 1);
+    while (g_running) {
+        /* Requests from the render thread */
+        if (!RD(v->frame_hold) && (v->hold || v->locked_size || v->last_avg >= 0)) {
+            v->locked_size = 0; v->last_avg = -1;
+            frame_unref(v->hold); v->hold = NULL;
         }
-        break;
-    }
-    case MODE_16BIT_LE: {
-        int limit16 = srclen / 2;
-        if (limit16 > npix) limit16 = npix;
-        int mn16 = 65535, mx16 = 0;
-        for (int i = 0; i < limit16; i++) {
-            uint16_t val = (uint16_t)src[i*2] | ((uint16_t)src[i*2+1] << 8);
-            if ((int)val < mn16) mn16 = (int)val;
-            if ((int)val > mx16) mx16 = (int)val;
+        if (RD(v->lock_req)) {
+            WR(v->lock_req, 0);
+            if (v->hold && v->hold_len > 0) {
+                v->locked_size = v->hold_len;
+                printf("[LOCK] Locked to size band: %d +/-%d%%\n",
+                       v->locked_size, v->size_tolerance);
+            } else {
+                v->locked_size = 0;
+                printf("[LOCK] Cleared size lock\n");
+            }
         }
-        int range16 = (mx16 - mn16 > 0) ? (mx16 - mn16) : 1;
-        for (int i = 0; i < limit16; i++) {
-            uint16_t val = (uint16_t)src[i*2] | ((uint16_t)src[i*2+1] << 8);
-            int s = (int)(val - mn16) * 255 / range16;
-            uint8_t v = (s < 0) ? 0 : (s > 255) ? 255 : (uint8_t)s;
-            dst[i] = 0xFF000000u | ((uint32_t)v << 16) | ((uint32_t)v << 8) | v;
+
+        frame_class_t want = (frame_class_t)RD(v->show);
+        if (want != cur) {
+            frame_demux_enable(v->demux, want, 1);
+            frame_demux_enable(v->demux, cur, 0);
+            frame_t *old;
+            while ((old = frame_demux_next(v->demux, cur, 0)) != NULL) frame_unref(old);
+            cur = want;
         }
-        break;
-    }
+
+        frame_t *fr = frame_demux_next(v->demux, cur, 100);
+        if (!fr) continue;
+        if (cur == FRAME_CLASS_GRAY8 && RD(v->detect)) detect_eyes(v, fr);
+        else v->have_hint = 0;
+        classify_frame(v, fr);
+        if (ms && v->src.dev) metrics_observe_ns(ms, g_vm.h_classify, (int64_t)(mono_ns() - fr->t_last_ns));
+        frame_unref(fr);
     }
+    frame_demux_enable(v->demux, cur, 0);
+    frame_unref(v->hold); v->hold = NULL;
+    return NULL;
 }
 
 /* ── Main ───────────────────────────────────────────────────────────── */
@@ -300,102 +543,204 @@ int main(int argc, char *argv[])
     signal(SIGINT, sig_handler);
     signal(SIGTERM, sig_handler);
 
-    int dump_only = (argc > 1 && strcmp(argv[1], "--dump") == 0);
-    int rawdump   = (argc > 1 && strcmp(argv[1], "--rawdump") == 0);
+    int dump_only = 0, rawdump = 0, use_gl = 0, loop = 0, no_window = 0;
+    int list_devices = 0, cpu = -1, probe_cache = 1, full_rate = 0, eyes = 0;
+    const char *rawdump_path = RAWDUMP_PATH, *replay_path = NULL, *device = NULL;
+    const char *metrics_addr = NULL;
+    double speed = 1.0;
+    recorder_config_t rcfg = RECORDER_DEFAULTS;
+    rcfg.prefix = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dump") == 0) dump_only = 1;
+        else if (strcmp(argv[i], "--gl") == 0) use_gl = 1;
+        else if (strcmp(argv[i], "--loop") == 0) loop = 1;
+        else if (strcmp(argv[i], "--rawdump") == 0) {
+            rawdump = 1;
+            if (i + 1 < argc && argv[i + 1][0] != '-') rawdump_path = argv[++i];
+        }
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) replay_path = argv[++i];
+        else if (strcmp(argv[i], "--speed") == 0 && i + 1 < argc) speed = atof(argv[++i]);
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) rcfg.prefix = argv[++i];
+        else if (strcmp(argv[i], "--rotate-mb") == 0 && i + 1 < argc)
+            rcfg.max_file_bytes = (uint64_t)atoll(argv[++i]) << 20;
+        else if (strcmp(argv[i], "--rotate-min") == 0 && i + 1 < argc)
+            rcfg.max_file_secs = (uint32_t)atoi(argv[++i]) * 60;
+        else if (strcmp(argv[i], "--compress") == 0 && i + 1 < argc) {
+            rcfg.codec = parse_codec(argv[++i], &rcfg.level);
+            if (rcfg.codec < 0) { fprintf(stderr, "Unknown codec: %s\n", argv[i]); return 1; }
+        }
+        else if (strcmp(argv[i], "--no-window") == 0) no_window = 1;
+        else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) device = argv[++i];
+        else if (strcmp(argv[i], "--list-devices") == 0) list_devices = 1;
+        else if (strcmp(argv[i], "--cpu") == 0 && i + 1 < argc) cpu = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-probe-cache") == 0) probe_cache = 0;
+        else if (strcmp(argv[i], "--full-rate") == 0) full_rate = 1;
+        else if (strcmp(argv[i], "--eyes") == 0) eyes = 1;
+        else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) metrics_addr = argv[++i];
+        else {
+            fprintf(stderr, "Usage: %s [--dump | --rawdump [file] | --replay file "
+                            "[--speed x] [--loop]] [--gl]\n"
+                            "       [--record prefix [--rotate-mb n] [--rotate-min n]"
+                            " [--compress lz4|zstd[:level]] [--no-window]]\n"
+                            "       [--device BUS-PORT[.PORT...] | --list-devices] [--cpu N]\n"
+                            "       [--no-probe-cache] [--full-rate] [--eyes]"
+                            " [--metrics unix:PATH | PORT | HOST:PORT]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (rcfg.prefix && (replay_path || rawdump)) {
+        fprintf(stderr, "--record needs the live stream (not --replay / --rawdump)\n");
+        return 1;
+    }
+    if (metrics_addr && viewer_metrics_start(metrics_addr) < 0) {
+        metrics_destroy(g_vm.m);
+        return 1;
+    }
+
+    libusb_context *ctx = NULL;
+    uvc_device_t *dev = NULL;
+    frame_pool_t *pool = NULL;
+    capfile_t *replay = NULL;
+    capfile_player_t *player = NULL;
+    recorder_t *rec = NULL;
+    uint32_t negotiated_frame_size = 0;
+    int preview_only = 0;           /* the window is the only subscriber */
+
+    /* ── REPLAY: recording instead of the device ───────────────────── */
+
+    if (replay_path) {
+        replay = capfile_open(replay_path);
+        if (!replay) return 1;
+        player = capfile_player_create(replay, speed, loop);
+        if (!player) { capfile_free(replay); return 1; }
+        const capfile_header_t *h = capfile_header(replay);
+        negotiated_frame_size = h->frame_size;
+        printf("[REPLAY] %s: %llu frames, frame size %u, speed %s%.2g%s\n",
+               replay_path, (unsigned long long)capfile_count(replay), h->frame_size,
+               speed > 0 ? "x" : "", speed > 0 ? speed : 0.0, speed > 0 ? "" : " (unpaced)");
+        goto source_ready;
+    }
 
     /* ── libusb init ────────────────────────────────────────────────── */
 
-    libusb_context *ctx = NULL;
     if (libusb_init(&ctx) < 0) { perror("libusb_init"); return 1; }
 
-    libusb_device_handle *dev = libusb_open_device_with_vid_pid(ctx, TOBII_VID, TOBII_PID);
+    if (list_devices) {
+        char paths[16][UVC_PATH_MAX];
+        int n = uvc_list_devices(ctx, paths, 16);
+        for (int i = 0; i < n && i < 16; i++) printf("%s\n", paths[i]);
+        libusb_exit(ctx);
+        return n > 0 ? 0 : 1;
+    }
+    /* One shared pool: capture queue + frame in flight + held frame */
+    pool = frame_pool_create(VIEWER_POOL_SLOTS, MAX_FRAME_SIZE);
+    if (!pool) goto done;
+    uvc_device_config_t dcfg = UVC_DEVICE_DEFAULTS;
+    dcfg.path = device;
+    dcfg.probe_cache = probe_cache;
+    dcfg.replug = !rawdump;         /* a recording that lost its device ends */
+    /* Recording and analysis want every frame; the window alone only a preview */
+    dcfg.demand = rawdump || dump_only || rcfg.prefix || full_rate ? UVC_DEMAND_FULL
+                                                                   : UVC_DEMAND_PREVIEW;
+    preview_only = dcfg.demand == UVC_DEMAND_PREVIEW;
+    dcfg.capture.pool = pool;
+    dcfg.capture.cpu = cpu;
+    if (rcfg.prefix) {
+        dcfg.capture.tap = rec_tap;
+        dcfg.capture.tap_arg = &rec;
+    }
+    dev = uvc_device_open(ctx, &dcfg);
     if (!dev) {
-        fprintf(stderr, "Cannot open Tobii ET5 (2104:0313)\nTry: sudo -E %s\n", argv[0]);
-        libusb_exit(ctx); return 1;
+        fprintf(stderr, "Try: sudo -E %s (--list-devices shows every tracker)\n", argv[0]);
+        goto done;
+    }
+    const uvc_probe_t *probe = uvc_device_probe(dev);
+    negotiated_frame_size = probe->dwMaxVideoFrameSize;
+
+    if (rcfg.prefix) {
+        rcfg.probe = probe;
+        rcfg.probe_len = sizeof(*probe);
+        rcfg.frame_size = negotiated_frame_size;
+        rcfg.slot_size = MAX_FRAME_SIZE;
+        recorder_t *r = recorder_start(&rcfg);
+        if (!r) goto done;
+        __atomic_store_n(&rec, r, __ATOMIC_RELEASE);
     }
-    printf("[USB] Opened Tobii Eye Tracker 5\n");
-
-    int c1 = 0, c2 = 0, d1 = 0, d2 = 0;
-
-    if (libusb_kernel_driver_active(dev, IF_VIDEO_CONTROL) == 1)
-        { libusb_detach_kernel_driver(dev, IF_VIDEO_CONTROL); d1 = 1; }
-    if (libusb_kernel_driver_active(dev, IF_VIDEO_STREAM) == 1)
-        { libusb_detach_kernel_driver(dev, IF_VIDEO_STREAM); d2 = 1; }
-
-    if (libusb_claim_interface(dev, IF_VIDEO_CONTROL) < 0)
-        { fprintf(stderr, "Cannot claim IF%d\n", IF_VIDEO_CONTROL); goto done; }
-    c1 = 1;
-    if (libusb_claim_interface(dev, IF_VIDEO_STREAM) < 0)
-        { fprintf(stderr, "Cannot claim IF%d\n", IF_VIDEO_STREAM); goto done; }
-    c2 = 1;
-    printf("[USB] Claimed IF1 + IF2 (Video Control + Streaming)\n");
-
-    if (uvc_start(dev) < 0)
-        fprintf(stderr, "[UVC] Negotiation failed — trying raw reads\n");
-
-    uint8_t *fbuf = calloc(1, MAX_FRAME_SIZE);
-    if (!fbuf) { perror("calloc"); goto done; }
 
-    /* ── RAW DUMP MODE ──────────────────────────────────────────────── */
+    /* ── RAW DUMP MODE: indexed recording for --replay ──────────────── */
 
     if (rawdump) {
-        const char *path = "/tmp/tobii_raw_stream.bin";
-        FILE *f = fopen(path, "wb");
-        if (!f) { perror("fopen"); free(fbuf); goto done; }
-        printf("[RAWDUMP] Saving raw packet stream to %s...\n", path);
-        printf("[RAWDUMP] Capturing ~2MB. Press Ctrl+C to stop.\n\n");
-
-        uint8_t pkt[65536];
-        int total = 0, npkts = 0;
-        while (g_running && total < 2 * 1024 * 1024) {
-            int xferred = 0;
-            int r = libusb_bulk_transfer(dev, EP_BULK_IN, pkt, sizeof(pkt), &xferred, 500);
-            if (r == LIBUSB_ERROR_TIMEOUT) continue;
-            if (r < 0) { printf("[RAWDUMP] USB error: %s\n", libusb_strerror(r)); break; }
-            if (xferred < 1) continue;
-
-            /* File format: [size 4B LE] [data] for each packet */
-            uint32_t sz = (uint32_t)xferred;
-            fwrite(&sz, 4, 1, f);
-            fwrite(pkt, 1, xferred, f);
-            total += 4 + xferred;
-            npkts++;
-
-            printf("\r[RAWDUMP] %d bytes (%d packets)...", total, npkts);
+        capfile_writer_t *w = capfile_create(rawdump_path, probe, sizeof(*probe),
+                                             negotiated_frame_size);
+        if (!w) goto done;
+        printf("[RAWDUMP] Recording frames to %s...\n", rawdump_path);
+        printf("[RAWDUMP] Up to %u MB. Press Ctrl+C to stop.\n\n", RAWDUMP_MAX_BYTES >> 20);
+
+        uint64_t next_publish = 0;
+        while (g_running && capfile_writer_bytes(w) < RAWDUMP_MAX_BYTES) {
+            uint64_t now = (uint64_t)time(NULL);
+            if (now >= next_publish) { viewer_metrics_publish(dev, NULL, NULL, NULL); next_publish = now + 1; }
+            frame_t *fr = uvc_device_next(dev, 500);
+            if (!fr) { if (!uvc_device_running(dev)) break; continue; }
+            int r = capfile_write(w, fr);
+            frame_unref(fr);
+            if (r < 0) break;
+
+            printf("\r[RAWDUMP] %llu bytes (%llu frames)...",
+                   (unsigned long long)capfile_writer_bytes(w),
+                   (unsigned long long)capfile_writer_frames(w));
             fflush(stdout);
         }
-        printf("\n[RAWDUMP] Saved %d bytes (%d packets) to %s\n", total, npkts, path);
-        fclose(f);
-        free(fbuf); goto done;
+        unsigned long long nb = capfile_writer_bytes(w), nf = capfile_writer_frames(w);
+        int ok = capfile_close(w) == 0;
+        printf("\n[RAWDUMP] %s %llu bytes (%llu frames) to %s\n",
+               ok ? "Saved" : "FAILED after", nb, nf, rawdump_path);
+        goto done;
     }
 
+    /* ── HEADLESS RECORDING ─────────────────────────────────────────── */
+
+    if (rec && no_window) {
+        printf("[REC] Headless. Press Ctrl+C to stop.\n");
+        uint64_t next_status = 0;
+        while (g_running) {
+            /* Frames are recorded by the tap; just keep the queue drained */
+            frame_t *fr = uvc_device_next(dev, 250);
+            if (fr) frame_unref(fr);
+            uint64_t now = (uint64_t)time(NULL);
+            if (now >= next_status) {
+                print_rec_status(rec);
+                viewer_metrics_publish(dev, NULL, NULL, rec);
+                next_status = now + 1;
+            }
+        }
+        printf("\n");
+        goto done;
+    }
+
+source_ready:;
+    source_t src = { dev, player };
+
     /* ── TEXT DUMP MODE (with analysis) ─────────────────────────────── */
 
     if (dump_only) {
         printf("\n[DUMP] Capturing frames with analysis... Ctrl+C to stop\n\n");
         for (int n = 0; g_running && n < 30; ) {
-            int got = read_frame(dev, fbuf, MAX_FRAME_SIZE);
-            if (got <= 0) { usleep(10000); continue; }
+            frame_t *fr = source_next(&src, 500);
+            if (!fr) { if (!source_running(&src)) break; continue; }
+            uint8_t *fbuf = fr->data;
+            int got = (int)fr->len;
+            const frame_stats_t *st = &fr->stats;
             n++;
 
-            uint8_t *pix = fbuf;
-            int pixlen = got;
-            int has_meta = strip_meta_header(&pix, &pixlen);
-
-            printf("[Frame %3d] %6d bytes  meta=%d  first 32: ", n, got, has_meta);
-            hexdump(pix, got < 32 ? got : 32);
+            printf("[Frame %3d] %6d bytes  %-11s meta=%d  first 32: ", n, got,
+                   frame_class_names[frame_classify(fr)], st->has_meta);
+            hexdump(fbuf + st->pix_off, st->pix_len < 32 ? (int)st->pix_len : 32);
 
-            if (got >= 100) {
-                int mn = 255, mx = 0; long sum = 0;
-                for (int i = 0; i < got; i++) {
-                    if (fbuf[i] < mn) mn = fbuf[i];
-                    if (fbuf[i] > mx) mx = fbuf[i];
-                    sum += fbuf[i];
-                }
-                double nd = neighbor_diff(pix, pixlen);
-                printf("           stats: min=%d max=%d avg=%.1f  nd=%.1f  %s\n",
-                       mn, mx, (double)sum/got, nd,
-                       nd > 25 ? "INTERLEAVED" : "smooth");
+            if (got >= TOBII_MIN_FRAGMENT) {
+                printf("           stats: min=%d max=%d avg=%.1f  nd=%.1f\n",
+                       st->min, st->max, st->mean, st->nd);
             }
 
             if (n == 1) {
@@ -403,34 +748,44 @@ int main(int argc, char *argv[])
                 if (f) { fwrite(fbuf, 1, got, f); fclose(f);
                          printf("           -> saved /tmp/tobii_ir_frame.raw\n"); }
             }
+            frame_unref(fr);
         }
-        free(fbuf); goto done;
+        goto done;
     }
 
     /* ── SDL2 VIEWER ────────────────────────────────────────────────── */
 
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         fprintf(stderr, "SDL_Init: %s\nTry: sudo -E %s\n", SDL_GetError(), argv[0]);
-        free(fbuf); goto done;
+        goto done;
     }
 
     int dw = FRAME_W_DEFAULT, dh = FRAME_H_DEFAULT;
-    int display_mode = MODE_RAW;
-    int stripe_filter = 1;   /* ON by default: skip interleaved frames */
-    int accumulate = 0;
+    int display_mode = IR_MODE_RAW;
+    ir_decode_fn decode = ir_render_decoder(display_mode);
     int save_next = 0;
-    int bright_thresh = 15;  /* lowered: some real frames are dim */
-
-    /* Frame-hold: stabilize display by locking onto consistent frames */
-    int frame_hold = 1;     /* ON by default to reduce flicker */
-    int locked_size = 0;    /* 0 = not locked; >0 = target frame size */
-    int size_tolerance = 20; /* percent tolerance for size matching */
-    int last_avg = -1;      /* brightness of last displayed frame */
-    int avg_tolerance = 40; /* max brightness jump between frames */
-    uint8_t *hold_buf = NULL;  /* last good frame pixel data */
-    int hold_len = 0;          /* length of held frame */
-    int hold_valid = 0;        /* is hold buffer populated? */
-    int skip_hold = 0;         /* frames rejected by hold filter */
+
+    viewer_t v;
+    memset(&v, 0, sizeof(v));
+    v.src = src;
+    v.demux = frame_demux_create(VIEWER_DEMUX_DEPTH);
+    if (!v.demux) { SDL_Quit(); goto done; }
+    v.rec = rec;
+    v.accum_target = negotiated_frame_size;
+    v.show = FRAME_CLASS_GRAY8;      /* 8-bit planes by default */
+    v.bright_thresh = 15;    /* lowered: some real frames are dim */
+    v.frame_hold = 1;        /* ON by default to reduce flicker */
+    v.size_tolerance = 20;
+    v.last_avg = -1;
+    v.avg_tolerance = 40;
+    const eye_camera_t cam = EYE_CAMERA_DEFAULTS;
+    v.eyes = eye_detect_create(NULL, &cam, FRAME_W_DEFAULT, FRAME_H_DEFAULT);
+    pthread_mutex_init(&v.eyes_lock, NULL);
+    if (eyes && v.eyes) {
+        /* Detection wants every frame, whatever the window asked for */
+        v.detect = 1;
+        if (dev) uvc_device_subscribe(dev, UVC_DEMAND_FULL);
+    }
 
     /* Texture uses max possible width for runtime width changes */
     int tex_w = 1284, tex_h = 480;
@@ -439,42 +794,81 @@ int main(int argc, char *argv[])
     SDL_Window *win = SDL_CreateWindow("Tobii ET5 — Raw IR",
         SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
         dw * scale, dh * scale,
-        SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE);
-    if (!win) { fprintf(stderr, "SDL window: %s\n", SDL_GetError()); free(fbuf); SDL_Quit(); goto done; }
-
-    SDL_Renderer *ren = SDL_CreateRenderer(win, -1,
-        SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
-    if (!ren) ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_SOFTWARE);
-
-    SDL_Texture *tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888,
-        SDL_TEXTUREACCESS_STREAMING, tex_w, tex_h);
-    uint32_t *argb = calloc(tex_w * tex_h, sizeof(uint32_t));
-
-    /* Accumulation buffer */
-    uint8_t *accum_buf = calloc(1, MAX_FRAME_SIZE);
-    int accum_off = 0;
-    hold_buf = calloc(1, MAX_FRAME_SIZE);
+        SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | (use_gl ? SDL_WINDOW_OPENGL : 0));
+    if (!win) { fprintf(stderr, "SDL window: %s\n", SDL_GetError()); SDL_Quit(); goto done; }
+
+    /* GPU path: raw plane upload + shader decode. Otherwise (or if GL is
+     * unavailable) decode on the CPU into an ARGB streaming texture. */
+    ir_gl_t *gl = use_gl ? ir_gl_create(win) : NULL;
+    if (use_gl && !gl) printf("[GL] Falling back to SDL_Renderer + CPU decode\n");
+    int palette = IR_PALETTE_GRAY;
+
+    SDL_Renderer *ren = NULL;
+    SDL_Texture *tex = NULL;
+    uint32_t *argb = NULL;
+    if (!gl) {
+        ren = SDL_CreateRenderer(win, -1,
+            SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+        if (!ren) ren = SDL_CreateRenderer(win, -1, SDL_RENDERER_SOFTWARE);
+
+        tex = SDL_CreateTexture(ren, SDL_PIXELFORMAT_ARGB8888,
+            SDL_TEXTUREACCESS_STREAMING, tex_w, tex_h);
+        argb = calloc(tex_w * tex_h, sizeof(uint32_t));
+    }
 
-    printf("\n[READY] IR viewer active. Controls:\n");
-    printf("  M = cycle mode (%s", mode_names[0]);
-    for (int i = 1; i < MODE_COUNT; i++) printf(", %s", mode_names[i]);
+    printf("\n[READY] IR viewer active (render: %s). Controls:\n",
+           gl ? "gpu" : ir_render_backend());
+    printf("  M = cycle mode (%s", ir_mode_names[0]);
+    for (int i = 1; i < IR_MODE_COUNT; i++) printf(", %s", ir_mode_names[i]);
     printf(")\n");
-    printf("  +/- = adjust width (Shift: +/-10)   R = reset width to 642\n");
-    printf("  S = toggle stripe filter (currently ON)\n");
+    printf("  +/- = adjust width (Shift: +/-10)   R = reset width to the format's\n");
+    printf("  S = switch frame type shown (currently %s)\n", frame_class_names[v.show]);
     printf("  A = toggle frame accumulation\n");
     printf("  H = toggle frame-hold (stabilize display, currently ON)\n");
     printf("  L = lock onto current frame size band\n");
-    printf("  B = lower brightness threshold   D = dump frame   Q/Esc = quit\n\n");
+    printf("  P = cycle false-colour palette (--gl only)\n");
+    printf("  E = toggle eye detection (8-bit planes; A stitches them)\n");
+    printf("  B = lower brightness threshold   D = dump frame   Q/Esc = quit\n");
+    if (player) printf("  Space = pause/resume replay\n");
+    printf("\n");
 
-    int frames = 0, fps_cnt = 0, last_got = 0, all_frames = 0;
-    int skip_stripe = 0, skip_dark = 0, skip_size = 0, skip_bright = 0;
+    pthread_t classify_tid, demux_tid;
+    int started = pthread_create(&classify_tid, NULL, classify_thread, &v) == 0;
+    if (started && pthread_create(&demux_tid, NULL, demux_thread, &v) != 0) {
+        g_running = 0;
+        pthread_join(classify_tid, NULL);
+        started = 0;
+    }
+    if (!started) {
+        perror("pthread_create");
+        frame_demux_destroy(v.demux);
+        eye_detect_destroy(v.eyes);
+        ir_gl_destroy(gl);
+        free(argb);
+        if (tex) SDL_DestroyTexture(tex);
+        if (ren) SDL_DestroyRenderer(ren);
+        SDL_DestroyWindow(win); SDL_Quit(); goto done;
+    }
+
+    int fps_cnt = 0, shown = 0;
+    int last_len = 0, last_avg = 0;
+    float last_nd = 0;
     uint32_t fps_tick = SDL_GetTicks();
     float fps = 0;
+    int hidden = 0;         /* preview subscription dropped while minimised */
 
     while (g_running) {
         SDL_Event ev;
         while (SDL_PollEvent(&ev)) {
             if (ev.type == SDL_QUIT) g_running = 0;
+            if (ev.type == SDL_WINDOWEVENT && preview_only) {
+                int gone = ev.window.event == SDL_WINDOWEVENT_MINIMIZED ||
+                           ev.window.event == SDL_WINDOWEVENT_HIDDEN;
+                int back = ev.window.event == SDL_WINDOWEVENT_RESTORED ||
+                           ev.window.event == SDL_WINDOWEVENT_SHOWN;
+                if (gone && !hidden) { uvc_device_unsubscribe(dev, UVC_DEMAND_PREVIEW); hidden = 1; }
+                if (back && hidden) { uvc_device_subscribe(dev, UVC_DEMAND_PREVIEW); hidden = 0; }
+            }
             if (ev.type == SDL_KEYDOWN) {
                 SDL_Keymod mod = SDL_GetModState();
                 int shift = (mod & KMOD_SHIFT) != 0;
@@ -482,8 +876,9 @@ int main(int argc, char *argv[])
                 case SDLK_q: case SDLK_ESCAPE:
                     g_running = 0; break;
                 case SDLK_m:
-                    display_mode = (display_mode + 1) % MODE_COUNT;
-                    printf("[MODE] -> %s\n", mode_names[display_mode]);
+                    display_mode = (display_mode + 1) % IR_MODE_COUNT;
+                    decode = ir_render_decoder(display_mode);
+                    printf("[MODE] -> %s\n", ir_mode_names[display_mode]);
                     break;
                 case SDLK_EQUALS: case SDLK_PLUS: case SDLK_KP_PLUS:
                     dw += shift ? 10 : 1;
@@ -496,135 +891,152 @@ int main(int argc, char *argv[])
                     printf("[WIDTH] -> %d\n", dw);
                     break;
                 case SDLK_r:
-                    dw = FRAME_W_DEFAULT;
+                    dw = ir_formats[display_mode].width;
+                    if (dw > tex_w) dw = tex_w;
                     printf("[WIDTH] -> %d (reset)\n", dw);
                     break;
                 case SDLK_s:
-                    stripe_filter = !stripe_filter;
-                    printf("[STRIPE FILTER] %s\n", stripe_filter ? "ON" : "OFF");
+                    WR(v.show, v.show == FRAME_CLASS_GRAY8 ? FRAME_CLASS_INTERLEAVED
+                                                           : FRAME_CLASS_GRAY8);
+                    printf("[SHOW] %s frames\n", frame_class_names[v.show]);
                     break;
                 case SDLK_a:
-                    accumulate = !accumulate;
-                    accum_off = 0;
+                    if (!dev) { printf("[ACCUMULATE] Not available in replay\n"); break; }
+                    WR(v.accumulate, !v.accumulate);
+                    uvc_device_set_accumulate(dev, v.accumulate ? negotiated_frame_size : 0);
                     printf("[ACCUMULATE] %s (target=%u bytes)\n",
-                           accumulate ? "ON" : "OFF", negotiated_frame_size);
+                           v.accumulate ? "ON" : "OFF", negotiated_frame_size);
                     break;
                 case SDLK_h:
-                    frame_hold = !frame_hold;
-                    if (!frame_hold) { locked_size = 0; last_avg = -1; hold_valid = 0; }
-                    printf("[HOLD] %s\n", frame_hold ? "ON (stabilized)" : "OFF (show all)");
+                    WR(v.frame_hold, !v.frame_hold);
+                    printf("[HOLD] %s\n", v.frame_hold ? "ON (stabilized)" : "OFF (show all)");
                     break;
                 case SDLK_l:
-                    if (hold_valid && hold_len > 0) {
-                        locked_size = hold_len;
-                        printf("[LOCK] Locked to size band: %d +/-%d%%\n", locked_size, size_tolerance);
-                    } else {
-                        locked_size = 0;
-                        printf("[LOCK] Cleared size lock\n");
-                    }
+                    WR(v.lock_req, 1);
                     break;
                 case SDLK_b:
-                    bright_thresh = (bright_thresh > 2) ? bright_thresh - 5 : 0;
-                    printf("[BRIGHTNESS] threshold -> %d\n", bright_thresh);
+                    WR(v.bright_thresh, (v.bright_thresh > 2) ? v.bright_thresh - 5 : 0);
+                    printf("[BRIGHTNESS] threshold -> %d\n", v.bright_thresh);
+                    break;
+                case SDLK_p:
+                    if (!gl) { printf("[PALETTE] Needs the GPU path (--gl)\n"); break; }
+                    palette = (palette + 1) % IR_PALETTE_COUNT;
+                    ir_gl_set_palette(gl, palette);
+                    printf("[PALETTE] -> %s\n", ir_palette_names[palette]);
+                    break;
+                case SDLK_e:
+                    if (!v.eyes) { printf("[EYES] Detector unavailable\n"); break; }
+                    WR(v.detect, !v.detect);
+                    if (dev && v.detect) uvc_device_subscribe(dev, UVC_DEMAND_FULL);
+                    else if (dev) uvc_device_unsubscribe(dev, UVC_DEMAND_FULL);
+                    printf("[EYES] %s\n", v.detect ? "ON (full frame rate, 8-bit planes)" : "OFF");
                     break;
                 case SDLK_d:
                     save_next = 1;
                     printf("[SAVE] Will save next displayed frame\n");
                     break;
+                case SDLK_SPACE:
+                    if (!player) break;
+                    WR(v.paused, !v.paused);
+                    printf("[REPLAY] %s at frame %llu\n", v.paused ? "Paused" : "Resumed",
+                           (unsigned long long)capfile_player_position(player));
+                    break;
                 }
             }
         }
         if (!g_running) break;
 
-        int got = read_frame(dev, fbuf, MAX_FRAME_SIZE);
-        if (got <= 0) { SDL_Delay(1); continue; }
-
-        /* Skip very small fragments */
-        if (got < 100) continue;
-
-        all_frames++;
-
-        uint8_t *pix = fbuf;
-        int pixlen = got;
-
-        /* Strip 10-byte Tobii metadata header if present */
-        strip_meta_header(&pix, &pixlen);
+        /* ── FPS + title bar ────────────────────────────────────────── */
+        uint32_t now = SDL_GetTicks();
+        if (now - fps_tick >= 1000) {
+            fps = fps_cnt * 1000.0f / (now - fps_tick);
+            fps_cnt = 0; fps_tick = now;
 
-        /* ── Accumulation mode: stitch fragments until target size ── */
-        if (accumulate && negotiated_frame_size > 0) {
-            int space = (int)negotiated_frame_size - accum_off;
-            int copy = (pixlen < space) ? pixlen : space;
-            if (copy > 0) {
-                memcpy(accum_buf + accum_off, pix, copy);
-                accum_off += copy;
+            /* Capture queue, or replay position: the device's snapshot,
+             * never its engine, which the demux thread may free */
+            uvc_device_stats_t ds;
+            memset(&ds, 0, sizeof(ds));
+            char q[64];
+            if (dev) uvc_device_get_stats(dev, &ds);
+            if (dev && ds.connected && ds.demand != UVC_DEMAND_OFF) {
+                snprintf(q, sizeof(q), "cap=%d %.0fHz", ds.queue_depth,
+                         ds.frame_interval ? 1e7 / ds.frame_interval : 0.0);
+            } else if (dev) {
+                snprintf(q, sizeof(q), ds.connected ? "stream off" : "tracker away");
+            } else {
+                snprintf(q, sizeof(q), "replay=%llu/%llu",
+                         (unsigned long long)capfile_player_position(player),
+                         (unsigned long long)capfile_count(replay));
             }
-            if (accum_off < (int)negotiated_frame_size) continue;
-            /* Full frame accumulated */
-            pix = accum_buf;
-            pixlen = accum_off;
-            accum_off = 0;
-        }
-
-        /* ── Stripe detection ───────────────────────────────────────── */
-        double nd = neighbor_diff(pix, pixlen);
-        int is_interleaved = (nd > 25.0);
-
-        if (stripe_filter && is_interleaved) {
-            skip_stripe++;
-            continue;
-        }
-
-        /* ── Size-band filter (when locked) ─────────────────────────── */
-        if (frame_hold && locked_size > 0) {
-            int lo = locked_size * (100 - size_tolerance) / 100;
-            int hi = locked_size * (100 + size_tolerance) / 100;
-            if (pixlen < lo || pixlen > hi) {
-                skip_size++;
-                continue;
+            char rq[64] = "";
+            if (rec) {
+                recorder_stats_t rs;
+                recorder_get_stats(rec, &rs);
+                snprintf(rq, sizeof(rq), " [REC %.0fMB q=%d drop=%llu]", rs.bytes_disk / 1048576.0,
+                         rs.queued, (unsigned long long)(rs.drop_nobuf + rs.drop_toobig + rs.drop_error));
             }
-        }
 
-        /* ── Brightness filter ──────────────────────────────────────── */
-        long qsum = 0;
-        int qn = (pixlen < 4000) ? pixlen : 4000;
-        for (int i = 0; i < qn; i++) qsum += pix[i];
-        int qavg = (int)(qsum / qn);
-
-        if (qavg < bright_thresh) {
-            skip_dark++;
-            continue;
-        }
-
-        /* ── Brightness consistency (frame-hold) ────────────────────── */
-        if (frame_hold && last_avg >= 0) {
-            int diff = abs(qavg - last_avg);
-            if (diff > avg_tolerance) {
-                skip_bright++;
-                continue;
+            /* Per-type arrival rates; "of" = frames of the type on screen */
+            frame_class_stats_t ks[FRAME_CLASS_COUNT];
+            uint64_t type_drops = 0;
+            for (int c = 0; c < FRAME_CLASS_COUNT; c++) {
+                frame_demux_get_stats(v.demux, (frame_class_t)c, &ks[c]);
+                type_drops += ks[c].drop_full;
             }
-        }
-
-        /* ── This frame passed all filters — update hold buffer ────── */
-        if (frame_hold) {
-            memcpy(hold_buf, pix, pixlen);
-            hold_len = pixlen;
-            hold_valid = 1;
-            last_avg = qavg;
-            /* Auto-lock onto first good frame's size if not locked yet */
-            if (locked_size == 0 && frames == 0) {
-                locked_size = pixlen;
-                printf("[HOLD] Auto-locked to size band: %d +/-%d%%\n", locked_size, size_tolerance);
+            int disp_q = __atomic_load_n(&v.display.slot, __ATOMIC_RELAXED) != NULL;
+
+            /* Eyes in the last plane searched, and how often both were found */
+            char eq[96] = "";
+            if (RD(v.detect) && !RD(v.eyes_searched)) {
+                snprintf(eq, sizeof(eq), " [EYES: no 8-bit planes yet%s]",
+                         RD(v.eyes_small) ? ", try A" : "");
+            } else if (RD(v.detect)) {
+                eye_features_t e;
+                pthread_mutex_lock(&v.eyes_lock);
+                e = v.eyes_last;
+                pthread_mutex_unlock(&v.eyes_lock);
+                char side[2][24];
+                for (int i = 0; i < 2; i++) {
+                    if (e.eye[i].found)
+                        snprintf(side[i], sizeof(side[i]), "%.0f,%.0f", e.eye[i].pupil[0], e.eye[i].pupil[1]);
+                    else
+                        snprintf(side[i], sizeof(side[i]), "-");
+                }
+                snprintf(eq, sizeof(eq), " [EYES %d/%d L %s R %s%s]", RD(v.eyes_found),
+                         RD(v.eyes_searched), side[0], side[1], e.nostrils_found ? " nose" : "");
             }
+
+            /* Each stage's queue depth, then what each stage dropped */
+            char t[512];
+            snprintf(t, sizeof(t),
+                "Tobii ET5 IR — w=%d — %.1f fps — #%d (of %llu %s) — avg=%d nd=%.0f — "
+                "%s — %dB — types: g8=%.0f il=%.0f meta=%.0f/s — skip: D=%d Z=%d B=%d — "
+                "q: %s g8=%d il=%d meta=%d disp=%d — drop: cap=%llu types=%llu disp=%llu%s%s%s%s%s",
+                dw, fps, RD(v.frames), (unsigned long long)ks[v.show].frames,
+                frame_class_names[v.show], last_avg, last_nd,
+                ir_mode_names[display_mode], last_len,
+                ks[FRAME_CLASS_GRAY8].rate_hz, ks[FRAME_CLASS_INTERLEAVED].rate_hz,
+                ks[FRAME_CLASS_META].rate_hz,
+                RD(v.skip_dark), RD(v.skip_size), RD(v.skip_bright),
+                q, ks[FRAME_CLASS_GRAY8].depth, ks[FRAME_CLASS_INTERLEAVED].depth,
+                ks[FRAME_CLASS_META].depth, disp_q,
+                (unsigned long long)(ds.capture.drop_queue + ds.capture.drop_nobuf),
+                (unsigned long long)type_drops, (unsigned long long)RD(v.display.dropped),
+                v.accumulate ? " [ACCUM]" : "",
+                v.frame_hold ? " [HOLD]" : "",
+                gl ? " [GL]" : "", rq, eq);
+            SDL_SetWindowTitle(win, t);
         }
 
-        /* ── Display this frame ─────────────────────────────────────── */
-        frames++; fps_cnt++; last_got = got;
+        /* Newest classified frame, or wait briefly so key events stay snappy */
+        frame_t *fr = frame_mailbox_take(&v.display);
+        if (!fr) { frame_mailbox_wait(&v.display, 10); continue; }
 
-        if (frames <= 5) {
-            printf("[Frame %d] %d bytes, mode=%s, avg=%d, nd=%.1f, first 20: ",
-                   frames, pixlen, mode_names[display_mode], qavg, nd);
-            hexdump(pix, pixlen < 20 ? pixlen : 20);
-        }
+        const frame_stats_t *st = &fr->stats;
+        const uint8_t *pix = fr->data + st->pix_off;
+        int pixlen = (int)st->pix_len;
+        shown++; fps_cnt++;
+        last_len = pixlen; last_avg = st->head_avg; last_nd = (float)st->nd;
 
         /* Save frame if requested */
         if (save_next) {
@@ -633,31 +1045,20 @@ int main(int argc, char *argv[])
             if (f) {
                 fwrite(pix, 1, pixlen, f); fclose(f);
                 printf("[SAVED] %d bytes -> %s (w=%d mode=%s)\n",
-                       pixlen, path, dw, mode_names[display_mode]);
+                       pixlen, path, dw, ir_mode_names[display_mode]);
             }
             save_next = 0;
         }
 
-        /* ── FPS + title bar ────────────────────────────────────────── */
-        uint32_t now = SDL_GetTicks();
-        if (now - fps_tick >= 1000) {
-            fps = fps_cnt * 1000.0f / (now - fps_tick);
-            fps_cnt = 0; fps_tick = now;
-
-            char t[256];
-            snprintf(t, sizeof(t),
-                "Tobii ET5 IR — w=%d — %.1f fps — #%d (of %d) — avg=%d nd=%.0f — "
-                "%s — %dB — skip: S=%d D=%d Z=%d B=%d%s%s",
-                dw, fps, frames, all_frames, qavg, nd,
-                mode_names[display_mode], pixlen,
-                skip_stripe, skip_dark, skip_size, skip_bright,
-                accumulate ? " [ACCUM]" : "",
-                frame_hold ? " [HOLD]" : "");
-            SDL_SetWindowTitle(win, t);
-        }
-
         /* ── Render ─────────────────────────────────────────────────── */
-        render_frame(pix, pixlen, argb, dw, dh, display_mode);
+        if (gl) {
+            ir_gl_draw(gl, pix, pixlen, st, dw, dh, display_mode);
+            frame_unref(fr);
+            SDL_GL_SwapWindow(win);
+            continue;
+        }
+        decode(st, pix, argb, dw, dh);
+        frame_unref(fr);
 
         /* Update SDL texture (actual width may differ from tex_w) */
         SDL_UpdateTexture(tex, &(SDL_Rect){0, 0, dw, dh}, argb, dw * 4);
@@ -668,22 +1069,36 @@ int main(int argc, char *argv[])
         SDL_RenderPresent(ren);
     }
 
-    printf("\n[DONE] %d displayed, %d total, skip: stripe=%d dark=%d size=%d bright=%d\n",
-           frames, all_frames, skip_stripe, skip_dark, skip_size, skip_bright);
-
-    free(argb); free(fbuf); free(accum_buf); free(hold_buf);
-    SDL_DestroyTexture(tex);
-    SDL_DestroyRenderer(ren);
+    g_running = 0;
+    pthread_join(demux_tid, NULL);
+    pthread_join(classify_tid, NULL);
+    frame_mailbox_clear(&v.display);
+
+    printf("\n[DONE] %d shown, %d passed, skip: dark=%d size=%d bright=%d\n",
+           shown, v.frames, v.skip_dark, v.skip_size, v.skip_bright);
+    if (v.eyes_searched || v.eyes_small)
+        printf("[EYES] %d planes searched, both pupils in %d; %d sub-frames too small\n",
+               v.eyes_searched, v.eyes_found, v.eyes_small);
+    print_demux_stats(v.demux);
+    frame_demux_destroy(v.demux);
+    eye_detect_destroy(v.eyes);
+    pthread_mutex_destroy(&v.eyes_lock);
+
+    ir_gl_destroy(gl);
+    free(argb);
+    if (tex) SDL_DestroyTexture(tex);
+    if (ren) SDL_DestroyRenderer(ren);
     SDL_DestroyWindow(win);
     SDL_Quit();
 
 done:
     g_running = 0;
-    if (c2) libusb_release_interface(dev, IF_VIDEO_STREAM);
-    if (c1) libusb_release_interface(dev, IF_VIDEO_CONTROL);
-    if (d2) libusb_attach_kernel_driver(dev, IF_VIDEO_STREAM);
-    if (d1) libusb_attach_kernel_driver(dev, IF_VIDEO_CONTROL);
-    if (dev) libusb_close(dev);
-    libusb_exit(ctx);
+    metrics_destroy(g_vm.m);    /* every recording thread has been joined */
+    uvc_device_close(dev);
+    recorder_stop(rec);         /* after the engine: it was the producer */
+    frame_pool_destroy(pool);
+    capfile_player_destroy(player);
+    capfile_free(replay);
+    if (ctx) libusb_exit(ctx);
     return 0;
 }
@@ -0,0 +1,118 @@
+/*
+ * lat_hist.h — Fixed-size log-linear latency histogram (header-only)
+ *
+ * HDR-histogram style: every power of two is split into 32 linear
+ * sub-buckets, so any value is recorded within 1/32 (3%) of its true
+ * value from 1 ns to ~500 years, in 1920 counters and no allocation.
+ * Recording is a bucket index (a clz and a shift) and three relaxed
+ * atomic adds; one thread records, any thread may read percentiles while
+ * it does (a reader can see a count a sample ahead of the sum, nothing
+ * worse).
+ *
+ *   lat_hist_t h;
+ *   lat_hist_reset(&h);
+ *   lat_hist_record(&h, t_out_ns - t_dev_ns);
+ *   uint64_t p99 = lat_hist_percentile(&h, 99.0);
+ *   lat_hist_print(stderr, "end-to-end", &h);
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_LAT_HIST_H
+#define SQUIG_LAT_HIST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#define LAT_HIST_SUB_BITS   5
+#define LAT_HIST_SUB        (1u << LAT_HIST_SUB_BITS)
+#define LAT_HIST_BUCKETS    ((64 - LAT_HIST_SUB_BITS + 1) * LAT_HIST_SUB)
+
+typedef struct {
+    uint64_t n;
+    uint64_t sum;               /* ns */
+    uint64_t max;               /* ns */
+    uint64_t count[LAT_HIST_BUCKETS];
+} lat_hist_t;
+
+static inline void lat_hist_reset(lat_hist_t *h)
+{
+    memset(h, 0, sizeof(*h));
+}
+
+/* Values below LAT_HIST_SUB get a bucket each; above, the top
+ * LAT_HIST_SUB_BITS + 1 significant bits select the bucket. */
+static inline unsigned lat_hist_index(uint64_t v)
+{
+    if (v < LAT_HIST_SUB) return (unsigned)v;
+    unsigned msb = 63u - (unsigned)__builtin_clzll(v);
+    unsigned shift = msb - LAT_HIST_SUB_BITS;
+    return (shift + 1) * LAT_HIST_SUB + (unsigned)((v >> shift) & (LAT_HIST_SUB - 1));
+}
+
+/* Smallest value that lands in bucket i */
+static inline uint64_t lat_hist_lower(unsigned i)
+{
+    if (i < LAT_HIST_SUB) return i;
+    unsigned shift = i / LAT_HIST_SUB - 1;
+    return (uint64_t)(LAT_HIST_SUB | (i & (LAT_HIST_SUB - 1))) << shift;
+}
+
+static inline void lat_hist_record(lat_hist_t *h, int64_t ns)
+{
+    uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+    __atomic_fetch_add(&h->count[lat_hist_index(v)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, v, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->n, 1, __ATOMIC_RELAXED);
+    if (v > __atomic_load_n(&h->max, __ATOMIC_RELAXED))
+        __atomic_store_n(&h->max, v, __ATOMIC_RELAXED);
+}
+
+/* Value at percentile q (0-100): the midpoint of the bucket holding it,
+ * capped at the recorded maximum. 0 when empty. */
+static inline uint64_t lat_hist_percentile(const lat_hist_t *h, double q)
+{
+    uint64_t n = __atomic_load_n(&h->n, __ATOMIC_RELAXED);
+    if (!n) return 0;
+    uint64_t want = (uint64_t)(q / 100.0 * (double)n + 0.5);
+    if (want < 1) want = 1;
+    uint64_t seen = 0;
+    for (unsigned i = 0; i < LAT_HIST_BUCKETS; i++) {
+        seen += __atomic_load_n(&h->count[i], __ATOMIC_RELAXED);
+        if (seen >= want) {
+            uint64_t lo = lat_hist_lower(i);
+            uint64_t hi = i + 1 < LAT_HIST_BUCKETS ? lat_hist_lower(i + 1) : lo;
+            uint64_t mid = lo + (hi - lo) / 2;
+            uint64_t mx = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+            return mid < mx ? mid : mx;
+        }
+    }
+    return __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+}
+
+/* Fraction of samples above limit_ns (bucket resolution) */
+static inline double lat_hist_over(const lat_hist_t *h, uint64_t limit_ns)
+{
+    uint64_t n = __atomic_load_n(&h->n, __ATOMIC_RELAXED), over = 0;
+    if (!n) return 0;
+    for (unsigned i = lat_hist_index(limit_ns) + 1; i < LAT_HIST_BUCKETS; i++)
+        over += __atomic_load_n(&h->count[i], __ATOMIC_RELAXED);
+    return (double)over / (double)n;
+}
+
+/* One line: count, mean, p50/p90/p99/p99.9, max — in milliseconds */
+static inline void lat_hist_print(FILE *out, const char *name, const lat_hist_t *h)
+{
+    uint64_t n = __atomic_load_n(&h->n, __ATOMIC_RELAXED);
+    uint64_t sum = __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+    fprintf(out, "  %-20s n=%-9llu mean %7.3f  p50 %7.3f  p90 %7.3f  p99 %7.3f  "
+            "p99.9 %7.3f  max %7.3f ms\n", name, (unsigned long long)n,
+            n ? sum / 1e6 / n : 0.0,
+            lat_hist_percentile(h, 50.0) / 1e6, lat_hist_percentile(h, 90.0) / 1e6,
+            lat_hist_percentile(h, 99.0) / 1e6, lat_hist_percentile(h, 99.9) / 1e6,
+            __atomic_load_n(&h->max, __ATOMIC_RELAXED) / 1e6);
+}
+
+#endif /* SQUIG_LAT_HIST_H */
@@ -0,0 +1,369 @@
+/*
+ * metrics.c — Runtime metrics registry and Prometheus text exporter
+ *
+ * See metrics.h. The registry is filled before the recording threads
+ * start and read-only afterwards; shards are pushed onto a lock-free
+ * list and never removed until metrics_destroy(). A scrape (the exporter
+ * thread, or metrics_write() from anywhere) holds the scrape lock, runs
+ * the collectors and sums every shard with relaxed loads — the recording
+ * threads never see it.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "metrics.h"
+
+#define METRICS_COLLECTORS  16
+#define HIST_LE_FIRST       10      /* le buckets 2^10 ns (~1 us) ... */
+#define HIST_LE_LAST        36      /* ... 2^36 ns (~69 s) */
+#define POLL_MS             250     /* the server thread checks for stop this often */
+#define CLIENT_MS           100     /* wait this long for a request line */
+
+enum { KIND_COUNTER, KIND_GAUGE, KIND_HISTOGRAM };
+
+static const char *const kind_names[] = { "counter", "gauge", "histogram" };
+
+typedef struct {
+    char name[64];
+    char labels[128];
+    char help[128];
+    int  kind;
+    int  slot;                  /* c[] / set[] index, or h[] for a histogram */
+} entry_t;
+
+struct metrics {
+    char             prefix[32];
+    entry_t          e[METRICS_MAX + METRICS_MAX_HIST];
+    int              n, ncounter, nhist;
+    int64_t          set[METRICS_MAX];      /* metrics_set() */
+    metrics_shard_t *shards;                /* pushed with a CAS */
+    struct {
+        void (*fn)(metrics_t *, void *);
+        void *arg;
+    } coll[METRICS_COLLECTORS];
+    int              ncoll;
+    pthread_mutex_t  scrape_lock;
+
+    /* Server */
+    int              fd;                    /* -1 = not serving */
+    int              tcp;
+    char             unix_path[108];
+    pthread_t        thread;
+    int              stop;
+};
+
+metrics_t *metrics_create(const char *prefix)
+{
+    metrics_t *m = calloc(1, sizeof(*m));
+    if (!m) return NULL;
+    snprintf(m->prefix, sizeof(m->prefix), "%s", prefix ? prefix : "");
+    pthread_mutex_init(&m->scrape_lock, NULL);
+    m->fd = -1;
+    return m;
+}
+
+void metrics_destroy(metrics_t *m)
+{
+    if (!m) return;
+    if (m->fd >= 0) {
+        __atomic_store_n(&m->stop, 1, __ATOMIC_RELEASE);
+        pthread_join(m->thread, NULL);
+        close(m->fd);
+        if (m->unix_path[0]) unlink(m->unix_path);
+    }
+    metrics_shard_t *s = m->shards;
+    while (s) {
+        metrics_shard_t *next = s->next;
+        free(s);
+        s = next;
+    }
+    pthread_mutex_destroy(&m->scrape_lock);
+    free(m);
+}
+
+static int add(metrics_t *m, int kind, const char *name, const char *labels, const char *help)
+{
+    int *count = kind == KIND_HISTOGRAM ? &m->nhist : &m->ncounter;
+    int max = kind == KIND_HISTOGRAM ? METRICS_MAX_HIST : METRICS_MAX;
+    if (*count >= max) {
+        fprintf(stderr, "[METRICS] No room for %s\n", name);
+        return -1;
+    }
+    char full[sizeof(m->e[0].name)];
+    snprintf(full, sizeof(full), "%s%s%s", m->prefix, m->prefix[0] ? "_" : "", name);
+    entry_t *e = &m->e[m->n++];
+    memcpy(e->name, full, sizeof(full));
+    snprintf(e->labels, sizeof(e->labels), "%s", labels ? labels : "");
+    snprintf(e->help, sizeof(e->help), "%s", help ? help : "");
+    e->kind = kind;
+    e->slot = (*count)++;
+    return e->slot;
+}
+
+int metrics_counter(metrics_t *m, const char *name, const char *labels, const char *help)
+{
+    return add(m, KIND_COUNTER, name, labels, help);
+}
+
+int metrics_gauge(metrics_t *m, const char *name, const char *labels, const char *help)
+{
+    return add(m, KIND_GAUGE, name, labels, help);
+}
+
+int metrics_histogram(metrics_t *m, const char *name, const char *labels, const char *help)
+{
+    return add(m, KIND_HISTOGRAM, name, labels, help);
+}
+
+metrics_shard_t *metrics_shard(metrics_t *m)
+{
+    metrics_shard_t *s = aligned_alloc(64, sizeof(*s));
+    if (!s) return NULL;
+    memset(s, 0, sizeof(*s));
+    s->next = __atomic_load_n(&m->shards, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&m->shards, &s->next, s, 1, __ATOMIC_RELEASE,
+                                        __ATOMIC_RELAXED))
+        ;
+    return s;
+}
+
+int metrics_collector(metrics_t *m, void (*fn)(metrics_t *m, void *arg), void *arg)
+{
+    if (m->ncoll >= METRICS_COLLECTORS) return -1;
+    m->coll[m->ncoll].fn = fn;
+    m->coll[m->ncoll].arg = arg;
+    m->ncoll++;
+    return 0;
+}
+
+void metrics_set(metrics_t *m, int id, int64_t value)
+{
+    if (id >= 0 && id < METRICS_MAX) __atomic_store_n(&m->set[id], value, __ATOMIC_RELAXED);
+}
+
+/* ── Exposition ─────────────────────────────────────────────────────── */
+
+static int64_t counter_value(metrics_t *m, int slot)
+{
+    int64_t v = __atomic_load_n(&m->set[slot], __ATOMIC_RELAXED);
+    for (metrics_shard_t *s = __atomic_load_n(&m->shards, __ATOMIC_ACQUIRE); s; s = s->next)
+        v += (int64_t)__atomic_load_n(&s->c[slot], __ATOMIC_RELAXED);
+    return v;
+}
+
+/* Returns the count: the sum of the bins read, so the buckets, +Inf and
+ * _count agree whatever the recording threads did meanwhile (sum may be
+ * an observation ahead or behind) */
+static uint64_t hist_value(metrics_t *m, int slot, metrics_hist_t *out)
+{
+    uint64_t count = 0;
+    memset(out, 0, sizeof(*out));
+    for (metrics_shard_t *s = __atomic_load_n(&m->shards, __ATOMIC_ACQUIRE); s; s = s->next) {
+        const metrics_hist_t *h = &s->h[slot];
+        out->sum += __atomic_load_n(&h->sum, __ATOMIC_RELAXED);
+        for (int b = 0; b < METRICS_HIST_BINS; b++)
+            out->bin[b] += __atomic_load_n(&h->bin[b], __ATOMIC_RELAXED);
+    }
+    for (int b = 0; b < METRICS_HIST_BINS; b++) count += out->bin[b];
+    return count;
+}
+
+/* name{labels[,extra]} */
+static void series(FILE *out, const entry_t *e, const char *suffix, const char *extra)
+{
+    fprintf(out, "%s%s", e->name, suffix);
+    if (!e->labels[0] && !extra) return;
+    fprintf(out, "{%s%s%s}", e->labels, e->labels[0] && extra ? "," : "", extra ? extra : "");
+}
+
+static void write_hist(FILE *out, metrics_t *m, const entry_t *e)
+{
+    metrics_hist_t h;
+    const uint64_t count = hist_value(m, e->slot, &h);
+    /* Bin b holds [2^(b-1), 2^b) ns, so everything up to bin b is <= 2^b ns */
+    uint64_t cum = 0;
+    int b = 0;
+    for (int le = HIST_LE_FIRST; le <= HIST_LE_LAST; le++) {
+        for (; b <= le; b++) cum += h.bin[b];
+        char extra[48];
+        snprintf(extra, sizeof(extra), "le=\"%.9g\"", (double)(1ull << le) / 1e9);
+        series(out, e, "_bucket", extra);
+        fprintf(out, " %llu\n", (unsigned long long)cum);
+    }
+    series(out, e, "_bucket", "le=\"+Inf\"");
+    fprintf(out, " %llu\n", (unsigned long long)count);
+    series(out, e, "_sum", NULL);
+    fprintf(out, " %.9f\n", h.sum / 1e9);
+    series(out, e, "_count", NULL);
+    fprintf(out, " %llu\n", (unsigned long long)count);
+}
+
+void metrics_write(metrics_t *m, FILE *out)
+{
+    pthread_mutex_lock(&m->scrape_lock);
+    for (int i = 0; i < m->ncoll; i++) m->coll[i].fn(m, m->coll[i].arg);
+
+    /* One family at a time, its HELP/TYPE first, in registration order */
+    for (int i = 0; i < m->n; i++) {
+        const entry_t *e = &m->e[i];
+        int seen = 0;
+        for (int j = 0; j < i && !seen; j++) seen = !strcmp(m->e[j].name, e->name);
+        if (seen) continue;
+        if (e->help[0]) fprintf(out, "# HELP %s %s\n", e->name, e->help);
+        fprintf(out, "# TYPE %s %s\n", e->name, kind_names[e->kind]);
+        for (int j = i; j < m->n; j++) {
+            const entry_t *f = &m->e[j];
+            if (strcmp(f->name, e->name)) continue;
+            if (f->kind == KIND_HISTOGRAM) {
+                write_hist(out, m, f);
+            } else {
+                series(out, f, "", NULL);
+                fprintf(out, " %lld\n", (long long)counter_value(m, f->slot));
+            }
+        }
+    }
+    pthread_mutex_unlock(&m->scrape_lock);
+}
+
+/* ── Server ─────────────────────────────────────────────────────────── */
+
+static void write_all(int fd, const char *p, size_t n)
+{
+    while (n) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return;
+        p += w;
+        n -= (size_t)w;
+    }
+}
+
+/* One connection: read what the client sent (if anything, briefly),
+ * answer and close. */
+static void serve_client(metrics_t *m, int c)
+{
+    char req[1024];
+    ssize_t r = 0;
+    struct pollfd pfd = { c, POLLIN, 0 };
+    if (poll(&pfd, 1, CLIENT_MS) > 0) r = recv(c, req, sizeof(req) - 1, 0);
+    int http = m->tcp || (r >= 4 && !memcmp(req, "GET ", 4));
+
+    char *body = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&body, &len);
+    if (!out) return;
+    metrics_write(m, out);
+    fclose(out);
+
+    struct timeval tv = { 1, 0 };               /* a stuck reader does not hold us up */
+    setsockopt(c, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (http) {
+        char hdr[160];
+        int n = snprintf(hdr, sizeof(hdr), "HTTP/1.0 200 OK\r\n"
+                         "Content-Type: text/plain; version=0.0.4\r\n"
+                         "Content-Length: %zu\r\nConnection: close\r\n\r\n", len);
+        write_all(c, hdr, (size_t)n);
+    }
+    write_all(c, body, len);
+    free(body);
+}
+
+static void *server_thread(void *arg)
+{
+    metrics_t *m = arg;
+    while (!__atomic_load_n(&m->stop, __ATOMIC_ACQUIRE)) {
+        struct pollfd pfd = { m->fd, POLLIN, 0 };
+        if (poll(&pfd, 1, POLL_MS) <= 0) continue;
+        int c = accept4(m->fd, NULL, NULL, SOCK_CLOEXEC);
+        if (c < 0) continue;
+        serve_client(m, c);
+        close(c);
+    }
+    return NULL;
+}
+
+static int listen_unix(metrics_t *m, const char *path)
+{
+    struct sockaddr_un sa = { .sun_family = AF_UNIX };
+    if (strlen(path) >= sizeof(sa.sun_path)) {
+        fprintf(stderr, "[METRICS] Socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(sa.sun_path, path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    unlink(path);                               /* left over from a previous run */
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(fd, 8) < 0) {
+        fprintf(stderr, "[METRICS] %s: %s\n", path, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    snprintf(m->unix_path, sizeof(m->unix_path), "%s", path);
+    return fd;
+}
+
+static int listen_tcp(const char *where)
+{
+    char host[256] = "";
+    const char *port = where, *colon = strrchr(where, ':');
+    if (colon) {
+        size_t n = (size_t)(colon - where);
+        if (n >= sizeof(host)) n = sizeof(host) - 1;
+        memcpy(host, where, n);
+        host[n] = 0;
+        if (host[0] == '[' && n > 1 && host[n - 1] == ']') {     /* [v6]:port */
+            memmove(host, host + 1, n - 2);
+            host[n - 2] = 0;
+        }
+        port = colon + 1;
+    }
+    struct addrinfo hints = { .ai_flags = AI_PASSIVE, .ai_socktype = SOCK_STREAM }, *ai;
+    int rc = getaddrinfo(host[0] ? host : NULL, port, &hints, &ai);
+    if (rc) {
+        fprintf(stderr, "[METRICS] %s: %s\n", where, gai_strerror(rc));
+        return -1;
+    }
+    int fd = -1;
+    for (struct addrinfo *a = ai; a && fd < 0; a = a->ai_next) {
+        fd = socket(a->ai_family, a->ai_socktype | SOCK_CLOEXEC, a->ai_protocol);
+        if (fd < 0) continue;
+        int one = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        if (bind(fd, a->ai_addr, a->ai_addrlen) < 0 || listen(fd, 8) < 0) {
+            close(fd);
+            fd = -1;
+        }
+    }
+    freeaddrinfo(ai);
+    if (fd < 0) fprintf(stderr, "[METRICS] Cannot listen on %s: %s\n", where, strerror(errno));
+    return fd;
+}
+
+int metrics_serve(metrics_t *m, const char *where)
+{
+    if (m->fd >= 0) return -1;
+    m->tcp = strncmp(where, "unix:", 5) != 0;
+    int fd = m->tcp ? listen_tcp(where) : listen_unix(m, where + 5);
+    if (fd < 0) return -1;
+    m->fd = fd;
+    if (pthread_create(&m->thread, NULL, server_thread, m) != 0) {
+        perror("[METRICS] pthread_create");
+        close(fd);
+        m->fd = -1;
+        if (m->unix_path[0]) unlink(m->unix_path);
+        return -1;
+    }
+    return 0;
+}
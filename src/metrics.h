@@ -0,0 +1,129 @@
+/*
+ * metrics.h — Runtime metrics: per-thread counters and histograms,
+ *             served as Prometheus text on a Unix or TCP socket
+ *
+ * Every metric is registered up front and gets a small integer id. Each
+ * thread that records takes a shard of its own (metrics_shard()) — one
+ * cache-aligned block of counter slots and log₂ histograms that only
+ * that thread writes. Recording is a plain load and a relaxed store into
+ * the shard (no lock prefix, no shared line), a couple of ns; a
+ * histogram observation adds a clz. Nothing on the hot path ever
+ * synchronises with the exporter.
+ *
+ * A scrape walks the shard list (append-only, lock-free) and sums each
+ * metric over the shards. Counters that already exist elsewhere (the
+ * capture engine's stats, pose_udp's per-destination counts) are not
+ * duplicated: a collector registered with metrics_collector() runs at
+ * scrape time and publishes their current values with metrics_set().
+ *
+ *   metrics_t *m = metrics_create("squig");
+ *   int rx  = metrics_counter(m, "samples_total", "tracker=\"0\"", "gaze_origin callbacks");
+ *   int ekf = metrics_histogram(m, "ekf_step_seconds", NULL, "EKF step time");
+ *   metrics_serve(m, "unix:/run/squig/metrics");   // or "9464", "127.0.0.1:9464"
+ *   ...
+ *   metrics_shard_t *sh = metrics_shard(m);        // once per thread
+ *   metrics_inc(sh, rx);
+ *   metrics_observe_ns(sh, ekf, t1 - t0);
+ *   ...
+ *   metrics_destroy(m);                            // after the recording threads
+ *
+ * Served as the Prometheus text format (version 0.0.4): over TCP as an
+ * HTTP response to any request, over a Unix socket the same to a client
+ * that sends "GET", and the bare text to one that sends nothing
+ * (`socat - UNIX-CONNECT:/run/squig/metrics`).
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_METRICS_H
+#define SQUIG_METRICS_H
+
+#include <stdint.h>
+#include <stdio.h>
+
+#define METRICS_MAX         256     /* metrics per registry */
+#define METRICS_MAX_HIST    32      /* ... of them histograms */
+#define METRICS_HIST_BINS   64      /* log₂ bins: [2^(i-1), 2^i) ns, bin 0 = 0 */
+
+/* No count: a scrape sums the bins, so +Inf and _count always match
+ * the le buckets even when it races an observation */
+typedef struct {
+    uint64_t sum;                   /* ns */
+    uint64_t bin[METRICS_HIST_BINS];
+} metrics_hist_t;
+
+/* One thread's slots. Written by its thread only. */
+typedef struct metrics_shard {
+    uint64_t              c[METRICS_MAX] __attribute__((aligned(64)));
+    metrics_hist_t        h[METRICS_MAX_HIST];
+    struct metrics_shard *next;     /* registry's list */
+} metrics_shard_t;
+
+typedef struct metrics metrics_t;
+
+/* prefix is prepended to every name ("squig" → squig_samples_total).
+ * Returns NULL on allocation failure. */
+metrics_t *metrics_create(const char *prefix);
+
+/* Stop serving and free the registry and every shard. No thread may
+ * record afterwards. */
+void metrics_destroy(metrics_t *m);
+
+/* Register before the recording threads start. name without the prefix;
+ * labels the inside of the {} ("" / NULL: none); the same name with
+ * different labels is one family. Return the id (counters and gauges
+ * share one numbering, histograms have their own), or -1 when full. */
+int metrics_counter(metrics_t *m, const char *name, const char *labels, const char *help);
+int metrics_gauge(metrics_t *m, const char *name, const char *labels, const char *help);
+int metrics_histogram(metrics_t *m, const char *name, const char *labels, const char *help);
+
+/* The calling thread's shard (allocated once; keep the pointer). */
+metrics_shard_t *metrics_shard(metrics_t *m);
+
+/* Called at every scrape, on the exporter thread, before the values are
+ * read; publishes with metrics_set(). Returns 0 or -1 when full. */
+int metrics_collector(metrics_t *m, void (*fn)(metrics_t *m, void *arg), void *arg);
+
+/* Absolute value for a counter or gauge, added to what the shards hold
+ * (from a collector, or any thread for a gauge). */
+void metrics_set(metrics_t *m, int id, int64_t value);
+
+/* Write the exposition text to out (runs the collectors). */
+void metrics_write(metrics_t *m, FILE *out);
+
+/* Serve on "unix:PATH", "PORT" or "HOST:PORT" from a thread of its own.
+ * Returns 0, or -1 with a message. */
+int metrics_serve(metrics_t *m, const char *where);
+
+/* ── Hot path ───────────────────────────────────────────────────────── */
+
+/* Single writer per shard: a relaxed load and store, no atomic RMW.
+ * The exporter reads with relaxed loads and may see a value one record
+ * behind, never a torn one. */
+static inline void metrics__bump(uint64_t *p, uint64_t v)
+{
+    __atomic_store_n(p, __atomic_load_n(p, __ATOMIC_RELAXED) + v, __ATOMIC_RELAXED);
+}
+
+static inline void metrics_add(metrics_shard_t *s, int id, uint64_t v)
+{
+    metrics__bump(&s->c[id], v);
+}
+
+static inline void metrics_inc(metrics_shard_t *s, int id)
+{
+    metrics__bump(&s->c[id], 1);
+}
+
+/* Histogram id (from metrics_histogram) observes a duration in ns */
+static inline void metrics_observe_ns(metrics_shard_t *s, int id, int64_t ns)
+{
+    metrics_hist_t *h = &s->h[id];
+    uint64_t v = ns > 0 ? (uint64_t)ns : 0;
+    unsigned b = v ? 64u - (unsigned)__builtin_clzll(v) : 0;
+    metrics__bump(&h->bin[b < METRICS_HIST_BINS ? b : METRICS_HIST_BINS - 1], 1);
+    metrics__bump(&h->sum, v);
+}
+
+#endif /* SQUIG_METRICS_H */
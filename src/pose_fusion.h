@@ -0,0 +1,267 @@
+/*
+ * pose_fusion.h — Merge head poses from several trackers by confidence
+ *
+ * With more than one ET5 on a rig (wider coverage, a hot spare), each
+ * tracker runs its own head_tracker and produces its own pose stream.
+ * This stage keeps the newest pose of every source and, each time one
+ * arrives, blends it with the others that are still fresh:
+ *
+ *   w_i  = confidence_i             for sources updated within stale_ms
+ *   pose = ref + Σ w_i (pose_i - ref) / Σ w_i
+ *
+ * where ref is the pose that just arrived and angle differences are
+ * wrapped to ±180°, so a blend across the yaw seam stays continuous. A
+ * tracker that loses the eyes reports confidence 0 and drops out of the
+ * blend at once; one that stops delivering drops out after stale_ms. The
+ * fused pose carries the confidence, eye count and flags of its best
+ * source.
+ *
+ * Each source is first put in the shared frame by its extrinsic: the
+ * mount yaw (degrees, positive = the tracker is turned to the user's
+ * left), the rotation M about the vertical axis, and where the tracker
+ * sits. The head rotation becomes M·R(yaw, pitch, roll), read back as
+ * angles; in head_ekf.h's yaw-pitch-roll order that adds the mount to
+ * yaw and leaves pitch and roll as they were (a tracker that also tilted
+ * would change them). Trackers mounted level and facing the user need no
+ * mount.
+ *
+ * Translation is fused as the absolute pivot position, M·pivot + offset,
+ * not as each tracker's x, y, z: those are relative to where its filter
+ * seeded, and every tracker seeds on its own (first sight of the eyes,
+ * or after a gap), so they share no origin and a reseed would move
+ * one under the others. The fused translation is relative to the first
+ * pivot fused. The offset (where the tracker sits, shared frame) is not
+ * configured but learned: on a tracker's first pose next to the others
+ * it is set so the pivots agree, then follows their difference slowly.
+ * A reseed leaves it alone. A source whose filter just (re)seeded
+ * (pose_fusion_reseeded()) has no pitch yet, and its pivot is off by
+ * the head model's lever arm times that error, so for
+ * POSE_FUSION_SETTLE_MS it is left out of the blend whenever a settled
+ * source is there; alone, it is used and continues from the last fused
+ * position.
+ *
+ *   pose_fusion_t fu;
+ *   pose_fusion_init(&fu, 2, 50.0);
+ *   pose_fusion_mount(&fu, 1, -30.0);
+ *   if (reseeded) pose_fusion_reseeded(&fu, dev);    // head_tracker_t.reseeds moved
+ *   int used = pose_fusion_update(&fu, dev, &pose, now_ns, &fused);
+ *
+ * Header-only, no allocation, no locking: callers feeding it from
+ * several threads serialise around pose_fusion_update().
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_POSE_FUSION_H
+#define SQUIG_POSE_FUSION_H
+
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include "head_tracker.h"
+
+#define POSE_FUSION_MAX         8
+#define POSE_FUSION_SETTLE_MS   4000.0  /* after a seed: the filter's pitch still converging */
+#define POSE_FUSION_LEARN       0.002   /* offset gain per pose (~5 s at 90 Hz) */
+
+typedef struct {
+    head_tracker_pose_t pose;   /* in the shared frame */
+    double   pivot[3];          /* M·pivot + offset, mm */
+    int64_t  t_ns;              /* host time it arrived, 0 = never */
+    int64_t  settle_ns;         /* (re)seeded: settling until then */
+    int      seeded;            /* pose_fusion_reseeded() since the last pose */
+    int      placed;            /* offset known */
+    double   mount_yaw;         /* degrees */
+    double   mount[3][3];       /* M: tracker frame -> shared frame */
+    double   offset[3];         /* where the tracker sits, shared frame, mm */
+    uint64_t updates;
+    uint64_t used;              /* fused into another source's output */
+    uint64_t placements;        /* offset set from the other sources */
+} pose_fusion_source_t;
+
+typedef struct {
+    pose_fusion_source_t src[POSE_FUSION_MAX];
+    int     n;
+    int64_t stale_ns;
+    int     ref;                /* source whose pivot set the origin (offset fixed), -1 = none yet */
+    double  origin[3];          /* fused translation is relative to this pivot */
+    double  last[3];            /* last fused pivot */
+} pose_fusion_t;
+
+static inline void pose_fusion_mount(pose_fusion_t *fu, int i, double yaw_deg)
+{
+    pose_fusion_source_t *s = &fu->src[i];
+    const double c = cos(yaw_deg * M_PI / 180.0), sn = sin(yaw_deg * M_PI / 180.0);
+    const double M[3][3] = { { c, 0, -sn }, { 0, 1, 0 }, { sn, 0, c } };    /* head_ekf.h's yaw */
+    s->mount_yaw = yaw_deg;
+    memcpy(s->mount, M, sizeof(M));
+}
+
+static inline void pose_fusion_init(pose_fusion_t *fu, int n, double stale_ms)
+{
+    memset(fu, 0, sizeof(*fu));
+    fu->n = n < POSE_FUSION_MAX ? n : POSE_FUSION_MAX;
+    fu->stale_ns = (int64_t)(stale_ms * 1e6);
+    fu->ref = -1;
+    for (int i = 0; i < POSE_FUSION_MAX; i++) pose_fusion_mount(fu, i, 0.0);
+}
+
+/* Source i's filter (re)seeded on the pose about to be passed in */
+static inline void pose_fusion_reseeded(pose_fusion_t *fu, int i)
+{
+    fu->src[i].seeded = 1;
+}
+
+static inline double pose_fusion_wrap(double deg)
+{
+    while (deg > 180.0) deg -= 360.0;
+    while (deg < -180.0) deg += 360.0;
+    return deg;
+}
+
+/* Fresh, with eyes and placed; settled: also past its settling time */
+static inline int pose_fusion__live(const pose_fusion_t *fu, int k, int64_t now_ns, int settled)
+{
+    const pose_fusion_source_t *o = &fu->src[k];
+    return o->t_ns && now_ns - o->t_ns <= fu->stale_ns && o->pose.confidence > 0.0f && o->placed &&
+           (!settled || now_ns >= o->settle_ns);
+}
+
+/* p (tracker frame) into s: pivot M·(p + base) + offset, rotation M·R */
+static inline void pose_fusion__to_shared(pose_fusion_source_t *s, const head_tracker_pose_t *p)
+{
+    const double (*M)[3] = s->mount, d2r = M_PI / 180.0;
+    const double t[3] = { p->x + p->base[0], p->y + p->base[1], p->z + p->base[2] };
+    double R[3][3], MR[3][3];
+    for (int k = 0; k < 3; k++)
+        s->pivot[k] = M[k][0] * t[0] + M[k][1] * t[1] + M[k][2] * t[2] + s->offset[k];
+
+    /* R = Y(yaw) X(pitch) Z(roll), as head_ekf_rotation() */
+    const double cy = cos(p->yaw * d2r), sy = sin(p->yaw * d2r);
+    const double cp = cos(p->pitch * d2r), sp = sin(p->pitch * d2r);
+    const double cr = cos(p->roll * d2r), sr = sin(p->roll * d2r);
+    R[0][0] = cy * cr - sy * sp * sr;  R[0][1] = -cy * sr - sy * sp * cr;  R[0][2] = -sy * cp;
+    R[1][0] = cp * sr;                 R[1][1] = cp * cr;                  R[1][2] = -sp;
+    R[2][0] = sy * cr + cy * sp * sr;  R[2][1] = -sy * sr + cy * sp * cr;  R[2][2] = cy * cp;
+    for (int a = 0; a < 3; a++)
+        for (int b = 0; b < 3; b++) MR[a][b] = M[a][0] * R[0][b] + M[a][1] * R[1][b] + M[a][2] * R[2][b];
+
+    s->pose = *p;
+    s->pose.yaw   = atan2(-MR[0][2], MR[2][2]) / d2r;
+    s->pose.pitch = asin(fmax(-1.0, fmin(1.0, -MR[1][2]))) / d2r;
+    s->pose.roll  = atan2(MR[1][0], MR[1][1]) / d2r;
+}
+
+/* Confidence-weighted pivot of the live sources other than i; 0 if none */
+static inline double pose_fusion__others(const pose_fusion_t *fu, int i, int64_t now_ns, int settled,
+                                         double pivot[3])
+{
+    double wsum = 0;
+    pivot[0] = pivot[1] = pivot[2] = 0;
+    for (int k = 0; k < fu->n; k++) {
+        if (k == i || !pose_fusion__live(fu, k, now_ns, settled)) continue;
+        double w = fu->src[k].pose.confidence;
+        for (int a = 0; a < 3; a++) pivot[a] += w * fu->src[k].pivot[a];
+        wsum += w;
+    }
+    if (wsum > 0)
+        for (int a = 0; a < 3; a++) pivot[a] /= wsum;
+    return wsum;
+}
+
+/* Set or follow source i's offset from the others (its pose has eyes) */
+static inline void pose_fusion__place(pose_fusion_t *fu, int i, int64_t now_ns)
+{
+    pose_fusion_source_t *s = &fu->src[i];
+    double to[3], gain;
+    if (fu->ref < 0) {                          /* the first pivot: the origin */
+        fu->ref = i;
+        memcpy(fu->origin, s->pivot, sizeof(fu->origin));
+        s->placed = 1;
+        return;
+    }
+    if (s->placed) {
+        if (i == fu->ref || now_ns < s->settle_ns || !pose_fusion__others(fu, i, now_ns, 1, to)) return;
+        gain = POSE_FUSION_LEARN;
+    } else if (pose_fusion__others(fu, i, now_ns, 1, to)) {
+        if (now_ns < s->settle_ns) return;      /* wait: the settled ones carry on */
+        gain = 1.0;
+    } else {
+        /* Nobody settled: join the unsettled, or where the fused pose was */
+        if (!pose_fusion__others(fu, i, now_ns, 0, to)) memcpy(to, fu->last, sizeof(to));
+        gain = 1.0;
+    }
+    for (int a = 0; a < 3; a++) {
+        double d = gain * (to[a] - s->pivot[a]);
+        s->offset[a] += d;
+        s->pivot[a] += d;
+    }
+    if (!s->placed) s->placements++;
+    s->placed = 1;
+}
+
+/* Store source i's new pose (tracker frame) at host time now_ns and blend
+ * it with the other fresh sources into *out. Returns the number of
+ * sources blended (1 = passed through, or only another source used). */
+static inline int pose_fusion_update(pose_fusion_t *fu, int i, const head_tracker_pose_t *p,
+                                     int64_t now_ns, head_tracker_pose_t *out)
+{
+    pose_fusion_source_t *s = &fu->src[i];
+    pose_fusion__to_shared(s, p);
+    if (s->seeded) s->settle_ns = now_ns + (int64_t)(POSE_FUSION_SETTLE_MS * 1e6);
+    s->seeded = 0;
+    s->t_ns = now_ns;
+    s->updates++;
+    if (p->confidence > 0.0f) pose_fusion__place(fu, i, now_ns);
+
+    /* Blend the settled live sources, or all live ones if none is settled */
+    int settled = 0;
+    for (int k = 0; k < fu->n && !settled; k++) settled = pose_fusion__live(fu, k, now_ns, 1);
+    int r = pose_fusion__live(fu, i, now_ns, settled) ? i : -1;
+    for (int k = 0; k < fu->n && r < 0; k++)
+        if (pose_fusion__live(fu, k, now_ns, settled)) r = k;
+    if (r < 0) {                                /* no eyes anywhere: pass through */
+        *out = s->pose;
+        if (fu->ref >= 0) {
+            out->x = s->pivot[0] - fu->origin[0];
+            out->y = s->pivot[1] - fu->origin[1];
+            out->z = s->pivot[2] - fu->origin[2];
+            memcpy(out->base, fu->origin, sizeof(out->base));
+        }
+        return 1;
+    }
+
+    const head_tracker_pose_t *ref = &fu->src[r].pose;
+    *out = *ref;
+    double wsum = 0, acc[6] = { 0 };
+    int used = 0;
+    for (int k = 0; k < fu->n; k++) {
+        pose_fusion_source_t *o = &fu->src[k];
+        if (!pose_fusion__live(fu, k, now_ns, settled)) continue;
+        double w = o->pose.confidence;
+        for (int a = 0; a < 3; a++) acc[a] += w * o->pivot[a];
+        acc[3] += w * pose_fusion_wrap(o->pose.yaw - ref->yaw);
+        acc[4] += w * pose_fusion_wrap(o->pose.pitch - ref->pitch);
+        acc[5] += w * pose_fusion_wrap(o->pose.roll - ref->roll);
+        wsum += w;
+        if (o->pose.confidence > out->confidence) {     /* eyes, flags of the best */
+            out->confidence = o->pose.confidence;
+            out->eyes = o->pose.eyes;
+            out->flags = o->pose.flags;
+        }
+        if (k != i) o->used++;
+        used++;
+    }
+    for (int a = 0; a < 3; a++) fu->last[a] = acc[a] / wsum;
+    out->x = fu->last[0] - fu->origin[0];
+    out->y = fu->last[1] - fu->origin[1];
+    out->z = fu->last[2] - fu->origin[2];
+    memcpy(out->base, fu->origin, sizeof(out->base));
+    out->yaw   = pose_fusion_wrap(ref->yaw + acc[3] / wsum);
+    out->pitch = pose_fusion_wrap(ref->pitch + acc[4] / wsum);
+    out->roll  = pose_fusion_wrap(ref->roll + acc[5] / wsum);
+    return used;
+}
+
+#endif /* SQUIG_POSE_FUSION_H */
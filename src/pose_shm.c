@@ -0,0 +1,355 @@
+/*
+ * pose_shm.c — Latest head pose in POSIX shared memory (seqlock)
+ *
+ * See pose_shm.h. Memory ordering (the usual seqlock recipe):
+ *
+ *   writer   seq = s+1 (relaxed); release fence; pose words (relaxed);
+ *            seq = s+2 (release)
+ *   reader   s1 = seq (acquire); pose words (relaxed); acquire fence;
+ *            s2 = seq (relaxed); retry unless s1 == s2 and s1 is even
+ *
+ * Every access to the shared pose is a whole-word atomic, so a torn read
+ * is detected by the sequence check instead of being a data race.
+ *
+ * Wake-ups go through the wake page: the writer copies seq there after
+ * each publish and wakes the parked readers; a reader loads that copy
+ * before it checks the segment's seq and waits on the copy, so a publish
+ * in between changes the futex word and the wait returns at once.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <grp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/eventfd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "pose_shm.h"
+
+#define SEG_BYTES       4096    /* one page; the segment itself is < 256 B */
+#define READ_RETRIES    1000    /* a writer stuck mid-update is a dead writer */
+
+_Static_assert(sizeof(pose_shm_pose_t) % sizeof(uint64_t) == 0, "pose must be whole words");
+_Static_assert(sizeof(pose_shm_segment_t) <= SEG_BYTES, "segment must fit its mapping");
+
+struct pose_shm_writer {
+    pose_shm_segment_t *seg;
+    pose_shm_wake_t    *wake;           /* NULL: readers poll */
+    char                name[128];
+    uint64_t            count;
+    int                 efd;
+};
+
+struct pose_shm_reader {
+    const pose_shm_segment_t *seg;
+    pose_shm_wake_t          *wake;     /* NULL when not writable: poll */
+    uint32_t                  last_seq;
+};
+
+/* FUTEX_WAIT_BITSET: the timeout is an absolute CLOCK_MONOTONIC time */
+static long futex(uint32_t *addr, int op, uint32_t val, const struct timespec *ts)
+{
+    return syscall(SYS_futex, addr, op, val, ts, NULL, FUTEX_BITSET_MATCH_ANY);
+}
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int segment_compatible(const pose_shm_segment_t *s)
+{
+    return s->magic == POSE_SHM_MAGIC && s->version == POSE_SHM_VERSION &&
+           s->size == sizeof(pose_shm_segment_t) && s->pose_size == sizeof(pose_shm_pose_t);
+}
+
+/* ── Writer ─────────────────────────────────────────────────────────── */
+
+/* Open (O_EXCL first) or create name with mode, as a page of this size,
+ * and map it. A name that exists must belong to this user; its mode is
+ * reset, so nobody else keeps write access. */
+static void *map_own(const char *name, mode_t mode, gid_t gid)
+{
+    int fd = shm_open(name, O_RDWR | O_CREAT | O_EXCL, mode);
+    if (fd < 0 && errno == EEXIST) fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0) {
+        fprintf(stderr, "[SHM] shm_open %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    const char *err = NULL;
+    if (fstat(fd, &st) < 0) err = strerror(errno);
+    else if (st.st_uid != geteuid()) err = "owned by another user, not using it";
+    else if (gid != (gid_t)-1 && st.st_gid != gid && fchown(fd, (uid_t)-1, gid) < 0) err = strerror(errno);
+    else if (fchmod(fd, mode) < 0) err = strerror(errno);     /* umask, or an older 0666 one */
+    else if (st.st_size != SEG_BYTES && ftruncate(fd, SEG_BYTES) < 0) err = strerror(errno);
+    if (err) {
+        fprintf(stderr, "[SHM] %s: %s\n", name, err);
+        close(fd);
+        return NULL;
+    }
+    void *m = mmap(NULL, SEG_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        fprintf(stderr, "[SHM] mmap %s: %s\n", name, strerror(errno));
+        return NULL;
+    }
+    return m;
+}
+
+pose_shm_writer_t *pose_shm_create(const char *name, const char *group)
+{
+    gid_t gid = (gid_t)-1;
+    if (group) {
+        struct group *gr = getgrnam(group);
+        if (!gr) {
+            fprintf(stderr, "[SHM] No group %s\n", group);
+            return NULL;
+        }
+        gid = gr->gr_gid;
+    }
+    pose_shm_writer_t *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    snprintf(w->name, sizeof(w->name), "%s", name ? name : POSE_SHM_DEFAULT_NAME);
+    w->efd = -1;
+
+    pose_shm_segment_t *s = map_own(w->name, group ? 0640 : 0600, gid);
+    if (!s) {
+        free(w);
+        return NULL;
+    }
+    w->seg = s;
+
+    if (segment_compatible(s)) {
+        /* Re-attach: keep seq running so mapped readers see new poses, and
+         * close a write the previous writer died in the middle of */
+        uint32_t q = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+        if (q & 1) __atomic_store_n(&s->seq, q + 1, __ATOMIC_RELEASE);
+    } else {
+        memset(s, 0, sizeof(*s));
+        s->version   = POSE_SHM_VERSION;
+        s->size      = sizeof(pose_shm_segment_t);
+        s->pose_size = sizeof(pose_shm_pose_t);
+        __atomic_store_n(&s->magic, POSE_SHM_MAGIC, __ATOMIC_RELEASE);
+    }
+
+    /* The wake page is optional: without it readers poll */
+    char wname[sizeof(w->name) + sizeof(POSE_SHM_WAKE_SUFFIX)];
+    snprintf(wname, sizeof(wname), "%s%s", w->name, POSE_SHM_WAKE_SUFFIX);
+    w->wake = map_own(wname, group ? 0660 : 0600, gid);
+    if (w->wake) {
+        pose_shm_wake_t *k = w->wake;
+        k->version = POSE_SHM_VERSION;
+        __atomic_store_n(&k->seq, __atomic_load_n(&s->seq, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+        __atomic_store_n(&k->magic, POSE_SHM_MAGIC, __ATOMIC_RELEASE);
+    } else {
+        fprintf(stderr, "[SHM] No wake page: readers will poll\n");
+    }
+
+    __atomic_fetch_add(&s->generation, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->writer_pid, (int32_t)getpid(), __ATOMIC_RELEASE);
+    printf("[SHM] Publishing poses in /dev/shm%s (generation %llu, %s)\n", w->name,
+           (unsigned long long)s->generation, group ? group : "this user only");
+    return w;
+}
+
+void pose_shm_publish(pose_shm_writer_t *w, const pose_shm_pose_t *p)
+{
+    pose_shm_segment_t *s = w->seg;
+    pose_shm_pose_t v = *p;
+    v.publish_ns = now_ns();
+    v.count = ++w->count;
+    uint64_t words[POSE_SHM_WORDS];
+    memcpy(words, &v, sizeof(words));
+
+    uint32_t q = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seq, q + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    for (size_t i = 0; i < POSE_SHM_WORDS; i++)
+        __atomic_store_n(&s->pose[i], words[i], __ATOMIC_RELAXED);
+    __atomic_store_n(&s->seq, q + 2, __ATOMIC_RELEASE);
+
+    /* Pairs with the fence in pose_shm_wait(): either the reader sees the
+     * new seq before sleeping, or we see it counted in waiters. */
+    pose_shm_wake_t *k = w->wake;
+    if (k) {
+        __atomic_store_n(&k->seq, q + 2, __ATOMIC_RELEASE);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&k->waiters, __ATOMIC_RELAXED))
+            futex(&k->seq, FUTEX_WAKE, INT_MAX, NULL);
+    }
+    if (w->efd >= 0) {
+        uint64_t one = 1;
+        if (write(w->efd, &one, sizeof(one)) < 0) { /* counter full: still readable */ }
+    }
+}
+
+int pose_shm_eventfd(pose_shm_writer_t *w)
+{
+    if (w->efd < 0) {
+        w->efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (w->efd < 0) perror("[SHM] eventfd");
+    }
+    return w->efd;
+}
+
+void pose_shm_destroy(pose_shm_writer_t *w, int unlink)
+{
+    if (!w) return;
+    __atomic_store_n(&w->seg->writer_pid, 0, __ATOMIC_RELEASE);
+    munmap(w->seg, SEG_BYTES);
+    if (w->wake) munmap(w->wake, SEG_BYTES);
+    if (unlink) {
+        char wname[sizeof(w->name) + sizeof(POSE_SHM_WAKE_SUFFIX)];
+        snprintf(wname, sizeof(wname), "%s%s", w->name, POSE_SHM_WAKE_SUFFIX);
+        shm_unlink(w->name);
+        shm_unlink(wname);
+    }
+    if (w->efd >= 0) close(w->efd);
+    free(w);
+}
+
+/* ── Reader ─────────────────────────────────────────────────────────── */
+
+/* The wake page of name, if this process may write it */
+static pose_shm_wake_t *open_wake(const char *name)
+{
+    char wname[192];
+    snprintf(wname, sizeof(wname), "%s%s", name, POSE_SHM_WAKE_SUFFIX);
+    int fd = shm_open(wname, O_RDWR, 0);
+    if (fd < 0) return NULL;
+    struct stat st;
+    void *m = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size >= (off_t)sizeof(pose_shm_wake_t))
+        m = mmap(NULL, SEG_BYTES, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return NULL;
+    pose_shm_wake_t *k = m;
+    if (__atomic_load_n(&k->magic, __ATOMIC_ACQUIRE) != POSE_SHM_MAGIC || k->version != POSE_SHM_VERSION) {
+        munmap(m, SEG_BYTES);
+        return NULL;
+    }
+    return k;
+}
+
+pose_shm_reader_t *pose_shm_open(const char *name)
+{
+    if (!name) name = POSE_SHM_DEFAULT_NAME;
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < (off_t)sizeof(pose_shm_segment_t)) {
+        close(fd);
+        return NULL;
+    }
+    void *m = mmap(NULL, SEG_BYTES, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return NULL;
+
+    const pose_shm_segment_t *s = m;
+    if (__atomic_load_n(&s->magic, __ATOMIC_ACQUIRE) != POSE_SHM_MAGIC || !segment_compatible(s)) {
+        fprintf(stderr, "[SHM] %s: incompatible pose segment (version %u)\n", name, s->version);
+        munmap(m, SEG_BYTES);
+        return NULL;
+    }
+    pose_shm_reader_t *r = calloc(1, sizeof(*r));
+    if (!r) {
+        munmap(m, SEG_BYTES);
+        return NULL;
+    }
+    r->seg = s;
+    r->wake = open_wake(name);
+    r->last_seq = 0;            /* seq 0 = nothing published yet */
+    return r;
+}
+
+int pose_shm_read(pose_shm_reader_t *r, pose_shm_pose_t *out)
+{
+    const pose_shm_segment_t *s = r->seg;
+    uint64_t words[POSE_SHM_WORDS];
+    for (int tries = 0; tries < READ_RETRIES; tries++) {
+        uint32_t s1 = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        if (s1 == 0) return -1;
+        if (s1 & 1) continue;
+        for (size_t i = 0; i < POSE_SHM_WORDS; i++)
+            words[i] = __atomic_load_n(&s->pose[i], __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&s->seq, __ATOMIC_RELAXED) != s1) continue;
+
+        memcpy(out, words, sizeof(*out));
+        int fresh = s1 != r->last_seq;
+        r->last_seq = s1;
+        return fresh;
+    }
+    return -1;
+}
+
+int pose_shm_wait(pose_shm_reader_t *r, int timeout_ms)
+{
+    const pose_shm_segment_t *s = r->seg;
+    uint32_t q = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+    if (q != r->last_seq && !(q & 1)) return 0;
+    if (timeout_ms <= 0) return -1;
+
+    uint64_t deadline = now_ns() + (uint64_t)timeout_ms * 1000000ull;
+    pose_shm_wake_t *k = r->wake;
+    if (!k) {
+        /* No wake page: cannot announce ourselves, poll at 1 kHz */
+        while (now_ns() < deadline) {
+            struct timespec ts = { 0, 1000000L };
+            nanosleep(&ts, NULL);
+            q = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+            if (q != r->last_seq && !(q & 1)) return 0;
+        }
+        return -1;
+    }
+
+    struct timespec abs = { (time_t)(deadline / 1000000000ull), (long)(deadline % 1000000000ull) };
+    __atomic_fetch_add(&k->waiters, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (;;) {
+        /* The copy first: a publish after this load changes it */
+        uint32_t kq = __atomic_load_n(&k->seq, __ATOMIC_ACQUIRE);
+        q = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        if (q != r->last_seq && !(q & 1)) break;
+        if (futex(&k->seq, FUTEX_WAIT_BITSET, kq, &abs) < 0 && errno == ETIMEDOUT) break;
+        if (now_ns() >= deadline) break;
+    }
+    __atomic_fetch_sub(&k->waiters, 1, __ATOMIC_RELAXED);
+    q = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+    return (q != r->last_seq && !(q & 1)) ? 0 : -1;
+}
+
+int pose_shm_writer_alive(const pose_shm_reader_t *r)
+{
+    pid_t pid = __atomic_load_n(&r->seg->writer_pid, __ATOMIC_ACQUIRE);
+    if (pid <= 0) return 0;
+    if (kill(pid, 0) == 0 || errno == EPERM) return 1;
+    /* No such pid here: crashed, or in another pid namespace. The last
+     * pose's age decides (publish_ns is word 7 of the pose). */
+    uint64_t pub = __atomic_load_n(&r->seg->pose[offsetof(pose_shm_pose_t, publish_ns) / sizeof(uint64_t)],
+                                   __ATOMIC_RELAXED);
+    return pub && now_ns() - pub < POSE_SHM_ALIVE_MS * 1000000ull;
+}
+
+void pose_shm_close(pose_shm_reader_t *r)
+{
+    if (!r) return;
+    munmap((void *)r->seg, SEG_BYTES);
+    if (r->wake) munmap(r->wake, SEG_BYTES);
+    free(r);
+}
@@ -0,0 +1,154 @@
+/*
+ * pose_shm.h — Latest head pose in POSIX shared memory (seqlock)
+ *
+ * One writer (squig-headtrackd) publishes every pose into a small
+ * /dev/shm segment; any number of readers, in any process, copy the
+ * latest one out. Nothing is queued: a reader that looks twice between
+ * two publishes sees the same pose, one that looks late sees only the
+ * newest.
+ *
+ * The segment is a seqlock: the writer makes the sequence word odd,
+ * stores the pose, makes it even again. Readers retry when the word was
+ * odd or changed under them, so the writer never waits for (or even
+ * knows about) readers, and a reader never takes a lock the writer could
+ * need. Each field lives in its own cache line: the read-only header,
+ * the sequence word, the pose.
+ *
+ * Only the writer can write the pose segment: it is created 0600 (0640
+ * with a group), exclusively, and a segment someone else owns or could
+ * write is refused. Readers map it read-only.
+ *
+ * Readers that want to be woken instead of polling park with a shared
+ * futex on a second page, <name>.wake (pose_shm_wait()), the one thing
+ * they need write access to. It holds a copy of the sequence word and
+ * the waiter count, nothing a reader trusts: whatever is written there,
+ * the pose and its sequence come from the writer's page, so the worst a
+ * stray writer can do is spurious or missed wake-ups. The writer only
+ * issues FUTEX_WAKE when the waiter count says someone is parked, so a
+ * publish with no sleepers is a few stores and no syscall. In-process
+ * consumers that live in a poll()/epoll loop can ask the writer for an
+ * eventfd instead (pose_shm_eventfd()).
+ *
+ *   pose_shm_writer_t *w = pose_shm_create(NULL, NULL);   // /dev/shm/squig-headpose
+ *   pose_shm_publish(w, &pose);                      // per filtered sample
+ *
+ *   pose_shm_reader_t *r = pose_shm_open(NULL);
+ *   for (;;) {
+ *       pose_shm_wait(r, 100);                       // or poll on a frame tick
+ *       if (pose_shm_read(r, &pose) > 0) use(&pose);
+ *   }
+ *
+ * The layout is ABI: bump POSE_SHM_VERSION on any change. Readers refuse
+ * a segment whose magic, version or sizes differ.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_POSE_SHM_H
+#define SQUIG_POSE_SHM_H
+
+#include <stdint.h>
+
+#define POSE_SHM_DEFAULT_NAME   "/squig-headpose"
+#define POSE_SHM_MAGIC          0x45534F50u     /* "POSE" */
+#define POSE_SHM_VERSION        2
+#define POSE_SHM_WAKE_SUFFIX    ".wake"
+#define POSE_SHM_CACHELINE      64
+
+/* pose_shm_pose_t.flags */
+#define POSE_SHM_F_LEFT         0x01u   /* left eye contributed */
+#define POSE_SHM_F_RIGHT        0x02u   /* right eye contributed */
+#define POSE_SHM_F_PREDICTED    0x04u   /* no eyes: filter extrapolation */
+
+typedef struct {
+    double   x, y, z;           /* mm from the starting position, tracker axes */
+    double   yaw, pitch, roll;  /* degrees */
+    int64_t  timestamp_us;      /* Stream Engine time of the source sample */
+    uint64_t publish_ns;        /* CLOCK_MONOTONIC when published */
+    float    confidence;        /* 0 (no eyes) .. 1 (both eyes, in the gate) */
+    uint32_t flags;             /* POSE_SHM_F_* */
+    uint64_t count;             /* poses published by this writer, from 1 */
+} pose_shm_pose_t;
+
+#define POSE_SHM_WORDS  (sizeof(pose_shm_pose_t) / sizeof(uint64_t))
+
+typedef struct {
+    /* Line 0: written once per writer start */
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;              /* sizeof(pose_shm_segment_t) */
+    uint32_t pose_size;         /* sizeof(pose_shm_pose_t) */
+    int32_t  writer_pid;        /* 0 = no writer attached (or it exited cleanly) */
+    uint32_t pad0;
+    uint64_t generation;        /* bumped by every writer start */
+    /* Line 1: seqlock word (odd = write in progress) */
+    uint32_t seq __attribute__((aligned(POSE_SHM_CACHELINE)));
+    /* Line 2-3: the pose, accessed as whole words */
+    uint64_t pose[POSE_SHM_WORDS] __attribute__((aligned(POSE_SHM_CACHELINE)));
+} pose_shm_segment_t;
+
+/* <name>.wake, writable by readers */
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;               /* segment seq after each publish: the futex word */
+    uint32_t waiters;           /* readers parked on it */
+} pose_shm_wake_t;
+
+/* ── Writer ─────────────────────────────────────────────────────────── */
+
+typedef struct pose_shm_writer pose_shm_writer_t;
+
+/* Create or re-attach to the segment (name: "/..." in /dev/shm, NULL =
+ * POSE_SHM_DEFAULT_NAME) and its wake page. group NULL: only this user
+ * can read the pose (0600); otherwise that group can read it and park on
+ * the wake page (0640 / 0660). A compatible segment left by an earlier
+ * writer of the same user is reused, so readers that still have it
+ * mapped keep working across a daemon restart; one owned by another
+ * user, or writable by anyone else, is refused. Without a wake page
+ * (same checks) readers poll. Returns NULL with a message on failure. */
+pose_shm_writer_t *pose_shm_create(const char *name, const char *group);
+
+/* Publish p (publish_ns and count are filled in). Single writer thread;
+ * wait-free apart from the FUTEX_WAKE when readers are parked. */
+void pose_shm_publish(pose_shm_writer_t *w, const pose_shm_pose_t *p);
+
+/* An eventfd (EFD_NONBLOCK) that is signalled on every publish from now
+ * on, for in-process consumers with a poll loop. Created on first call;
+ * owned by the writer. Returns -1 on failure. */
+int pose_shm_eventfd(pose_shm_writer_t *w);
+
+/* Detach (readers see writer_pid 0). unlink: also remove the name. */
+void pose_shm_destroy(pose_shm_writer_t *w, int unlink);
+
+/* ── Reader ─────────────────────────────────────────────────────────── */
+
+typedef struct pose_shm_reader pose_shm_reader_t;
+
+/* Map an existing segment read-only (NULL = default name), and its wake
+ * page if this process may write it; without one, pose_shm_wait() polls.
+ * Returns NULL if there is no compatible segment. */
+pose_shm_reader_t *pose_shm_open(const char *name);
+
+/* Copy the latest pose. Returns 1 if it is newer than the last one this
+ * reader returned, 0 if it is the same, -1 if nothing was published yet
+ * (or the writer died mid-update). Never blocks. */
+int pose_shm_read(pose_shm_reader_t *r, pose_shm_pose_t *out);
+
+/* Sleep until a pose newer than the last one read is published, or
+ * timeout_ms passes (a deadline: signals and spurious wake-ups do not
+ * extend it). Returns 0 when there is something new, -1 on timeout. */
+int pose_shm_wait(pose_shm_reader_t *r, int timeout_ms);
+
+/* Nonzero while a writer is attached to the segment: its pid is set and
+ * that process exists, or (a writer in another pid namespace) the last
+ * pose is under POSE_SHM_ALIVE_MS old. A writer that crashed reads as
+ * gone once its pid is. */
+#define POSE_SHM_ALIVE_MS       1000
+
+int pose_shm_writer_alive(const pose_shm_reader_t *r);
+
+void pose_shm_close(pose_shm_reader_t *r);
+
+#endif /* SQUIG_POSE_SHM_H */
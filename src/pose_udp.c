@@ -0,0 +1,337 @@
+/*
+ * pose_udp.c — Non-blocking UDP pose fan-out (opentrack + extended)
+ *
+ * See pose_udp.h. Per pose: pick the destinations whose rate says they
+ * are due, build one datagram each into a batch, and hand each socket
+ * its whole batch with one sendmmsg(). sendmmsg() stops at the first
+ * message that fails; a full send buffer (EAGAIN/ENOBUFS) fails the rest
+ * of the batch as well, so they are all counted as dropped, while any
+ * other error is charged to that one destination and the batch resumes
+ * after it.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include "pose_udp.h"
+
+#define STAT_INC(x)     __atomic_fetch_add(&(x), 1, __ATOMIC_RELAXED)
+#define STAT_LOAD(x)    __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+enum { FAM_V4, FAM_V6, FAM_COUNT };
+
+_Static_assert(sizeof(pose_udp_packet_t) == 80, "wire format changed: bump version");
+
+const char *const pose_udp_format_names[POSE_UDP_FORMAT_COUNT] = {
+    [POSE_UDP_OPENTRACK] = "opentrack",
+    [POSE_UDP_SQUIG]     = "squig",
+};
+
+typedef struct {
+    pose_udp_stats_t        st;         /* counters written with STAT_INC */
+    struct sockaddr_storage addr;
+    socklen_t               addr_len;
+    int                     fam;
+    uint64_t                interval_ns;    /* 0 = every pose */
+    uint64_t                next_ns;        /* 0 = nothing sent yet */
+    uint64_t                seq;
+} dest_t;
+
+struct pose_udp {
+    dest_t d[POSE_UDP_MAX_DEST];
+    int    n;
+    int    fd[FAM_COUNT];
+};
+
+typedef union {
+    double            opentrack[6];
+    pose_udp_packet_t squig;
+} payload_t;
+
+pose_udp_t *pose_udp_create(void)
+{
+    pose_udp_t *u = calloc(1, sizeof(*u));
+    if (!u) return NULL;
+    for (int f = 0; f < FAM_COUNT; f++) u->fd[f] = -1;
+    return u;
+}
+
+/* ── Destinations ───────────────────────────────────────────────────── */
+
+static int parse_spec(const char *spec, char *host, size_t host_len, char *port,
+                      size_t port_len, double *hz, int *format)
+{
+    char buf[160];
+    snprintf(buf, sizeof(buf), "%s", spec);
+    *hz = 0;
+    *format = POSE_UDP_OPENTRACK;
+    snprintf(port, port_len, "%d", POSE_UDP_PORT);
+
+    char *s = strchr(buf, '/');
+    if (s) {
+        *s++ = 0;
+        int f;
+        for (f = 0; f < POSE_UDP_FORMAT_COUNT; f++)
+            if (!strcmp(s, pose_udp_format_names[f])) break;
+        if (f == POSE_UDP_FORMAT_COUNT) return -1;
+        *format = f;
+    }
+    if ((s = strchr(buf, '@'))) {
+        *s++ = 0;
+        char *end;
+        *hz = strtod(s, &end);
+        if (*end || *hz < 0) return -1;
+    }
+
+    char *h = buf, *p = NULL;
+    if (*h == '[') {                            /* [v6]:port */
+        h++;
+        if (!(s = strchr(h, ']'))) return -1;
+        *s++ = 0;
+        if (*s == ':') p = s + 1;
+        else if (*s) return -1;
+    } else if ((s = strchr(h, ':')) && !strchr(s + 1, ':')) {
+        *s = 0;                                 /* host:port (a bare v6 has several) */
+        p = s + 1;
+    }
+    if (!*h) return -1;
+    if (p) {
+        char *end;
+        long v = strtol(p, &end, 10);
+        if (*end || v < 1 || v > 65535) return -1;
+        snprintf(port, port_len, "%ld", v);
+    }
+    snprintf(host, host_len, "%s", h);
+    return 0;
+}
+
+int pose_udp_add(pose_udp_t *u, const char *spec)
+{
+    if (u->n >= POSE_UDP_MAX_DEST) {
+        fprintf(stderr, "[UDP] More than %d destinations\n", POSE_UDP_MAX_DEST);
+        return -1;
+    }
+    char host[160], port[8];
+    double hz;
+    int format;
+    if (parse_spec(spec, host, sizeof(host), port, sizeof(port), &hz, &format) < 0) {
+        fprintf(stderr, "[UDP] Bad destination '%s' (HOST[:PORT][@HZ][/opentrack|squig])\n", spec);
+        return -1;
+    }
+
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_DGRAM,
+                              .ai_flags = AI_NUMERICSERV | AI_ADDRCONFIG };
+    struct addrinfo *ai = NULL;
+    int gai = getaddrinfo(host, port, &hints, &ai);
+    if (gai) {
+        fprintf(stderr, "[UDP] %s: %s\n", host, gai_strerror(gai));
+        return -1;
+    }
+    int fam = ai->ai_family == AF_INET6 ? FAM_V6 : FAM_V4;
+    if (u->fd[fam] < 0) {
+        u->fd[fam] = socket(ai->ai_family, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (u->fd[fam] < 0) {
+            fprintf(stderr, "[UDP] socket: %s\n", strerror(errno));
+            freeaddrinfo(ai);
+            return -1;
+        }
+    }
+
+    dest_t *d = &u->d[u->n];
+    memset(d, 0, sizeof(*d));
+    memcpy(&d->addr, ai->ai_addr, ai->ai_addrlen);
+    d->addr_len = ai->ai_addrlen;
+    d->fam = fam;
+    d->interval_ns = hz > 0 ? (uint64_t)(1e9 / hz) : 0;
+    snprintf(d->st.name, sizeof(d->st.name), "%s", spec);
+    d->st.format = format;
+    d->st.rate_hz = hz;
+    freeaddrinfo(ai);
+
+    char shown[NI_MAXHOST];
+    if (getnameinfo((struct sockaddr *)&d->addr, d->addr_len, shown, sizeof(shown),
+                    NULL, 0, NI_NUMERICHOST))
+        snprintf(shown, sizeof(shown), "%s", host);
+    if (hz > 0)
+        printf("[UDP] -> %s port %s, %s, %.1f Hz\n", shown, port, pose_udp_format_names[format], hz);
+    else
+        printf("[UDP] -> %s port %s, %s, every pose\n", shown, port, pose_udp_format_names[format]);
+    return u->n++;
+}
+
+int pose_udp_add_file(pose_udp_t *u, const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "[UDP] %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    char line[256];
+    int added = 0, lineno = 0;
+    while (fgets(line, sizeof(line), f)) {
+        lineno++;
+        char *c = strchr(line, '#');
+        if (c) *c = 0;
+        char *s = line;
+        while (*s == ' ' || *s == '\t') s++;
+        char *e = s + strlen(s);
+        while (e > s && (e[-1] == ' ' || e[-1] == '\t' || e[-1] == '\n' || e[-1] == '\r')) *--e = 0;
+        if (!*s) continue;
+        if (pose_udp_add(u, s) < 0) {
+            fprintf(stderr, "[UDP] %s:%d: destination not added\n", path, lineno);
+            fclose(f);
+            return -1;
+        }
+        added++;
+    }
+    fclose(f);
+    return added;
+}
+
+int pose_udp_count(const pose_udp_t *u)
+{
+    return u->n;
+}
+
+/* ── Sending ────────────────────────────────────────────────────────── */
+
+/* Rate decision for one destination. A quarter-interval of slack keeps a
+ * jittery 90 Hz source from beating against a 30 Hz limit (every third
+ * pose, not every third or fourth); the schedule keeps its phase unless
+ * the stream stalled for longer than an interval. */
+static int dest_due(dest_t *d, uint64_t t_ns)
+{
+    if (!d->interval_ns) return 1;
+    if (d->next_ns && t_ns + d->interval_ns / 4 < d->next_ns) return 0;
+    if (d->next_ns && t_ns < d->next_ns + d->interval_ns) d->next_ns += d->interval_ns;
+    else d->next_ns = t_ns + d->interval_ns;
+    return 1;
+}
+
+static size_t build_payload(dest_t *d, const pose_udp_pose_t *p, payload_t *out)
+{
+    if (d->st.format == POSE_UDP_OPENTRACK) {
+        /* opentrack: centimetres, then yaw, pitch, roll in degrees */
+        out->opentrack[0] = p->x / 10.0;
+        out->opentrack[1] = p->y / 10.0;
+        out->opentrack[2] = p->z / 10.0;
+        out->opentrack[3] = p->yaw;
+        out->opentrack[4] = p->pitch;
+        out->opentrack[5] = p->roll;
+        return sizeof(out->opentrack);
+    }
+    pose_udp_packet_t *k = &out->squig;
+    k->magic = POSE_UDP_MAGIC;
+    k->version = 1;
+    k->size = sizeof(*k);
+    k->seq = d->seq++;
+    k->timestamp_us = p->timestamp_us;
+    k->x = p->x;
+    k->y = p->y;
+    k->z = p->z;
+    k->yaw = p->yaw;
+    k->pitch = p->pitch;
+    k->roll = p->roll;
+    k->confidence = p->confidence;
+    k->flags = p->flags;
+    return sizeof(*k);
+}
+
+static int send_batch(int fd, struct mmsghdr *msg, dest_t **who, int n)
+{
+    int sent = 0, off = 0;
+    while (off < n) {
+        int r = sendmmsg(fd, msg + off, (unsigned)(n - off), MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (r > 0) {
+            for (int i = 0; i < r; i++) STAT_INC(who[off + i]->st.sent);
+            sent += r;
+            off += r;
+            continue;
+        }
+        if (r < 0 && errno == EINTR) continue;
+        if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == ENOBUFS)) {
+            for (; off < n; off++) STAT_INC(who[off]->st.dropped);
+            break;
+        }
+        STAT_INC(who[off]->st.errors);
+        off++;
+    }
+    return sent;
+}
+
+_Static_assert(sizeof(((pose_udp_batch_t *)0)->data[0]) >= sizeof(payload_t), "batch slot too small");
+
+int pose_udp_prepare(pose_udp_t *u, const pose_udp_pose_t *p, uint64_t t_ns,
+                     pose_udp_batch_t *b)
+{
+    b->n = 0;
+    for (int i = 0; i < u->n; i++) {
+        dest_t *d = &u->d[i];
+        if (!dest_due(d, t_ns)) continue;
+        b->dest[b->n] = (uint8_t)i;
+        b->len[b->n] = (uint8_t)build_payload(d, p, (payload_t *)b->data[b->n]);
+        b->n++;
+    }
+    return b->n;
+}
+
+int pose_udp_flush(pose_udp_t *u, const pose_udp_batch_t *b)
+{
+    struct iovec   iov[POSE_UDP_MAX_DEST];
+    struct mmsghdr msg[FAM_COUNT][POSE_UDP_MAX_DEST];
+    dest_t        *who[FAM_COUNT][POSE_UDP_MAX_DEST];
+    int            cnt[FAM_COUNT] = { 0 };
+
+    for (int j = 0; j < b->n; j++) {
+        dest_t *d = &u->d[b->dest[j]];
+        iov[j].iov_base = (void *)b->data[j];
+        iov[j].iov_len = b->len[j];
+        int k = cnt[d->fam]++;
+        memset(&msg[d->fam][k], 0, sizeof(msg[d->fam][k]));
+        msg[d->fam][k].msg_hdr.msg_name = &d->addr;
+        msg[d->fam][k].msg_hdr.msg_namelen = d->addr_len;
+        msg[d->fam][k].msg_hdr.msg_iov = &iov[j];
+        msg[d->fam][k].msg_hdr.msg_iovlen = 1;
+        who[d->fam][k] = d;
+    }
+
+    int sent = 0;
+    for (int f = 0; f < FAM_COUNT; f++)
+        if (cnt[f]) sent += send_batch(u->fd[f], msg[f], who[f], cnt[f]);
+    return sent;
+}
+
+int pose_udp_send(pose_udp_t *u, const pose_udp_pose_t *p, uint64_t t_ns)
+{
+    pose_udp_batch_t b;
+    pose_udp_prepare(u, p, t_ns, &b);
+    return pose_udp_flush(u, &b);
+}
+
+void pose_udp_get_stats(const pose_udp_t *u, int i, pose_udp_stats_t *out)
+{
+    const dest_t *d = &u->d[i];
+    memcpy(out->name, d->st.name, sizeof(out->name));
+    out->format  = d->st.format;
+    out->rate_hz = d->st.rate_hz;
+    out->sent    = STAT_LOAD(d->st.sent);
+    out->dropped = STAT_LOAD(d->st.dropped);
+    out->errors  = STAT_LOAD(d->st.errors);
+}
+
+void pose_udp_destroy(pose_udp_t *u)
+{
+    if (!u) return;
+    for (int f = 0; f < FAM_COUNT; f++)
+        if (u->fd[f] >= 0) close(u->fd[f]);
+    free(u);
+}
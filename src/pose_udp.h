@@ -0,0 +1,125 @@
+/*
+ * pose_udp.h — Non-blocking UDP pose fan-out (opentrack + extended)
+ *
+ * Sends each pose to any number of destinations, each with its own rate
+ * and packet format:
+ *
+ *   opentrack   6 × double: x, y, z (cm), yaw, pitch, roll (degrees) —
+ *               opentrack's "UDP over network" input, port 4242
+ *   squig       pose_udp_packet_t: the same plus timestamp_us, sequence,
+ *               confidence and flags, for loggers and our own tools
+ *
+ * All destinations due for a pose go out in one sendmmsg() per socket
+ * (one for IPv4, one for IPv6), not one sendto() each. The sockets are
+ * non-blocking: when the kernel queue is full the datagram is dropped and
+ * counted rather than stalling the caller, which is the filter thread.
+ * Rates are decimated per destination against the pose timestamps, so a
+ * 30 Hz logger gets every third pose of a 90 Hz stream.
+ *
+ *   pose_udp_t *u = pose_udp_create();
+ *   pose_udp_add(u, "127.0.0.1");                  // opentrack, :4242, every pose
+ *   pose_udp_add(u, "sim-pc:5005@60");
+ *   pose_udp_add(u, "[fd00::7]:6000@30/squig");
+ *   pose_udp_send(u, &pose, t_ns);
+ *
+ * pose_udp_send() is pose_udp_prepare() then pose_udp_flush(). Several
+ * producers sharing one sender serialise only the prepare step (it
+ * advances the rate and sequence state) and flush their batches after
+ * dropping their lock; two such batches may then leave in either order.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_POSE_UDP_H
+#define SQUIG_POSE_UDP_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define POSE_UDP_PORT       4242        /* opentrack default */
+#define POSE_UDP_MAX_DEST   16
+#define POSE_UDP_MAGIC      0x50515153u /* "SQQP" */
+
+enum {
+    POSE_UDP_OPENTRACK = 0,
+    POSE_UDP_SQUIG,
+    POSE_UDP_FORMAT_COUNT
+};
+
+/* One pose as the sender takes it */
+typedef struct {
+    double   x, y, z;           /* mm */
+    double   yaw, pitch, roll;  /* degrees */
+    int64_t  timestamp_us;      /* Stream Engine time of the source sample */
+    float    confidence;
+    uint32_t flags;             /* POSE_SHM_F_* */
+} pose_udp_pose_t;
+
+/* POSE_UDP_SQUIG wire format (little-endian) */
+typedef struct __attribute__((packed)) {
+    uint32_t magic;             /* POSE_UDP_MAGIC */
+    uint16_t version;           /* 1 */
+    uint16_t size;              /* sizeof(pose_udp_packet_t) */
+    uint64_t seq;               /* per destination, from 0; gaps = loss */
+    int64_t  timestamp_us;
+    double   x, y, z;           /* mm */
+    double   yaw, pitch, roll;  /* degrees */
+    float    confidence;
+    uint32_t flags;
+} pose_udp_packet_t;
+
+/* The datagrams one pose owes its due destinations */
+typedef struct {
+    int      n;
+    uint8_t  dest[POSE_UDP_MAX_DEST];           /* destination index */
+    uint8_t  len[POSE_UDP_MAX_DEST];
+    uint8_t  data[POSE_UDP_MAX_DEST][sizeof(pose_udp_packet_t)] __attribute__((aligned(8)));
+} pose_udp_batch_t;
+
+typedef struct {
+    char     name[96];          /* as given to pose_udp_add() */
+    int      format;
+    double   rate_hz;           /* 0 = every pose */
+    uint64_t sent;              /* datagrams the kernel accepted */
+    uint64_t dropped;           /* socket buffer full (EAGAIN/ENOBUFS) */
+    uint64_t errors;            /* other send errors (unreachable, ...) */
+} pose_udp_stats_t;
+
+extern const char *const pose_udp_format_names[POSE_UDP_FORMAT_COUNT];
+
+typedef struct pose_udp pose_udp_t;
+
+pose_udp_t *pose_udp_create(void);
+
+/* Add a destination: HOST[:PORT][@HZ][/FORMAT], IPv6 hosts in brackets.
+ * PORT defaults to 4242, HZ to every pose, FORMAT to opentrack. Resolves
+ * now. Returns the destination index, or -1 with a message. */
+int pose_udp_add(pose_udp_t *u, const char *spec);
+
+/* Add every destination listed in a file: one spec per line, '#' starts
+ * a comment. Returns the number added, or -1 on the first bad line. */
+int pose_udp_add_file(pose_udp_t *u, const char *path);
+
+int pose_udp_count(const pose_udp_t *u);
+
+/* Send p to every destination that is due at t_ns (the pose's time, any
+ * monotonic clock). One caller at a time; never blocks. Returns the
+ * number of datagrams accepted by the kernel. */
+int pose_udp_send(pose_udp_t *u, const pose_udp_pose_t *p, uint64_t t_ns);
+
+/* Build p's datagrams for every destination due at t_ns into b, without
+ * sending. Callers must serialise this. Returns b->n. */
+int pose_udp_prepare(pose_udp_t *u, const pose_udp_pose_t *p, uint64_t t_ns,
+                     pose_udp_batch_t *b);
+
+/* Send a prepared batch (any thread, concurrently with other flushes).
+ * Never blocks. Returns the number of datagrams accepted by the kernel. */
+int pose_udp_flush(pose_udp_t *u, const pose_udp_batch_t *b);
+
+/* Counters of destination i (any thread). */
+void pose_udp_get_stats(const pose_udp_t *u, int i, pose_udp_stats_t *out);
+
+void pose_udp_destroy(pose_udp_t *u);
+
+#endif /* SQUIG_POSE_UDP_H */
@@ -0,0 +1,134 @@
+/*
+ * presence_gate.h — Park the tracking pipeline while the user is away
+ *
+ * Stream Engine's user_presence stream (~10 Hz, present / away) decides
+ * whether there is anyone to track. The acquisition thread feeds every
+ * status in from its callback and polls the gate after each pump; once
+ * AWAY has held for away_ms with no PRESENT in between, the gate closes:
+ * the acquisition thread unsubscribes the gaze streams (se_session_pause),
+ * so it only wakes for presence updates, and the filter threads park on
+ * the gate's futex word instead of timing out on their rings every
+ * 200 ms. The first PRESENT opens it again straight away and wakes them.
+ *
+ * Going away is debounced (a blink or a glance at a phone is not a
+ * departure); coming back is not — the first sample after a return is
+ * the one that matters.
+ *
+ *   presence_gate_t g;
+ *   presence_gate_init(&g, NULL);
+ *   presence_gate_report(&g, status, now_ns);    // presence callback
+ *   switch (presence_gate_poll(&g, now_ns)) {    // same thread, after each pump
+ *   case PRESENCE_GATE_LEFT:     se_session_pause(s, 1); break;
+ *   case PRESENCE_GATE_RETURNED: se_session_pause(s, 0); break;
+ *   }
+ *   if (presence_gate_park(&g, &stopping)) ...;  // worker: slept while away
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_PRESENCE_GATE_H
+#define SQUIG_PRESENCE_GATE_H
+
+#include <limits.h>
+#include <stdint.h>
+#include <string.h>
+#include "spsc_ring.h"          /* spsc_futex() */
+#include "se_session.h"
+
+typedef struct {
+    int64_t away_ms;            /* AWAY held this long closes the gate */
+    int     park_ms;            /* a parked worker rechecks its stop flag this often */
+} presence_gate_config_t;
+
+#define PRESENCE_GATE_DEFAULTS { 3000, 1000 }
+
+/* presence_gate_t.state */
+enum { PRESENCE_GATE_OPEN, PRESENCE_GATE_CLOSED };
+
+/* presence_gate_poll() */
+enum { PRESENCE_GATE_NONE, PRESENCE_GATE_LEFT, PRESENCE_GATE_RETURNED };
+
+typedef struct {
+    presence_gate_config_t cfg;
+    /* Reporting thread only (the callback and the poll share it) */
+    int      status;            /* last tobii_user_presence_status_t */
+    int64_t  away_since_ns;     /* start of the current AWAY run, 0 = none */
+    int64_t  left_ns;           /* when the gate closed */
+    /* Shared: the futex word and the waiters on it */
+    uint32_t state;             /* PRESENCE_GATE_OPEN / CLOSED */
+    uint32_t waiting;
+    /* Counters (reporting thread writes, anyone reads) */
+    uint64_t departures;
+    uint64_t returns;
+    int64_t  away_ns;           /* time closed, closed periods that ended */
+} presence_gate_t;
+
+static inline void presence_gate_init(presence_gate_t *g, const presence_gate_config_t *cfg)
+{
+    const presence_gate_config_t def = PRESENCE_GATE_DEFAULTS;
+    memset(g, 0, sizeof(*g));
+    g->cfg = cfg ? *cfg : def;
+}
+
+/* One user_presence status, with the host time it was handled at. */
+static inline void presence_gate_report(presence_gate_t *g, int status, int64_t now_ns)
+{
+    g->status = status;
+    if (status != TOBII_USER_PRESENCE_STATUS_AWAY) g->away_since_ns = 0;  /* unknown: stay open */
+    else if (!g->away_since_ns) g->away_since_ns = now_ns;
+}
+
+/* Apply what has been reported; returns PRESENCE_GATE_LEFT when the gate
+ * just closed, PRESENCE_GATE_RETURNED when it just opened (parked
+ * workers are woken), else PRESENCE_GATE_NONE. */
+static inline int presence_gate_poll(presence_gate_t *g, int64_t now_ns)
+{
+    uint32_t state = __atomic_load_n(&g->state, __ATOMIC_RELAXED);
+    if (state == PRESENCE_GATE_OPEN) {
+        if (!g->away_since_ns || now_ns - g->away_since_ns < g->cfg.away_ms * 1000000LL)
+            return PRESENCE_GATE_NONE;
+        g->left_ns = now_ns;
+        __atomic_store_n(&g->state, PRESENCE_GATE_CLOSED, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&g->departures, 1, __ATOMIC_RELAXED);
+        return PRESENCE_GATE_LEFT;
+    }
+    if (g->away_since_ns) return PRESENCE_GATE_NONE;
+    __atomic_fetch_add(&g->away_ns, now_ns - g->left_ns, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g->returns, 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&g->state, PRESENCE_GATE_OPEN, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&g->waiting, __ATOMIC_RELAXED))
+        spsc_futex(&g->state, FUTEX_WAKE_PRIVATE, INT_MAX, NULL);
+    return PRESENCE_GATE_RETURNED;
+}
+
+/* Nonzero while the gate is closed (any thread). */
+static inline int presence_gate_closed(const presence_gate_t *g)
+{
+    return __atomic_load_n(&g->state, __ATOMIC_ACQUIRE) == PRESENCE_GATE_CLOSED;
+}
+
+/* Worker: sleep while the gate is closed, until it opens or *stop is
+ * set. Returns 1 if it slept (the world moved on meanwhile), 0 if the
+ * gate was open. */
+static inline int presence_gate_park(presence_gate_t *g, const int *stop)
+{
+    if (!presence_gate_closed(g)) return 0;
+    __atomic_fetch_add(&g->waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    while (presence_gate_closed(g) && !__atomic_load_n(stop, __ATOMIC_ACQUIRE)) {
+        struct timespec ts = { g->cfg.park_ms / 1000, (long)(g->cfg.park_ms % 1000) * 1000000L };
+        spsc_futex(&g->state, FUTEX_WAIT_PRIVATE, PRESENCE_GATE_CLOSED, &ts);
+    }
+    __atomic_fetch_sub(&g->waiting, 1, __ATOMIC_RELAXED);
+    return 1;
+}
+
+/* Wake parked workers so they look at their stop flag (shutdown). */
+static inline void presence_gate_wake(presence_gate_t *g)
+{
+    spsc_futex(&g->state, FUTEX_WAKE_PRIVATE, INT_MAX, NULL);
+}
+
+#endif /* SQUIG_PRESENCE_GATE_H */
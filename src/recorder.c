@@ -0,0 +1,286 @@
+/*
+ * recorder.c — Long-duration IR recording on a background writer thread
+ *
+ * See recorder.h. Threading model:
+ *
+ *   producer   recorder_submit(): slot from the recorder's frame_pool,
+ *              memcpy, SPSC push (no locks, no syscalls on the fast path)
+ *   writer     SPSC pop → rotate if due → capfile_write → frame_unref
+ *
+ * The slot pool is the back-pressure: its size is the most the writer can
+ * fall behind before frames are dropped.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "recorder.h"
+#include "spsc_ring.h"
+
+#define STAT_INC(x)     __atomic_fetch_add(&(x), 1, __ATOMIC_RELAXED)
+#define STAT_ADD(x, v)  __atomic_fetch_add(&(x), (v), __ATOMIC_RELAXED)
+#define STAT_LOAD(x)    __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+/* After a failed write, wait this long before trying a new file */
+#define RETRY_NS        1000000000ull
+
+struct recorder {
+    recorder_config_t cfg;
+    char              prefix[224];
+    uint8_t           probe[CAPFILE_PROBE_MAX];
+
+    frame_pool_t     *pool;
+    spsc_ring_t       ring;
+    pthread_t         thread;
+    int               stopping;
+    int               failed;
+
+    /* Writer thread only */
+    capfile_writer_t *w;
+    uint64_t          file_t0_ns;   /* capture time of the file's first frame */
+    uint64_t          retry_ns;     /* no new file before this */
+    uint32_t          file_no;
+
+    /* Current path (writer updates, recorder_current_file() reads) */
+    pthread_mutex_t   path_lock;
+    char              path[256];
+
+    recorder_stats_t  stats;
+};
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* ── Writer thread ──────────────────────────────────────────────────── */
+
+static void close_file(recorder_t *r)
+{
+    if (!r->w) return;
+    uint64_t frames = capfile_writer_frames(r->w);
+    uint64_t bytes = capfile_writer_bytes(r->w);
+    if (capfile_close(r->w) < 0) r->failed = 1;
+    r->w = NULL;
+    printf("[REC] Closed %s: %llu frames, %.1f MB\n", r->path,
+           (unsigned long long)frames, bytes / 1048576.0);
+}
+
+static int open_file(recorder_t *r, const frame_t *first)
+{
+    char path[sizeof(r->path)];
+    snprintf(path, sizeof(path), "%s-%04u.sqcap", r->prefix, r->file_no);
+    capfile_writer_t *w = capfile_create(path, r->cfg.probe_len ? r->probe : NULL,
+                                         r->cfg.probe_len, r->cfg.frame_size);
+    if (!w) return -1;
+    if (capfile_writer_set_codec(w, r->cfg.codec, r->cfg.level) < 0) {
+        capfile_close(w);
+        return -1;
+    }
+    pthread_mutex_lock(&r->path_lock);
+    memcpy(r->path, path, sizeof(path));
+    pthread_mutex_unlock(&r->path_lock);
+    r->w = w;
+    r->file_no++;
+    r->file_t0_ns = first->t_first_ns;
+    STAT_INC(r->stats.files);
+    return 0;
+}
+
+static int rotation_due(const recorder_t *r, const frame_t *f)
+{
+    const recorder_config_t *c = &r->cfg;
+    if (c->max_file_bytes &&
+        capfile_writer_bytes(r->w) + f->len + sizeof(capfile_rec_t) > c->max_file_bytes)
+        return capfile_writer_frames(r->w) > 0;     /* one frame per file at least */
+    if (c->max_file_secs && f->t_first_ns > r->file_t0_ns &&
+        f->t_first_ns - r->file_t0_ns >= (uint64_t)c->max_file_secs * 1000000000ull)
+        return 1;
+    return 0;
+}
+
+static void write_frame(recorder_t *r, frame_t *f)
+{
+    if (r->w && rotation_due(r, f)) close_file(r);
+    if (!r->w) {
+        if (now_ns() < r->retry_ns || open_file(r, f) < 0) {
+            r->retry_ns = now_ns() + RETRY_NS;
+            r->failed = 1;
+            STAT_INC(r->stats.drop_error);
+            return;
+        }
+    }
+
+    uint64_t before = capfile_writer_bytes(r->w);
+    if (capfile_write(r->w, f) < 0) {
+        /* Disk full / I/O error: keep what is on disk, try again later */
+        STAT_INC(r->stats.drop_error);
+        close_file(r);
+        r->failed = 1;
+        r->retry_ns = now_ns() + RETRY_NS;
+        return;
+    }
+    STAT_INC(r->stats.written);
+    STAT_ADD(r->stats.bytes_raw, f->len);
+    STAT_ADD(r->stats.bytes_disk, capfile_writer_bytes(r->w) - before);
+}
+
+static void *writer_thread(void *arg)
+{
+    recorder_t *r = arg;
+    for (;;) {
+        frame_t *f;
+        if (spsc_ring_pop_wait(&r->ring, &f, 200) < 0) {
+            if (__atomic_load_n(&r->stopping, __ATOMIC_ACQUIRE) && spsc_ring_count(&r->ring) == 0)
+                break;
+            continue;
+        }
+        write_frame(r, f);
+        frame_unref(f);
+    }
+    close_file(r);
+    return NULL;
+}
+
+/* ── Producer side ──────────────────────────────────────────────────── */
+
+int recorder_submit(recorder_t *r, const frame_t *f)
+{
+    STAT_INC(r->stats.submitted);
+    if (f->len > r->cfg.slot_size) {
+        STAT_INC(r->stats.drop_toobig);
+        return -1;
+    }
+    frame_t *c = frame_pool_get(r->pool);
+    if (!c) {
+        STAT_INC(r->stats.drop_nobuf);
+        return -1;
+    }
+    memcpy(c->data, f->data, f->len);
+    c->len        = f->len;
+    c->fid        = f->fid;
+    c->flags      = f->flags;
+    c->npayloads  = f->npayloads;
+    c->seq        = f->seq;
+    c->t_first_ns = f->t_first_ns;
+    c->t_last_ns  = f->t_last_ns;
+    c->stats      = f->stats;
+
+    if (spsc_ring_push(&r->ring, &c) < 0) {     /* ring >= slots: not reached */
+        frame_unref(c);
+        STAT_INC(r->stats.drop_nobuf);
+        return -1;
+    }
+    uint32_t depth = spsc_ring_count(&r->ring);
+    if (depth > r->stats.queue_max) __atomic_store_n(&r->stats.queue_max, depth, __ATOMIC_RELAXED);
+    return 0;
+}
+
+void recorder_tap(void *r, const frame_t *f)
+{
+    recorder_submit(r, f);
+}
+
+/* ── Lifecycle ──────────────────────────────────────────────────────── */
+
+recorder_t *recorder_start(const recorder_config_t *cfg)
+{
+    recorder_config_t def = RECORDER_DEFAULTS;
+    if (!cfg) cfg = &def;
+    if (!capfile_codec_supported(cfg->codec)) {
+        fprintf(stderr, "[REC] Codec %s not compiled in\n",
+                cfg->codec >= 0 && cfg->codec < CAPFILE_CODEC_COUNT
+                    ? capfile_codec_names[cfg->codec] : "?");
+        return NULL;
+    }
+
+    recorder_t *r = calloc(1, sizeof(*r));
+    if (!r) return NULL;
+    r->cfg = *cfg;
+    if (r->cfg.buffer_frames < 2) r->cfg.buffer_frames = 2;
+    snprintf(r->prefix, sizeof(r->prefix), "%s", cfg->prefix ? cfg->prefix : def.prefix);
+    r->cfg.prefix = r->prefix;
+    if (r->cfg.probe_len > CAPFILE_PROBE_MAX) r->cfg.probe_len = CAPFILE_PROBE_MAX;
+    if (cfg->probe) memcpy(r->probe, cfg->probe, r->cfg.probe_len);
+    else r->cfg.probe_len = 0;
+    r->cfg.probe = r->probe;
+
+    r->pool = frame_pool_create(r->cfg.buffer_frames, r->cfg.slot_size);
+    if (!r->pool || spsc_ring_init(&r->ring, (uint32_t)r->cfg.buffer_frames, sizeof(frame_t *)) < 0) {
+        fprintf(stderr, "[REC] Cannot allocate %d x %u byte buffers\n",
+                r->cfg.buffer_frames, r->cfg.slot_size);
+        frame_pool_destroy(r->pool);
+        free(r);
+        return NULL;
+    }
+    pthread_mutex_init(&r->path_lock, NULL);
+    snprintf(r->path, sizeof(r->path), "%s-%04u.sqcap", r->prefix, 0u);
+
+    if (pthread_create(&r->thread, NULL, writer_thread, r) != 0) {
+        perror("[REC] pthread_create");
+        pthread_mutex_destroy(&r->path_lock);
+        spsc_ring_free(&r->ring);
+        frame_pool_destroy(r->pool);
+        free(r);
+        return NULL;
+    }
+    printf("[REC] Recording to %s-NNNN.sqcap (%d x %u KB buffer, codec %s",
+           r->prefix, r->cfg.buffer_frames, r->cfg.slot_size >> 10,
+           capfile_codec_names[r->cfg.codec]);
+    if (r->cfg.max_file_bytes) printf(", rotate at %llu MB", (unsigned long long)(r->cfg.max_file_bytes >> 20));
+    if (r->cfg.max_file_secs)  printf(", rotate every %u s", r->cfg.max_file_secs);
+    printf(")\n");
+    return r;
+}
+
+void recorder_get_stats(const recorder_t *r, recorder_stats_t *out)
+{
+    out->submitted   = STAT_LOAD(r->stats.submitted);
+    out->written     = STAT_LOAD(r->stats.written);
+    out->drop_nobuf  = STAT_LOAD(r->stats.drop_nobuf);
+    out->drop_toobig = STAT_LOAD(r->stats.drop_toobig);
+    out->drop_error  = STAT_LOAD(r->stats.drop_error);
+    out->bytes_raw   = STAT_LOAD(r->stats.bytes_raw);
+    out->bytes_disk  = STAT_LOAD(r->stats.bytes_disk);
+    out->files       = STAT_LOAD(r->stats.files);
+    out->queue_max   = STAT_LOAD(r->stats.queue_max);
+    out->queued      = (int)spsc_ring_count(&r->ring);
+}
+
+void recorder_current_file(recorder_t *r, char *buf, size_t n)
+{
+    pthread_mutex_lock(&r->path_lock);
+    snprintf(buf, n, "%s", r->path);
+    pthread_mutex_unlock(&r->path_lock);
+}
+
+int recorder_stop(recorder_t *r)
+{
+    if (!r) return 0;
+    __atomic_store_n(&r->stopping, 1, __ATOMIC_RELEASE);
+    spsc_ring_wake(&r->ring);
+    pthread_join(r->thread, NULL);
+
+    recorder_stats_t s;
+    recorder_get_stats(r, &s);
+    printf("[REC] %llu of %llu frames written in %u file(s), %.1f MB on disk "
+           "(%.1f MB raw); dropped: nobuf=%llu toobig=%llu error=%llu; max backlog %u\n",
+           (unsigned long long)s.written, (unsigned long long)s.submitted, s.files,
+           s.bytes_disk / 1048576.0, s.bytes_raw / 1048576.0,
+           (unsigned long long)s.drop_nobuf, (unsigned long long)s.drop_toobig,
+           (unsigned long long)s.drop_error, s.queue_max);
+
+    int rc = r->failed ? -1 : 0;
+    pthread_mutex_destroy(&r->path_lock);
+    spsc_ring_free(&r->ring);
+    frame_pool_destroy(r->pool);
+    free(r);
+    return rc;
+}
@@ -0,0 +1,90 @@
+/*
+ * recorder.h — Long-duration IR recording on a background writer thread
+ *
+ * recorder_submit() is called by the producer (normally the capture
+ * engine's event thread, through uvc_capture_config_t.tap) for every
+ * finished frame. It copies the frame into one of the recorder's own
+ * preallocated slots and pushes it onto a lock-free SPSC ring — it never
+ * blocks and never holds a capture-pool slot, so a slow or stalled disk
+ * cannot hold up USB reads. A dedicated writer thread drains the ring into
+ * .sqcap files (capture_file.h), optionally compressing each frame, and
+ * starts a new file when the current one reaches a size or age limit.
+ *
+ * When the writer falls behind, the slots run out and frames are dropped
+ * at submit time; every drop is counted (recorder_stats_t) and the gap is
+ * visible in the recorded sequence numbers.
+ *
+ *   recorder_config_t rc = RECORDER_DEFAULTS;
+ *   rc.prefix = "/data/ir/night";               // night-0000.sqcap, ...
+ *   rc.max_file_bytes = 2ull << 30;
+ *   recorder_t *rec = recorder_start(&rc);
+ *   ccfg.tap = recorder_tap; ccfg.tap_arg = rec;
+ *   ...
+ *   recorder_stop(rec);                         // drains, closes the file
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_RECORDER_H
+#define SQUIG_RECORDER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "frame_pool.h"
+#include "capture_file.h"
+
+typedef struct {
+    const char *prefix;         /* files are <prefix>-NNNN.sqcap */
+    uint64_t    max_file_bytes; /* rotate at this size (0 = never) */
+    uint32_t    max_file_secs;  /* rotate at this age (0 = never) */
+    int         codec;          /* CAPFILE_CODEC_* */
+    int         level;          /* codec level (0 = default) */
+    int         buffer_frames;  /* slots between submit and the disk */
+    uint32_t    slot_size;      /* largest frame recorded */
+    const void *probe;          /* committed UVC probe for the headers */
+    uint32_t    probe_len;
+    uint32_t    frame_size;     /* negotiated frame size for the headers */
+} recorder_config_t;
+
+#define RECORDER_DEFAULTS { "/tmp/tobii_rec", 0, 0, CAPFILE_CODEC_NONE, 0, \
+                            64, 1024 * 1024, NULL, 0, 0 }
+
+typedef struct {
+    uint64_t submitted;         /* frames offered */
+    uint64_t written;           /* frames in files */
+    uint64_t drop_nobuf;        /* dropped: writer behind, no free slot */
+    uint64_t drop_toobig;       /* dropped: larger than slot_size */
+    uint64_t drop_error;        /* dropped: write failed */
+    uint64_t bytes_raw;         /* frame bytes written (before codec) */
+    uint64_t bytes_disk;        /* file bytes (after codec, incl. headers) */
+    uint32_t files;             /* files opened so far */
+    uint32_t queue_max;         /* deepest backlog seen, in frames */
+    int      queued;            /* backlog right now */
+} recorder_stats_t;
+
+typedef struct recorder recorder_t;
+
+/* Allocate the slots, open the first file and start the writer thread.
+ * Returns NULL with a message on failure (including an unsupported
+ * codec). */
+recorder_t *recorder_start(const recorder_config_t *cfg);
+
+/* Queue a copy of f. Single producer thread; wait-free. Returns 0, or -1
+ * if the frame was dropped (counted). */
+int recorder_submit(recorder_t *r, const frame_t *f);
+
+/* recorder_submit() with the uvc_capture_config_t.tap signature. */
+void recorder_tap(void *r, const frame_t *f);
+
+void recorder_get_stats(const recorder_t *r, recorder_stats_t *out);
+
+/* Copy the path of the file being written (for status lines). */
+void recorder_current_file(recorder_t *r, char *buf, size_t n);
+
+/* Write out the backlog, close the file, join the thread and free
+ * everything. The producer must be stopped first (uvc_capture_stop()).
+ * Returns 0, or -1 if any write failed. */
+int recorder_stop(recorder_t *r);
+
+#endif /* SQUIG_RECORDER_H */
@@ -0,0 +1,348 @@
+/*
+ * se_session.c — Shared Stream Engine session layer
+ *
+ * See se_session.h. The symbol table is filled under pthread_once and
+ * never changes afterwards, so any thread can use it without locking.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include "se_session.h"
+
+#define SE_LIBRARY          "libtobii_stream_engine.so"
+#define SE_RETRY_MS         250     /* between recovery attempts */
+#define SE_RECREATE_EVERY   8       /* reconnects before a fresh device (~2 s) */
+
+/* ── Symbol table ───────────────────────────────────────────────────── */
+
+static se_lib_t       g_lib;
+static int            g_lib_ok;
+static char           g_lib_err[256];
+static pthread_once_t g_lib_once = PTHREAD_ONCE_INIT;
+
+static void lib_load(void)
+{
+    static const struct { const char *name; size_t off; int optional; } syms[] = {
+        { "tobii_api_create",                          offsetof(se_lib_t, api_create), 0 },
+        { "tobii_api_destroy",                         offsetof(se_lib_t, api_destroy), 0 },
+        { "tobii_enumerate_local_device_urls",         offsetof(se_lib_t, enumerate), 0 },
+        { "tobii_device_create",                       offsetof(se_lib_t, device_create), 0 },
+        { "tobii_device_destroy",                      offsetof(se_lib_t, device_destroy), 0 },
+        { "tobii_device_reconnect",                    offsetof(se_lib_t, reconnect), 0 },
+        { "tobii_wait_for_callbacks",                  offsetof(se_lib_t, wait_for_callbacks), 0 },
+        { "tobii_device_process_callbacks",            offsetof(se_lib_t, process_callbacks), 0 },
+        { "tobii_system_clock",                        offsetof(se_lib_t, system_clock), 0 },
+        { "tobii_error_message",                       offsetof(se_lib_t, error_message), 0 },
+        { "tobii_gaze_origin_subscribe",               offsetof(se_lib_t, gaze_origin_subscribe), 0 },
+        { "tobii_gaze_origin_unsubscribe",             offsetof(se_lib_t, gaze_origin_unsubscribe), 0 },
+        { "tobii_eye_position_normalized_subscribe",   offsetof(se_lib_t, eye_position_normalized_subscribe), 1 },
+        { "tobii_eye_position_normalized_unsubscribe", offsetof(se_lib_t, eye_position_normalized_unsubscribe), 1 },
+        { "tobii_gaze_point_subscribe",                offsetof(se_lib_t, gaze_point_subscribe), 1 },
+        { "tobii_gaze_point_unsubscribe",              offsetof(se_lib_t, gaze_point_unsubscribe), 1 },
+        { "tobii_user_presence_subscribe",             offsetof(se_lib_t, user_presence_subscribe), 1 },
+        { "tobii_user_presence_unsubscribe",           offsetof(se_lib_t, user_presence_unsubscribe), 1 },
+        { "tobii_get_device_info",                     offsetof(se_lib_t, get_device_info), 1 },
+        { "tobii_capability_supported",                offsetof(se_lib_t, capability_supported), 1 },
+        { "tobii_stream_supported",                    offsetof(se_lib_t, stream_supported), 1 },
+        { "tobii_enumerate_illumination_modes",        offsetof(se_lib_t, enumerate_illumination_modes), 1 },
+        { "tobii_get_illumination_mode",               offsetof(se_lib_t, get_illumination_mode), 1 },
+        { "tobii_set_illumination_mode",               offsetof(se_lib_t, set_illumination_mode), 1 },
+    };
+    void *lib = dlopen(SE_LIBRARY, RTLD_NOW);
+    if (!lib) {
+        snprintf(g_lib_err, sizeof(g_lib_err), "dlopen: %s", dlerror());
+        return;
+    }
+    for (size_t i = 0; i < sizeof(syms) / sizeof(syms[0]); i++) {
+        void *p = dlsym(lib, syms[i].name);
+        if (!p && !syms[i].optional) {
+            snprintf(g_lib_err, sizeof(g_lib_err), "%s not found in Stream Engine", syms[i].name);
+            dlclose(lib);
+            memset(&g_lib, 0, sizeof(g_lib));
+            return;
+        }
+        memcpy((char *)&g_lib + syms[i].off, &p, sizeof(p));
+    }
+    g_lib.lib = lib;
+    g_lib_ok = 1;
+}
+
+const se_lib_t *se_lib_get(void)
+{
+    pthread_once(&g_lib_once, lib_load);
+    if (!g_lib_ok) {
+        fprintf(stderr, "[SE] %s\n", g_lib_err);
+        return NULL;
+    }
+    return &g_lib;
+}
+
+const char *se_error(int err)
+{
+    static __thread char buf[32];
+    pthread_once(&g_lib_once, lib_load);
+    if (g_lib_ok) return g_lib.error_message(err);
+    snprintf(buf, sizeof(buf), "error %d", err);
+    return buf;
+}
+
+/* ── Session ────────────────────────────────────────────────────────── */
+
+struct se_session {
+    const se_lib_t *se;
+    const char     *tag;
+    tobii_api_t    *api;
+    tobii_device_t *dev;
+    char            url[SE_URL_MAX];
+    int             url_given;  /* from the caller: never re-enumerated */
+    int             lost;       /* recovery attempts so far, 0 = connected */
+    uint64_t        reconnects;
+    /* Subscriptions to replay on a fresh device */
+    tobii_gaze_origin_callback_t             go_cb;
+    void                                    *go_user;
+    tobii_eye_position_normalized_callback_t ep_cb;
+    void                                    *ep_user;
+    tobii_gaze_point_callback_t              gp_cb;
+    void                                    *gp_user;
+    tobii_user_presence_callback_t           up_cb;
+    void                                    *up_user;
+    int                                      paused;    /* gaze streams off (se_session_pause) */
+};
+
+static void url_receiver(char const *url, void *user_data)
+{
+    char *b = user_data;
+    if (*b) return;
+    if (strlen(url) < SE_URL_MAX) strcpy(b, url);
+}
+
+typedef struct {
+    char (*urls)[SE_URL_MAX];
+    int max, n;
+} url_list_t;
+
+static void url_list_receiver(char const *url, void *user_data)
+{
+    url_list_t *l = user_data;
+    if (strlen(url) >= SE_URL_MAX) return;
+    if (l->n < l->max) strcpy(l->urls[l->n], url);
+    l->n++;
+}
+
+int se_enumerate_urls(char urls[][SE_URL_MAX], int max)
+{
+    const se_lib_t *se = se_lib_get();
+    if (!se) return -1;
+    tobii_api_t *api;
+    if (se->api_create(&api, NULL, NULL) != TOBII_ERROR_NO_ERROR) {
+        fprintf(stderr, "[SE] tobii_api_create failed\n");
+        return -1;
+    }
+    url_list_t l = { urls, max, 0 };
+    se->enumerate(api, url_list_receiver, &l);
+    se->api_destroy(api);
+    return l.n;
+}
+
+static int find_url(se_session_t *s)
+{
+    char url[SE_URL_MAX] = { 0 };
+    s->se->enumerate(s->api, url_receiver, url);
+    if (!url[0]) return -1;
+    memcpy(s->url, url, sizeof(url));
+    return 0;
+}
+
+se_session_t *se_session_open(const char *url, const char *tag)
+{
+    const se_lib_t *se = se_lib_get();
+    if (!se) return NULL;
+    se_session_t *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->se = se;
+    s->tag = tag ? tag : "[SE]";
+    if (se->api_create(&s->api, NULL, NULL) != TOBII_ERROR_NO_ERROR) {
+        fprintf(stderr, "%s tobii_api_create failed\n", s->tag);
+        free(s);
+        return NULL;
+    }
+    if (url && *url) {
+        snprintf(s->url, sizeof(s->url), "%s", url);
+        s->url_given = 1;
+    } else if (find_url(s) < 0) {
+        fprintf(stderr, "%s No tracker found\n", s->tag);
+        se->api_destroy(s->api);
+        free(s);
+        return NULL;
+    }
+    int err = se->device_create(s->api, s->url, TOBII_FIELD_OF_USE_INTERACTIVE, &s->dev);
+    if (err) {
+        fprintf(stderr, "%s device_create %s: %d - %s\n", s->tag, s->url, err, se->error_message(err));
+        se->api_destroy(s->api);
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void se_session_close(se_session_t *s)
+{
+    if (!s) return;
+    if (s->dev) {
+        se_session_pause(s, 1);
+        if (s->up_cb) s->se->user_presence_unsubscribe(s->dev);
+        s->se->device_destroy(s->dev);
+    }
+    s->se->api_destroy(s->api);
+    free(s);
+}
+
+int se_session_gaze_origin(se_session_t *s, tobii_gaze_origin_callback_t cb, void *user)
+{
+    int err = s->se->gaze_origin_subscribe(s->dev, cb, user);
+    if (err == TOBII_ERROR_NO_ERROR) {
+        s->go_cb = cb;
+        s->go_user = user;
+    }
+    return err;
+}
+
+int se_session_eye_position_normalized(se_session_t *s, tobii_eye_position_normalized_callback_t cb,
+                                       void *user)
+{
+    if (!s->se->eye_position_normalized_subscribe || !s->se->eye_position_normalized_unsubscribe)
+        return TOBII_ERROR_NOT_SUPPORTED;
+    int err = s->se->eye_position_normalized_subscribe(s->dev, cb, user);
+    if (err == TOBII_ERROR_NO_ERROR) {
+        s->ep_cb = cb;
+        s->ep_user = user;
+    }
+    return err;
+}
+
+int se_session_gaze_point(se_session_t *s, tobii_gaze_point_callback_t cb, void *user)
+{
+    if (!s->se->gaze_point_subscribe || !s->se->gaze_point_unsubscribe) return TOBII_ERROR_NOT_SUPPORTED;
+    int err = s->se->gaze_point_subscribe(s->dev, cb, user);
+    if (err == TOBII_ERROR_NO_ERROR) {
+        s->gp_cb = cb;
+        s->gp_user = user;
+    }
+    return err;
+}
+
+int se_session_user_presence(se_session_t *s, tobii_user_presence_callback_t cb, void *user)
+{
+    if (!s->se->user_presence_subscribe || !s->se->user_presence_unsubscribe)
+        return TOBII_ERROR_NOT_SUPPORTED;
+    int err = s->se->user_presence_subscribe(s->dev, cb, user);
+    if (err == TOBII_ERROR_NO_ERROR) {
+        s->up_cb = cb;
+        s->up_user = user;
+    }
+    return err;
+}
+
+/* The gaze subscriptions on the current device (paused: off) */
+static int subscribe_gaze(se_session_t *s, int on)
+{
+    const se_lib_t *se = s->se;
+    int err = TOBII_ERROR_NO_ERROR, e;
+    if (s->go_cb) {
+        e = on ? se->gaze_origin_subscribe(s->dev, s->go_cb, s->go_user)
+               : se->gaze_origin_unsubscribe(s->dev);
+        if (!err) err = e;
+    }
+    if (s->ep_cb) {
+        e = on ? se->eye_position_normalized_subscribe(s->dev, s->ep_cb, s->ep_user)
+               : se->eye_position_normalized_unsubscribe(s->dev);
+        if (!err) err = e;
+    }
+    if (s->gp_cb) {
+        e = on ? se->gaze_point_subscribe(s->dev, s->gp_cb, s->gp_user)
+               : se->gaze_point_unsubscribe(s->dev);
+        if (!err) err = e;
+    }
+    return err;
+}
+
+int se_session_pause(se_session_t *s, int paused)
+{
+    paused = !!paused;
+    if (paused == s->paused) return TOBII_ERROR_NO_ERROR;
+    s->paused = paused;
+    return s->dev ? subscribe_gaze(s, !paused) : TOBII_ERROR_NO_ERROR;    /* recreate() follows */
+}
+
+/* Fresh device from the cached URL on the same API instance, with the
+ * subscriptions replayed. */
+static int recreate(se_session_t *s)
+{
+    const se_lib_t *se = s->se;
+    if (s->dev) se->device_destroy(s->dev);
+    s->dev = NULL;
+    int err = se->device_create(s->api, s->url, TOBII_FIELD_OF_USE_INTERACTIVE, &s->dev);
+    if (err && !s->url_given && find_url(s) == 0)      /* back under another URL? */
+        err = se->device_create(s->api, s->url, TOBII_FIELD_OF_USE_INTERACTIVE, &s->dev);
+    if (err) {
+        s->dev = NULL;
+        return err;
+    }
+    if (!s->paused) subscribe_gaze(s, 1);
+    if (s->up_cb) se->user_presence_subscribe(s->dev, s->up_cb, s->up_user);
+    return TOBII_ERROR_NO_ERROR;
+}
+
+static int recover(se_session_t *s)
+{
+    if (s->lost++ == 0) fprintf(stderr, "%s Connection lost, reconnecting...\n", s->tag);
+    int err = s->dev && s->lost % SE_RECREATE_EVERY ? s->se->reconnect(s->dev) : recreate(s);
+    if (err == TOBII_ERROR_NO_ERROR) {
+        fprintf(stderr, "%s Reconnected%s\n", s->tag,
+                s->lost % SE_RECREATE_EVERY ? "" : " (new device)");
+        s->lost = 0;
+        s->reconnects++;
+        return SE_PUMP_RECONNECTED;
+    }
+    struct timespec ts = { 0, SE_RETRY_MS * 1000000L };
+    nanosleep(&ts, NULL);
+    return SE_PUMP_LOST;
+}
+
+int se_session_pump(se_session_t *s)
+{
+    if (s->lost || !s->dev) return recover(s);
+    /* Blocks until data is pending (or a few hundred ms pass) */
+    int err = s->se->wait_for_callbacks(1, &s->dev);
+    if (err == TOBII_ERROR_TIMED_OUT) return SE_PUMP_TIMEOUT;
+    if (err == TOBII_ERROR_NO_ERROR) err = s->se->process_callbacks(s->dev);
+    if (err == TOBII_ERROR_NO_ERROR) return SE_PUMP_OK;
+    if (err == TOBII_ERROR_TIMED_OUT) return SE_PUMP_TIMEOUT;
+    if (err == TOBII_ERROR_CONNECTION_FAILED) return recover(s);
+    fprintf(stderr, "%s Stream Engine: %d - %s\n", s->tag, err, s->se->error_message(err));
+    struct timespec ts = { 0, 10 * 1000000L };      /* don't spin on a persistent error */
+    nanosleep(&ts, NULL);
+    return SE_PUMP_ERROR;
+}
+
+int64_t se_session_clock_us(se_session_t *s)
+{
+    int64_t us = 0;
+    if (s->se->system_clock(s->api, &us) != TOBII_ERROR_NO_ERROR) return 0;
+    return us;
+}
+
+const se_lib_t *se_session_lib(se_session_t *s) { return s->se; }
+tobii_api_t    *se_session_api(se_session_t *s) { return s->api; }
+tobii_device_t *se_session_device(se_session_t *s) { return s->dev; }
+const char     *se_session_url(se_session_t *s) { return s->url; }
+uint64_t        se_session_reconnects(se_session_t *s) { return s->reconnects; }
@@ -0,0 +1,218 @@
+/*
+ * se_session.h — Shared Stream Engine session layer
+ *
+ * Stream Engine is loaded at runtime (dlopen), and device creation needs
+ * the 4-argument tobii_device_create that the official header does not
+ * declare (see the README). Every tool used to redo all of that itself,
+ * with its own copy of the stream structs. This is the one copy:
+ *
+ *   se_lib_get()        dlopen + dlsym once per process, on first use;
+ *                       the table is shared and read-only afterwards
+ *   se_session_open()   API instance, device URL (enumerated once, then
+ *                       cached), device; typed subscriptions that are
+ *                       remembered, so they can be restored
+ *   se_session_pump()   block in tobii_wait_for_callbacks, dispatch, and
+ *                       recover from a lost connection: a cheap
+ *                       tobii_device_reconnect first, then the device is
+ *                       re-created from the cached URL on the existing
+ *                       API instance and subscriptions are replayed. The
+ *                       API is never torn down.
+ *
+ * The structs below are the official Stream Engine 4 layouts
+ * (tobii_streams.h), timestamp_us first; use these, not local copies.
+ *
+ *   se_session_t *s = se_session_open(NULL, "[TOOL]");
+ *   se_session_gaze_origin(s, on_gaze_origin, user);
+ *   while (running) se_session_pump(s);          // one wait + dispatch
+ *   se_session_close(s);
+ *
+ * One session belongs to one thread (Stream Engine's rule for a device);
+ * se_session_clock_us (tobii_system_clock, on the API) is safe from any.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_SE_SESSION_H
+#define SQUIG_SE_SESSION_H
+
+#include <stdint.h>
+
+/* ── Stream Engine 4 ABI (the subset we use) ────────────────────────── */
+
+typedef struct tobii_api_t tobii_api_t;
+typedef struct tobii_device_t tobii_device_t;
+#define TOBII_FIELD_OF_USE_INTERACTIVE 1
+
+enum {
+    TOBII_ERROR_NO_ERROR             = 0,
+    TOBII_ERROR_INTERNAL             = 1,
+    TOBII_ERROR_NOT_SUPPORTED        = 3,
+    TOBII_ERROR_CONNECTION_FAILED    = 5,
+    TOBII_ERROR_TIMED_OUT            = 6,
+    TOBII_ERROR_INVALID_PARAMETER    = 8,
+    TOBII_ERROR_ALREADY_SUBSCRIBED   = 11,
+    TOBII_ERROR_NOT_SUBSCRIBED       = 12,
+    TOBII_ERROR_TOO_MANY_SUBSCRIBERS = 17,
+};
+
+/* tobii_stream_supported() */
+#define TOBII_STREAM_HEAD_POSE  4
+#define TOBII_SUPPORTED         1
+
+typedef enum { TOBII_VALIDITY_INVALID = 0, TOBII_VALIDITY_VALID = 1 } tobii_validity_t;
+
+typedef struct {
+    int64_t timestamp_us;
+    tobii_validity_t left_validity;
+    float left_xyz[3];          /* mm, tracker coordinates */
+    tobii_validity_t right_validity;
+    float right_xyz[3];
+} tobii_gaze_origin_t;
+
+typedef struct {
+    int64_t timestamp_us;
+    tobii_validity_t left_validity;
+    float left_xyz[3];          /* 0..1 in the track box */
+    tobii_validity_t right_validity;
+    float right_xyz[3];
+} tobii_eye_position_normalized_t;
+
+typedef struct {
+    int64_t timestamp_us;
+    tobii_validity_t validity;
+    float position_xy[2];       /* 0..1 on the display */
+} tobii_gaze_point_t;
+
+/* Not produced by the ET5 on Linux; shim/tobii_headpose_shim.c serves it */
+typedef struct {
+    int64_t timestamp_us;
+    tobii_validity_t position_validity;
+    float position_xyz[3];      /* mm, tracker coordinates */
+    tobii_validity_t rotation_validity_xyz[3];
+    float rotation_xyz[3];      /* rad about the tracker's X (pitch), Y (yaw), Z (roll) */
+} tobii_head_pose_t;
+
+typedef void (*tobii_gaze_origin_callback_t)(tobii_gaze_origin_t const *, void *);
+typedef void (*tobii_eye_position_normalized_callback_t)(tobii_eye_position_normalized_t const *, void *);
+typedef void (*tobii_gaze_point_callback_t)(tobii_gaze_point_t const *, void *);
+typedef void (*tobii_head_pose_callback_t)(tobii_head_pose_t const *, void *);
+
+typedef enum {
+    TOBII_USER_PRESENCE_STATUS_UNKNOWN = 0,
+    TOBII_USER_PRESENCE_STATUS_AWAY    = 1,
+    TOBII_USER_PRESENCE_STATUS_PRESENT = 2,
+} tobii_user_presence_status_t;
+
+/* Not a struct like the others: status and timestamp_us as arguments */
+typedef void (*tobii_user_presence_callback_t)(tobii_user_presence_status_t status,
+                                               int64_t timestamp_us, void *);
+
+typedef struct {
+    char serial_number[256];
+    char model[256];
+    char generation[256];
+    char firmware_version[256];
+    char integration_id[128];
+    char hw_calibration_version[128];
+    char hw_calibration_date[128];
+    char lot_id[128];
+    char integration_type[256];
+    char runtime_build_version[256];
+} tobii_device_info_t;
+
+/* ── Symbol table ───────────────────────────────────────────────────── */
+
+typedef struct {
+    void *lib;
+    /* Required: se_lib_get() fails without them */
+    int         (*api_create)(tobii_api_t **, void *, void *);
+    int         (*api_destroy)(tobii_api_t *);
+    int         (*enumerate)(tobii_api_t *, void (*)(char const *, void *), void *);
+    int         (*device_create)(tobii_api_t *, char const *, int, tobii_device_t **);
+    int         (*device_destroy)(tobii_device_t *);
+    int         (*reconnect)(tobii_device_t *);
+    int         (*wait_for_callbacks)(int, tobii_device_t *const *);
+    int         (*process_callbacks)(tobii_device_t *);
+    int         (*system_clock)(tobii_api_t *, int64_t *);
+    char const *(*error_message)(int);
+    int         (*gaze_origin_subscribe)(tobii_device_t *, tobii_gaze_origin_callback_t, void *);
+    int         (*gaze_origin_unsubscribe)(tobii_device_t *);
+    /* Optional: NULL when this Stream Engine build lacks them */
+    int         (*eye_position_normalized_subscribe)(tobii_device_t *,
+                                                     tobii_eye_position_normalized_callback_t, void *);
+    int         (*eye_position_normalized_unsubscribe)(tobii_device_t *);
+    int         (*gaze_point_subscribe)(tobii_device_t *, tobii_gaze_point_callback_t, void *);
+    int         (*gaze_point_unsubscribe)(tobii_device_t *);
+    int         (*user_presence_subscribe)(tobii_device_t *, tobii_user_presence_callback_t, void *);
+    int         (*user_presence_unsubscribe)(tobii_device_t *);
+    int         (*get_device_info)(tobii_device_t *, tobii_device_info_t *);
+    int         (*capability_supported)(tobii_device_t *, int, int *);
+    int         (*stream_supported)(tobii_device_t *, int, int *);
+    int         (*enumerate_illumination_modes)(tobii_device_t *, void (*)(const char *, void *), void *);
+    int         (*get_illumination_mode)(tobii_device_t *, char *, int);
+    int         (*set_illumination_mode)(tobii_device_t *, const char *);
+} se_lib_t;
+
+/* The process-wide table, loaded on the first call. NULL (with a message
+ * on stderr, every call) if the library or a required symbol is missing. */
+const se_lib_t *se_lib_get(void);
+
+/* tobii_error_message(), or a number when the library is not loaded */
+const char *se_error(int err);
+
+/* ── Session ────────────────────────────────────────────────────────── */
+
+typedef struct se_session se_session_t;
+
+#define SE_URL_MAX  256
+
+/* Every tracker Stream Engine enumerates, in its order, on a throwaway API
+ * instance: up to max URLs into urls[]. Returns how many were found (may
+ * exceed max), or -1 if the library is missing. */
+int se_enumerate_urls(char urls[][SE_URL_MAX], int max);
+
+/* url NULL or "": the first enumerated tracker. tag prefixes messages
+ * ("[HTD]"; NULL = "[SE]"). Returns NULL with a message on failure. */
+se_session_t *se_session_open(const char *url, const char *tag);
+void          se_session_close(se_session_t *s);
+
+/* Typed subscriptions; re-applied when the device is re-created. Return
+ * a TOBII_ERROR_* (TOBII_ERROR_NOT_SUPPORTED if this build lacks the
+ * stream). */
+int se_session_gaze_origin(se_session_t *s, tobii_gaze_origin_callback_t cb, void *user);
+int se_session_eye_position_normalized(se_session_t *s, tobii_eye_position_normalized_callback_t cb,
+                                       void *user);
+int se_session_gaze_point(se_session_t *s, tobii_gaze_point_callback_t cb, void *user);
+int se_session_user_presence(se_session_t *s, tobii_user_presence_callback_t cb, void *user);
+
+/* Nonzero: unsubscribe the gaze streams (gaze_origin, eye_position_
+ * normalized, gaze_point) and keep only user_presence, so the tracker
+ * stops computing gaze while nobody is there; zero: subscribe them
+ * again. Remembered across recovery. Returns the first TOBII_ERROR_*. */
+int se_session_pause(se_session_t *s, int paused);
+
+/* Outcome of one se_session_pump() */
+enum {
+    SE_PUMP_OK = 0,             /* callbacks (if any) dispatched */
+    SE_PUMP_TIMEOUT,            /* nothing arrived in Stream Engine's wait */
+    SE_PUMP_RECONNECTED,        /* the connection dropped and is back */
+    SE_PUMP_LOST,               /* dropped and not back yet: call again */
+    SE_PUMP_ERROR,              /* another Stream Engine error (printed) */
+};
+
+/* One wait + dispatch; on a lost connection, one recovery attempt
+ * (reconnect, then every few attempts a fresh device). Failed attempts
+ * and other errors sleep briefly, so a caller loop never spins. */
+int se_session_pump(se_session_t *s);
+
+/* Stream Engine clock (same as timestamp_us); 0 if the call fails */
+int64_t se_session_clock_us(se_session_t *s);
+
+const se_lib_t *se_session_lib(se_session_t *s);
+tobii_api_t    *se_session_api(se_session_t *s);
+tobii_device_t *se_session_device(se_session_t *s);
+const char     *se_session_url(se_session_t *s);
+uint64_t        se_session_reconnects(se_session_t *s);
+
+#endif /* SQUIG_SE_SESSION_H */
@@ -0,0 +1,223 @@
+/*
+ * session_log.c — Compact binary log of Stream Engine streams (.sqsl)
+ *
+ * See session_log.h. The writer is a stdio stream with a 64 KB buffer
+ * behind a mutex (Stream Engine callbacks and a ground-truth listener can
+ * share one log); at a few KB/s that is a write() every ten seconds or
+ * so. The reader maps the file once and decodes records in place.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "session_log.h"
+
+#define HEADER_BYTES    32
+#define REC_HEAD_BYTES  16
+
+const char *const session_rec_names[SESSION_REC_TYPES] = {
+    [0]                        = "?",
+    [SESSION_REC_GAZE_ORIGIN]  = "gaze_origin",
+    [SESSION_REC_EYE_POS_NORM] = "eye_position_normalized",
+    [SESSION_REC_GAZE_POINT]   = "gaze_point",
+    [SESSION_REC_TRUTH]        = "truth",
+};
+
+static const uint8_t rec_values[SESSION_REC_TYPES] = {
+    [SESSION_REC_GAZE_ORIGIN]  = 6,
+    [SESSION_REC_EYE_POS_NORM] = 6,
+    [SESSION_REC_GAZE_POINT]   = 2,
+    [SESSION_REC_TRUTH]        = 6,
+};
+
+/* ── Writer ─────────────────────────────────────────────────────────── */
+
+struct session_log_writer {
+    FILE           *f;
+    char            path[256];
+    pthread_mutex_t lock;
+    int             failed;
+    uint64_t        written[SESSION_REC_TYPES];
+};
+
+session_log_writer_t *session_log_create(const char *path)
+{
+    session_log_writer_t *w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    snprintf(w->path, sizeof(w->path), "%s", path);
+    w->f = fopen(path, "wb");
+    if (!w->f) {
+        fprintf(stderr, "[SESSION] %s: %s\n", path, strerror(errno));
+        free(w);
+        return NULL;
+    }
+    setvbuf(w->f, NULL, _IOFBF, 1 << 16);
+    pthread_mutex_init(&w->lock, NULL);
+
+    uint8_t h[HEADER_BYTES] = { 0 };
+    uint32_t magic = SESSION_LOG_MAGIC;
+    uint16_t version = SESSION_LOG_VERSION, size = HEADER_BYTES;
+    int64_t created = (int64_t)time(NULL);
+    memcpy(h, &magic, 4);
+    memcpy(h + 4, &version, 2);
+    memcpy(h + 6, &size, 2);
+    memcpy(h + 8, &created, 8);
+    if (fwrite(h, sizeof(h), 1, w->f) != 1) w->failed = 1;
+    return w;
+}
+
+int session_log_write(session_log_writer_t *w, const session_rec_t *rec)
+{
+    uint8_t buf[REC_HEAD_BYTES + SESSION_LOG_MAX_VALUES * sizeof(float)];
+    unsigned n = rec->type < SESSION_REC_TYPES && rec_values[rec->type] ? rec_values[rec->type]
+                                                                        : rec->n;
+    if (n > SESSION_LOG_MAX_VALUES) n = SESSION_LOG_MAX_VALUES;
+    int64_t d = rec->recv_us - rec->timestamp_us;
+    int32_t delta = d > INT32_MAX ? INT32_MAX : d < INT32_MIN ? INT32_MIN : (int32_t)d;
+    buf[0] = rec->type;
+    buf[1] = rec->valid;
+    buf[2] = (uint8_t)n;
+    buf[3] = 0;
+    memcpy(buf + 4, &rec->timestamp_us, 8);
+    memcpy(buf + 12, &delta, 4);
+    for (unsigned i = 0; i < n; i++) {
+        float v = (float)rec->v[i];
+        memcpy(buf + REC_HEAD_BYTES + 4 * i, &v, 4);
+    }
+
+    pthread_mutex_lock(&w->lock);
+    if (!w->failed && fwrite(buf, REC_HEAD_BYTES + 4 * n, 1, w->f) != 1) {
+        fprintf(stderr, "[SESSION] %s: write: %s\n", w->path, strerror(errno));
+        w->failed = 1;
+    }
+    if (rec->type < SESSION_REC_TYPES) w->written[rec->type]++;
+    int rc = w->failed ? -1 : 0;
+    pthread_mutex_unlock(&w->lock);
+    return rc;
+}
+
+uint64_t session_log_written(session_log_writer_t *w, int type)
+{
+    if (type < 0 || type >= SESSION_REC_TYPES) return 0;
+    pthread_mutex_lock(&w->lock);
+    uint64_t n = w->written[type];
+    pthread_mutex_unlock(&w->lock);
+    return n;
+}
+
+int session_log_close(session_log_writer_t *w)
+{
+    if (!w) return 0;
+    int rc = w->failed ? -1 : 0;
+    if (fclose(w->f) != 0) {
+        fprintf(stderr, "[SESSION] %s: close: %s\n", w->path, strerror(errno));
+        rc = -1;
+    }
+    pthread_mutex_destroy(&w->lock);
+    free(w);
+    return rc;
+}
+
+/* ── Reader ─────────────────────────────────────────────────────────── */
+
+struct session_log_reader {
+    const uint8_t *map;
+    size_t         size;
+    size_t         pos;
+    size_t         start;       /* first record */
+};
+
+session_log_reader_t *session_log_open(const char *path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        fprintf(stderr, "[SESSION] %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < HEADER_BYTES) {
+        fprintf(stderr, "[SESSION] %s: not a session log\n", path);
+        close(fd);
+        return NULL;
+    }
+    void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) {
+        fprintf(stderr, "[SESSION] %s: mmap: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    uint32_t magic;
+    uint16_t version, hsize;
+    memcpy(&magic, m, 4);
+    memcpy(&version, (uint8_t *)m + 4, 2);
+    memcpy(&hsize, (uint8_t *)m + 6, 2);
+    if (magic != SESSION_LOG_MAGIC || version != SESSION_LOG_VERSION || hsize < HEADER_BYTES ||
+        hsize > st.st_size) {
+        fprintf(stderr, "[SESSION] %s: not a version %d session log\n", path, SESSION_LOG_VERSION);
+        munmap(m, (size_t)st.st_size);
+        return NULL;
+    }
+    madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+    session_log_reader_t *r = calloc(1, sizeof(*r));
+    if (!r) {
+        munmap(m, (size_t)st.st_size);
+        return NULL;
+    }
+    r->map = m;
+    r->size = (size_t)st.st_size;
+    r->start = r->pos = hsize;
+    return r;
+}
+
+int session_log_next(session_log_reader_t *r, session_rec_t *rec)
+{
+    if (r->pos == r->size) return 0;
+    if (r->size - r->pos < REC_HEAD_BYTES) return -1;
+    const uint8_t *p = r->map + r->pos;
+    unsigned n = p[2];
+    size_t len = REC_HEAD_BYTES + 4 * (size_t)n;
+    if (r->size - r->pos < len) return -1;
+
+    int32_t delta;
+    rec->type = p[0];
+    rec->valid = p[1];
+    rec->n = (uint8_t)(n < SESSION_LOG_MAX_VALUES ? n : SESSION_LOG_MAX_VALUES);
+    memcpy(&rec->timestamp_us, p + 4, 8);
+    memcpy(&delta, p + 12, 4);
+    rec->recv_us = rec->timestamp_us + delta;
+    for (unsigned i = 0; i < rec->n; i++) {
+        float v;
+        memcpy(&v, p + REC_HEAD_BYTES + 4 * i, 4);
+        rec->v[i] = v;
+    }
+    r->pos += len;
+    return 1;
+}
+
+void session_log_rewind(session_log_reader_t *r)
+{
+    r->pos = r->start;
+}
+
+size_t session_log_bytes(const session_log_reader_t *r)
+{
+    return r->size;
+}
+
+void session_log_close_reader(session_log_reader_t *r)
+{
+    if (!r) return;
+    munmap((void *)r->map, r->size);
+    free(r);
+}
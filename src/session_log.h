@@ -0,0 +1,102 @@
+/*
+ * session_log.h — Compact binary log of Stream Engine streams (.sqsl)
+ *
+ * Records what the head-tracking pipeline consumes, so a session can be
+ * replayed through it offline, faster than real time and bit-for-bit
+ * repeatably:
+ *
+ *   SESSION_REC_GAZE_ORIGIN     left/right eye position, mm      (6 values)
+ *   SESSION_REC_EYE_POS_NORM    left/right eye position, 0..1    (6 values)
+ *   SESSION_REC_GAZE_POINT      on-screen gaze point, 0..1       (2 values)
+ *   SESSION_REC_TRUTH           reference head pose: x, y, z mm,
+ *                               yaw, pitch, roll deg (ArUco,
+ *                               opentrack, ...)                  (6 values)
+ *
+ * Layout (little-endian):
+ *
+ *   header  "SQSL" u32 magic, u16 version, u16 header size,
+ *           i64 created (Unix seconds), 16 bytes reserved
+ *   record  u8 type, u8 valid (bit 0 left / the sample, bit 1 right),
+ *           u8 value count, u8 reserved, i64 timestamp_us (SE clock),
+ *           i32 recv_us - timestamp_us (when the host got it), then
+ *           count × f32
+ *
+ * A gaze_origin record is 40 bytes (~3.6 KB/s at 90 Hz). The value count
+ * lets a reader skip record types it does not know.
+ *
+ *   session_log_writer_t *w = session_log_create("run.sqsl");
+ *   session_log_write(w, &rec);                   // any thread
+ *   session_log_close(w);
+ *
+ *   session_log_reader_t *r = session_log_open("run.sqsl");
+ *   while (session_log_next(r, &rec) > 0) ...
+ *   session_log_close_reader(r);
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_SESSION_LOG_H
+#define SQUIG_SESSION_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define SESSION_LOG_MAGIC       0x4C535153u     /* "SQSL" */
+#define SESSION_LOG_VERSION     1
+#define SESSION_LOG_MAX_VALUES  6
+
+enum {
+    SESSION_REC_GAZE_ORIGIN  = 1,
+    SESSION_REC_EYE_POS_NORM = 2,
+    SESSION_REC_GAZE_POINT   = 3,
+    SESSION_REC_TRUTH        = 4,
+    SESSION_REC_TYPES
+};
+
+#define SESSION_VALID_LEFT      0x01u   /* also: the sample (gaze point, truth) */
+#define SESSION_VALID_RIGHT     0x02u
+
+typedef struct {
+    uint8_t type;               /* SESSION_REC_* */
+    uint8_t valid;              /* SESSION_VALID_* */
+    uint8_t n;                  /* values used */
+    int64_t timestamp_us;       /* SE clock */
+    int64_t recv_us;            /* SE clock, host arrival (= timestamp_us if unknown) */
+    double  v[SESSION_LOG_MAX_VALUES];
+} session_rec_t;
+
+extern const char *const session_rec_names[SESSION_REC_TYPES];
+
+/* ── Writer ─────────────────────────────────────────────────────────── */
+
+typedef struct session_log_writer session_log_writer_t;
+
+session_log_writer_t *session_log_create(const char *path);
+
+/* Append one record (n taken from the type for known types). Serialised
+ * internally: callbacks on different threads may share a writer.
+ * Returns 0, or -1 once a write has failed. */
+int session_log_write(session_log_writer_t *w, const session_rec_t *rec);
+
+/* Records written so far, per type (index SESSION_REC_*) */
+uint64_t session_log_written(session_log_writer_t *w, int type);
+
+/* Flush and close. Returns -1 if any write failed. */
+int session_log_close(session_log_writer_t *w);
+
+/* ── Reader ─────────────────────────────────────────────────────────── */
+
+typedef struct session_log_reader session_log_reader_t;
+
+/* Map a log. Returns NULL with a message if it is missing or not a log. */
+session_log_reader_t *session_log_open(const char *path);
+
+/* Next record. Returns 1, 0 at the end, -1 on a truncated record. */
+int session_log_next(session_log_reader_t *r, session_rec_t *rec);
+
+void   session_log_rewind(session_log_reader_t *r);
+size_t session_log_bytes(const session_log_reader_t *r);
+void   session_log_close_reader(session_log_reader_t *r);
+
+#endif /* SQUIG_SESSION_LOG_H */
@@ -0,0 +1,145 @@
+/*
+ * spsc_ring.h — Lock-free single-producer / single-consumer ring
+ *
+ * Bounded FIFO of fixed-size elements for handing data between exactly
+ * two threads (capture → classify, acquisition → filter, ...). Push and
+ * pop are wait-free: one acquire load of the other side's index (cached,
+ * so usually not even that) and one release store of our own.
+ *
+ * A consumer that runs dry can sleep in spsc_ring_pop_wait(). It parks on
+ * a futex keyed to the producer index, and the producer only issues a
+ * FUTEX_WAKE when the consumer has announced it is waiting — so the fast
+ * path never makes a syscall.
+ *
+ *   spsc_ring_t q;
+ *   spsc_ring_init(&q, 8, sizeof(frame_t *));
+ *   spsc_ring_push(&q, &f);                   // producer, -1 when full
+ *   spsc_ring_pop_wait(&q, &f, 100);          // consumer, -1 on timeout
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_SPSC_RING_H
+#define SQUIG_SPSC_RING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#define SPSC_CACHELINE 64
+
+typedef struct {
+    /* Producer side */
+    uint32_t head __attribute__((aligned(SPSC_CACHELINE)));
+    uint32_t tail_cache;
+    /* Consumer side */
+    uint32_t tail __attribute__((aligned(SPSC_CACHELINE)));
+    uint32_t head_cache;
+    uint32_t waiting;       /* consumer is (about to be) parked on head */
+    /* Read-only after init */
+    uint32_t mask  __attribute__((aligned(SPSC_CACHELINE)));
+    uint32_t elem_size;
+    uint8_t *buf;
+} spsc_ring_t;
+
+/* capacity is rounded up to a power of two. Returns 0 or -1 (ENOMEM). */
+static inline int spsc_ring_init(spsc_ring_t *r, uint32_t capacity, uint32_t elem_size)
+{
+    uint32_t cap = 1;
+    while (cap < capacity) cap <<= 1;
+    memset(r, 0, sizeof(*r));
+    r->mask = cap - 1;
+    r->elem_size = elem_size;
+    r->buf = calloc(cap, elem_size);
+    return r->buf ? 0 : -1;
+}
+
+static inline void spsc_ring_free(spsc_ring_t *r)
+{
+    free(r->buf);
+    r->buf = NULL;
+}
+
+static inline uint32_t spsc_ring_capacity(const spsc_ring_t *r)
+{
+    return r->mask + 1;
+}
+
+/* Elements currently queued (exact from either side, a snapshot elsewhere) */
+static inline uint32_t spsc_ring_count(const spsc_ring_t *r)
+{
+    return __atomic_load_n(&r->head, __ATOMIC_ACQUIRE) -
+           __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+}
+
+static inline long spsc_futex(uint32_t *addr, int op, uint32_t val,
+                              const struct timespec *ts)
+{
+    return syscall(SYS_futex, addr, op, val, ts, NULL, 0);
+}
+
+/* Wake a consumer parked in spsc_ring_pop_wait() even if nothing was
+ * pushed (shutdown). */
+static inline void spsc_ring_wake(spsc_ring_t *r)
+{
+    spsc_futex(&r->head, FUTEX_WAKE_PRIVATE, 1, NULL);
+}
+
+/* Producer: copy one element in. Returns 0, or -1 if the ring is full. */
+static inline int spsc_ring_push(spsc_ring_t *r, const void *elem)
+{
+    uint32_t h = r->head;
+    if (h - r->tail_cache > r->mask) {
+        r->tail_cache = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+        if (h - r->tail_cache > r->mask) return -1;
+    }
+    memcpy(r->buf + (size_t)(h & r->mask) * r->elem_size, elem, r->elem_size);
+    __atomic_store_n(&r->head, h + 1, __ATOMIC_RELEASE);
+
+    /* Pairs with the fence in spsc_ring_pop_wait(): either the consumer
+     * sees the new head, or we see its waiting flag. */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&r->waiting, __ATOMIC_RELAXED))
+        spsc_ring_wake(r);
+    return 0;
+}
+
+/* Consumer: copy one element out. Returns 0, or -1 if the ring is empty. */
+static inline int spsc_ring_pop(spsc_ring_t *r, void *elem)
+{
+    uint32_t t = r->tail;
+    if (t == r->head_cache) {
+        r->head_cache = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        if (t == r->head_cache) return -1;
+    }
+    memcpy(elem, r->buf + (size_t)(t & r->mask) * r->elem_size, r->elem_size);
+    __atomic_store_n(&r->tail, t + 1, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/* Consumer: pop, sleeping up to timeout_ms if the ring is empty.
+ * Returns 0, or -1 on timeout / spsc_ring_wake(). */
+static inline int spsc_ring_pop_wait(spsc_ring_t *r, void *elem, int timeout_ms)
+{
+    if (spsc_ring_pop(r, elem) == 0) return 0;
+    if (timeout_ms <= 0) return -1;
+
+    uint32_t seen = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&r->waiting, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (spsc_ring_pop(r, elem) == 0) {
+        __atomic_store_n(&r->waiting, 0, __ATOMIC_RELAXED);
+        return 0;
+    }
+    struct timespec ts = { timeout_ms / 1000, (long)(timeout_ms % 1000) * 1000000L };
+    spsc_futex(&r->head, FUTEX_WAIT_PRIVATE, seen, &ts);
+    __atomic_store_n(&r->waiting, 0, __ATOMIC_RELAXED);
+    return spsc_ring_pop(r, elem);
+}
+
+#endif /* SQUIG_SPSC_RING_H */
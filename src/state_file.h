@@ -0,0 +1,91 @@
+/*
+ * state_file.h — Small checksummed state files, replaced atomically (header-only)
+ *
+ * What the tree keeps between runs (head_profile.c's per-user head
+ * model, uvc_device.c's per-serial probe cache) is a few dozen bytes
+ * packed at fixed offsets and closed by an FNV-1a of everything before
+ * it. A save writes <path>.tmp, flushes it to disk and renames it over
+ * the old file, so a crash at any point leaves either the old file or
+ * the new one, never a truncated one that a later load has to reject.
+ *
+ *   uint8_t b[BYTES];
+ *   ... pack fields ...
+ *   uint32_t sum = state_file_fnv1a(b, BYTES - 4);
+ *   memcpy(b + BYTES - 4, &sum, 4);
+ *   if (state_file_write(path, b, BYTES) < 0) perror(path);
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_STATE_FILE_H
+#define SQUIG_STATE_FILE_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+static inline uint32_t state_file_fnv1a(const uint8_t *p, size_t n)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < n; i++) h = (h ^ p[i]) * 16777619u;
+    return h;
+}
+
+/* mkdir -p of path's directory. Returns 0 or -1 (errno set). */
+static inline int state_file_make_parent(const char *path)
+{
+    char dir[512];
+    const char *slash = strrchr(path, '/');
+    if (!slash || slash == path) return 0;
+    size_t len = (size_t)(slash - path);
+    if (len >= sizeof(dir)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    memcpy(dir, path, len);
+    dir[len] = 0;
+    for (char *c = dir + 1; ; c++) {
+        if (*c == '/' || !*c) {
+            char keep = *c;
+            *c = 0;
+            if (mkdir(dir, 0755) < 0 && errno != EEXIST) return -1;
+            if (!keep) break;
+            *c = keep;
+        }
+    }
+    return 0;
+}
+
+/* Create the directory if needed, write b to <path>.tmp, fsync it and
+ * rename it into place. Returns 0, or -1 (errno set, nothing left
+ * behind). */
+static inline int state_file_write(const char *path, const void *b, size_t n)
+{
+    char tmp[520];
+    if (snprintf(tmp, sizeof(tmp), "%s.tmp", path) >= (int)sizeof(tmp)) {
+        errno = ENAMETOOLONG;
+        return -1;
+    }
+    if (state_file_make_parent(path) < 0) return -1;
+    FILE *f = fopen(tmp, "wb");
+    if (!f) return -1;
+    int ok = fwrite(b, n, 1, f) == 1 && fflush(f) == 0 && fsync(fileno(f)) == 0;
+    int err = errno;
+    if (fclose(f) != 0 && ok) {
+        ok = 0;
+        err = errno;
+    }
+    if (!ok || rename(tmp, path) < 0) {
+        if (ok) err = errno;
+        unlink(tmp);
+        errno = err;
+        return -1;
+    }
+    return 0;
+}
+
+#endif /* SQUIG_STATE_FILE_H */
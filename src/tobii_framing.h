@@ -0,0 +1,28 @@
+/*
+ * tobii_framing.h — Tobii ET5 IR payload framing details
+ *
+ * Kept free of libusb so offline tools (replay, analysis, benchmarks) can
+ * share the same rules as the live capture engine.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_TOBII_FRAMING_H
+#define SQUIG_TOBII_FRAMING_H
+
+#include <stdint.h>
+
+/* 10-byte metadata header some sub-frames start with:
+ * [seq 1B] [00] [e8 03] [00 00] [size 2B LE] [00 00] */
+#define TOBII_META_LEN      10
+
+static inline int tobii_has_meta_header(const uint8_t *p, uint32_t n)
+{
+    return n > 12 && p[1] == 0x00 && p[2] == 0xe8 && p[3] == 0x03;
+}
+
+/* Fragments shorter than this carry no image data (header-only payloads) */
+#define TOBII_MIN_FRAGMENT  100
+
+#endif /* SQUIG_TOBII_FRAMING_H */
@@ -0,0 +1,181 @@
+/*
+ * capture_scan_bench.c — Throughput and determinism check for capture_scan
+ *
+ * Writes two synthetic recordings (the second compressed when a codec is
+ * built in) with a known mix of frames — lit and dark 8-bit planes,
+ * interleaved planes, metadata-only packets — and analyses them with one
+ * thread, then with several. Reports frames/s, MB/s, the speed-up and
+ * the steals, and checks that every column is identical whatever the
+ * thread count and that the class and LED counts match what was written.
+ * The speed-up is bounded by the cores this machine has.
+ *
+ * Build & run:
+ *   make bench
+ *   ./build/capture_scan_bench [-n frames-per-file] [-t threads]
+ *
+ * Needs no hardware.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include "../capture_file.h"
+#include "../capture_scan.h"
+#include "../tobii_framing.h"
+
+#define FRAME_BYTES     32768
+#define NFILES          2
+
+/* Frame kinds, in a cycle of 5: lit, dark, lit, interleaved, meta */
+enum { LIT, DARK, STRIPES, META };
+static const int cycle[5] = { LIT, DARK, LIT, STRIPES, META };
+
+static uint32_t rng = 12345;
+static inline uint32_t rnd(void)
+{
+    rng = rng * 1103515245u + 12345u;
+    return rng >> 16;
+}
+
+static int make_file(const char *path, int nframes, int codec, uint8_t *buf)
+{
+    capfile_writer_t *w = capfile_create(path, NULL, 0, FRAME_BYTES);
+    if (!w) return -1;
+    if (codec != CAPFILE_CODEC_NONE) capfile_writer_set_codec(w, codec, 0);
+    frame_t *f = aligned_alloc(FRAME_ALIGN, sizeof(*f));
+    if (!f) return -1;
+    for (int i = 0; i < nframes; i++) {
+        int kind = cycle[i % 5];
+        memset(f, 0, sizeof(*f));
+        f->data = buf;
+        f->seq = (uint64_t)i;
+        f->t_first_ns = 1000000000ull + (uint64_t)i * 11111111u + rnd() % 200000;
+        f->t_last_ns = f->t_first_ns + 3000000;
+        /* 10-byte metadata header, then the pixels */
+        memset(buf, 0, TOBII_META_LEN);
+        f->stats.pix_off = TOBII_META_LEN;
+        if (kind == META) {
+            f->len = TOBII_META_LEN;
+        } else {
+            f->len = FRAME_BYTES;
+            uint8_t *p = buf + TOBII_META_LEN;
+            for (uint32_t k = 0; k < FRAME_BYTES - TOBII_META_LEN; k++) {
+                int v = kind == LIT ? 110 + (int)(k % 642) / 16 : kind == DARK ? 12 + (int)(k % 642) / 64
+                                                                 : (k & 1) ? 200 : 10;
+                p[k] = (uint8_t)(v + (int)(rnd() % 5));
+            }
+        }
+        if (capfile_write(w, f) < 0) break;
+    }
+    free(f);
+    return capfile_close(w);
+}
+
+/* Columns equal, frame by frame */
+static int same(const capscan_result_t *a, const capscan_result_t *b)
+{
+    if (a->n != b->n) return 0;
+    size_t n = (size_t)a->n;
+    return !memcmp(a->file, b->file, n * sizeof(*a->file)) &&
+           !memcmp(a->frame, b->frame, n * sizeof(*a->frame)) &&
+           !memcmp(a->seq, b->seq, n * sizeof(*a->seq)) &&
+           !memcmp(a->t_ns, b->t_ns, n * sizeof(*a->t_ns)) &&
+           !memcmp(a->len, b->len, n * sizeof(*a->len)) &&
+           !memcmp(a->cls, b->cls, n) && !memcmp(a->min, b->min, n) &&
+           !memcmp(a->max, b->max, n) && !memcmp(a->mean, b->mean, n * sizeof(*a->mean)) &&
+           !memcmp(a->head_avg, b->head_avg, n) && !memcmp(a->nd, b->nd, n * sizeof(*a->nd)) &&
+           !memcmp(a->diff, b->diff, n * sizeof(*a->diff)) && !memcmp(a->lit, b->lit, n) &&
+           !memcmp(a->hist, b->hist, sizeof(a->hist));
+}
+
+int main(int argc, char **argv)
+{
+    int nframes = 3000, threads = 8;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) nframes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) threads = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-n frames-per-file] [-t threads]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (nframes < 5) nframes = 5;
+
+    uint8_t *buf = malloc(FRAME_BYTES);
+    if (!buf) return 1;
+    char paths[NFILES][64] = { "" };
+    capfile_t *files[NFILES] = { 0 };
+    int codec = capfile_codec_supported(CAPFILE_CODEC_LZ4)    ? CAPFILE_CODEC_LZ4
+              : capfile_codec_supported(CAPFILE_CODEC_ZSTD)   ? CAPFILE_CODEC_ZSTD
+                                                              : CAPFILE_CODEC_NONE;
+    int fail = 0;
+    for (int f = 0; f < NFILES && !fail; f++) {
+        snprintf(paths[f], sizeof(paths[f]), "/tmp/capture_scan_bench.%d.%d.sqcap", (int)getpid(), f);
+        int c = f == 1 ? codec : CAPFILE_CODEC_NONE;
+        fail = make_file(paths[f], nframes, c, buf) < 0 || !(files[f] = capfile_open(paths[f]));
+        if (!fail) printf("%s: %d frames of %d B, %s\n", paths[f], nframes, FRAME_BYTES,
+                          capfile_codec_names[c]);
+    }
+    free(buf);
+
+    capscan_result_t one, many;
+    memset(&one, 0, sizeof(one));
+    memset(&many, 0, sizeof(many));
+    capscan_config_t cfg = CAPSCAN_DEFAULTS;
+    if (!fail) {
+        cfg.threads = 1;
+        fail = capscan_run(files, NFILES, &cfg, &one) < 0;
+    }
+    if (!fail) {
+        cfg.threads = threads;
+        fail = capscan_run(files, NFILES, &cfg, &many) < 0;
+    }
+
+    int ok = 0;
+    if (!fail) {
+        printf("\n1 thread: %.0f frames/s, %.0f MB/s\n", one.n / (one.wall_ns / 1e9),
+               one.bytes / 1048576.0 / (one.wall_ns / 1e9));
+        printf("\n%d threads (%ld online CPUs):\n", threads, sysconf(_SC_NPROCESSORS_ONLN));
+        capscan_print_summary(&many, stdout);
+
+        /* Per cycle of 5: three planes (two lit), one interleaved, one meta */
+        uint64_t total = (uint64_t)nframes * NFILES, planes = 0, lit = 0;
+        for (int i = 0; i < nframes; i++) {
+            planes += cycle[i % 5] == LIT || cycle[i % 5] == DARK;
+            lit += cycle[i % 5] == LIT || cycle[i % 5] == STRIPES;
+        }
+        int counts = one.n == total &&
+                     one.class_count[FRAME_CLASS_GRAY8] == planes * NFILES &&
+                     one.class_count[FRAME_CLASS_COUNT] == 0 &&
+                     one.class_count[FRAME_CLASS_GRAY8] + one.class_count[FRAME_CLASS_INTERLEAVED] +
+                     one.class_count[FRAME_CLASS_META] == total &&
+                     one.lit_count == lit * NFILES;
+        int equal = same(&one, &many);
+        double speedup = many.wall_ns ? (double)one.wall_ns / many.wall_ns : 0.0;
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        printf("\nSpeed-up %.2fx with %d threads; columns %s; counts %s\n", speedup, threads,
+               equal ? "identical" : "DIFFER", counts ? "as written" : "WRONG");
+        if (cpus < threads)
+            printf("(%ld online CPU%s: the speed-up says nothing about scaling)\n", cpus,
+                   cpus == 1 ? "" : "s");
+        ok = equal && counts;
+    }
+    capscan_result_free(&one);
+    capscan_result_free(&many);
+    for (int f = 0; f < NFILES; f++) {
+        capfile_free(files[f]);
+        if (paths[f][0]) unlink(paths[f]);
+    }
+
+    if (!ok) {
+        printf("\n[FAIL]\n");
+        return 1;
+    }
+    printf("\n[OK]\n");
+    return 0;
+}
@@ -0,0 +1,405 @@
+/*
+ * eye_detect_bench.c — Cost, accuracy and EKF benefit of the IR eye detector
+ *
+ * Renders the synth_head.h session as 642×480 IR frames at 30 fps through
+ * the nominal eye_camera_t: skin, eye sockets, iris, a dark pupil that
+ * wanders with gaze, two LED glints on each cornea, eyebrows, nostrils,
+ * sensor noise — the features anti-aliased, so sub-pixel centroids mean
+ * something. Then:
+ *
+ *   check     every vector backend's down2 / classify kernels against the
+ *             scalar reference, random data and odd lengths: bit-exact
+ *   accuracy  cornea / pupil / nostril centroid error against the
+ *             projected ground truth, detection rate
+ *   fusion    the head_tracker.h pipeline on the same 90 Hz gaze
+ *             session with and without head_tracker_vision(), each frame
+ *             fused two samples (~22 ms) after it was taken; pitch / roll
+ *             RMS error against ground truth once the face is learned,
+ *             and pitch split into a constant offset (what the learned
+ *             face gets wrong) and the spread around it
+ *   timing    eye_detect_frame() per backend, around predicted eyes and
+ *             as a whole-frame search, against the 2 ms/frame budget
+ *
+ * Build & run:
+ *   make bench
+ *   ./build/eye_detect_bench [-n frames]
+ *
+ * Needs no hardware.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+#include "../eye_detect.h"
+#include "../head_tracker.h"
+#include "synth_head.h"
+
+#define W           642
+#define H           480
+#define FRAME_EVERY 3               /* gaze samples per frame: 30 fps */
+#define FUSE_AFTER  2               /* samples between a frame and its fusion */
+#define BUDGET_MS   2.0
+#define DEG         SYNTH_DEG
+
+/* The synthetic face (mm). Nose differs from head_vision's defaults on
+ * purpose: k has to be learned. */
+#define NOSE_DOWN   50.0
+#define NOSE_FWD    0.45
+#define NOSTRIL_X   8.0
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* ── Kernel check ───────────────────────────────────────────────────── */
+
+static int check_kernels(void)
+{
+    const eye_kernels_t *const *all = eye_detect_backends();
+    const eye_kernels_t *ref = all[0];
+    enum { N = 1400 };
+    uint8_t r0[2 * N], r1[2 * N], a[N], b[N];
+    int fails = 0;
+    for (int i = 0; i < 2 * N; i++) {
+        r0[i] = (uint8_t)synth_rng();
+        r1[i] = (uint8_t)synth_rng();
+    }
+    for (int k = 1; all[k]; k++) {
+        if (!all[k]->usable()) continue;
+        int f = 0;
+        for (int n = 0; n <= N; n += (n < 80 ? 1 : 37)) {
+            ref->down2(r0, r1, n, a);
+            all[k]->down2(r0, r1, n, b);
+            f += memcmp(a, b, (size_t)n) != 0;
+            for (int t = 0; t < 6; t++) {
+                int dark = (int)(synth_rng() % 256), bright = (int)(synth_rng() % 256);
+                if (t == 0) dark = 0, bright = 255;
+                if (t == 1) dark = 255, bright = 0;
+                ref->classify(r0 + 1, n, dark, bright, a);
+                all[k]->classify(r0 + 1, n, dark, bright, b);
+                f += memcmp(a, b, (size_t)n) != 0;
+            }
+        }
+        printf("  check %-7s %s\n", all[k]->name, f ? "FAILED" : "bit-exact vs scalar");
+        fails += f;
+    }
+    return fails;
+}
+
+/* ── Renderer ───────────────────────────────────────────────────────── */
+
+typedef struct {
+    double cornea[2][2];        /* projected eye centres (user's left, right) */
+    double pupil[2][2];
+    double nostril_mid[2];
+} truth_t;
+
+/* Ellipse of radii rx, ry (px) blended toward v with edge coverage */
+static void ellipse(uint8_t *img, double cx, double cy, double rx, double ry, int v)
+{
+    int x0 = (int)floor(cx - rx - 1), x1 = (int)ceil(cx + rx + 1);
+    int y0 = (int)floor(cy - ry - 1), y1 = (int)ceil(cy + ry + 1);
+    double rm = rx < ry ? rx : ry;
+    for (int y = y0 < 0 ? 0 : y0; y <= y1 && y < H; y++)
+        for (int x = x0 < 0 ? 0 : x0; x <= x1 && x < W; x++) {
+            double dx = (x - cx) / rx, dy = (y - cy) / ry;
+            double cov = (1.0 - sqrt(dx * dx + dy * dy)) * rm + 0.5;
+            if (cov <= 0) continue;
+            if (cov > 1) cov = 1;
+            uint8_t *p = &img[y * W + x];
+            *p = (uint8_t)lrint(*p + (v - *p) * cov);
+        }
+}
+
+static void make_background(uint8_t *bg)
+{
+    for (int y = 0; y < H; y++)
+        for (int x = 0; x < W; x++) {
+            double dx = (x - W / 2) / (0.45 * W), dy = (y - H / 2) / (0.6 * H);
+            double skin = 150 - 60 * (dx * dx + dy * dy);     /* lit face, darker edges */
+            bg[y * W + x] = (uint8_t)(skin < 40 ? 40 : skin);
+        }
+}
+
+/* Project a head-frame point (relative to the head origin) at pose x */
+static void project_head(const eye_camera_t *cam, const double x[6], const double q[3], double uv[2])
+{
+    const head_real_t ang[3] = { x[3], x[4], x[5] };
+    head_real_t R[3][3];
+    double p[3];
+    head_ekf_rotation(ang, R, NULL);
+    for (int k = 0; k < 3; k++) p[k] = x[k] + R[k][0] * q[0] + R[k][1] * q[1] + R[k][2] * q[2];
+    eye_camera_project(cam, p, uv);
+}
+
+/* head_ekf_eye_offset() in double, whatever head_real_t is */
+static void eye_offset(const head_ekf_config_t *hc, int e, double o[3])
+{
+    head_real_t ho[3];
+    head_ekf_eye_offset(hc, e, ho);
+    for (int k = 0; k < 3; k++) o[k] = ho[k];
+}
+
+static void render(uint8_t *img, const uint8_t *bg, const int8_t *noise, const eye_camera_t *cam,
+                   const head_ekf_config_t *hc, const double pose[6], const double gaze[2], truth_t *tr)
+{
+    memcpy(img, bg, W * H);
+    double px = cam->fx / pose[2];                          /* px per mm, roughly */
+    for (int e = 0; e < 2; e++) {
+        double o[3], uv[2], g[3], pu[2];
+        eye_offset(hc, e, o);
+        project_head(cam, pose, o, uv);
+        memcpy(tr->cornea[e], uv, sizeof(uv));
+        memcpy(g, o, sizeof(g));
+        g[0] += gaze[0];
+        g[1] += gaze[1];
+        project_head(cam, pose, g, pu);
+        memcpy(tr->pupil[e], pu, sizeof(pu));
+
+        double brow[3] = { o[0], o[1] + 16, o[2] }, bu[2];
+        project_head(cam, pose, brow, bu);
+        ellipse(img, bu[0], bu[1], 14 * px, 2.5 * px, 70);
+        ellipse(img, uv[0], uv[1], 14 * px, 8 * px, 105);   /* socket */
+        ellipse(img, uv[0], uv[1], 6 * px, 6 * px, 75);     /* iris */
+        ellipse(img, pu[0], pu[1], 2.4 * px, 2.4 * px, 18);
+        for (int l = -1; l <= 1; l += 2)                    /* the two LEDs' reflections */
+            ellipse(img, uv[0] + l * 1.3 * px, uv[1], 1.5, 1.5, 250);
+    }
+    double o[3];
+    eye_offset(hc, 0, o);
+    double m[2] = { 0, 0 };
+    for (int s = -1; s <= 1; s += 2) {
+        double q[3] = { s * NOSTRIL_X, o[1] - NOSE_DOWN, o[2] - NOSE_FWD * NOSE_DOWN }, uv[2];
+        project_head(cam, pose, q, uv);
+        ellipse(img, uv[0], uv[1], 3.0 * px, 2.0 * px, 28);
+        m[0] += 0.5 * uv[0];
+        m[1] += 0.5 * uv[1];
+    }
+    memcpy(tr->nostril_mid, m, sizeof(m));
+    int off = (int)(synth_rng() % (W * H));
+    for (int i = 0; i < W * H; i++) {
+        int v = img[i] + noise[i + off];
+        img[i] = (uint8_t)(v < 0 ? 0 : v > 255 ? 255 : v);
+    }
+}
+
+/* ── Session ────────────────────────────────────────────────────────── */
+
+typedef struct {
+    double se[3];               /* pitch, roll, ty */
+    double pitch_sum;           /* for the pitch offset */
+    int n;
+} rms_t;
+
+static void rms_add(rms_t *r, const head_tracker_t *t, const double pose[6])
+{
+    double d[3] = { t->ekf.x[HEAD_EKF_PITCH] - pose[4], t->ekf.x[HEAD_EKF_ROLL] - pose[5],
+                    t->ekf.x[HEAD_EKF_TY] - pose[1] };
+    for (int k = 0; k < 3; k++) r->se[k] += d[k] * d[k];
+    r->pitch_sum += d[0];
+    r->n++;
+}
+
+static double rms_of(const rms_t *r, int k)
+{
+    return r->n ? sqrt(r->se[k] / r->n) : 0;
+}
+
+/* Pitch error with its mean removed: what a pitch relative to the
+ * starting pose (the daemon's output) sees */
+static double pitch_spread(const rms_t *r)
+{
+    if (!r->n) return 0;
+    double m = r->pitch_sum / r->n, v = r->se[0] / r->n - m * m;
+    return v > 0 ? sqrt(v) : 0;
+}
+
+static void rms_print(const char *name, const rms_t *r)
+{
+    printf("  %-14s pitch %5.2f (offset %+5.2f, spread %4.2f)  roll %5.2f deg   ty %5.2f mm\n", name,
+           rms_of(r, 0) / DEG, (r->n ? r->pitch_sum / r->n : 0) / DEG, pitch_spread(r) / DEG,
+           rms_of(r, 1) / DEG, rms_of(r, 2));
+}
+
+static inline double dist2(const double a[2], const double b[2])
+{
+    return (a[0] - b[0]) * (a[0] - b[0]) + (a[1] - b[1]) * (a[1] - b[1]);
+}
+
+static void to_sample(const synth_sample_t *s, head_tracker_sample_t *out)
+{
+    memset(out, 0, sizeof(*out));
+    out->timestamp_us = (int64_t)(s->t * 1e6);
+    out->left_valid = s->lv;
+    out->right_valid = s->rv;
+    memcpy(out->left, s->left, sizeof(out->left));
+    memcpy(out->right, s->right, sizeof(out->right));
+}
+
+int main(int argc, char **argv)
+{
+    int frames = 1800;          /* 60 s */
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) frames = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-n frames]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (frames < 400) frames = 400;
+
+    head_ekf_config_t hc = HEAD_EKF_DEFAULTS;
+    eye_camera_t cam = EYE_CAMERA_DEFAULTS;
+    int n = frames * FRAME_EVERY + FUSE_AFTER + 1;
+    synth_sample_t *s = calloc((size_t)n, sizeof(*s));
+    uint8_t *bg = malloc(W * H), *img = malloc(W * H);
+    int8_t *noise = malloc(2 * W * H);
+    eye_detector_t *det = eye_detect_create(NULL, &cam, W, H);
+    if (!s || !bg || !img || !noise || !det) return 1;
+    synth_make_session(s, n, &hc);
+    make_background(bg);
+    for (int i = 0; i < 2 * W * H; i++) noise[i] = (int8_t)lrint(3.0 * synth_gauss());
+
+    printf("\n=== eye_detect: %dx%d IR frames, backend %s ===\n\n", W, H, eye_detect_backend());
+    int fails = check_kernels();
+
+    head_tracker_t plain, vis;
+    head_tracker_init(&plain, &hc, NULL);
+    head_tracker_init(&vis, &hc, NULL);
+    head_tracker_use_vision(&vis, NULL, &cam);
+
+    eye_features_t *feat = calloc((size_t)frames, sizeof(*feat));
+    if (!feat) return 1;
+    rms_t r_plain = { { 0 }, 0, 0 }, r_vis = { { 0 }, 0, 0 };
+    double se_cornea = 0, se_pupil = 0, se_nose = 0;
+    int n_eyes = 0, n_nose = 0, n_searched = 0, learned_at = -1;
+    double gaze[2] = { 0, 0 };
+    for (int i = 0; i < n; i++) {
+        head_tracker_sample_t smp;
+        head_tracker_pose_t pose;
+        to_sample(&s[i], &smp);
+        head_tracker_update(&plain, &smp, smp.timestamp_us, &pose);
+        head_tracker_update(&vis, &smp, smp.timestamp_us, &pose);
+
+        int fi = i / FRAME_EVERY;
+        if (i % FRAME_EVERY == 0 && fi < frames) {
+            if (i % 45 == 0) {                              /* a saccade every 0.5 s */
+                gaze[0] = 2.5 * (2 * synth_uniform() - 1);
+                gaze[1] = 1.5 * (2 * synth_uniform() - 1);
+            }
+            truth_t tr;
+            render(img, bg, noise, &cam, &hc, s[i].pose, gaze, &tr);
+            double hint[2][2];
+            int have = vis.ekf.seeded;
+            if (have) {
+                double L[3], R[3];
+                head_ekf_eyes(&vis.ekf.cfg, vis.ekf.x, L, R);
+                have = eye_camera_project(&cam, L, hint[0]) == 0 && eye_camera_project(&cam, R, hint[1]) == 0;
+            }
+            eye_features_t *e = &feat[fi];
+            int found = eye_detect_frame(det, img, W, have ? hint : NULL, e);
+            n_searched += e->searched;
+            if (found == 2) {
+                n_eyes++;
+                for (int k = 0; k < 2; k++) {
+                    se_cornea += dist2(e->eye[k].cornea, tr.cornea[k]);
+                    se_pupil += dist2(e->eye[k].pupil, tr.pupil[k]);
+                }
+                if (e->nostrils_found) {
+                    n_nose++;
+                    se_nose += dist2(e->nostril_mid, tr.nostril_mid);
+                }
+            }
+        }
+        /* Fuse the frame taken FUSE_AFTER samples ago */
+        if (i >= FUSE_AFTER && (i - FUSE_AFTER) % FRAME_EVERY == 0 && (i - FUSE_AFTER) / FRAME_EVERY < frames) {
+            int j = i - FUSE_AFTER;
+            head_tracker_vision(&vis, &feat[j / FRAME_EVERY], (int64_t)(s[j].t * 1e6));
+            if (learned_at < 0 && vis.vision.n >= vis.vision.cfg.warmup) learned_at = i;
+        }
+        if (learned_at >= 0 && i > learned_at) {
+            rms_add(&r_plain, &plain, s[i].pose);
+            rms_add(&r_vis, &vis, s[i].pose);
+        }
+    }
+
+    printf("\n  detection       both eyes %5.1f%%, nostrils %5.1f%% of %d frames (%d whole-frame searches)\n",
+           100.0 * n_eyes / frames, 100.0 * n_nose / frames, frames, n_searched);
+    printf("  centroid RMS    cornea %.2f px, pupil %.2f px (moves with gaze), nostrils %.2f px\n",
+           n_eyes ? sqrt(se_cornea / (2 * n_eyes)) : 0, n_eyes ? sqrt(se_pupil / (2 * n_eyes)) : 0,
+           n_nose ? sqrt(se_nose / n_nose) : 0);
+    printf("  face model      nostrils %.1f mm below the eyes (true %.1f), learned over %d frames\n",
+           vis.vision.k, NOSE_DOWN, vis.vision.n);
+    printf("\n  head_tracker RMS error after learning (%.1f s of samples):\n",
+           r_vis.n / SYNTH_RATE_HZ);
+    rms_print("gaze only", &r_plain);
+    rms_print("+ IR features", &r_vis);
+    printf("  vision updates  %llu pitch, %llu roll, %llu rejected\n",
+           (unsigned long long)vis.vision.pitch_updates, (unsigned long long)vis.vision.roll_updates,
+           (unsigned long long)vis.vision.rejected);
+
+    /* Timing: a few rendered frames, replayed per backend */
+    enum { TF = 16 };
+    uint8_t *tfr = malloc((size_t)TF * W * H);
+    double (*th)[2][2] = malloc(TF * sizeof(*th));
+    if (!tfr || !th) return 1;
+    for (int f = 0; f < TF; f++) {
+        truth_t tr;
+        render(tfr + (size_t)f * W * H, bg, noise, &cam, &hc, s[f * 97 % n].pose, gaze, &tr);
+        memcpy(th[f], tr.cornea, sizeof(th[f]));
+    }
+    printf("\n");
+    double best_hint = 0, best_search = 0;
+    const eye_kernels_t *const *all = eye_detect_backends();
+    for (int k = 0; all[k]; k++) {
+        if (!all[k]->usable()) continue;
+        eye_detect_select(all[k]->name);
+        double t[2];
+        for (int mode = 0; mode < 2; mode++) {
+            int reps = mode ? 200 : 2000;
+            eye_features_t e;
+            uint64_t t0 = now_ns();
+            for (int r = 0; r < reps; r++)
+                eye_detect_frame(det, tfr + (size_t)(r % TF) * W * H, W,
+                                 mode ? NULL : (const double (*)[2])th[r % TF], &e);
+            t[mode] = (now_ns() - t0) / 1e6 / reps;
+        }
+        printf("  %-7s  %7.3f ms/frame around predicted eyes, %7.3f ms/frame whole-frame search\n",
+               all[k]->name, t[0], t[1]);
+        best_hint = t[0];
+        best_search = t[1];
+    }
+    eye_detect_select(NULL);
+    printf("  budget   %.1f ms/frame on one core: %s\n", BUDGET_MS,
+           best_hint < BUDGET_MS && best_search < BUDGET_MS ? "met" : "MISSED");
+
+    if (n_eyes < frames * 9 / 10) {
+        printf("\n[FAIL] eyes found in only %d of %d frames\n", n_eyes, frames);
+        fails++;
+    } else if (!(rms_of(&r_vis, 0) < rms_of(&r_plain, 0) && pitch_spread(&r_vis) < 0.5 * pitch_spread(&r_plain))) {
+        printf("\n[FAIL] IR features did not improve pitch\n");
+        fails++;
+    } else if (fails) {
+        printf("\n[FAIL] %d mismatches against the scalar reference\n", fails);
+    }
+    free(tfr);
+    free(th);
+    free(feat);
+    free(noise);
+    free(img);
+    free(bg);
+    free(s);
+    eye_detect_destroy(det);
+    if (fails) return 1;
+    printf("\n[OK]\n");
+    return 0;
+}
@@ -0,0 +1,67 @@
+/*
+ * libusb.h — The part of libusb uvc_device.c uses, for tests without a tracker
+ *
+ * uvc_device_bench.c builds uvc_device.c against this header instead of
+ * the real one (-Isrc/tools/fake_usb) and defines every function below
+ * itself, so the bench needs neither libusb nor a device. Types are
+ * opaque or cut down to the fields uvc_device.c reads; nothing here is
+ * ABI-compatible with libusb, and nothing links against it.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_FAKE_LIBUSB_H
+#define SQUIG_FAKE_LIBUSB_H
+
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/time.h>
+
+#define LIBUSB_CALL
+
+typedef struct libusb_context libusb_context;
+typedef struct libusb_device libusb_device;
+typedef struct libusb_device_handle libusb_device_handle;
+
+struct libusb_device_descriptor {
+    uint16_t idVendor, idProduct, bcdDevice;
+    uint8_t  iSerialNumber;
+};
+
+typedef int libusb_hotplug_callback_handle;
+typedef enum {
+    LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED = 1,
+    LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT    = 2
+} libusb_hotplug_event;
+typedef int (LIBUSB_CALL *libusb_hotplug_callback_fn)(libusb_context *ctx, libusb_device *dev,
+                                                      libusb_hotplug_event event, void *user);
+
+#define LIBUSB_HOTPLUG_NO_FLAGS     0
+#define LIBUSB_HOTPLUG_MATCH_ANY    (-1)
+#define LIBUSB_CAP_HAS_HOTPLUG      0x0001
+
+ssize_t libusb_get_device_list(libusb_context *ctx, libusb_device ***list);
+void libusb_free_device_list(libusb_device **list, int unref);
+int libusb_get_device_descriptor(libusb_device *dev, struct libusb_device_descriptor *desc);
+int libusb_get_port_numbers(libusb_device *dev, uint8_t *ports, int len);
+uint8_t libusb_get_bus_number(libusb_device *dev);
+int libusb_open(libusb_device *dev, libusb_device_handle **h);
+void libusb_close(libusb_device_handle *h);
+libusb_device *libusb_get_device(libusb_device_handle *h);
+int libusb_get_string_descriptor_ascii(libusb_device_handle *h, uint8_t index, unsigned char *data,
+                                       int length);
+int libusb_kernel_driver_active(libusb_device_handle *h, int interface);
+int libusb_detach_kernel_driver(libusb_device_handle *h, int interface);
+int libusb_attach_kernel_driver(libusb_device_handle *h, int interface);
+int libusb_claim_interface(libusb_device_handle *h, int interface);
+int libusb_release_interface(libusb_device_handle *h, int interface);
+int libusb_handle_events_timeout_completed(libusb_context *ctx, struct timeval *tv, int *completed);
+int libusb_has_capability(uint32_t capability);
+int libusb_hotplug_register_callback(libusb_context *ctx, int events, int flags, int vendor,
+                                     int product, int dev_class, libusb_hotplug_callback_fn cb,
+                                     void *user, libusb_hotplug_callback_handle *handle);
+void libusb_hotplug_deregister_callback(libusb_context *ctx, libusb_hotplug_callback_handle handle);
+const char *libusb_strerror(int code);
+
+#endif /* SQUIG_FAKE_LIBUSB_H */
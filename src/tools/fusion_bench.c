@@ -0,0 +1,206 @@
+/*
+ * fusion_bench.c — Two trackers through pose_fusion.h, one of them reseeding
+ *
+ * The synth_head.h head, seen by two trackers on one rig: A facing the
+ * user, B turned MOUNT_B degrees and sitting B_AT mm to the side, each
+ * with its own measurement noise and its own head_tracker (no
+ * calibration, no look-ahead). B sees the eyes only from B_START_S, then
+ * loses them for B_GAP_S at B_GAP_AT_S, longer than a reseed gap, so its
+ * filter seeds twice, each time on a new origin and with pitch 0, while A
+ * keeps tracking. Every pose of either goes through pose_fusion_update()
+ * as the daemon does (pose_fusion_reseeded() when head_tracker_t.reseeds
+ * moved), and the fused pose is compared with the truth:
+ *
+ *   frames    A's and B's pivots and angles in the shared frame, against
+ *             each other once B has settled: the mount has to turn B's
+ *             translation and angles the same way, and the learned offset
+ *             has to find where B sits
+ *   steps     the largest step of the fused translation beyond what the
+ *             head moved, over the whole run, against A's alone: B's
+ *             seeds and its joining the blend must not show
+ *   accuracy  p95 of the fused pose against the truth (reference offset
+ *             removed, as session_bench), next to A's alone
+ *
+ * Build & run:
+ *   make bench
+ *   ./build/fusion_bench
+ *
+ * Needs no hardware.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include "../pose_fusion.h"
+#include "synth_head.h"
+
+#define SECONDS         60
+#define MOUNT_B         -25.0       /* deg */
+#define B_AT            250.0       /* mm along the shared x axis */
+#define B_START_S       5.0
+#define B_GAP_AT_S      30.0
+#define B_GAP_S         1.0         /* > HEAD_TRACKER_RESEED_GAP_US */
+#define STALE_MS        50.0
+#define FRAME_MAX       5.0         /* mm RMS, B against A in the shared frame (two filters' noise) */
+#define ANGLE_MAX       1.0         /* deg RMS */
+#define STEP_MAX        1.0         /* mm, worst fused step beyond A's alone */
+#define POS_MAX         1.1         /* fused p95 against A's alone, translation */
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/* Eyes of the truth pose x as a tracker at (at, 0, 0) turned mount_deg
+ * sees them: its frame is the shared one turned by M, so points are
+ * Mᵀ·(p - at) */
+static void eyes_seen(const head_ekf_config_t *cfg, const head_real_t *x, double mount_deg, double at,
+                      double left[3], double right[3])
+{
+    const double c = cos(mount_deg * SYNTH_DEG), s = sin(mount_deg * SYNTH_DEG);
+    double l[3], r[3];
+    head_ekf_eyes(cfg, x, l, r);
+    l[0] -= at;
+    r[0] -= at;
+    left[0]  = c * l[0] + s * l[2] + 0.7 * synth_gauss();
+    left[1]  = l[1] + 0.7 * synth_gauss();
+    left[2]  = -s * l[0] + c * l[2] + 0.7 * synth_gauss();
+    right[0] = c * r[0] + s * r[2] + 0.7 * synth_gauss();
+    right[1] = r[1] + 0.7 * synth_gauss();
+    right[2] = -s * r[0] + c * r[2] + 0.7 * synth_gauss();
+}
+
+typedef struct {
+    double frame_pos, frame_ang;    /* RMS, B against A, both settled */
+    double step;                    /* worst fused step beyond the truth's, mm */
+    double p95[6];
+    double offset[3];               /* B's, learned */
+    uint64_t placements, seeds;
+} result_t;
+
+/* with_b 0: A alone */
+static void run(int with_b, result_t *res)
+{
+    const head_ekf_config_t cfg = HEAD_EKF_DEFAULTS;
+    const int n = (int)(SECONDS * SYNTH_RATE_HZ);
+    head_tracker_t trk[2];
+    pose_fusion_t fu;
+    pose_fusion_init(&fu, 2, STALE_MS);
+    pose_fusion_mount(&fu, 1, MOUNT_B);
+    for (int k = 0; k < 2; k++) head_tracker_init(&trk[k], NULL, NULL);
+    synth_rng_state = 0x12345678u;
+
+    double *err[6];
+    for (int k = 0; k < 6; k++) err[k] = calloc((size_t)n * 2, sizeof(double));
+    double mean[6] = { 0 }, fse = 0, ase = 0;
+    size_t m = 0, nf = 0;
+    double last_fused[3] = { 0 }, last_truth[3] = { 0 };
+    int have_last = 0;
+    memset(res, 0, sizeof(*res));
+
+    for (int i = 0; i < n; i++) {
+        double t = (i + 1) / SYNTH_RATE_HZ, truth[6];
+        synth_truth(t, truth);
+        head_real_t x[HEAD_EKF_N] = { 0 };
+        for (int k = 0; k < 6; k++) x[k] = truth[k];
+        int64_t ts = (int64_t)(t * 1e6), now_ns = ts * 1000;
+        int b_sees = with_b && t >= B_START_S && !(t >= B_GAP_AT_S && t < B_GAP_AT_S + B_GAP_S);
+
+        for (int k = 0; k < 2; k++) {
+            head_tracker_sample_t hs;
+            memset(&hs, 0, sizeof(hs));
+            hs.timestamp_us = ts;
+            eyes_seen(&cfg, x, k ? MOUNT_B : 0.0, k ? B_AT : 0.0, hs.left, hs.right);
+            if (k && !b_sees) continue;
+            hs.left_valid = hs.right_valid = 1;
+            uint64_t seeds = trk[k].reseeds;
+            head_tracker_pose_t p, fused;
+            head_tracker_update(&trk[k], &hs, ts, &p);
+            if (trk[k].reseeds != seeds) pose_fusion_reseeded(&fu, k);
+            pose_fusion_update(&fu, k, &p, now_ns, &fused);
+
+            const double est[6] = { fused.x, fused.y, fused.z, fused.yaw, fused.pitch, fused.roll };
+            const double ref[6] = { truth[0], truth[1], truth[2], truth[3] / SYNTH_DEG,
+                                    truth[4] / SYNTH_DEG, truth[5] / SYNTH_DEG };
+            if (have_last) {
+                double step = 0, tstep = 0;
+                for (int a = 0; a < 3; a++) {
+                    step += (est[a] - last_fused[a]) * (est[a] - last_fused[a]);
+                    tstep += (ref[a] - last_truth[a]) * (ref[a] - last_truth[a]);
+                }
+                res->step = fmax(res->step, sqrt(step) - sqrt(tstep));
+            }
+            memcpy(last_fused, est, sizeof(last_fused));
+            memcpy(last_truth, ref, sizeof(last_truth));
+            have_last = 1;
+            if (t < 1.0) continue;
+            for (int a = 0; a < 6; a++) {
+                err[a][m] = est[a] - ref[a];
+                mean[a] += err[a][m];
+            }
+            m++;
+        }
+        /* Both saw this instant and both are settled */
+        if (b_sees && pose_fusion__live(&fu, 0, now_ns, 1) && pose_fusion__live(&fu, 1, now_ns, 1)) {
+            const pose_fusion_source_t *a = &fu.src[0], *b = &fu.src[1];
+            for (int k = 0; k < 3; k++) fse += (b->pivot[k] - a->pivot[k]) * (b->pivot[k] - a->pivot[k]);
+            const double dy = pose_fusion_wrap(b->pose.yaw - a->pose.yaw);
+            const double dp = b->pose.pitch - a->pose.pitch, dr = b->pose.roll - a->pose.roll;
+            ase += (dy * dy + dp * dp + dr * dr) / 3;
+            nf++;
+        }
+    }
+    res->frame_pos = nf ? sqrt(fse / nf) : INFINITY;
+    res->frame_ang = nf ? sqrt(ase / nf) : INFINITY;
+    for (int a = 0; a < 6; a++) {
+        mean[a] /= (double)m;
+        for (size_t j = 0; j < m; j++) err[a][j] = fabs(err[a][j] - mean[a]);
+        qsort(err[a], m, sizeof(double), cmp_double);
+        res->p95[a] = err[a][(size_t)(0.95 * (double)(m - 1))];
+        free(err[a]);
+    }
+    memcpy(res->offset, fu.src[1].offset, sizeof(res->offset));
+    res->placements = fu.src[1].placements;
+    res->seeds = trk[1].reseeds;
+}
+
+int main(void)
+{
+    result_t ab, a;
+    run(1, &ab);
+    run(0, &a);
+
+    printf("\n=== pose fusion: A, and B at %+.0f deg / %+.0f mm seeding at %.0f s and after a %.0f s gap at %.0f s ===\n\n",
+           MOUNT_B, B_AT, B_START_S, B_GAP_S, B_GAP_AT_S);
+    printf("  B against A, shared frame   pivot %.2f mm RMS   angles %.2f deg RMS\n",
+           ab.frame_pos, ab.frame_ang);
+    printf("  B seeds %llu, placed %llu, offset %+.1f %+.1f %+.1f mm (sits at %+.0f 0 0)\n\n",
+           (unsigned long long)ab.seeds, (unsigned long long)ab.placements, ab.offset[0], ab.offset[1],
+           ab.offset[2], B_AT);
+    printf("                worst step   p95:  tx     ty     tz    yaw  pitch   roll\n");
+    const result_t *r[2] = { &ab, &a };
+    for (int k = 0; k < 2; k++)
+        printf("  %-12s %7.1f mm      %6.2f %6.2f %6.2f %6.2f %6.2f %6.2f\n", k ? "A alone" : "fused A+B",
+               r[k]->step, r[k]->p95[0], r[k]->p95[1], r[k]->p95[2], r[k]->p95[3], r[k]->p95[4],
+               r[k]->p95[5]);
+
+    int worse = 0;
+    for (int k = 0; k < 3; k++) worse |= !(ab.p95[k] <= POS_MAX * a.p95[k]);
+    const char *why = !(ab.frame_pos <= FRAME_MAX) ? "B's pivot is off A's in the shared frame"
+                    : !(ab.frame_ang <= ANGLE_MAX) ? "B's angles are off A's in the shared frame"
+                    : ab.seeds != 2 || ab.placements != 1 ? "B was not placed once, across its seeds"
+                    : !(ab.step <= a.step + STEP_MAX) ? "fused translation steps when B seeds or joins"
+                    : worse ? "fused translation worse than A's alone" : NULL;
+    if (why) {
+        printf("\n[FAIL] %s\n", why);
+        return 1;
+    }
+    printf("\n[OK]\n");
+    return 0;
+}
@@ -0,0 +1,183 @@
+/*
+ * head_f32_bench.c — float32 head model and EKF against the double build
+ *
+ * This file is compiled twice and linked into one program: as is, where
+ * head_real_t is double and main() lives, and with -DSQUIG_HEAD_FLOAT32
+ * (the `make FLOAT32=1` build), where only the replay is compiled. Both
+ * replay the synth_head.h session through the daemon's per-sample code
+ * (head_tracker.h: calibration, EKF, look-ahead) and the driver checks:
+ *
+ *   - the head_math.h polynomials against libm over the angles the
+ *     filter sees and well past them
+ *   - every float32 pose against the double pose for the same sample:
+ *     yaw and roll within ±2°, translation within ±3 mm (the Option C
+ *     targets), after the first second
+ *   - the cost of each at 120 Hz, as a share of one core here; the
+ *     float32 path must stay under 1%, leaving 10x for hosts that slow
+ *
+ * Build & run:
+ *   make bench
+ *   ./build/head_f32_bench [-p passes]
+ *
+ * Needs no hardware.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+#include "../head_tracker.h"
+#include "synth_head.h"
+
+#define RATE_HZ     120.0       /* the daemon's output rate on those hosts */
+#define CORE_MAX    1.0         /* % of a core at RATE_HZ, float32 path */
+#define SIN_MAX     2e-7        /* head_math.h bounds */
+#define ATAN_MAX    3e-7
+#define YAW_MAX     2.0         /* deg, float32 vs double */
+#define ROLL_MAX    2.0
+#define POS_MAX     3.0         /* mm */
+
+#ifdef SQUIG_HEAD_FLOAT32
+#define REPLAY  replay_f32
+#else
+#define REPLAY  replay_f64
+#endif
+
+double replay_f32(const synth_sample_t *s, int n, int passes, double (*out)[6]);
+double replay_f64(const synth_sample_t *s, int n, int passes, double (*out)[6]);
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Replay s[0..n) `passes` times as the daemon would (calibration and
+ * look-ahead on) in this file's precision; out gets the poses of the
+ * last pass (mm, deg). Returns ns per sample. */
+double REPLAY(const synth_sample_t *s, int n, int passes, double (*out)[6])
+{
+    pose_predict_config_t pc = POSE_PREDICT_DEFAULTS;
+    uint64_t t0 = now_ns();
+    for (int p = 0; p < passes; p++) {
+        head_tracker_t t;
+        head_tracker_init(&t, NULL, &pc);
+        head_tracker_calibrate(&t, NULL, NULL);
+        for (int i = 0; i < n; i++) {
+            head_tracker_sample_t hs;
+            memset(&hs, 0, sizeof(hs));
+            hs.timestamp_us = (int64_t)(s[i].t * 1e6);
+            hs.left_valid = s[i].lv;
+            hs.right_valid = s[i].rv;
+            memcpy(hs.left, s[i].left, sizeof(hs.left));
+            memcpy(hs.right, s[i].right, sizeof(hs.right));
+            head_tracker_pose_t pose;
+            head_tracker_update(&t, &hs, hs.timestamp_us, &pose);
+            const double v[6] = { pose.x, pose.y, pose.z, pose.yaw, pose.pitch, pose.roll };
+            memcpy(out[i], v, sizeof(v));
+        }
+    }
+    return (double)(now_ns() - t0) / ((double)passes * n);
+}
+
+#ifndef SQUIG_HEAD_FLOAT32
+
+/* Largest |polynomial - libm| for sincos over ±100 rad and atan2 around
+ * the circle at eye-vector and sub-millimetre lengths */
+static void trig_errors(double *sin_err, double *atan_err)
+{
+    double es = 0, ea = 0;
+    for (int i = -2000000; i <= 2000000; i++) {
+        float x = (float)i * 5e-5f, sv, cv;
+        head_fast_sincosf(x, &sv, &cv);
+        double d = fmax(fabs(sv - sin((double)x)), fabs(cv - cos((double)x)));
+        if (d > es) es = d;
+    }
+    const float radius[3] = { 1e-3f, 1.0f, 700.0f };
+    for (int i = 0; i < 1000000; i++) {
+        float a = (float)i * (float)(2 * M_PI / 1000000) - (float)M_PI;
+        for (int k = 0; k < 3; k++) {
+            float y = radius[k] * sinf(a), x = radius[k] * cosf(a);
+            double d = fabs(head_fast_atan2f(y, x) - atan2((double)y, (double)x));
+            if (d > M_PI) d = fabs(d - 2 * M_PI);            /* ±π: same angle */
+            if (d > ea) ea = d;
+        }
+    }
+    *sin_err = es;
+    *atan_err = ea;
+}
+
+int main(int argc, char **argv)
+{
+    int passes = 20;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-p") && i + 1 < argc) passes = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-p passes]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (passes < 1) passes = 1;
+
+    head_ekf_config_t cfg = HEAD_EKF_DEFAULTS;
+    int n = (int)(120 * SYNTH_RATE_HZ);
+    synth_sample_t *s = calloc((size_t)n, sizeof(*s));
+    double (*ref)[6] = calloc((size_t)n, sizeof(*ref));
+    double (*f32)[6] = calloc((size_t)n, sizeof(*f32));
+    if (!s || !ref || !f32) return 1;
+    synth_make_session(s, n, &cfg);
+
+    printf("\n=== head model + EKF, float32 vs double: %.0f s session, %d passes ===\n\n",
+           s[n - 1].t, passes);
+    double es, ea;
+    trig_errors(&es, &ea);
+    printf("  polynomial trig      sincos %.2g   atan2 %.2g rad   (bounds %.0g, %.0g)\n",
+           es, ea, SIN_MAX, ATAN_MAX);
+
+    double ns64 = replay_f64(s, n, passes, ref);
+    double ns32 = replay_f32(s, n, passes, f32);
+
+    /* Largest and RMS difference per axis, after the first second */
+    double dmax[6] = { 0 }, dse[6] = { 0 };
+    int scored = 0;
+    for (int i = (int)SYNTH_RATE_HZ; i < n; i++, scored++)
+        for (int k = 0; k < 6; k++) {
+            double d = fabs(f32[i][k] - ref[i][k]);
+            if (!(d <= dmax[k])) dmax[k] = d;           /* NaN sticks */
+            dse[k] += d * d;
+        }
+    static const char *const axis[6] = { "x", "y", "z", "yaw", "pitch", "roll" };
+    printf("  float32 - double     max / RMS over %d poses\n", scored);
+    for (int k = 0; k < 6; k++)
+        printf("    %-6s %10.2e / %.2e %s\n", axis[k], dmax[k], sqrt(dse[k] / scored),
+               k < 3 ? "mm" : "deg");
+
+    double core64 = ns64 * RATE_HZ / 1e9 * 100.0, core32 = ns32 * RATE_HZ / 1e9 * 100.0;
+    printf("\n  double     %7.1f ns/sample   %.4f%% of a core at %.0f Hz\n", ns64, core64, RATE_HZ);
+    printf("  float32    %7.1f ns/sample   %.4f%% of a core at %.0f Hz   (%.2fx)\n", ns32, core32,
+           RATE_HZ, ns64 / ns32);
+
+    free(s);
+    free(ref);
+    free(f32);
+    const char *why = !(es <= SIN_MAX) ? "sincos error" : !(ea <= ATAN_MAX) ? "atan2 error"
+                    : !(dmax[3] <= YAW_MAX) ? "yaw off the double build"
+                    : !(dmax[5] <= ROLL_MAX) ? "roll off the double build"
+                    : !(dmax[0] <= POS_MAX && dmax[1] <= POS_MAX && dmax[2] <= POS_MAX)
+                        ? "translation off the double build"
+                    : !(core32 < CORE_MAX) ? "float32 path over budget" : NULL;
+    if (why) {
+        printf("\n[FAIL] %s\n", why);
+        return 1;
+    }
+    printf("\n[OK]\n");
+    return 0;
+}
+
+#endif /* !SQUIG_HEAD_FLOAT32 */
@@ -0,0 +1,96 @@
+/*
+ * ir_batch.c — Offline batch analysis of IR recordings, on every core
+ *
+ * Maps one or more .sqcap files (ir_viewer --rawdump / --record) and runs
+ * the frame-stats, classification, LED-lit and frame-to-frame difference
+ * kernels over every frame in parallel (capture_scan.h: a work-stealing
+ * pool over the frame index). Writes one CSV row per frame and prints a
+ * summary — class counts, LED duty, histograms of brightness, neighbour
+ * difference, frame-to-frame difference and frame interval, and how the
+ * work spread over the threads.
+ *
+ * Where ir_compare --replay looks at the first 100 frames of two
+ * recordings one at a time, this takes hours of them.
+ *
+ * Build & run:
+ *   make build/ir_batch
+ *   ./build/ir_batch [--threads N] [--chunk N] [--lit MEAN] [--csv out.csv | --csv -]
+ *                    night-0000.sqcap night-0001.sqcap ...
+ *
+ * Needs no hardware.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "../capture_file.h"
+#include "../capture_scan.h"
+
+static void usage(const char *argv0)
+{
+    fprintf(stderr, "Usage: %s [--threads N] [--chunk N] [--lit MEAN] [--csv FILE | --csv -] "
+                    "file.sqcap...\n", argv0);
+}
+
+int main(int argc, char **argv)
+{
+    capscan_config_t cfg = CAPSCAN_DEFAULTS;
+    const char *csv = NULL;
+    int first = argc;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--threads") && i + 1 < argc) cfg.threads = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--chunk") && i + 1 < argc) cfg.chunk = (uint32_t)atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--lit") && i + 1 < argc) cfg.lit_avg = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--csv") && i + 1 < argc) csv = argv[++i];
+        else if (argv[i][0] == '-') { usage(argv[0]); return 1; }
+        else { first = i; break; }
+    }
+    int nfiles = argc - first;
+    if (nfiles < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    /* With the CSV on stdout, everything else goes to stderr */
+    FILE *info = csv && !strcmp(csv, "-") ? stderr : stdout;
+    capfile_t **files = calloc((size_t)nfiles, sizeof(*files));
+    if (!files) return 1;
+    int rc = 1;
+    for (int f = 0; f < nfiles; f++) {
+        if (!(files[f] = capfile_open(argv[first + f]))) goto out;
+        fprintf(info, "[%d] %s: %llu frames%s\n", f, argv[first + f],
+                (unsigned long long)capfile_count(files[f]),
+                capfile_recovered(files[f]) ? " (index rebuilt)" : "");
+    }
+
+    capscan_result_t r;
+    if (capscan_run(files, nfiles, &cfg, &r) < 0) {
+        capscan_result_free(&r);
+        goto out;
+    }
+    rc = 0;
+    if (csv) {
+        FILE *out = strcmp(csv, "-") ? fopen(csv, "w") : stdout;
+        if (!out) {
+            perror(csv);
+            rc = 1;
+        } else {
+            setvbuf(out, NULL, _IOFBF, 1 << 20);
+            if (capscan_write_csv(&r, out) < 0 || (out != stdout ? fclose(out) : fflush(out))) {
+                fprintf(stderr, "Writing %s failed\n", csv);
+                rc = 1;
+            }
+        }
+    }
+    fprintf(info, "\n");
+    capscan_print_summary(&r, info);
+    capscan_result_free(&r);
+
+out:
+    for (int f = 0; f < nfiles; f++) capfile_free(files[f]);
+    free(files);
+    return rc;
+}
@@ -3,6 +3,14 @@
  *
  * Captures frames via libusb IF2, first WITHOUT SE (ambient IR only),
  * then WITH SE (IR LEDs pulsing). Compares statistics to prove LEDs are active.
+ * Frames come from the shared async capture engine (../uvc_capture.c);
+ * Stream Engine runs on a thread of the same process (../gaze_stream.c),
+ * so in the second phase every frame is also paired with its nearest
+ * gaze_origin sample on the one CLOCK_MONOTONIC timeline.
+ *
+ * Offline: compare two recordings made with `ir_viewer --rawdump` instead,
+ * processed as fast as they can be read (no device, no SE):
+ *   ./ir_compare --replay without_se.sqcap with_se.sqcap
  *
  * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
  * See LICENSE file for details.
@@ -14,92 +22,63 @@
 #include <stdint.h>
 #include <signal.h>
 #include <unistd.h>
-#include <dlfcn.h>
-#include <sys/wait.h>
+#include <time.h>
 #include <libusb.h>
-
-#define TOBII_VID   0x2104
-#define TOBII_PID   0x0313
-#define IF_VC       1
-#define IF_VS       2
-#define EP_IN       0x82
-
-#define VS_PROBE_CONTROL  0x01
-#define VS_COMMIT_CONTROL 0x02
-#define UVC_SET_CUR       0x01
-#define UVC_GET_CUR       0x81
-#define BFH_FID  0x01
-#define BFH_EOF  0x02
-#define BFH_ERR  0x40
-
-typedef struct __attribute__((packed)) {
-    uint16_t bmHint;
-    uint8_t  bFormatIndex, bFrameIndex;
-    uint32_t dwFrameInterval;
-    uint16_t wKeyFrameRate, wPFrameRate, wCompQuality, wCompWindowSize, wDelay;
-    uint32_t dwMaxVideoFrameSize, dwMaxPayloadTransferSize;
-} uvc_probe_t;
+#include "../uvc_capture.h"
+#include "../capture_file.h"
+#include "../gaze_stream.h"
 
 static volatile int g_running = 1;
 static void sig(int s) { (void)s; g_running = 0; }
 
-static int uvc_ctrl(libusb_device_handle *d, uint8_t req, uint8_t cs,
-                    uint8_t intf, void *buf, uint16_t len) {
-    uint8_t rt = (req & 0x80)
-        ? (LIBUSB_ENDPOINT_IN|LIBUSB_REQUEST_TYPE_CLASS|LIBUSB_RECIPIENT_INTERFACE)
-        : (LIBUSB_ENDPOINT_OUT|LIBUSB_REQUEST_TYPE_CLASS|LIBUSB_RECIPIENT_INTERFACE);
-    return libusb_control_transfer(d, rt, req, (uint16_t)(cs<<8), intf, buf, len, 2000);
-}
+typedef struct { int count; long sum; int mn, mx; } stats_t;
 
-static int read_frame(libusb_device_handle *d, uint8_t *buf, int bufsz) {
-    uint8_t pkt[65536]; int xferred, off=0, fid=-1;
-    while (off < bufsz && g_running) {
-        int r = libusb_bulk_transfer(d, EP_IN, pkt, sizeof(pkt), &xferred, 500);
-        if (r == LIBUSB_ERROR_TIMEOUT) continue;
-        if (r == LIBUSB_ERROR_OVERFLOW) continue;
-        if (r < 0) return -1;
-        if (xferred < 2) continue;
-        uint8_t hlen = pkt[0], bfh = pkt[1];
-        if (hlen < 2 || hlen > xferred) {
-            int n = (off+xferred<=bufsz)?xferred:(bufsz-off);
-            memcpy(buf+off, pkt, n); off+=n; continue;
-        }
-        if (bfh & BFH_ERR) { off=0; fid=-1; continue; }
-        int cfid = bfh & BFH_FID;
-        if (fid>=0 && cfid!=fid && off>0) return off;
-        fid = cfid;
-        int plen = xferred - hlen;
-        if (plen>0) { int n=(off+plen<=bufsz)?plen:(bufsz-off);
-            memcpy(buf+off, pkt+hlen, n); off+=n; }
-        if (bfh & BFH_EOF) return off;
-    }
-    return off;
+/* Live engine, or a recording when player is set */
+static frame_t *next_frame(uvc_capture_t *cap, capfile_player_t *pl, int ms) {
+    return pl ? capfile_player_next(pl, ms) : uvc_capture_next(cap, ms);
 }
 
-typedef struct { int count; long sum; int mn, mx; } stats_t;
+static int source_running(uvc_capture_t *cap, capfile_player_t *pl) {
+    return pl ? capfile_player_running(pl) : uvc_capture_running(cap);
+}
 
-static void capture_stats(libusb_device_handle *d, const char *label, int nframes) {
-    uint8_t *buf = calloc(1, 1024*1024);
+/* gs: pair every frame with its nearest gaze_origin sample (same clock) */
+static void capture_stats(uvc_capture_t *cap, capfile_player_t *pl, gaze_stream_t *gs,
+                          const char *label, int nframes) {
     stats_t bright = {0,0,255,0};
     stats_t all = {0,0,255,0};
     int frame_sizes[100];
     long frame_avgs[100];
+    double frame_dt_ms[100];
     int n = 0;
+    int paired = 0;
+    double dt_sum = 0, dt_max = 0;
+
+    /* Drop frames queued before this phase started */
+    frame_t *f;
+    if (cap) while ((f = uvc_capture_next(cap, 0)) != NULL) frame_unref(f);
 
     printf("\n=== %s: capturing %d frames ===\n", label, nframes);
     for (int i = 0; i < nframes && g_running; ) {
-        int got = read_frame(d, buf, 1024*1024);
-        if (got <= 0) { usleep(10000); continue; }
-        if (got < 1000) continue;  /* skip tiny headers */
+        f = next_frame(cap, pl, 500);
+        if (!f) { if (!source_running(cap, pl)) break; continue; }
+        int got = (int)f->len;
+        if (got < 1000) { frame_unref(f); continue; }  /* skip tiny headers */
         i++;
-        int mn=255, mx=0; long sum=0;
-        for (int j=0; j<got; j++) {
-            if (buf[j]<mn) mn=buf[j];
-            if (buf[j]>mx) mx=buf[j];
-            sum += buf[j];
+        /* min/max/mean come precomputed with the frame */
+        int mn = f->stats.min, mx = f->stats.max;
+        long avg = (long)f->stats.mean;
+        /* Frame start minus the gaze sample's device time, both CLOCK_MONOTONIC */
+        gaze_sample_t g;
+        double dt_ms = 0;
+        if (gs && gaze_stream_nearest(gs, (int64_t)f->t_first_ns, &g) == 0) {
+            dt_ms = ((int64_t)f->t_first_ns - g.dev_ns) / 1e6;
+            paired++;
+            dt_sum += dt_ms;
+            if (dt_ms > dt_max || -dt_ms > dt_max) dt_max = dt_ms < 0 ? -dt_ms : dt_ms;
         }
-        long avg = sum/got;
-        if (n < 100) { frame_sizes[n] = got; frame_avgs[n] = avg; n++; }
+        frame_unref(f);
+        if (n < 100) { frame_sizes[n] = got; frame_avgs[n] = avg; frame_dt_ms[n] = dt_ms; n++; }
         all.count++; all.sum += avg;
         if (all.mn > mn) all.mn = mn;
         if (all.mx < mx) all.mx = mx;
@@ -119,91 +98,88 @@ static void capture_stats(libusb_device_handle *d, const char *label, int nframe
     if (bright.count)
         printf("  Bright avg-of-avg: %.1f, max pixel=%d\n",
                (double)bright.sum/bright.count, bright.mx);
+    if (gs) {
+        gaze_stream_stats_t st;
+        gaze_stream_get_stats(gs, &st);
+        printf("  Paired with gaze_origin: %d/%d, frame - gaze mean %+.2f ms, |max| %.2f ms "
+               "(%llu samples, clock fit over %d s)\n", paired, all.count,
+               paired ? dt_sum / paired : 0, dt_max, (unsigned long long)st.samples, st.clock.buckets);
+    }
     printf("  Frame details:\n");
-    for (int i=0; i<n && i<30; i++)
-        printf("    [%2d] %6d bytes, avg=%ld\n", i+1, frame_sizes[i], frame_avgs[i]);
+    for (int i=0; i<n && i<30; i++) {
+        printf("    [%2d] %6d bytes, avg=%ld", i+1, frame_sizes[i], frame_avgs[i]);
+        if (gs) printf(", gaze %+.2f ms", frame_dt_ms[i]);
+        printf("\n");
+    }
+}
+
+static void print_verdict(void) {
+    printf("\nDone. Compare the bright frame counts and averages above.\n");
+    printf("If similar → IR LEDs were already pulsing (just invisible at 850nm)\n");
+    printf("If different → SE activation changes IR illumination\n");
+}
 
-    free(buf);
+/* Both phases from recordings, unpaced */
+static int compare_recordings(const char *without, const char *with) {
+    const char *path[2] = { without, with };
+    const char *label[2] = { "WITHOUT Stream Engine (recording)", "WITH Stream Engine (recording)" };
+    for (int i = 0; i < 2 && g_running; i++) {
+        capfile_t *cf = capfile_open(path[i]);
+        if (!cf) return 1;
+        capfile_player_t *pl = capfile_player_create(cf, 0, 0);
+        if (!pl) { capfile_free(cf); return 1; }
+        printf("\n[REPLAY] %s: %llu frames\n", path[i], (unsigned long long)capfile_count(cf));
+        capture_stats(NULL, pl, NULL, label[i], 30);
+        capfile_player_destroy(pl);
+        capfile_free(cf);
+    }
+    print_verdict();
+    return 0;
 }
 
-int main() {
+int main(int argc, char **argv) {
     signal(SIGINT, sig); signal(SIGTERM, sig);
+    if (argc == 4 && strcmp(argv[1], "--replay") == 0)
+        return compare_recordings(argv[2], argv[3]);
+    if (argc != 1) {
+        fprintf(stderr, "Usage: %s [--replay without_se.sqcap with_se.sqcap]\n", argv[0]);
+        return 1;
+    }
     libusb_context *ctx = NULL;
     libusb_init(&ctx);
     libusb_device_handle *dev = libusb_open_device_with_vid_pid(ctx, TOBII_VID, TOBII_PID);
     if (!dev) { fprintf(stderr, "Cannot open device\n"); return 1; }
 
-    if (libusb_kernel_driver_active(dev, IF_VC)==1) libusb_detach_kernel_driver(dev, IF_VC);
-    if (libusb_kernel_driver_active(dev, IF_VS)==1) libusb_detach_kernel_driver(dev, IF_VS);
-    libusb_claim_interface(dev, IF_VC);
-    libusb_claim_interface(dev, IF_VS);
+    if (libusb_kernel_driver_active(dev, IF_VIDEO_CONTROL)==1) libusb_detach_kernel_driver(dev, IF_VIDEO_CONTROL);
+    if (libusb_kernel_driver_active(dev, IF_VIDEO_STREAM)==1) libusb_detach_kernel_driver(dev, IF_VIDEO_STREAM);
+    libusb_claim_interface(dev, IF_VIDEO_CONTROL);
+    libusb_claim_interface(dev, IF_VIDEO_STREAM);
 
-    /* UVC negotiate */
-    uvc_probe_t p; memset(&p,0,sizeof(p));
-    p.bmHint=1; p.bFormatIndex=1; p.bFrameIndex=1; p.dwFrameInterval=416667;
-    uvc_ctrl(dev, UVC_SET_CUR, VS_PROBE_CONTROL, IF_VS, &p, sizeof(p));
-    memset(&p,0,sizeof(p));
-    uvc_ctrl(dev, UVC_GET_CUR, VS_PROBE_CONTROL, IF_VS, &p, sizeof(p));
-    uvc_ctrl(dev, UVC_SET_CUR, VS_COMMIT_CONTROL, IF_VS, &p, sizeof(p));
+    /* UVC negotiate + async capture (keeps streaming across both phases) */
+    uvc_start(dev, NULL);
+    uvc_capture_t *cap = uvc_capture_start(ctx, dev, NULL);
+    if (!cap) { fprintf(stderr, "Cannot start capture\n"); return 1; }
 
     /* ── Phase 1: NO Stream Engine ── */
-    capture_stats(dev, "WITHOUT Stream Engine (no IR LEDs)", 30);
-
-    /* ── Phase 2: Start SE in child process ── */
-    int pipefd[2]; pipe(pipefd);
-    pid_t child = fork();
-    if (child == 0) {
-        close(pipefd[0]);
-        typedef struct tobii_api_t tobii_api_t;
-        typedef struct tobii_device_t tobii_device_t;
-        void *lib = dlopen("libtobii_stream_engine.so", RTLD_NOW);
-        if (!lib) { uint8_t f=0; write(pipefd[1],&f,1); close(pipefd[1]); _exit(1); }
-
-        int(*ac)(tobii_api_t**,void*,void*) = dlsym(lib,"tobii_api_create");
-        int(*en)(tobii_api_t*,void(*)(const char*,void*),void*) = dlsym(lib,"tobii_enumerate_local_device_urls");
-        int(*dc)(tobii_api_t*,const char*,int,tobii_device_t**) = dlsym(lib,"tobii_device_create");
-        int(*pc)(tobii_device_t*) = dlsym(lib,"tobii_device_process_callbacks");
-        int(*rc)(tobii_device_t*) = dlsym(lib,"tobii_device_reconnect");
-        typedef struct { int v; float f[3]; int v2; float f2[3]; long long ts; } go_t;
-        int(*gs)(tobii_device_t*,void(*)(const go_t*,void*),void*) = dlsym(lib,"tobii_gaze_origin_subscribe");
-
-        tobii_api_t *a=NULL; ac(&a,NULL,NULL);
-        char u[256]={0};
-        void ucb(const char *s, void *d) { char *b=d; if(!b[0]&&strlen(s)<255)strcpy(b,s); }
-        en(a, ucb, u);
-        tobii_device_t *d=NULL; dc(a,u,1,&d);
-        void gcb(const go_t *x, void *y) { (void)x;(void)y; }
-        gs(d, gcb, NULL);
-
-        /* Process a few times, then signal ready */
-        for(int i=0;i<20;i++){pc(d);usleep(50000);}
-        uint8_t ok=1; write(pipefd[1],&ok,1); close(pipefd[1]);
-
-        /* Keep running */
-        while(1) {
-            int e=pc(d);
-            if(e&&e!=3&&rc) rc(d);
-            usleep(5000);
-        }
-    }
-    close(pipefd[1]);
-    uint8_t rdy=0; read(pipefd[0],&rdy,1); close(pipefd[0]);
-    if (rdy) printf("\n[SE child ready, IR tracking active]\n");
-    else printf("\n[SE child FAILED]\n");
+    capture_stats(cap, NULL, NULL, "WITHOUT Stream Engine (no IR LEDs)", 30);
+
+    /* ── Phase 2: Stream Engine on a thread of this process ── */
+    gaze_stream_t *gs = gaze_stream_start(NULL);
+    if (gs) printf("\n[SE thread running, IR tracking active]\n");
+    else printf("\n[SE FAILED]\n");
 
     /* Let SE run a moment more */
     sleep(1);
 
-    capture_stats(dev, "WITH Stream Engine (IR LEDs pulsing)", 30);
+    capture_stats(cap, NULL, gs, "WITH Stream Engine (IR LEDs pulsing)", 30);
 
     /* Clean up */
-    kill(child, SIGTERM); waitpid(child, NULL, 0);
-    libusb_release_interface(dev, IF_VS);
-    libusb_release_interface(dev, IF_VC);
+    gaze_stream_stop(gs);
+    uvc_capture_stop(cap);
+    libusb_release_interface(dev, IF_VIDEO_STREAM);
+    libusb_release_interface(dev, IF_VIDEO_CONTROL);
     libusb_close(dev);
     libusb_exit(ctx);
-    printf("\nDone. Compare the bright frame counts and averages above.\n");
-    printf("If similar → IR LEDs were already pulsing (just invisible at 850nm)\n");
-    printf("If different → SE activation changes IR illumination\n");
+    print_verdict();
     return 0;
 }
@@ -14,9 +14,9 @@
 #include <stdint.h>
 #include <signal.h>
 #include <unistd.h>
-#include <dlfcn.h>
-#include <sys/wait.h>
+#include <time.h>
 #include <libusb.h>
+#include "../gaze_stream.h"
 
 #define TOBII_VID   0x2104
 #define TOBII_PID   0x0313
@@ -46,57 +46,20 @@ static int uvc_ctrl(libusb_device_handle *d, uint8_t req, uint8_t cs,
     return libusb_control_transfer(d, rt, req, (uint16_t)(cs<<8), intf, buf, len, 2000);
 }
 
-static pid_t se_pid = 0;
+/* Stream Engine runs on a thread of this process (../gaze_stream.c) */
+static gaze_stream_t *se_gs = NULL;
 
 static void start_se(void) {
-    int pipefd[2]; pipe(pipefd);
-    pid_t pid = fork();
-    if (pid == 0) {
-        close(pipefd[0]);
-        typedef struct tobii_api_t tobii_api_t;
-        typedef struct tobii_device_t tobii_device_t;
-        void *lib = dlopen("libtobii_stream_engine.so", RTLD_NOW);
-        if (!lib) { uint8_t f=0; write(pipefd[1],&f,1); close(pipefd[1]); _exit(1); }
-
-        int(*ac)(tobii_api_t**,void*,void*) = dlsym(lib,"tobii_api_create");
-        int(*en)(tobii_api_t*,void(*)(const char*,void*),void*) = dlsym(lib,"tobii_enumerate_local_device_urls");
-        int(*dc)(tobii_api_t*,const char*,int,tobii_device_t**) = dlsym(lib,"tobii_device_create");
-        int(*pc)(tobii_device_t*) = dlsym(lib,"tobii_device_process_callbacks");
-        int(*rc)(tobii_device_t*) = dlsym(lib,"tobii_device_reconnect");
-        typedef struct { int v; float f[3]; int v2; float f2[3]; long long ts; } go_t;
-        int(*gs)(tobii_device_t*,void(*)(const go_t*,void*),void*) = dlsym(lib,"tobii_gaze_origin_subscribe");
-
-        tobii_api_t *a=NULL; ac(&a,NULL,NULL);
-        char u[256]={0};
-        void ucb(const char *s, void *d) { char *b=d; if(!b[0]&&strlen(s)<255)strcpy(b,s); }
-        en(a, ucb, u);
-        tobii_device_t *d=NULL; dc(a,u,1,&d);
-        void gcb(const go_t *x, void *y) { (void)x;(void)y; }
-        gs(d, gcb, NULL);
-        for(int i=0;i<20;i++){pc(d);usleep(50000);}
-        uint8_t ok=1; write(pipefd[1],&ok,1); close(pipefd[1]);
-
-        /* Keep running with reconnect */
-        int errs = 0;
-        while(1) {
-            int e=pc(d);
-            if(e == 0 || e == 3) { errs=0; usleep(5000); }
-            else {
-                errs++;
-                if (errs % 100 == 1) fprintf(stderr, "[SE-child] error %d, reconnecting...\n", e);
-                if(rc) { int re = rc(d); if(re==0) { gs(d,gcb,NULL); errs=0; fprintf(stderr,"[SE-child] reconnected\n"); } }
-                usleep(20000);
-            }
-        }
-    }
-    close(pipefd[1]);
-    se_pid = pid;
-    uint8_t rdy=0; read(pipefd[0],&rdy,1); close(pipefd[0]);
-    printf("  SE child pid=%d, ready=%d\n", pid, rdy);
+    se_gs = gaze_stream_start(NULL);
+    if (se_gs) sleep(1);        /* let the subscription activate */
+    gaze_stream_stats_t st = {0};
+    if (se_gs) gaze_stream_get_stats(se_gs, &st);
+    printf("  SE thread ready=%d, %llu gaze samples\n", se_gs != NULL, (unsigned long long)st.samples);
 }
 
 static void stop_se(void) {
-    if (se_pid > 0) { kill(se_pid, SIGTERM); waitpid(se_pid,NULL,0); se_pid=0; }
+    gaze_stream_stop(se_gs);
+    se_gs = NULL;
 }
 
 static void wait_and_ask(const char *msg) {
@@ -187,6 +150,15 @@ int main() {
         r = libusb_bulk_transfer(dev, EP_IN, buf, sizeof(buf), &xferred, 500);
         printf("  [%d] r=%d, %d bytes\n", i, r, xferred);
     }
+    gaze_sample_t g;
+    if (se_gs && gaze_stream_latest(se_gs, &g) == 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        int64_t now_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+        printf("  gaze_origin alongside: sample %llu, %.1f ms old\n",
+               (unsigned long long)g.seq, (now_ns - g.recv_ns) / 1e6);
+    }
+
     wait_and_ask("STEP 10: After 10 bulk reads. LEDs still on?");
 
     /* ── Cleanup ── */
@@ -0,0 +1,262 @@
+/*
+ * metrics_bench.c — Cost and correctness check for metrics.h
+ *
+ * Times the hot path (metrics_inc, metrics_observe_ns) on one thread and
+ * on several at once, each with its own shard, next to a shared counter
+ * bumped with an atomic add from every thread (what a single global
+ * counter costs once threads contend for its line). Then checks that a
+ * scrape sums the shards exactly, that histogram buckets are cumulative
+ * and end at the count, also in scrapes taken while threads observe,
+ * and that the Unix socket endpoint answers both a bare connection and
+ * an HTTP GET.
+ *
+ * Build & run:
+ *   make bench
+ *   ./build/metrics_bench [-n records-per-thread]
+ *
+ * Needs no hardware.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "../metrics.h"
+
+#define THREADS     4
+#define INC_MAX_NS  5.0         /* hot-path budget per record */
+#define OBS_MAX_NS  10.0
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+typedef struct {
+    metrics_t *m;
+    int        counter, hist;
+    long       n;
+    int        mode;            /* 0 = inc, 1 = observe, 2 = shared atomic */
+    double     ns;              /* per record */
+    pthread_barrier_t *go;
+} worker_t;
+
+static uint64_t shared_counter;
+
+static void *worker(void *arg)
+{
+    worker_t *w = arg;
+    metrics_shard_t *sh = metrics_shard(w->m);
+    if (!sh) return NULL;
+    pthread_barrier_wait(w->go);
+    uint64_t t0 = now_ns();
+    switch (w->mode) {
+    case 0:
+        for (long i = 0; i < w->n; i++) metrics_inc(sh, w->counter);
+        break;
+    case 1:
+        for (long i = 0; i < w->n; i++) metrics_observe_ns(sh, w->hist, (i & 1023) * 1000);
+        break;
+    default:
+        for (long i = 0; i < w->n; i++) __atomic_fetch_add(&shared_counter, 1, __ATOMIC_RELAXED);
+    }
+    w->ns = (double)(now_ns() - t0) / w->n;
+    return NULL;
+}
+
+/* Mean ns per record over nthr threads running mode at once */
+static double run(metrics_t *m, int counter, int hist, int mode, int nthr, long n)
+{
+    pthread_t tid[THREADS];
+    worker_t w[THREADS];
+    pthread_barrier_t go;
+    pthread_barrier_init(&go, NULL, (unsigned)nthr);
+    for (int i = 0; i < nthr; i++) {
+        w[i] = (worker_t){ m, counter, hist, n, mode, 0, &go };
+        pthread_create(&tid[i], NULL, worker, &w[i]);
+    }
+    double sum = 0;
+    for (int i = 0; i < nthr; i++) {
+        pthread_join(tid[i], NULL);
+        sum += w[i].ns;
+    }
+    pthread_barrier_destroy(&go);
+    return sum / nthr;
+}
+
+/* Value of the first sample line starting with series, -1 if none */
+static double sample(const char *text, const char *series)
+{
+    size_t len = strlen(series);
+    for (const char *p = text; p && *p; p = strchr(p, '\n'), p = p ? p + 1 : NULL)
+        if (!strncmp(p, series, len) && p[len] == ' ') return atof(p + len + 1);
+    return -1;
+}
+
+/* Histogram buckets never decrease and +Inf equals _count */
+static int buckets_ok(const char *text, const char *name)
+{
+    char prefix[128];
+    snprintf(prefix, sizeof(prefix), "%s_bucket{", name);
+    double last = 0;
+    int n = 0;
+    for (const char *p = strstr(text, prefix); p; p = strstr(p + 1, prefix)) {
+        const char *sp = strchr(p, ' ');
+        double v = sp ? atof(sp + 1) : -1;
+        if (v < last) return 0;
+        last = v;
+        n++;
+    }
+    char count[128];
+    snprintf(count, sizeof(count), "%s_count", name);
+    return n > 1 && last == sample(text, count);
+}
+
+typedef struct {
+    metrics_t *m;
+    int        counter, hist;
+    long       n;
+    int        done;
+} racer_t;
+
+static void *observers(void *arg)
+{
+    racer_t *r = arg;
+    run(r->m, r->counter, r->hist, 1, THREADS, r->n);
+    __atomic_store_n(&r->done, 1, __ATOMIC_RELEASE);
+    return NULL;
+}
+
+/* Scrape until THREADS threads have each observed n values; returns how
+ * many scrapes had buckets out of order or not ending at _count (of
+ * *taken) */
+static int scrape_race(metrics_t *m, int counter, int hist, long n, int *taken)
+{
+    racer_t r = { m, counter, hist, n, 0 };
+    pthread_t tid;
+    pthread_create(&tid, NULL, observers, &r);
+    int bad = 0;
+    *taken = 0;
+    while (!__atomic_load_n(&r.done, __ATOMIC_ACQUIRE)) {
+        char *text = NULL;
+        size_t len = 0;
+        FILE *out = open_memstream(&text, &len);
+        metrics_write(m, out);
+        fclose(out);
+        bad += !buckets_ok(text, "bench_observe_seconds");
+        free(text);
+        (*taken)++;
+    }
+    pthread_join(tid, NULL);
+    return bad;
+}
+
+/* Connect to the Unix endpoint, optionally send a GET, read it all */
+static char *fetch(const char *path, int http)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    struct sockaddr_un sa = { .sun_family = AF_UNIX };
+    snprintf(sa.sun_path, sizeof(sa.sun_path), "%s", path);
+    if (fd < 0 || connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        if (fd >= 0) close(fd);
+        return NULL;
+    }
+    if (http) {
+        const char *req = "GET /metrics HTTP/1.0\r\n\r\n";
+        if (write(fd, req, strlen(req)) < 0) { close(fd); return NULL; }
+    }
+    size_t cap = 1 << 16, len = 0;
+    char *buf = malloc(cap + 1);
+    ssize_t r;
+    while (buf && len < cap && (r = read(fd, buf + len, cap - len)) > 0) len += (size_t)r;
+    close(fd);
+    if (buf) buf[len] = 0;
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    long n = 20000000;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) n = atol(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [-n records-per-thread]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    metrics_t *m = metrics_create("bench");
+    if (!m) return 1;
+    int c = metrics_counter(m, "records_total", "kind=\"inc\"", "metrics_inc calls");
+    int g = metrics_gauge(m, "threads", NULL, "Recording threads");
+    int h = metrics_histogram(m, "observe_seconds", NULL, "metrics_observe_ns values");
+    metrics_set(m, g, THREADS);
+
+    /* ── Cost ──────────────────────────────────────────────────────── */
+    printf("Hot path, %ld records per thread:\n", n);
+    double inc1 = run(m, c, h, 0, 1, n);
+    double obs1 = run(m, c, h, 1, 1, n);
+    double incN = run(m, c, h, 0, THREADS, n);
+    double obsN = run(m, c, h, 1, THREADS, n);
+    double atoN = run(m, c, h, 2, THREADS, n);
+    printf("  metrics_inc          1 thread  %6.2f ns   %d threads %6.2f ns\n", inc1, THREADS, incN);
+    printf("  metrics_observe_ns   1 thread  %6.2f ns   %d threads %6.2f ns\n", obs1, THREADS, obsN);
+    printf("  shared atomic add                        %d threads %6.2f ns\n", THREADS, atoN);
+
+    /* ── Scrape ────────────────────────────────────────────────────── */
+    char *text = NULL;
+    size_t len = 0;
+    FILE *out = open_memstream(&text, &len);
+    metrics_write(m, out);
+    fclose(out);
+    double want = (double)n * (1 + THREADS);
+    double got = sample(text, "bench_records_total{kind=\"inc\"}");
+    double cnt = sample(text, "bench_observe_seconds_count");
+    int sums = got == want && cnt == want && sample(text, "bench_threads") == THREADS;
+    int hist = buckets_ok(text, "bench_observe_seconds");
+    printf("\nScrape: %zu bytes, counter %.0f of %.0f, histogram count %.0f, buckets %s\n",
+           len, got, want, cnt, hist ? "cumulative" : "BROKEN");
+    free(text);
+    int taken, racy = scrape_race(m, c, h, n, &taken);
+    printf("Scrapes while observing: %d of %d with buckets off _count\n", racy, taken);
+
+    /* ── Endpoint ──────────────────────────────────────────────────── */
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/metrics_bench.%d.sock", (int)getpid());
+    char where[80];
+    snprintf(where, sizeof(where), "unix:%s", path);
+    int served = metrics_serve(m, where) == 0;
+    char *bare = served ? fetch(path, 0) : NULL;
+    char *http = served ? fetch(path, 1) : NULL;
+    int ep = bare && http && !strncmp(bare, "# HELP ", 7) &&
+             !strncmp(http, "HTTP/1.0 200 OK\r\n", 17) && strstr(http, "\r\n\r\n# HELP ");
+    printf("Endpoint %s: bare %s, HTTP %s\n", path, bare ? "answered" : "no answer",
+           http ? "answered" : "no answer");
+    free(bare);
+    free(http);
+    metrics_destroy(m);
+    if (served && access(path, F_OK) == 0) ep = 0;      /* socket left behind */
+
+    if (!sums || !hist || racy || !ep) {
+        printf("\n[FAIL] %s\n", !sums ? "scrape lost records" : !hist ? "histogram buckets"
+                                : racy ? "histogram buckets during observation" : "endpoint");
+        return 1;
+    }
+    if (inc1 > INC_MAX_NS || obs1 > OBS_MAX_NS) {
+        printf("\n[FAIL] hot path over budget (%.0f / %.0f ns)\n", INC_MAX_NS, OBS_MAX_NS);
+        return 1;
+    }
+    printf("\n[OK]\n");
+    return 0;
+}
@@ -0,0 +1,96 @@
+/*
+ * pose_shm_read.c — Follow the squig-headtrackd shared-memory pose
+ *
+ * Maps the pose segment (pose_shm.h) and prints each new pose as it is
+ * published, woken by the segment's futex rather than polling. Once a
+ * second it prints the rate and how long poses took from publish to
+ * this reader (CLOCK_MONOTONIC, both sides on this machine).
+ *
+ * Build & run:
+ *   make build/pose_shm_read
+ *   ./build/pose_shm_read [--name /squig-headpose] [--quiet] [--poll HZ]
+ *     --poll HZ   read at a fixed rate instead of waiting (like a game loop)
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <time.h>
+#include "../pose_shm.h"
+
+static volatile sig_atomic_t g_running = 1;
+static void sig_handler(int s) { (void)s; g_running = 0; }
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = NULL;
+    int quiet = 0, poll_hz = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--name") && i + 1 < argc) name = argv[++i];
+        else if (!strcmp(argv[i], "--quiet")) quiet = 1;
+        else if (!strcmp(argv[i], "--poll") && i + 1 < argc) poll_hz = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "Usage: %s [--name /squig-headpose] [--quiet] [--poll HZ]\n", argv[0]);
+            return 1;
+        }
+    }
+    signal(SIGINT, sig_handler);
+    signal(SIGTERM, sig_handler);
+
+    pose_shm_reader_t *r = pose_shm_open(name);
+    if (!r) {
+        fprintf(stderr, "No pose segment %s (is squig-headtrackd running?)\n",
+                name ? name : POSE_SHM_DEFAULT_NAME);
+        return 1;
+    }
+
+    uint64_t n = 0, lat_sum = 0, lat_max = 0, missed = 0, last_count = 0;
+    uint64_t t_last = now_ns();
+    while (g_running) {
+        if (poll_hz > 0) {
+            struct timespec ts = { 0, 1000000000L / poll_hz };
+            nanosleep(&ts, NULL);
+        } else if (pose_shm_wait(r, 200) < 0) {
+            if (!pose_shm_writer_alive(r)) fprintf(stderr, "(no writer)\r");
+            continue;
+        }
+
+        pose_shm_pose_t p;
+        if (pose_shm_read(r, &p) > 0) {
+            uint64_t lat = now_ns() - p.publish_ns;
+            n++;
+            lat_sum += lat;
+            if (lat > lat_max) lat_max = lat;
+            if (last_count && p.count > last_count + 1) missed += p.count - last_count - 1;
+            last_count = p.count;
+            if (!quiet)
+                printf("#%-8llu x=%7.1f y=%7.1f z=%7.1f  yaw=%6.1f pitch=%6.1f roll=%6.1f  "
+                       "conf=%.2f  %5.1f us\n", (unsigned long long)p.count,
+                       p.x, p.y, p.z, p.yaw, p.pitch, p.roll, p.confidence, lat / 1000.0);
+        }
+
+        uint64_t t = now_ns();
+        if (t - t_last >= 1000000000ull) {
+            double secs = (t - t_last) / 1e9;
+            fprintf(stderr, "[SHM] %5.1f poses/s  publish->read avg %.1f us  max %.1f us  "
+                    "skipped %llu\n", n / secs, n ? lat_sum / 1000.0 / n : 0.0,
+                    lat_max / 1000.0, (unsigned long long)missed);
+            n = lat_sum = lat_max = missed = 0;
+            t_last = t;
+        }
+    }
+    pose_shm_close(r);
+    return 0;
+}
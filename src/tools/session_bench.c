@@ -0,0 +1,641 @@
+/*
+ * session_bench.c — Replay a recorded session through the tracking pipeline
+ *
+ * Reads a session log (session_log.h, recorded with session_rec or
+ * synthesised here) and pushes its gaze_origin samples through exactly
+ * the code squig-headtrackd runs (gaze_fusion.h: gaze_point and
+ * eye_position_normalized aligned to each sample, in log order;
+ * head_tracker.h: head-model calibration, batched EKF update, then
+ * look-ahead and pose output), as fast as it will go. Reports:
+ *
+ *   throughput   samples/s and how many times faster than real time
+ *   stages       ns per sample for log decode, calib, filter and output
+ *   head model   what the streaming calibration (head_calib.h) settled on
+ *   accuracy     against the log's truth records or a --truth CSV
+ *                (timestamp_us,x,y,z,yaw,pitch,roll on the SE clock; mm,
+ *                degrees — e.g. an ArUco or opentrack capture), checked
+ *                against the Option C criteria: yaw ±2°, pitch ±4°,
+ *                translation ±3 mm (95th percentile), and on the
+ *                synthetic session against the p95 this tree gets
+ *                (synth_baseline below)
+ *   away         the user leaves for 30 s (samples cut out of the replay):
+ *                the first poses back, resumed warm as the daemon does
+ *                after a presence pause, and reseeded
+ *
+ * Without --session it writes the synth_head.h session (120 s at 90 Hz,
+ * with eye_position_normalized and gaze_point streams and 120 Hz truth,
+ * for a user whose head model is not the EKF default) to a temporary log
+ * and replays that, so `make bench` needs no hardware. Its gaze point
+ * follows head_gaze.h's model (the head takes its share of where the
+ * eyes look, plus eye-only wander and noise), so the gaze pitch rows are
+ * exercised; points that fall off the display are reported invalid.
+ * Poses are compared with the truth at the time they are meant for: the
+ * sample's arrival plus --lookahead with the predictor on, the sample's
+ * timestamp_us with --no-predict. The tracker reports motion
+ * from where tracking started and the reference has its own origin, so
+ * each channel's mean offset is removed (and printed) before scoring.
+ *
+ * The synthetic session does not meet Option C yet: yaw does, but
+ * translation (6-9 mm p95) and pitch (4.5°) miss. So `make bench` does
+ * not fail on the criteria; it fails when an axis gets more than
+ * BASELINE_TOL worse than synth_baseline, the p95 recorded when the
+ * pipeline last changed. Run with the stock options (calibration, gaze
+ * fusion, look-ahead at the default) for that check; re-record the
+ * baseline in the same commit as a change that moves it.
+ *
+ * Build & run:
+ *   make bench
+ *   ./build/session_bench [--session run.sqsl] [--truth ref.csv] [--write out.sqsl]
+ *                         [--repeat N] [--lookahead MS | --no-predict] [--no-calib]
+ *                         [--origin-only] [--strict]
+ *     --no-calib     keep the EKF's default head model (no calib stage)
+ *     --origin-only  gaze_origin alone (no gaze_point / track-box fusion)
+ *     --strict       exit 1 when a criterion is missed (default: report only; the
+ *                    synthetic session's baseline is always enforced)
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include "../head_tracker.h"
+#include "../session_log.h"
+#include "../gaze_fusion.h"
+#include "synth_head.h"
+
+#define SYNTH_SECONDS   120
+#define SYNTH_LATENCY   25000       /* us, sample -> host arrival */
+#define TRUTH_RATE_HZ   120.0
+#define SETTLE_US       1000000     /* not scored: first second after the start */
+#define AWAY_AT_US      40000000    /* away check: the user leaves 40 s in... */
+#define AWAY_FOR_US     30000000    /* ...for 30 s */
+#define AWAY_REF_US     10000000    /* reference offset from the 10 s before */
+#define AWAY_POSES      5           /* poses scored after the return */
+#define SYNTH_HABIT_ELEV (2 * SYNTH_DEG)   /* where the synthetic user looks at pitch 0 */
+
+/* The synthetic user's head model: not the EKF defaults, so calibration
+ * has something to find */
+static const double synth_user[3] = { 66.0, 135.0, 30.0 };    /* ipd, eye_up, eye_fwd */
+/* The synthetic head sweeps ±18° of pitch, more than a display's worth of
+ * gaze at the default head share, so its eyes follow with a larger one */
+static const head_gaze_config_t synth_gaze = { 336.0, 10.0, 0.8, 0.14, 900, 0.6 };
+static int calibrate = 1;
+static int fuse_gaze = 1;
+static const head_gaze_config_t *gaze_cfg;     /* NULL: HEAD_GAZE_DEFAULTS */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+typedef struct {
+    head_tracker_sample_t s;
+    int64_t recv_us;
+} replay_sample_t;
+
+typedef struct {
+    int64_t t_us;
+    double  v[6];               /* mm, degrees */
+} truth_t;
+
+typedef struct {
+    replay_sample_t *samples;
+    size_t           n, cap;
+    truth_t         *truth;
+    size_t           nt, tcap;
+    uint64_t         counts[SESSION_REC_TYPES];
+    uint64_t         records;
+    gaze_fusion_t    fusion;        /* aligns at decode, as the daemon does at pop */
+} session_t;
+
+static int grow(void **p, size_t *cap, size_t n, size_t elem)
+{
+    if (n < *cap) return 0;
+    size_t c = *cap ? *cap * 2 : 4096;
+    void *q = realloc(*p, c * elem);
+    if (!q) return -1;
+    *p = q;
+    *cap = c;
+    return 0;
+}
+
+/* ── Synthetic recording ────────────────────────────────────────────── */
+
+/* eye_position_normalized: a 500 x 500 x 500 mm track box from 400 mm out */
+static double synth_box(const double eye[3], int k)
+{
+    return k == 2 ? (eye[2] - 400.0) / 500.0 : 0.5 + eye[k] / 500.0;
+}
+
+static int write_synthetic(const char *path)
+{
+    head_ekf_config_t cfg = HEAD_EKF_DEFAULTS;
+    cfg.ipd = synth_user[0];
+    cfg.eye_up = synth_user[1];
+    cfg.eye_fwd = synth_user[2];
+    int n = (int)(SYNTH_SECONDS * SYNTH_RATE_HZ);
+    synth_sample_t *s = calloc((size_t)n, sizeof(*s));
+    if (!s) return -1;
+    synth_make_session(s, n, &cfg);
+
+    session_log_writer_t *w = session_log_create(path);
+    if (!w) {
+        free(s);
+        return -1;
+    }
+    const int64_t t0 = 1000000000;          /* SE clocks do not start at 0 */
+    double next_truth = 0;
+    for (int i = 0; i < n; i++) {
+        int64_t ts = t0 + (int64_t)(s[i].t * 1e6);
+        session_rec_t r = { 0 };
+
+        /* Reference pose at 120 Hz, on its own schedule */
+        for (; next_truth <= s[i].t; next_truth += 1.0 / TRUTH_RATE_HZ) {
+            double x[6];
+            synth_truth(next_truth, x);
+            session_rec_t tr = { .type = SESSION_REC_TRUTH, .valid = SESSION_VALID_LEFT };
+            tr.timestamp_us = tr.recv_us = t0 + (int64_t)(next_truth * 1e6);
+            for (int k = 0; k < 3; k++) tr.v[k] = x[k];
+            for (int k = 3; k < 6; k++) tr.v[k] = x[k] / SYNTH_DEG;
+            session_log_write(w, &tr);
+        }
+
+        r.type = SESSION_REC_GAZE_ORIGIN;
+        r.valid = (s[i].lv ? SESSION_VALID_LEFT : 0) | (s[i].rv ? SESSION_VALID_RIGHT : 0);
+        r.timestamp_us = ts;
+        r.recv_us = ts + SYNTH_LATENCY + (int64_t)(synth_uniform() * 2000.0);
+        memcpy(r.v, s[i].left, sizeof(s[i].left));
+        memcpy(r.v + 3, s[i].right, sizeof(s[i].right));
+        session_log_write(w, &r);
+
+        r.type = SESSION_REC_EYE_POS_NORM;
+        for (int k = 0; k < 3; k++) {
+            r.v[k]     = synth_box(s[i].left, k);
+            r.v[3 + k] = synth_box(s[i].right, k);
+        }
+        session_log_write(w, &r);
+
+        /* Eyes at the elevation the head's pitch implies, plus their own
+         * wander and noise; a point off the display is not valid */
+        const head_gaze_config_t gc = synth_gaze;
+        double my = 0.5 * (s[i].left[1] + s[i].right[1]), mz = 0.5 * (s[i].left[2] + s[i].right[2]);
+        double e = SYNTH_HABIT_ELEV + s[i].pose[HEAD_EKF_PITCH] / gc.gain +
+                   3 * SYNTH_DEG * sin(2 * M_PI * 0.41 * s[i].t) + 1.5 * SYNTH_DEG * synth_gauss();
+        double gy = 1.0 - (my + tan(e) * mz - gc.screen_up) / gc.screen_h;
+        r.type = SESSION_REC_GAZE_POINT;
+        r.valid = (s[i].lv || s[i].rv) && gy >= 0.0 && gy <= 1.0 ? SESSION_VALID_LEFT : 0;
+        r.v[0] = 0.5 + 0.3 * sin(s[i].t);
+        r.v[1] = gy;
+        r.timestamp_us = ts + (int64_t)(synth_uniform() * 4000.0) - 2000;      /* own clock edge */
+        session_log_write(w, &r);
+    }
+    free(s);
+    return session_log_close(w);
+}
+
+/* ── Loading ────────────────────────────────────────────────────────── */
+
+static int cmp_truth(const void *a, const void *b)
+{
+    int64_t x = ((const truth_t *)a)->t_us, y = ((const truth_t *)b)->t_us;
+    return (x > y) - (x < y);
+}
+
+/* Decode the whole log once, timing the decode. */
+static int load_session(session_log_reader_t *r, session_t *ss, double *ns_per_rec)
+{
+    session_rec_t rec;
+    int rc;
+    if (gaze_fusion_init(&ss->fusion, NULL, 64) < 0) return -1;
+    uint64_t t0 = now_ns();
+    while ((rc = session_log_next(r, &rec)) > 0) {
+        ss->records++;
+        if (rec.type < SESSION_REC_TYPES) ss->counts[rec.type]++;
+        if (rec.type == SESSION_REC_GAZE_POINT && fuse_gaze) {
+            tobii_gaze_point_t gp = { rec.timestamp_us, (rec.valid & SESSION_VALID_LEFT) ?
+                                      TOBII_VALIDITY_VALID : TOBII_VALIDITY_INVALID,
+                                      { rec.v[0], rec.v[1] } };
+            gaze_fusion_push_point(&ss->fusion, &gp);
+        } else if (rec.type == SESSION_REC_EYE_POS_NORM && fuse_gaze) {
+            tobii_eye_position_normalized_t ep = { 0 };
+            ep.timestamp_us = rec.timestamp_us;
+            ep.left_validity = (rec.valid & SESSION_VALID_LEFT) ? TOBII_VALIDITY_VALID : TOBII_VALIDITY_INVALID;
+            ep.right_validity = (rec.valid & SESSION_VALID_RIGHT) ? TOBII_VALIDITY_VALID : TOBII_VALIDITY_INVALID;
+            for (int k = 0; k < 3; k++) {
+                ep.left_xyz[k] = rec.v[k];
+                ep.right_xyz[k] = rec.v[3 + k];
+            }
+            gaze_fusion_push_eyes(&ss->fusion, &ep);
+        } else if (rec.type == SESSION_REC_GAZE_ORIGIN) {
+            if (grow((void **)&ss->samples, &ss->cap, ss->n, sizeof(*ss->samples)) < 0) return -1;
+            replay_sample_t *p = &ss->samples[ss->n++];
+            memset(&p->s, 0, sizeof(p->s));
+            p->s.timestamp_us = rec.timestamp_us;
+            p->s.left_valid  = !!(rec.valid & SESSION_VALID_LEFT);
+            p->s.right_valid = !!(rec.valid & SESSION_VALID_RIGHT);
+            memcpy(p->s.left, rec.v, sizeof(p->s.left));
+            memcpy(p->s.right, rec.v + 3, sizeof(p->s.right));
+            p->recv_us = rec.recv_us;
+            if (fuse_gaze) gaze_fusion_align(&ss->fusion, &p->s);
+        } else if (rec.type == SESSION_REC_TRUTH && (rec.valid & SESSION_VALID_LEFT)) {
+            if (grow((void **)&ss->truth, &ss->tcap, ss->nt, sizeof(*ss->truth)) < 0) return -1;
+            truth_t *t = &ss->truth[ss->nt++];
+            t->t_us = rec.timestamp_us;
+            memcpy(t->v, rec.v, sizeof(t->v));
+        }
+    }
+    *ns_per_rec = ss->records ? (double)(now_ns() - t0) / ss->records : 0;
+    if (rc < 0) fprintf(stderr, "  (log truncated after %llu records)\n",
+                        (unsigned long long)ss->records);
+    return 0;
+}
+
+/* Replace any truth from the log with a CSV: timestamp_us,x,y,z,yaw,pitch,roll */
+static int load_truth_csv(const char *path, session_t *ss)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return -1;
+    }
+    ss->nt = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        long long t;
+        truth_t v;
+        if (sscanf(line, "%lld,%lf,%lf,%lf,%lf,%lf,%lf", &t, &v.v[0], &v.v[1], &v.v[2],
+                   &v.v[3], &v.v[4], &v.v[5]) != 7)
+            continue;                       /* header, comments */
+        v.t_us = t;
+        if (grow((void **)&ss->truth, &ss->tcap, ss->nt, sizeof(*ss->truth)) < 0) break;
+        ss->truth[ss->nt++] = v;
+    }
+    fclose(f);
+    return 0;
+}
+
+/* Linear interpolation; 0 outside the reference's span or across a gap */
+static int truth_at(const session_t *ss, int64_t t_us, size_t *hint, double out[6])
+{
+    const truth_t *tr = ss->truth;
+    size_t i = *hint;
+    if (ss->nt < 2 || t_us < tr[0].t_us || t_us > tr[ss->nt - 1].t_us) return 0;
+    if (i >= ss->nt - 1 || tr[i].t_us > t_us) i = 0;
+    while (i + 1 < ss->nt - 1 && tr[i + 1].t_us <= t_us) i++;
+    *hint = i;
+    int64_t span = tr[i + 1].t_us - tr[i].t_us;
+    if (span <= 0 || span > 100000) return 0;
+    double a = (double)(t_us - tr[i].t_us) / (double)span;
+    for (int k = 0; k < 6; k++) out[k] = tr[i].v[k] + a * (tr[i + 1].v[k] - tr[i].v[k]);
+    return 1;
+}
+
+/* ── Replay ─────────────────────────────────────────────────────────── */
+
+static int64_t target_us(const replay_sample_t *p, const pose_predict_config_t *pc)
+{
+    return pc ? p->recv_us + (int64_t)(pc->lookahead_ms * 1e3) : p->s.timestamp_us;
+}
+
+static void tracker_init(head_tracker_t *t, const pose_predict_config_t *pc)
+{
+    head_tracker_init(t, NULL, pc);
+    if (calibrate) head_tracker_calibrate(t, NULL, NULL);
+    if (fuse_gaze) head_tracker_use_gaze(t, gaze_cfg);
+}
+
+static double replay_throughput(const session_t *ss, const pose_predict_config_t *pc,
+                                int repeat, double *sink)
+{
+    head_tracker_t t;
+    uint64_t t0 = now_ns();
+    for (int it = 0; it < repeat; it++) {
+        tracker_init(&t, pc);
+        for (size_t i = 0; i < ss->n; i++) {
+            head_tracker_pose_t pose;
+            head_tracker_update(&t, &ss->samples[i].s, ss->samples[i].recv_us, &pose);
+            *sink += pose.yaw;
+        }
+    }
+    return (double)(now_ns() - t0) / ((double)ss->n * repeat);
+}
+
+static void replay_stages(const session_t *ss, const pose_predict_config_t *pc,
+                          double ns_stage[3], double *sink)
+{
+    /* clock_gettime() itself, subtracted from each stage */
+    uint64_t c0 = now_ns();
+    for (int i = 0; i < 10000; i++) *sink += (double)(now_ns() & 1);
+    double overhead = (double)(now_ns() - c0) / 10000;
+
+    head_tracker_t t;
+    tracker_init(&t, pc);
+    uint64_t sum[3] = { 0 };
+    for (size_t i = 0; i < ss->n; i++) {
+        head_tracker_pose_t pose;
+        uint64_t a = now_ns();
+        head_tracker_calib(&t, &ss->samples[i].s);
+        uint64_t b = now_ns();
+        head_tracker_filter(&t, &ss->samples[i].s);
+        uint64_t c = now_ns();
+        head_tracker_output(&t, &ss->samples[i].s, ss->samples[i].recv_us, &pose);
+        uint64_t e = now_ns();
+        sum[0] += b - a;
+        sum[1] += c - b;
+        sum[2] += e - c;
+        *sink += pose.pitch;
+    }
+    for (int k = 0; k < 3; k++) ns_stage[k] = fmax(0, (double)sum[k] / ss->n - overhead);
+}
+
+/* ── Accuracy ───────────────────────────────────────────────────────── */
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static const char *const axis_names[6] = { "tx", "ty", "tz", "yaw", "pitch", "roll" };
+static const char *const axis_units[6] = { "mm", "mm", "mm", "deg", "deg", "deg" };
+static const double criteria[6] = { 3.0, 3.0, 3.0, 2.0, 4.0, 0.0 };    /* p95, 0 = none */
+
+/* p95 on the synthetic session with the stock options, and how much worse
+ * (relative) still passes: the session is fixed-seed, so only compiler and
+ * libm differences (and the float32 build, ~1e-4) move it */
+static const double synth_baseline[6] = { 6.47, 3.96, 8.47, 1.90, 4.50, 1.01 };
+#define BASELINE_TOL    0.05
+
+/* Returns the number of criteria missed, -1 without usable truth; p95
+ * gets each axis's 95th percentile. */
+static int replay_accuracy(const session_t *ss, const pose_predict_config_t *pc, int synthetic,
+                           double p95[6])
+{
+    double *err[6];
+    double mean[6] = { 0 };
+    size_t m = 0, hint = 0;
+    for (int k = 0; k < 6; k++) err[k] = malloc(ss->n * sizeof(double));
+    if (!err[0] || !err[1] || !err[2] || !err[3] || !err[4] || !err[5]) {
+        for (int k = 0; k < 6; k++) free(err[k]);
+        return -1;
+    }
+
+    head_tracker_t t;
+    tracker_init(&t, pc);
+    int64_t start = ss->n ? ss->samples[0].s.timestamp_us : 0;
+    for (size_t i = 0; i < ss->n; i++) {
+        const replay_sample_t *p = &ss->samples[i];
+        head_tracker_pose_t pose;
+        head_tracker_update(&t, &p->s, p->recv_us, &pose);
+        double ref[6];
+        if (!t.ekf.seeded || p->s.timestamp_us - start < SETTLE_US) continue;
+        if (!truth_at(ss, target_us(p, pc), &hint, ref)) continue;
+        const double est[6] = { pose.x, pose.y, pose.z, pose.yaw, pose.pitch, pose.roll };
+        for (int k = 0; k < 6; k++) {
+            err[k][m] = est[k] - ref[k];
+            mean[k] += err[k][m];
+        }
+        m++;
+    }
+    if (calibrate) {
+        head_calib_model_t hm;
+        head_calib_model(&t.calib, &hm);
+        printf("\n  head model  ipd %.1f ±%.1f, eye_up %.1f ±%.1f, eye_fwd %.1f ±%.1f mm "
+               "(%llu samples, %llu model updates)\n", hm.ipd, sqrt(hm.var[0]), hm.eye_up,
+               sqrt(hm.var[1]), hm.eye_fwd, sqrt(hm.var[2]), (unsigned long long)hm.samples,
+               (unsigned long long)t.model_updates);
+        if (synthetic)
+            printf("              synthetic user: ipd %.1f, eye_up %.1f, eye_fwd %.1f mm\n",
+                   synth_user[0], synth_user[1], synth_user[2]);
+    }
+    if (fuse_gaze)
+        printf("  gaze fusion %.0f%% of samples with a gaze point, %llu pitch rows batched "
+               "(%llu off the display), %llu with an eye outside the track box\n",
+               ss->fusion.aligned ? 100.0 * ss->fusion.with_gaze / ss->fusion.aligned : 0.0,
+               (unsigned long long)t.gaze.updates, (unsigned long long)t.gaze.rejected,
+               (unsigned long long)t.inconsistent);
+    if (m < 2) {
+        printf("\n  accuracy: no reference pose covers the replay (give --truth)\n");
+        for (int k = 0; k < 6; k++) free(err[k]);
+        return -1;
+    }
+
+    int missed = 0;
+    printf("\n  accuracy over %zu poses (reference offset removed, pose %s):\n", m,
+           pc ? "at emission + look-ahead" : "at timestamp_us");
+    printf("             %9s %9s %9s %9s   criterion (p95)\n", "offset", "RMS", "p95", "max");
+    for (int k = 0; k < 6; k++) {
+        mean[k] /= (double)m;
+        double ss2 = 0;
+        for (size_t i = 0; i < m; i++) {
+            err[k][i] = fabs(err[k][i] - mean[k]);
+            ss2 += err[k][i] * err[k][i];
+        }
+        qsort(err[k], m, sizeof(double), cmp_double);
+        p95[k] = err[k][(size_t)(0.95 * (double)(m - 1))];
+        printf("  %-6s %-3s %9.2f %9.2f %9.2f %9.2f", axis_names[k], axis_units[k], mean[k],
+               sqrt(ss2 / (double)m), p95[k], err[k][m - 1]);
+        if (criteria[k] > 0) {
+            int ok = p95[k] <= criteria[k];
+            missed += !ok;
+            printf("   ±%.0f %s  %s", criteria[k], axis_units[k], ok ? "PASS" : "MISS");
+        }
+        printf("\n");
+        free(err[k]);
+    }
+    return missed;
+}
+
+/* The user leaves AWAY_AT_US into the session and comes back AWAY_FOR_US
+ * later (the samples in between are skipped, as the daemon's paused
+ * streams would not deliver them). Scores the first AWAY_POSES poses
+ * after the return against the offset the pose had before leaving, so
+ * an output origin that moved counts as error. warm: resumed with
+ * head_tracker_resume(), as the daemon does; otherwise reseeded. */
+static void away_errors(const session_t *ss, const pose_predict_config_t *pc, int warm,
+                        double worst[3])
+{
+    head_tracker_t t;
+    tracker_init(&t, pc);
+    int64_t start = ss->samples[0].s.timestamp_us;
+    double off[6] = { 0 };
+    size_t n_off = 0, hint = 0;
+    int scored = -1;
+    worst[0] = worst[1] = worst[2] = 0;
+    for (size_t i = 0; i < ss->n && scored < AWAY_POSES; i++) {
+        const replay_sample_t *p = &ss->samples[i];
+        int64_t rel = p->s.timestamp_us - start;
+        if (rel >= AWAY_AT_US && rel < AWAY_AT_US + AWAY_FOR_US) {
+            if (scored < 0 && warm) head_tracker_resume(&t);
+            scored = 0;
+            continue;
+        }
+        head_tracker_pose_t pose;
+        head_tracker_update(&t, &p->s, p->recv_us, &pose);
+        double ref[6];
+        if (!t.ekf.seeded || !truth_at(ss, target_us(p, pc), &hint, ref)) continue;
+        const double est[6] = { pose.x, pose.y, pose.z, pose.yaw, pose.pitch, pose.roll };
+        if (scored < 0) {
+            if (rel < AWAY_AT_US - AWAY_REF_US) continue;
+            for (int k = 0; k < 6; k++) off[k] += est[k] - ref[k];
+            n_off++;
+            continue;
+        }
+        if (!pose.eyes || !n_off) continue;
+        double e[6];
+        for (int k = 0; k < 6; k++) e[k] = est[k] - ref[k] - off[k] / n_off;
+        worst[0] = fmax(worst[0], sqrt(e[0] * e[0] + e[1] * e[1] + e[2] * e[2]));
+        worst[1] = fmax(worst[1], fabs(e[3]));
+        worst[2] = fmax(worst[2], fabs(e[4]));
+        scored++;
+    }
+}
+
+static void replay_away(const session_t *ss, const pose_predict_config_t *pc)
+{
+    if (ss->nt < 2 || ss->samples[ss->n - 1].s.timestamp_us - ss->samples[0].s.timestamp_us <
+                      AWAY_AT_US + AWAY_FOR_US + 1000000)
+        return;
+    double w[3], c[3];
+    away_errors(ss, pc, 1, w);
+    away_errors(ss, pc, 0, c);
+    printf("\n  away %d s at %d s, worst of the first %d poses back (offset from before leaving):\n",
+           AWAY_FOR_US / 1000000, AWAY_AT_US / 1000000, AWAY_POSES);
+    printf("    warm resume   translation %6.1f mm  yaw %5.2f deg  pitch %5.2f deg\n", w[0], w[1], w[2]);
+    printf("    reseed        translation %6.1f mm  yaw %5.2f deg  pitch %5.2f deg\n", c[0], c[1], c[2]);
+}
+
+int main(int argc, char **argv)
+{
+    const char *session = NULL, *truth_csv = NULL, *write_path = NULL;
+    int repeat = 20, strict = 0, predict = 1;
+    pose_predict_config_t pcfg = POSE_PREDICT_DEFAULTS;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--session") && i + 1 < argc) session = argv[++i];
+        else if (!strcmp(argv[i], "--truth") && i + 1 < argc) truth_csv = argv[++i];
+        else if (!strcmp(argv[i], "--write") && i + 1 < argc) write_path = argv[++i];
+        else if (!strcmp(argv[i], "--repeat") && i + 1 < argc) repeat = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "--lookahead") && i + 1 < argc) pcfg.lookahead_ms = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--no-predict")) predict = 0;
+        else if (!strcmp(argv[i], "--no-calib")) calibrate = 0;
+        else if (!strcmp(argv[i], "--origin-only")) fuse_gaze = 0;
+        else if (!strcmp(argv[i], "--strict")) strict = 1;
+        else {
+            fprintf(stderr, "Usage: %s [--session run.sqsl] [--truth ref.csv] [--write out.sqsl]\n"
+                    "       [--repeat N] [--lookahead MS | --no-predict] [--no-calib]\n"
+                    "       [--origin-only] [--strict]\n",
+                    argv[0]);
+            return 1;
+        }
+    }
+    if (repeat < 1) repeat = 1;
+    const pose_predict_config_t *pc = predict ? &pcfg : NULL;
+
+    char tmp[] = "/tmp/squig-session-XXXXXX";
+    if (!session) {
+        if (!write_path) {
+            int fd = mkstemp(tmp);
+            if (fd < 0) {
+                perror("mkstemp");
+                return 1;
+            }
+            close(fd);
+            write_path = tmp;
+        }
+        if (write_synthetic(write_path) < 0) return 1;
+        session = write_path;
+        gaze_cfg = &synth_gaze;
+    }
+
+    session_log_reader_t *r = session_log_open(session);
+    if (write_path == tmp) unlink(tmp);         /* mapped: gone when we exit */
+    if (!r) return 1;
+    session_t ss = { 0 };
+    double ns_decode;
+    if (load_session(r, &ss, &ns_decode) < 0) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    if (truth_csv && load_truth_csv(truth_csv, &ss) < 0) return 1;
+    if (ss.nt) qsort(ss.truth, ss.nt, sizeof(*ss.truth), cmp_truth);
+    if (ss.n < 2) {
+        fprintf(stderr, "%s: no gaze_origin samples\n", session);
+        return 1;
+    }
+
+    double secs = (ss.samples[ss.n - 1].s.timestamp_us - ss.samples[0].s.timestamp_us) / 1e6;
+    printf("\n=== session replay: %s ===\n\n", session == tmp ? "synthetic" : session);
+    printf("  %zu bytes, %llu records, %.1f s:", session_log_bytes(r),
+           (unsigned long long)ss.records, secs);
+    for (int t = 1; t < SESSION_REC_TYPES; t++)
+        if (ss.counts[t]) printf(" %s %llu", session_rec_names[t], (unsigned long long)ss.counts[t]);
+    printf("\n");
+
+    double sink = 0, ns_stage[3];
+    double ns_total = replay_throughput(&ss, pc, repeat, &sink);
+    replay_stages(&ss, pc, ns_stage, &sink);
+    printf("\n  throughput  %.0f samples/s, %.0fx real time (%d passes, %s)\n",
+           1e9 / ns_total, secs * 1e9 / (ns_total * ss.n), repeat,
+           pc ? "with look-ahead" : "no look-ahead");
+    printf("  decode      %7.1f ns/record\n", ns_decode);
+    if (calibrate)
+        printf("  calib       %7.1f ns/sample   (head-model RLS, model hand-over)\n", ns_stage[0]);
+    printf("  filter      %7.1f ns/sample   (EKF seed/predict/update)\n", ns_stage[1]);
+    printf("  output      %7.1f ns/sample   (look-ahead, relative pose)\n", ns_stage[2]);
+    printf("  total       %7.1f ns/sample\n", ns_total);
+
+    double p95[6];
+    int missed = replay_accuracy(&ss, pc, session == tmp, p95);
+    replay_away(&ss, pc);
+
+    /* The synthetic session with the stock options: hold the baseline */
+    const pose_predict_config_t pdef = POSE_PREDICT_DEFAULTS;
+    int stock = session == tmp && !truth_csv && calibrate && fuse_gaze && pc &&
+                pc->lookahead_ms == pdef.lookahead_ms;
+    int regressed = -1;
+    if (stock && missed >= 0) {
+        printf("\n  baseline (p95, +%.0f%% allowed):", BASELINE_TOL * 100);
+        for (int k = 0; k < 6; k++) {
+            if (p95[k] > synth_baseline[k] * (1 + BASELINE_TOL) && regressed < 0) regressed = k;
+            printf(" %s %.2f", axis_names[k], synth_baseline[k]);
+        }
+        printf("\n");
+    }
+    if (missed > 0) {
+        printf("\n  Option C targets missed:");
+        for (int k = 0; k < 6; k++)
+            if (criteria[k] > 0 && p95[k] > criteria[k]) printf(" %s", axis_names[k]);
+        printf("%s\n", stock ? " (known on this session: translation and pitch are not there yet)" : "");
+    }
+
+    free(ss.samples);
+    free(ss.truth);
+    gaze_fusion_free(&ss.fusion);
+    session_log_close_reader(r);
+    if (!isfinite(sink)) {
+        printf("\n[FAIL] filter diverged\n");
+        return 1;
+    }
+    if (regressed >= 0) {
+        printf("\n[FAIL] %s p95 %.2f %s, baseline %.2f\n", axis_names[regressed], p95[regressed],
+               axis_units[regressed], synth_baseline[regressed]);
+        return 1;
+    }
+    if (strict && missed != 0) {
+        printf("\n[FAIL] %s\n", missed < 0 ? "no reference to check against" : "criteria missed");
+        return 1;
+    }
+    if (missed > 0)
+        printf("\n[OK] %s, %d Option C criteria missed\n", stock ? "baseline held" : "report only", missed);
+    else
+        printf("\n[OK]\n");
+    return 0;
+}
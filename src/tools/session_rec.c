@@ -0,0 +1,220 @@
+/*
+ * session_rec.c — Record Stream Engine streams to a session log (.sqsl)
+ *
+ * Subscribes to gaze_origin, eye_position_normalized and gaze_point and
+ * appends every sample to a session_log.h file, stamped with
+ * tobii_system_clock() on arrival, for replay with session_bench.
+ * gaze_origin is required; the other two streams are recorded when the
+ * tracker and Stream Engine build provide them.
+ *
+ * With --truth-udp PORT it also listens for opentrack UDP packets (six
+ * little-endian doubles: x, y, z cm, yaw, pitch, roll degrees — what
+ * opentrack's "UDP over network" output and aruco/PointTracker setups
+ * send) and logs each as a truth record in mm on the SE clock, so a
+ * reference tracker running alongside gives session_bench something to
+ * score against.
+ *
+ * Usage:
+ *   session_rec [--url URL] [--seconds N] [--truth-udp PORT] out.sqsl
+ *   (Ctrl+C stops; the log is flushed on exit)
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <signal.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <poll.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include "../se_session.h"
+#include "../session_log.h"
+
+/* ── Recording ──────────────────────────────────────────────────────── */
+
+typedef struct {
+    se_session_t         *se;
+    session_log_writer_t *log;
+    int                   truth_fd;
+} rec_t;
+
+static volatile sig_atomic_t g_running = 1;
+
+static void sig_handler(int sig)
+{
+    (void)sig;
+    g_running = 0;
+}
+
+static int64_t se_now(rec_t *r, int64_t fallback)
+{
+    int64_t t = se_session_clock_us(r->se);
+    return t ? t : fallback;
+}
+
+static void gaze_origin_callback(tobii_gaze_origin_t const *g, void *user)
+{
+    rec_t *r = user;
+    session_rec_t rec = {
+        .type = SESSION_REC_GAZE_ORIGIN,
+        .valid = (g->left_validity == TOBII_VALIDITY_VALID ? SESSION_VALID_LEFT : 0) |
+                 (g->right_validity == TOBII_VALIDITY_VALID ? SESSION_VALID_RIGHT : 0),
+        .timestamp_us = g->timestamp_us,
+        .recv_us = se_now(r, g->timestamp_us),
+    };
+    for (int k = 0; k < 3; k++) {
+        rec.v[k] = g->left_xyz[k];
+        rec.v[3 + k] = g->right_xyz[k];
+    }
+    session_log_write(r->log, &rec);
+}
+
+static void eye_pos_callback(tobii_eye_position_normalized_t const *e, void *user)
+{
+    rec_t *r = user;
+    session_rec_t rec = {
+        .type = SESSION_REC_EYE_POS_NORM,
+        .valid = (e->left_validity == TOBII_VALIDITY_VALID ? SESSION_VALID_LEFT : 0) |
+                 (e->right_validity == TOBII_VALIDITY_VALID ? SESSION_VALID_RIGHT : 0),
+        .timestamp_us = e->timestamp_us,
+        .recv_us = se_now(r, e->timestamp_us),
+    };
+    for (int k = 0; k < 3; k++) {
+        rec.v[k] = e->left_xyz[k];
+        rec.v[3 + k] = e->right_xyz[k];
+    }
+    session_log_write(r->log, &rec);
+}
+
+static void gaze_point_callback(tobii_gaze_point_t const *p, void *user)
+{
+    rec_t *r = user;
+    session_rec_t rec = {
+        .type = SESSION_REC_GAZE_POINT,
+        .valid = p->validity == TOBII_VALIDITY_VALID ? SESSION_VALID_LEFT : 0,
+        .timestamp_us = p->timestamp_us,
+        .recv_us = se_now(r, p->timestamp_us),
+        .v = { p->position_xy[0], p->position_xy[1] },
+    };
+    session_log_write(r->log, &rec);
+}
+
+/* opentrack UDP: 6 doubles, cm and degrees → truth record, mm and degrees */
+static void *truth_thread(void *arg)
+{
+    rec_t *r = arg;
+    while (g_running) {
+        struct pollfd pfd = { .fd = r->truth_fd, .events = POLLIN };
+        if (poll(&pfd, 1, 200) <= 0) continue;
+        double v[6];
+        ssize_t n = recv(r->truth_fd, v, sizeof(v), 0);
+        if (n != (ssize_t)sizeof(v)) continue;
+        session_rec_t rec = { .type = SESSION_REC_TRUTH, .valid = SESSION_VALID_LEFT };
+        rec.timestamp_us = rec.recv_us = se_now(r, 0);
+        for (int k = 0; k < 3; k++) rec.v[k] = v[k] * 10.0;
+        for (int k = 3; k < 6; k++) rec.v[k] = v[k];
+        session_log_write(r->log, &rec);
+    }
+    return NULL;
+}
+
+static int open_truth_socket(int port)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    struct sockaddr_in sa = { .sin_family = AF_INET, .sin_port = htons((uint16_t)port),
+                              .sin_addr.s_addr = htonl(INADDR_ANY) };
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        fprintf(stderr, "--truth-udp %d: %s\n", port, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char **argv)
+{
+    const char *out = NULL;
+    char url[256] = { 0 };
+    double seconds = 0;
+    int truth_port = 0;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--url") && i + 1 < argc) snprintf(url, sizeof(url), "%s", argv[++i]);
+        else if (!strcmp(argv[i], "--seconds") && i + 1 < argc) seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "--truth-udp") && i + 1 < argc) truth_port = atoi(argv[++i]);
+        else if (argv[i][0] != '-' && !out) out = argv[i];
+        else out = NULL, i = argc;
+    }
+    if (!out) {
+        fprintf(stderr, "Usage: %s [--url URL] [--seconds N] [--truth-udp PORT] out.sqsl\n", argv[0]);
+        return 1;
+    }
+
+    signal(SIGINT, sig_handler);
+    signal(SIGTERM, sig_handler);
+
+    rec_t r = { .truth_fd = -1 };
+    if (!(r.se = se_session_open(url, NULL))) return 1;
+    printf("Device: %s\n", se_session_url(r.se));
+
+    int rc = 1;
+    pthread_t truth_tid;
+    int truth_started = 0;
+    if (!(r.log = session_log_create(out))) goto out_dev;
+    int err = se_session_gaze_origin(r.se, gaze_origin_callback, &r);
+    if (err) {
+        fprintf(stderr, "gaze_origin_subscribe: %d - %s\n", err, se_error(err));
+        goto out_log;
+    }
+    if ((err = se_session_eye_position_normalized(r.se, eye_pos_callback, &r)))
+        printf("eye_position_normalized: %d - %s (not recorded)\n", err, se_error(err));
+    if ((err = se_session_gaze_point(r.se, gaze_point_callback, &r)))
+        printf("gaze_point: %d - %s (not recorded)\n", err, se_error(err));
+    if (truth_port) {
+        if ((r.truth_fd = open_truth_socket(truth_port)) < 0) goto out_log;
+        if (pthread_create(&truth_tid, NULL, truth_thread, &r) != 0) {
+            perror("pthread_create");
+            goto out_log;
+        }
+        truth_started = 1;
+        printf("Truth: opentrack UDP on port %d\n", truth_port);
+    }
+    printf("Recording to %s%s\n", out, seconds > 0 ? "" : " (Ctrl+C to stop)");
+
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (g_running) {
+        se_session_pump(r.se);          /* reconnects (and resubscribes) itself */
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (seconds > 0 && (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9 >= seconds)
+            break;
+    }
+    g_running = 0;
+    rc = 0;
+
+out_log:
+    if (truth_started) pthread_join(truth_tid, NULL);
+    if (r.truth_fd >= 0) close(r.truth_fd);
+    if (r.log) {
+        printf("%llu gaze_origin, %llu eye_position_normalized, %llu gaze_point, %llu truth\n",
+               (unsigned long long)session_log_written(r.log, SESSION_REC_GAZE_ORIGIN),
+               (unsigned long long)session_log_written(r.log, SESSION_REC_EYE_POS_NORM),
+               (unsigned long long)session_log_written(r.log, SESSION_REC_GAZE_POINT),
+               (unsigned long long)session_log_written(r.log, SESSION_REC_TRUTH));
+        if (session_log_close(r.log) < 0) rc = 1;
+    }
+out_dev:
+    se_session_close(r.se);
+    return rc;
+}
@@ -0,0 +1,95 @@
+/*
+ * synth_head.h — Synthetic head-tracking session for the benchmarks
+ *
+ * A 90 Hz gaze_origin stream with known ground truth: a head moving on
+ * smooth yaw/pitch/roll/translation sweeps at a few tenths of a Hz (like
+ * looking around a cockpit) plus a faster small nod, eyes generated
+ * through the head_ekf.h rigid head model, 0.7 mm of measurement noise,
+ * ±5% sample-time jitter, one-eye dropouts and short blinks. The
+ * generator is a fixed-seed xorshift, so every run sees the same session.
+ *
+ * Used by ekf_bench (filter accuracy and cost) and session_bench (the
+ * record/replay harness, which writes it out as a session log).
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_SYNTH_HEAD_H
+#define SQUIG_SYNTH_HEAD_H
+
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include "../head_ekf.h"
+
+#define SYNTH_RATE_HZ   90.0
+#define SYNTH_DEG       (M_PI / 180.0)
+
+static uint32_t synth_rng_state = 0x12345678u;
+static inline uint32_t synth_rng(void)
+{
+    synth_rng_state ^= synth_rng_state << 13;
+    synth_rng_state ^= synth_rng_state >> 17;
+    synth_rng_state ^= synth_rng_state << 5;
+    return synth_rng_state;
+}
+
+static inline double synth_uniform(void) { return (synth_rng() + 0.5) / 4294967296.0; }
+
+static inline double synth_gauss(void)
+{
+    return sqrt(-2.0 * log(synth_uniform())) * cos(2.0 * M_PI * synth_uniform());
+}
+
+/* Nonzero: hold the pose of t = 3 s for the whole session */
+static int synth_still;
+
+/* Ground-truth [tx, ty, tz (mm), yaw, pitch, roll (rad)] at time t (s) */
+static inline void synth_truth(double t, double x[6])
+{
+    if (synth_still) t = 3.0;
+    x[0] = 60.0 * sin(2 * M_PI * 0.13 * t);
+    x[1] = 25.0 * sin(2 * M_PI * 0.21 * t + 1.0);
+    x[2] = 620.0 + 40.0 * sin(2 * M_PI * 0.07 * t);
+    x[3] = 35 * SYNTH_DEG * sin(2 * M_PI * 0.31 * t);
+    x[4] = 15 * SYNTH_DEG * sin(2 * M_PI * 0.23 * t + 0.5) + 3 * SYNTH_DEG * sin(2 * M_PI * 2.0 * t);
+    x[5] = 10 * SYNTH_DEG * sin(2 * M_PI * 0.17 * t + 2.0);
+}
+
+typedef struct {
+    double t;                   /* s from the session start */
+    double pose[6];             /* ground truth at t */
+    double left[3], right[3];   /* measured eyes, mm */
+    int lv, rv;
+} synth_sample_t;
+
+static inline int synth_make_session(synth_sample_t *s, int n, const head_ekf_config_t *cfg)
+{
+    double t = 0;
+    int blink = 0;
+    for (int i = 0; i < n; i++) {
+        t += (1.0 + 0.1 * (synth_uniform() - 0.5)) / SYNTH_RATE_HZ;
+        s[i].t = t;
+        synth_truth(t, s[i].pose);
+        head_real_t x[HEAD_EKF_N] = { 0 };
+        for (int k = 0; k < 6; k++) x[k] = s[i].pose[k];
+        head_ekf_eyes(cfg, x, s[i].left, s[i].right);
+        for (int k = 0; k < 3; k++) {
+            s[i].left[k]  += 0.7 * synth_gauss();
+            s[i].right[k] += 0.7 * synth_gauss();
+        }
+        s[i].lv = s[i].rv = 1;
+        if (blink > 0) {
+            s[i].lv = s[i].rv = 0;
+            blink--;
+        } else if (synth_rng() % 1000 < 3) {
+            blink = 8 + (int)(synth_rng() % 10);    /* ~100-200 ms */
+        } else if (synth_rng() % 100 < 3) {
+            if (synth_rng() & 1) s[i].lv = 0; else s[i].rv = 0;
+        }
+    }
+    return n;
+}
+
+#endif /* SQUIG_SYNTH_HEAD_H */
@@ -0,0 +1,406 @@
+/*
+ * uvc_device_bench.c — uvc_device.c's threading contract, against a fake tracker
+ *
+ * uvc_device.c is built against src/tools/fake_usb/libusb.h, and this
+ * file provides that libusb and the uvc_capture.h functions: one tracker
+ * that can be unplugged, and a capture engine that makes empty frames
+ * and checks which thread calls it. The main thread is the consumer
+ * (uvc_device_next() in a loop); meanwhile one thread keeps changing the
+ * demand (subscribe / unsubscribe at FULL and PREVIEW, down to nobody)
+ * and the accumulation target, and another reads the stats snapshot.
+ * Then the tracker is unplugged and plugged back in. Checked:
+ *
+ *   owner     only the consumer thread ever calls into an engine, which
+ *             every demand change stops and frees
+ *   snapshot  the capture counts never go backwards across engines, and
+ *             each snapshot's demand matches its committed interval
+ *   demand    the toggles reach the device as restarts
+ *   replug    the tracker comes back on the cached probe, although the
+ *             device committed a different interval than was asked
+ *
+ * Build & run:
+ *   make bench
+ *   ./build/uvc_device_bench
+ *
+ * Needs no hardware (and no libusb).
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include "../uvc_device.h"
+
+#define TOGGLE_MS       1500
+#define REPLUG_MS       3000        /* for each of unplug seen, replug seen */
+#define IV_FULL         111111      /* 100 ns units: 90 Hz */
+#define IV_PREVIEW      333333      /* 30 Hz */
+#define IV_ADJUST       37          /* the device commits the asked interval + this */
+#define RESTARTS_MIN    10
+
+static pthread_t g_consumer;
+static uint64_t  g_foreign;         /* engine calls from another thread */
+static int       g_live;            /* engines started and not stopped */
+static int       g_present = 1;     /* tracker plugged in */
+
+#define OWNER() do { if (!pthread_equal(pthread_self(), g_consumer)) \
+                         __atomic_fetch_add(&g_foreign, 1, __ATOMIC_RELAXED); } while (0)
+
+static uint64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/* ── Fake libusb: one ET5 on bus 1, port 4 ──────────────────────────── */
+
+static char g_dev, g_handle;
+
+ssize_t libusb_get_device_list(libusb_context *ctx, libusb_device ***list)
+{
+    (void)ctx;
+    int n = __atomic_load_n(&g_present, __ATOMIC_ACQUIRE);
+    *list = calloc(2, sizeof(**list));
+    if (!*list) return -1;
+    if (n) (*list)[0] = (libusb_device *)&g_dev;
+    return n;
+}
+
+void libusb_free_device_list(libusb_device **list, int unref) { (void)unref; free(list); }
+
+int libusb_get_device_descriptor(libusb_device *dev, struct libusb_device_descriptor *d)
+{
+    (void)dev;
+    d->idVendor = TOBII_VID;
+    d->idProduct = TOBII_PID;
+    d->bcdDevice = 0x0105;
+    d->iSerialNumber = 3;
+    return 0;
+}
+
+int libusb_get_port_numbers(libusb_device *dev, uint8_t *ports, int len)
+{
+    (void)dev;
+    if (len < 1) return -1;
+    ports[0] = 4;
+    return 1;
+}
+
+uint8_t libusb_get_bus_number(libusb_device *dev) { (void)dev; return 1; }
+
+int libusb_open(libusb_device *dev, libusb_device_handle **h)
+{
+    (void)dev;
+    *h = (libusb_device_handle *)&g_handle;
+    return 0;
+}
+
+void libusb_close(libusb_device_handle *h) { (void)h; }
+libusb_device *libusb_get_device(libusb_device_handle *h) { (void)h; return (libusb_device *)&g_dev; }
+
+int libusb_get_string_descriptor_ascii(libusb_device_handle *h, uint8_t index, unsigned char *data,
+                                       int length)
+{
+    (void)h;
+    (void)index;
+    return snprintf((char *)data, (size_t)length, "FAKE-ET5-0001");
+}
+
+int libusb_kernel_driver_active(libusb_device_handle *h, int i) { (void)h; (void)i; return 0; }
+int libusb_detach_kernel_driver(libusb_device_handle *h, int i) { (void)h; (void)i; return 0; }
+int libusb_attach_kernel_driver(libusb_device_handle *h, int i) { (void)h; (void)i; return 0; }
+int libusb_claim_interface(libusb_device_handle *h, int i) { (void)h; (void)i; return 0; }
+int libusb_release_interface(libusb_device_handle *h, int i) { (void)h; (void)i; return 0; }
+
+int libusb_handle_events_timeout_completed(libusb_context *ctx, struct timeval *tv, int *completed)
+{
+    (void)ctx;
+    (void)completed;
+    usleep((useconds_t)(tv->tv_sec * 1000000 + tv->tv_usec));
+    return 0;
+}
+
+/* No hotplug: the device finds the tracker again by rescanning */
+int libusb_has_capability(uint32_t capability) { (void)capability; return 0; }
+
+int libusb_hotplug_register_callback(libusb_context *ctx, int events, int flags, int vendor,
+                                     int product, int dev_class, libusb_hotplug_callback_fn cb,
+                                     void *user, libusb_hotplug_callback_handle *handle)
+{
+    (void)ctx; (void)events; (void)flags; (void)vendor; (void)product; (void)dev_class;
+    (void)cb; (void)user; (void)handle;
+    return -12;
+}
+
+void libusb_hotplug_deregister_callback(libusb_context *ctx, libusb_hotplug_callback_handle handle)
+{
+    (void)ctx;
+    (void)handle;
+}
+
+const char *libusb_strerror(int code) { (void)code; return "fake"; }
+
+/* ── Fake UVC control and capture engine ────────────────────────────── */
+
+struct uvc_capture {
+    frame_pool_t *pool;
+    int           running;
+    uint32_t      accumulate;
+    uint64_t      frames;
+};
+
+int uvc_list_frames(libusb_device_handle *d, uvc_frame_desc_t *out, int max)
+{
+    (void)d;
+    if (max < 1) return 0;
+    out[0] = (uvc_frame_desc_t){ 1, 1, 642, 480, 4096, IV_FULL, IV_PREVIEW, IV_FULL };
+    return 1;
+}
+
+int uvc_negotiate(libusb_device_handle *d, const uvc_frame_desc_t *f, uint32_t interval,
+                  uvc_probe_t *out)
+{
+    (void)d;
+    (void)f;
+    OWNER();
+    memset(out, 0, sizeof(*out));
+    out->bFormatIndex = 1;
+    out->bFrameIndex = 1;
+    out->dwFrameInterval = interval + IV_ADJUST;
+    out->dwMaxVideoFrameSize = 4096;
+    out->dwMaxPayloadTransferSize = 4096;
+    return 0;
+}
+
+int uvc_commit(libusb_device_handle *d, const uvc_probe_t *p, unsigned timeout_ms)
+{
+    (void)d;
+    (void)p;
+    (void)timeout_ms;
+    OWNER();
+    return 0;
+}
+
+void uvc_stop_stream(libusb_device_handle *d) { (void)d; OWNER(); }
+
+int uvc_transfer_size(const uvc_probe_t *p, int fallback)
+{
+    return p->dwMaxPayloadTransferSize ? (int)p->dwMaxPayloadTransferSize : fallback;
+}
+
+uvc_capture_t *uvc_capture_start(libusb_context *ctx, libusb_device_handle *dev,
+                                 const uvc_capture_config_t *cfg)
+{
+    (void)ctx;
+    (void)dev;
+    OWNER();
+    uvc_capture_t *cap = calloc(1, sizeof(*cap));
+    if (!cap) return NULL;
+    cap->pool = cfg->pool;
+    cap->running = 1;
+    g_live++;
+    return cap;
+}
+
+frame_t *uvc_capture_next(uvc_capture_t *cap, int timeout_ms)
+{
+    (void)timeout_ms;
+    OWNER();
+    if (!__atomic_load_n(&g_present, __ATOMIC_ACQUIRE)) cap->running = 0;
+    if (!cap->running) return NULL;
+    usleep(300);
+    frame_t *f = frame_pool_get(cap->pool);
+    if (!f) return NULL;
+    f->len = 0;
+    cap->frames++;
+    return f;
+}
+
+void uvc_capture_set_accumulate(uvc_capture_t *cap, uint32_t target_bytes)
+{
+    OWNER();
+    cap->accumulate = target_bytes;
+}
+
+int uvc_capture_queue_depth(const uvc_capture_t *cap) { OWNER(); return cap->running; }
+int uvc_capture_running(const uvc_capture_t *cap) { OWNER(); return cap->running; }
+
+void uvc_capture_get_stats(const uvc_capture_t *cap, uvc_capture_stats_t *out)
+{
+    OWNER();
+    memset(out, 0, sizeof(*out));
+    out->xfer_done = out->frames = cap->frames;
+}
+
+void uvc_capture_stop(uvc_capture_t *cap)
+{
+    if (!cap) return;
+    OWNER();
+    memset(cap, 0xa5, sizeof(*cap));
+    free(cap);
+    g_live--;
+}
+
+/* ── Other threads ──────────────────────────────────────────────────── */
+
+typedef struct {
+    uvc_device_t *ud;
+    int           stop;
+    uint64_t      n, backwards, torn;
+} shared_t;
+
+/* Change the demand and the accumulation target as fast as a UI could */
+static void *toggler(void *arg)
+{
+    shared_t *s = arg;
+    unsigned seed = 1;
+    uint64_t end = now_ms() + TOGGLE_MS;
+    while (now_ms() < end) {
+        switch (rand_r(&seed) % 3) {
+        case 0:                                 /* recording starts and stops */
+            uvc_device_subscribe(s->ud, UVC_DEMAND_FULL);
+            usleep(1000 + rand_r(&seed) % 4000);
+            uvc_device_unsubscribe(s->ud, UVC_DEMAND_FULL);
+            break;
+        case 1:                                 /* window minimised and back */
+            uvc_device_unsubscribe(s->ud, UVC_DEMAND_PREVIEW);
+            usleep(1000 + rand_r(&seed) % 4000);
+            uvc_device_subscribe(s->ud, UVC_DEMAND_PREVIEW);
+            break;
+        default:
+            uvc_device_set_accumulate(s->ud, rand_r(&seed) & 1 ? 4096 : 0);
+        }
+        usleep(1000 + rand_r(&seed) % 4000);
+        s->n++;
+    }
+    return NULL;
+}
+
+/* A title bar or metrics scrape, much faster than one */
+static void *reader(void *arg)
+{
+    shared_t *s = arg;
+    uint64_t last = 0;
+    while (!__atomic_load_n(&s->stop, __ATOMIC_ACQUIRE)) {
+        uvc_device_stats_t ds;
+        uvc_device_get_stats(s->ud, &ds);
+        if (ds.capture.frames < last) s->backwards++;
+        last = ds.capture.frames;
+        uint32_t want = ds.demand == UVC_DEMAND_FULL ? IV_FULL + IV_ADJUST
+                      : ds.demand == UVC_DEMAND_PREVIEW ? IV_PREVIEW + IV_ADJUST : 0;
+        if (ds.frame_interval != want) s->torn++;
+        (void)uvc_device_demand(s->ud);
+        s->n++;
+        usleep(50);
+    }
+    return NULL;
+}
+
+/* Consume until cond(stats) holds or ms pass; returns whether it held */
+static int consume_until(uvc_device_t *ud, int (*cond)(const uvc_device_stats_t *), int ms,
+                         uint64_t *frames)
+{
+    uint64_t end = now_ms() + (uint64_t)ms;
+    while (now_ms() < end) {
+        frame_t *f = uvc_device_next(ud, 20);
+        if (f) {
+            (*frames)++;
+            frame_unref(f);
+        }
+        uvc_device_stats_t ds;
+        uvc_device_get_stats(ud, &ds);
+        if (cond && cond(&ds)) return 1;
+    }
+    return 0;
+}
+
+static int gone(const uvc_device_stats_t *ds) { return !ds->connected; }
+static int back(const uvc_device_stats_t *ds) { return ds->connected && ds->frame_interval; }
+
+int main(void)
+{
+    char dir[] = "/tmp/uvc_device_bench.XXXXXX";
+    if (!mkdtemp(dir)) {
+        perror("mkdtemp");
+        return 1;
+    }
+    setenv("SQUIG_PROFILE_DIR", dir, 1);
+    g_consumer = pthread_self();
+
+    /* The device reports every restart; keep stdout for the results */
+    fflush(stdout);
+    int out = dup(STDOUT_FILENO), null = open("/dev/null", O_WRONLY);
+    if (out >= 0 && null >= 0) dup2(null, STDOUT_FILENO);
+
+    uvc_device_config_t cfg = UVC_DEVICE_DEFAULTS;
+    cfg.demand = UVC_DEMAND_PREVIEW;
+    cfg.capture.frame_size = 4096;
+    uvc_device_t *ud = uvc_device_open(NULL, &cfg);
+    if (!ud) {
+        rmdir(dir);
+        return 1;
+    }
+
+    /* Demand and accumulation from another thread, stats from a third */
+    shared_t tg = { ud, 0, 0, 0, 0 }, rd = { ud, 0, 0, 0, 0 };
+    pthread_t tt, rt;
+    pthread_create(&tt, NULL, toggler, &tg);
+    pthread_create(&rt, NULL, reader, &rd);
+    uint64_t frames = 0;
+    consume_until(ud, NULL, TOGGLE_MS + 100, &frames);
+    pthread_join(tt, NULL);
+    consume_until(ud, NULL, 100, &frames);             /* settle on PREVIEW */
+
+    /* Unplug, then plug back in, with the reader still going */
+    __atomic_store_n(&g_present, 0, __ATOMIC_RELEASE);
+    int lost = consume_until(ud, gone, REPLUG_MS, &frames);
+    __atomic_store_n(&g_present, 1, __ATOMIC_RELEASE);
+    int rearmed = lost && consume_until(ud, back, REPLUG_MS, &frames);
+    consume_until(ud, NULL, 100, &frames);
+    __atomic_store_n(&rd.stop, 1, __ATOMIC_RELEASE);
+    pthread_join(rt, NULL);
+
+    uvc_device_stats_t ds;
+    uvc_device_get_stats(ud, &ds);
+    uvc_device_close(ud);
+    char path[512];
+    if (uvc_device_cache_path("FAKE-ET5-0001", path, sizeof(path)) == 0) unlink(path);
+    rmdir(dir);
+    fflush(stdout);
+    if (out >= 0 && null >= 0) dup2(out, STDOUT_FILENO);
+
+    printf("\n=== uvc_device: demand toggles and a replug against a fake tracker ===\n\n");
+    printf("  toggles %llu -> %llu restarts, %llu frames consumed\n", (unsigned long long)tg.n,
+           (unsigned long long)ds.rate_changes, (unsigned long long)frames);
+    printf("  snapshots read %llu: counts backwards %llu, demand / interval disagree %llu\n",
+           (unsigned long long)rd.n, (unsigned long long)rd.backwards, (unsigned long long)rd.torn);
+    printf("  engine calls off the consumer thread %llu, engines left %d\n",
+           (unsigned long long)g_foreign, g_live);
+    printf("  replug: %s, bring-ups %llu (cached %llu), losses %llu\n",
+           rearmed ? "re-armed" : lost ? "NOT re-armed" : "loss NOT seen",
+           (unsigned long long)ds.bringups, (unsigned long long)ds.cached,
+           (unsigned long long)ds.losses);
+
+    const char *why = g_foreign ? "engine called from another thread"
+                    : g_live ? "engine not stopped"
+                    : rd.backwards ? "capture counts went backwards"
+                    : rd.torn ? "snapshot demand and interval disagree"
+                    : ds.rate_changes < RESTARTS_MIN ? "demand changes did not restart the stream"
+                    : !rearmed || ds.losses != 1 || ds.bringups != 2 ? "replug not handled"
+                    : ds.cached != 1 ? "replug did not reuse the probe cache" : NULL;
+    if (why) {
+        printf("\n[FAIL] %s\n", why);
+        return 1;
+    }
+    printf("\n[OK]\n");
+    return 0;
+}
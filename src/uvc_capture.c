@@ -0,0 +1,633 @@
+/*
+ * uvc_capture.c — Asynchronous UVC bulk capture engine for the Tobii ET5
+ *
+ * See uvc_capture.h for the API. Threading model:
+ *
+ *   event thread   libusb_handle_events → transfer callbacks → reassembly
+ *                  (the only writer of the reassembly state and stats)
+ *   consumer       uvc_capture_next() / frame_unref()
+ *
+ * Frame memory comes from a frame_pool (lock-free get/unref) and finished
+ * frames travel to the consumer over a lock-free SPSC ring of frame
+ * pointers, so the event thread never blocks on the consumer. Each frame
+ * arrives with its frame_stats already computed: every payload is fed to
+ * the stats kernel as it is copied into the slot.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "uvc_capture.h"
+#include "spsc_ring.h"
+
+#define STAT_INC(x)   __atomic_fetch_add(&(x), 1, __ATOMIC_RELAXED)
+#define STAT_LOAD(x)  __atomic_load_n(&(x), __ATOMIC_RELAXED)
+
+struct uvc_capture {
+    libusb_context       *ctx;
+    libusb_device_handle *dev;
+    uvc_capture_config_t  cfg;
+
+    /* Transfer ring (event thread only after start) */
+    struct libusb_transfer **xfers;
+    int                      devmem;     /* buffers from libusb_dev_mem_alloc */
+    int                      active;     /* transfers currently submitted */
+
+    /* Frame slots */
+    frame_pool_t *pool;
+    int           own_pool;
+
+    /* Finished frames (event thread → consumer) */
+    spsc_ring_t   ready;
+
+    /* Reassembly state (event thread only) */
+    frame_t      *cur;
+    int           fid;                   /* -1 = unknown */
+    int           dropping;              /* discarding until next boundary */
+    uint64_t      seq;
+
+    /* Sub-frame stitching */
+    uint32_t      accum_req;             /* requested target (any thread) */
+    uint32_t      accum_target;          /* target latched for cur */
+    uint32_t      frag_start;            /* offset of current fragment in cur */
+    int           frag_fresh;            /* next payload starts a fragment */
+    frame_stats_t frag_stats;            /* cur->stats before this fragment */
+
+    pthread_t     thread;
+    int           stopping;              /* set by uvc_capture_stop() */
+    int           running;
+
+    uvc_capture_stats_t stats;
+};
+
+/* ── Device discovery ───────────────────────────────────────────────── */
+
+static int is_tracker(libusb_device *d)
+{
+    struct libusb_device_descriptor desc;
+    return libusb_get_device_descriptor(d, &desc) == 0 &&
+           desc.idVendor == TOBII_VID && desc.idProduct == TOBII_PID;
+}
+
+static void device_path(libusb_device *d, char *out)
+{
+    uint8_t ports[8];
+    int n = libusb_get_port_numbers(d, ports, (int)sizeof(ports));
+    int len = snprintf(out, UVC_PATH_MAX, "%u", libusb_get_bus_number(d));
+    for (int i = 0; i < n && len < UVC_PATH_MAX; i++)
+        len += snprintf(out + len, UVC_PATH_MAX - len, "%c%u", i ? '.' : '-', ports[i]);
+}
+
+int uvc_list_devices(libusb_context *ctx, char paths[][UVC_PATH_MAX], int max)
+{
+    libusb_device **list;
+    ssize_t cnt = libusb_get_device_list(ctx, &list);
+    if (cnt < 0) {
+        fprintf(stderr, "[USB] get_device_list: %s\n", libusb_strerror((int)cnt));
+        return -1;
+    }
+    int n = 0;
+    for (ssize_t i = 0; i < cnt; i++) {
+        if (!is_tracker(list[i])) continue;
+        if (n < max) device_path(list[i], paths[n]);
+        n++;
+    }
+    libusb_free_device_list(list, 1);
+    return n;
+}
+
+libusb_device_handle *uvc_open_device(libusb_context *ctx, const char *path)
+{
+    libusb_device **list;
+    ssize_t cnt = libusb_get_device_list(ctx, &list);
+    if (cnt < 0) {
+        fprintf(stderr, "[USB] get_device_list: %s\n", libusb_strerror((int)cnt));
+        return NULL;
+    }
+    libusb_device_handle *h = NULL;
+    int found = 0;
+    for (ssize_t i = 0; i < cnt && !found; i++) {
+        char p[UVC_PATH_MAX];
+        if (!is_tracker(list[i])) continue;
+        device_path(list[i], p);
+        if (path && *path && strcmp(p, path) != 0) continue;
+        found = 1;
+        int r = libusb_open(list[i], &h);
+        if (r < 0) {
+            fprintf(stderr, "[USB] Cannot open tracker at %s: %s\n", p, libusb_strerror(r));
+            h = NULL;
+        }
+    }
+    libusb_free_device_list(list, 1);
+    if (!found)
+        fprintf(stderr, "[USB] No Tobii ET5 (%04x:%04x)%s%s\n", TOBII_VID, TOBII_PID,
+                path && *path ? " at " : "", path && *path ? path : "");
+    return h;
+}
+
+/* ── UVC control transfers ──────────────────────────────────────────── */
+
+static int ctrl_timeout(libusb_device_handle *d, uint8_t req, uint8_t cs, uint8_t intf,
+                        void *buf, uint16_t len, unsigned timeout_ms)
+{
+    uint8_t rt = (req & 0x80)
+        ? (LIBUSB_ENDPOINT_IN  | LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE)
+        : (LIBUSB_ENDPOINT_OUT | LIBUSB_REQUEST_TYPE_CLASS | LIBUSB_RECIPIENT_INTERFACE);
+    return libusb_control_transfer(d, rt, req, (uint16_t)(cs << 8), intf, buf, len, timeout_ms);
+}
+
+int uvc_ctrl(libusb_device_handle *d, uint8_t req, uint8_t cs,
+             uint8_t intf, void *buf, uint16_t len)
+{
+    return ctrl_timeout(d, req, cs, intf, buf, len, 2000);
+}
+
+int uvc_commit(libusb_device_handle *d, const uvc_probe_t *p, unsigned timeout_ms)
+{
+    uvc_probe_t c = *p;
+    int r = ctrl_timeout(d, UVC_SET_CUR, VS_COMMIT_CONTROL, IF_VIDEO_STREAM, &c, sizeof(c), timeout_ms);
+    return r == (int)sizeof(c) ? 0 : -1;
+}
+
+/* ── Stream formats ─────────────────────────────────────────────────── */
+
+#define CS_INTERFACE            0x24
+#define VS_FORMAT_UNCOMPRESSED  0x04
+#define VS_FRAME_UNCOMPRESSED   0x05
+#define VS_FORMAT_MJPEG         0x06
+#define VS_FRAME_MJPEG          0x07
+#define VS_FORMAT_FRAME_BASED   0x10
+#define VS_FRAME_FRAME_BASED    0x11
+
+static uint32_t rd32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24; }
+static uint16_t rd16(const uint8_t *p) { return (uint16_t)(p[0] | p[1] << 8); }
+
+/* One VS_FRAME_* descriptor. The frame-based layout has no buffer size
+ * and moves the default interval up by four bytes; the interval list
+ * starts at 26 in all three. */
+static int parse_frame(const uint8_t *p, int len, uint8_t format, uvc_frame_desc_t *f)
+{
+    int based = p[2] == VS_FRAME_FRAME_BASED;
+    if (len < 26) return -1;
+    memset(f, 0, sizeof(*f));
+    f->format = format;
+    f->frame = p[3];
+    f->width = rd16(p + 5);
+    f->height = rd16(p + 7);
+    f->max_frame_bytes = based ? (uint32_t)f->width * f->height : rd32(p + 17);
+    f->interval_default = rd32(p + (based ? 17 : 21));
+    int type = p[based ? 21 : 25];
+    if (type == 0) {                    /* continuous: min, max, step */
+        if (len < 38) return -1;
+        f->interval_min = rd32(p + 26);
+        f->interval_max = rd32(p + 30);
+    } else {
+        if (len < 26 + 4 * type) return -1;
+        f->interval_min = f->interval_max = rd32(p + 26);
+        for (int i = 1; i < type; i++) {
+            uint32_t v = rd32(p + 26 + 4 * i);
+            if (v < f->interval_min) f->interval_min = v;
+            if (v > f->interval_max) f->interval_max = v;
+        }
+    }
+    return f->interval_min ? 0 : -1;
+}
+
+int uvc_list_frames(libusb_device_handle *d, uvc_frame_desc_t *out, int max)
+{
+    struct libusb_config_descriptor *cfg;
+    if (libusb_get_active_config_descriptor(libusb_get_device(d), &cfg) != 0) return -1;
+    int n = 0;
+    for (int i = 0; i < cfg->bNumInterfaces; i++) {
+        const struct libusb_interface *itf = &cfg->interface[i];
+        if (!itf->num_altsetting || itf->altsetting[0].bInterfaceNumber != IF_VIDEO_STREAM) continue;
+        const uint8_t *p = itf->altsetting[0].extra;
+        int left = itf->altsetting[0].extra_length;
+        uint8_t format = 0;
+        while (left >= 3 && p[0] >= 3 && p[0] <= left) {
+            if (p[1] == CS_INTERFACE) {
+                if (p[2] == VS_FORMAT_UNCOMPRESSED || p[2] == VS_FORMAT_MJPEG ||
+                    p[2] == VS_FORMAT_FRAME_BASED)
+                    format = p[0] > 3 ? p[3] : 0;
+                else if ((p[2] == VS_FRAME_UNCOMPRESSED || p[2] == VS_FRAME_MJPEG ||
+                          p[2] == VS_FRAME_FRAME_BASED) && format && n < max &&
+                         parse_frame(p, p[0], format, &out[n]) == 0)
+                    n++;
+            }
+            left -= p[0];
+            p += p[0];
+        }
+    }
+    libusb_free_config_descriptor(cfg);
+    return n;
+}
+
+int uvc_negotiate(libusb_device_handle *d, const uvc_frame_desc_t *f, uint32_t interval,
+                  uvc_probe_t *out)
+{
+    uvc_probe_t p;
+    int r;
+
+    memset(&p, 0, sizeof(p));
+    r = uvc_ctrl(d, UVC_GET_MAX, VS_PROBE_CONTROL, IF_VIDEO_STREAM, &p, sizeof(p));
+    if (r >= 0)
+        printf("[UVC] GET_MAX: fmt=%d frm=%d interval=%u maxframe=%u maxpayload=%u\n",
+               p.bFormatIndex, p.bFrameIndex, p.dwFrameInterval,
+               p.dwMaxVideoFrameSize, p.dwMaxPayloadTransferSize);
+
+    memset(&p, 0, sizeof(p));
+    p.bmHint = 0x0001;                  /* keep dwFrameInterval fixed */
+    p.bFormatIndex = f ? f->format : 1;
+    p.bFrameIndex = f ? f->frame : 1;
+    p.dwFrameInterval = interval ? interval : 416667;
+
+    r = uvc_ctrl(d, UVC_SET_CUR, VS_PROBE_CONTROL, IF_VIDEO_STREAM, &p, sizeof(p));
+    if (r < 0) { printf("[UVC] PROBE SET: %s\n", libusb_strerror(r)); return -1; }
+
+    memset(&p, 0, sizeof(p));
+    r = uvc_ctrl(d, UVC_GET_CUR, VS_PROBE_CONTROL, IF_VIDEO_STREAM, &p, sizeof(p));
+    if (r >= 0)
+        printf("[UVC] Negotiated: fmt=%d frm=%d interval=%u (%.1f fps) maxframe=%u payload=%u\n",
+               p.bFormatIndex, p.bFrameIndex, p.dwFrameInterval,
+               p.dwFrameInterval ? 1e7 / p.dwFrameInterval : 0.0,
+               p.dwMaxVideoFrameSize, p.dwMaxPayloadTransferSize);
+
+    r = uvc_ctrl(d, UVC_SET_CUR, VS_COMMIT_CONTROL, IF_VIDEO_STREAM, &p, sizeof(p));
+    if (r < 0) { printf("[UVC] COMMIT: %s\n", libusb_strerror(r)); return -1; }
+    printf("[UVC] Stream committed — EP 0x%02X\n", EP_BULK_IN);
+    if (out) *out = p;
+    return 0;
+}
+
+int uvc_start(libusb_device_handle *d, uvc_probe_t *out)
+{
+    return uvc_negotiate(d, NULL, 0, out);
+}
+
+int uvc_transfer_size(const uvc_probe_t *p, int fallback)
+{
+    uint32_t n = p->dwMaxPayloadTransferSize;
+    if (n < 512 || n > MAX_FRAME_SIZE) return fallback;
+    return (int)((n + 511) & ~511u);    /* whole bulk packets */
+}
+
+void uvc_stop_stream(libusb_device_handle *d)
+{
+    libusb_clear_halt(d, EP_BULK_IN);
+}
+
+/* ── Reassembly (event thread) ──────────────────────────────────────── */
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* Stitch target requested by the consumer, clamped to the slot size */
+static uint32_t accum_wanted(const uvc_capture_t *cap)
+{
+    uint32_t req = __atomic_load_n(&cap->accum_req, __ATOMIC_RELAXED);
+    uint32_t slot = (uint32_t)frame_pool_slot_size(cap->pool);
+    return req < slot ? req : slot;
+}
+
+static void queue_frame(uvc_capture_t *cap, frame_t *f, uint8_t why)
+{
+    if (f->len == 0) {
+        frame_unref(f);
+        return;
+    }
+    f->flags |= why;
+    frame_stats_end(&f->stats);
+    if (cap->cfg.tap) cap->cfg.tap(cap->cfg.tap_arg, f);
+    if (spsc_ring_push(&cap->ready, &f) < 0) {
+        STAT_INC(cap->stats.drop_queue);
+        frame_unref(f);
+        return;
+    }
+    STAT_INC(cap->stats.frames);
+}
+
+/* End of a sub-frame. Normally the frame goes to the consumer; while
+ * stitching it only closes the current fragment until the target fills. */
+static void frame_finish(uvc_capture_t *cap, uint8_t why)
+{
+    frame_t *f = cap->cur;
+    cap->dropping = 0;
+    if (!f) return;
+
+    if (cap->accum_target != accum_wanted(cap)) {
+        /* Mode changed mid-frame: throw the partial result away */
+        f->len = 0;
+    } else if (cap->accum_target > 0 && (why & (UVC_FRAME_EOF | UVC_FRAME_FID_FLIP))) {
+        if (f->len - cap->frag_start < TOBII_MIN_FRAGMENT) {
+            f->len = cap->frag_start;
+            f->stats = cap->frag_stats;
+        }
+        if (f->len < cap->accum_target) {
+            cap->frag_start = f->len;
+            cap->frag_fresh = 1;
+            return;
+        }
+    }
+
+    cap->cur = NULL;
+    queue_frame(cap, f, why | (cap->accum_target ? UVC_FRAME_STITCHED : 0));
+}
+
+/* Get the frame under construction, starting a new one if needed.
+ * Returns NULL while the current frame is being discarded. */
+static frame_t *frame_current(uvc_capture_t *cap, uint64_t now)
+{
+    if (cap->cur) return cap->cur;
+    if (cap->dropping) return NULL;
+
+    frame_t *f = frame_pool_get(cap->pool);
+    if (!f) {
+        cap->dropping = 1;
+        STAT_INC(cap->stats.drop_nobuf);
+        return NULL;
+    }
+    f->fid = (uint8_t)(cap->fid < 0 ? 0 : cap->fid);
+    f->npayloads = 0;
+    f->seq = cap->seq++;
+    f->t_first_ns = now;
+
+    cap->accum_target = accum_wanted(cap);
+    /* Stitched fragments have their headers stripped before they land */
+    frame_stats_begin(&f->stats, cap->accum_target == 0);
+    cap->frag_start = 0;
+    cap->frag_fresh = 1;
+    cap->cur = f;
+    return f;
+}
+
+static void frame_append(uvc_capture_t *cap, const uint8_t *p, int n, uint64_t now)
+{
+    frame_t *f = frame_current(cap, now);
+    if (!f) return;
+
+    if (cap->frag_fresh) {
+        cap->frag_fresh = 0;
+        if (cap->accum_target > 0) {
+            cap->frag_stats = f->stats;     /* to undo a header-only fragment */
+            if (tobii_has_meta_header(p, (uint32_t)n)) {
+                p += TOBII_META_LEN;
+                n -= TOBII_META_LEN;
+            }
+        }
+    }
+
+    uint32_t limit = cap->accum_target ? cap->accum_target : f->cap;
+    uint32_t room = limit - f->len;
+    uint32_t c = ((uint32_t)n < room) ? (uint32_t)n : room;
+    memcpy(f->data + f->len, p, c);
+    frame_stats_feed(&f->stats, p, c);      /* while p is still in cache */
+    f->len += c;
+    f->npayloads++;
+    f->t_last_ns = now;
+
+    if (f->len < limit) return;
+    if (cap->accum_target) {
+        /* Target reached mid-fragment: ship it, skip the rest of this one */
+        cap->cur = NULL;
+        queue_frame(cap, f, UVC_FRAME_STITCHED);
+        cap->dropping = 1;
+    } else {
+        frame_finish(cap, UVC_FRAME_FULL);
+    }
+}
+
+/* Same framing rules as the old synchronous read_frame(), except that the
+ * payload which toggles FID now starts the next frame instead of being
+ * thrown away. */
+static void handle_payload(uvc_capture_t *cap, const uint8_t *pkt, int n, uint64_t now)
+{
+    if (n < 2) return;
+    uint8_t hlen = pkt[0], bfh = pkt[1];
+
+    if (hlen < 2 || hlen > n) {
+        /* Not a valid UVC header — keep raw */
+        frame_append(cap, pkt, n, now);
+        if (cap->cur) cap->cur->flags |= UVC_FRAME_RAW;
+        return;
+    }
+    if (bfh & BFH_ERR) {
+        STAT_INC(cap->stats.payload_errs);
+        if (cap->cur) cap->cur->len = 0;
+        frame_finish(cap, 0);
+        cap->fid = -1;
+        return;
+    }
+
+    int cfid = bfh & BFH_FID;
+    if (cap->fid >= 0 && cfid != cap->fid &&
+        ((cap->cur && cap->cur->len > 0) || cap->dropping))
+        frame_finish(cap, UVC_FRAME_FID_FLIP);
+    cap->fid = cfid;
+
+    if (n > hlen) frame_append(cap, pkt + hlen, n - hlen, now);
+    if (bfh & BFH_EOF) frame_finish(cap, UVC_FRAME_EOF);
+}
+
+static void LIBUSB_CALL xfer_cb(struct libusb_transfer *t)
+{
+    uvc_capture_t *cap = t->user_data;
+    STAT_INC(cap->stats.xfer_done);
+
+    switch (t->status) {
+    case LIBUSB_TRANSFER_COMPLETED:
+        handle_payload(cap, t->buffer, t->actual_length, now_ns());
+        break;
+    case LIBUSB_TRANSFER_TIMED_OUT:
+        STAT_INC(cap->stats.xfer_timeouts);
+        if (t->actual_length > 0)
+            handle_payload(cap, t->buffer, t->actual_length, now_ns());
+        break;
+    case LIBUSB_TRANSFER_CANCELLED:
+        break;
+    default:
+        STAT_INC(cap->stats.xfer_errors);
+        break;
+    }
+
+    if (!__atomic_load_n(&cap->stopping, __ATOMIC_ACQUIRE) && t->status != LIBUSB_TRANSFER_CANCELLED &&
+        t->status != LIBUSB_TRANSFER_NO_DEVICE) {
+        int r = libusb_submit_transfer(t);
+        if (r == 0) return;
+        fprintf(stderr, "[CAPTURE] resubmit: %s\n", libusb_strerror(r));
+    }
+    cap->active--;
+    if (t->status == LIBUSB_TRANSFER_NO_DEVICE)
+        fprintf(stderr, "[CAPTURE] device disappeared\n");
+}
+
+static void *event_thread(void *arg)
+{
+    uvc_capture_t *cap = arg;
+    if (cap->cfg.cpu >= 0) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(cap->cfg.cpu, &set);
+        int rc = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+        if (rc) fprintf(stderr, "[CAPTURE] Cannot pin to CPU %d: %s\n", cap->cfg.cpu, strerror(rc));
+    }
+    while (cap->active > 0) {
+        struct timeval tv = { 0, 100000 };
+        libusb_handle_events_timeout_completed(cap->ctx, &tv, NULL);
+        /* A callback that ran while uvc_capture_stop() swept the ring may
+         * have resubmitted its transfer after the sweep missed it; with no
+         * timeout it would wait for a frame forever. Sweep again here,
+         * between callbacks, until every transfer is back. */
+        if (cap->active > 0 && __atomic_load_n(&cap->stopping, __ATOMIC_ACQUIRE))
+            for (int i = 0; i < cap->cfg.num_transfers; i++) libusb_cancel_transfer(cap->xfers[i]);
+    }
+    /* Ring is gone: wake the consumer so it can see running == 0 */
+    __atomic_store_n(&cap->running, 0, __ATOMIC_RELEASE);
+    spsc_ring_wake(&cap->ready);
+    return NULL;
+}
+
+/* ── Public API ─────────────────────────────────────────────────────── */
+
+static void free_buffers(uvc_capture_t *cap)
+{
+    if (cap->xfers) {
+        for (int i = 0; i < cap->cfg.num_transfers; i++) {
+            struct libusb_transfer *t = cap->xfers[i];
+            if (!t) continue;
+            if (cap->devmem) libusb_dev_mem_free(cap->dev, t->buffer, cap->cfg.transfer_size);
+            else             free(t->buffer);
+            libusb_free_transfer(t);
+        }
+    }
+    free(cap->xfers);
+    spsc_ring_free(&cap->ready);
+    if (cap->own_pool) frame_pool_destroy(cap->pool);
+}
+
+uvc_capture_t *uvc_capture_start(libusb_context *ctx, libusb_device_handle *dev,
+                                 const uvc_capture_config_t *cfg)
+{
+    static const uvc_capture_config_t defaults = UVC_CAPTURE_DEFAULTS;
+    uvc_capture_t *cap = calloc(1, sizeof(*cap));
+    if (!cap) return NULL;
+
+    cap->ctx = ctx;
+    cap->dev = dev;
+    cap->cfg = cfg ? *cfg : defaults;
+    cap->fid = -1;
+
+    int nx = cap->cfg.num_transfers;
+
+    cap->pool = cap->cfg.pool;
+    if (!cap->pool) {
+        cap->pool = frame_pool_create(cap->cfg.num_frames, (size_t)cap->cfg.frame_size);
+        cap->own_pool = 1;
+    }
+    cap->xfers = calloc(nx, sizeof(*cap->xfers));
+    if (!cap->pool || !cap->xfers ||
+        spsc_ring_init(&cap->ready, (uint32_t)cap->cfg.queue_depth, sizeof(frame_t *)) < 0) {
+        perror("[CAPTURE] alloc");
+        goto fail;
+    }
+
+    /* Prefer kernel-mapped buffers (usbfs zero-copy); fall back to heap */
+    cap->devmem = 1;
+    for (int i = 0; i < nx; i++) {
+        uint8_t *buf = cap->devmem ? libusb_dev_mem_alloc(dev, cap->cfg.transfer_size) : NULL;
+        if (!buf && cap->devmem && i == 0) cap->devmem = 0;
+        if (!buf) buf = malloc(cap->cfg.transfer_size);
+        struct libusb_transfer *t = libusb_alloc_transfer(0);
+        if (!buf || !t) { free(buf); libusb_free_transfer(t); goto fail; }
+        libusb_fill_bulk_transfer(t, dev, EP_BULK_IN, buf, cap->cfg.transfer_size,
+                                  xfer_cb, cap, 0);
+        cap->xfers[i] = t;
+    }
+
+    for (int i = 0; i < nx; i++) {
+        int r = libusb_submit_transfer(cap->xfers[i]);
+        if (r < 0) { fprintf(stderr, "[CAPTURE] submit: %s\n", libusb_strerror(r)); break; }
+        cap->active++;
+    }
+    if (cap->active == 0) goto fail;
+
+    cap->running = 1;
+    if (pthread_create(&cap->thread, NULL, event_thread, cap) != 0) {
+        perror("[CAPTURE] pthread_create");
+        __atomic_store_n(&cap->stopping, 1, __ATOMIC_RELEASE);
+        for (int i = 0; i < nx; i++) libusb_cancel_transfer(cap->xfers[i]);
+        while (cap->active > 0) libusb_handle_events_timeout_completed(ctx, &(struct timeval){0, 100000}, NULL);
+        goto fail;
+    }
+
+    printf("[CAPTURE] %d x %d KB transfers in flight on EP 0x%02X (%s), %d frame slots\n",
+           cap->active, cap->cfg.transfer_size / 1024, EP_BULK_IN,
+           cap->devmem ? "dev-mem" : "heap", frame_pool_size(cap->pool));
+    return cap;
+
+fail:
+    free_buffers(cap);
+    free(cap);
+    return NULL;
+}
+
+frame_t *uvc_capture_next(uvc_capture_t *cap, int timeout_ms)
+{
+    frame_t *f = NULL;
+    if (spsc_ring_pop(&cap->ready, &f) == 0) return f;
+    if (!__atomic_load_n(&cap->running, __ATOMIC_ACQUIRE)) return NULL;
+    if (spsc_ring_pop_wait(&cap->ready, &f, timeout_ms) == 0) return f;
+    return NULL;
+}
+
+int uvc_capture_queue_depth(const uvc_capture_t *cap)
+{
+    return (int)spsc_ring_count(&cap->ready);
+}
+
+void uvc_capture_set_accumulate(uvc_capture_t *cap, uint32_t target_bytes)
+{
+    __atomic_store_n(&cap->accum_req, target_bytes, __ATOMIC_RELAXED);
+}
+
+int uvc_capture_running(const uvc_capture_t *cap)
+{
+    return __atomic_load_n(&cap->running, __ATOMIC_ACQUIRE);
+}
+
+void uvc_capture_get_stats(const uvc_capture_t *cap, uvc_capture_stats_t *out)
+{
+    out->xfer_done     = STAT_LOAD(cap->stats.xfer_done);
+    out->xfer_errors   = STAT_LOAD(cap->stats.xfer_errors);
+    out->xfer_timeouts = STAT_LOAD(cap->stats.xfer_timeouts);
+    out->payload_errs  = STAT_LOAD(cap->stats.payload_errs);
+    out->frames        = STAT_LOAD(cap->stats.frames);
+    out->drop_nobuf    = STAT_LOAD(cap->stats.drop_nobuf);
+    out->drop_queue    = STAT_LOAD(cap->stats.drop_queue);
+}
+
+void uvc_capture_stop(uvc_capture_t *cap)
+{
+    if (!cap) return;
+    __atomic_store_n(&cap->stopping, 1, __ATOMIC_RELEASE);
+    for (int i = 0; i < cap->cfg.num_transfers; i++)
+        libusb_cancel_transfer(cap->xfers[i]);
+    pthread_join(cap->thread, NULL);
+
+    frame_t *f;
+    frame_unref(cap->cur);
+    while (spsc_ring_pop(&cap->ready, &f) == 0) frame_unref(f);
+    free_buffers(cap);
+    free(cap);
+}
@@ -0,0 +1,201 @@
+/*
+ * uvc_capture.h — Asynchronous UVC bulk capture engine for the Tobii ET5
+ *
+ * Keeps a ring of bulk transfers queued on EP 0x82 at all times and runs
+ * libusb event handling on its own thread, so the IR stream keeps flowing
+ * regardless of what the display or tracker threads are doing. Payloads
+ * are reassembled by FID/EOF straight into frame_pool slots and finished
+ * frames are handed to one consumer thread through a lock-free SPSC
+ * ring. The consumer owns one reference to each frame it receives and
+ * drops it with frame_unref() — it may frame_ref() it first to keep it
+ * around (hold).
+ *
+ * Typical use:
+ *   libusb_device_handle *dev = uvc_open_device(ctx, NULL);   // or "1-4.2"
+ *   uvc_capture_config_t cfg = UVC_CAPTURE_DEFAULTS;
+ *   uvc_capture_t *cap = uvc_capture_start(ctx, dev, &cfg);
+ *   for (;;) {
+ *       frame_t *f = uvc_capture_next(cap, 500);
+ *       if (!f) continue;              // timeout
+ *       ... use f->data / f->len ...
+ *       frame_unref(f);                // slot goes back to the pool
+ *   }
+ *   uvc_capture_stop(cap);
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_UVC_CAPTURE_H
+#define SQUIG_UVC_CAPTURE_H
+
+#include <stdint.h>
+#include <libusb.h>
+#include "frame_pool.h"
+#include "tobii_framing.h"
+
+/* ── Tobii USB constants ────────────────────────────────────────────── */
+#define TOBII_VID           0x2104
+#define TOBII_PID           0x0313
+#define IF_VIDEO_CONTROL    1
+#define IF_VIDEO_STREAM     2
+#define EP_BULK_IN          0x82
+#define MAX_FRAME_SIZE      (1024 * 1024)
+
+/* ── UVC Protocol ───────────────────────────────────────────────────── */
+#define VS_PROBE_CONTROL    0x01
+#define VS_COMMIT_CONTROL   0x02
+#define UVC_SET_CUR         0x01
+#define UVC_GET_CUR         0x81
+#define UVC_GET_MAX         0x83
+
+typedef struct __attribute__((packed)) {
+    uint16_t bmHint;
+    uint8_t  bFormatIndex;
+    uint8_t  bFrameIndex;
+    uint32_t dwFrameInterval;
+    uint16_t wKeyFrameRate;
+    uint16_t wPFrameRate;
+    uint16_t wCompQuality;
+    uint16_t wCompWindowSize;
+    uint16_t wDelay;
+    uint32_t dwMaxVideoFrameSize;
+    uint32_t dwMaxPayloadTransferSize;
+} uvc_probe_t;
+
+#define BFH_FID     0x01
+#define BFH_EOF     0x02
+#define BFH_ERR     0x40
+
+int uvc_ctrl(libusb_device_handle *d, uint8_t req, uint8_t cs,
+             uint8_t intf, void *buf, uint16_t len);
+
+/* ── Device discovery ───────────────────────────────────────────────── */
+
+#define UVC_PATH_MAX        32
+
+/* Every 2104:0313 on the bus, as "bus-port[.port...]" paths (the sysfs
+ * name, stable while the tracker stays in its socket), up to max of them
+ * into paths[]. Returns how many were found (may exceed max), or -1. */
+int uvc_list_devices(libusb_context *ctx, char paths[][UVC_PATH_MAX], int max);
+
+/* Open the tracker at path, or the first one found for NULL / "".
+ * Returns NULL (with a message) if there is none or it cannot be opened. */
+libusb_device_handle *uvc_open_device(libusb_context *ctx, const char *path);
+
+/* ── Stream formats ─────────────────────────────────────────────────── */
+
+#define UVC_MAX_FRAMES      16
+
+/* One frame descriptor of the VS interface (uncompressed, MJPEG or
+ * frame-based). Intervals are in 100 ns units: interval_min is the
+ * fastest rate offered, interval_max the slowest. */
+typedef struct {
+    uint8_t  format, frame;     /* bFormatIndex, bFrameIndex */
+    uint16_t width, height;
+    uint32_t max_frame_bytes;
+    uint32_t interval_min, interval_max, interval_default;
+} uvc_frame_desc_t;
+
+/* The frame descriptors of IF2, in descriptor order, up to max of them.
+ * Read from the cached configuration descriptor (no control traffic).
+ * Returns how many, 0 if the device lists none, or -1. */
+int uvc_list_frames(libusb_device_handle *d, uvc_frame_desc_t *out, int max);
+
+/* Run the PROBE/COMMIT negotiation for frame f at interval (100 ns
+ * units). f NULL = format 1 / frame 1, interval 0 = 24 fps. On success
+ * the committed probe is copied to *out (if non-NULL). */
+int uvc_negotiate(libusb_device_handle *d, const uvc_frame_desc_t *f, uint32_t interval,
+                  uvc_probe_t *out);
+
+/* uvc_negotiate(d, NULL, 0, out): 24 fps, format 1 / frame 1. */
+int uvc_start(libusb_device_handle *d, uvc_probe_t *out);
+
+/* uvc_capture_config_t.transfer_size for a committed probe: one bulk
+ * transfer carries one payload, so its dwMaxPayloadTransferSize rounded
+ * up to whole 512-byte packets. fallback if the probe has none. */
+int uvc_transfer_size(const uvc_probe_t *p, int fallback);
+
+/* Stop a committed bulk stream: CLEAR_FEATURE(ENDPOINT_HALT) on the
+ * streaming endpoint, which is how UVC ends bulk streaming. Stop the
+ * capture engine first; a new COMMIT starts the stream again. */
+void uvc_stop_stream(libusb_device_handle *d);
+
+/* COMMIT a probe negotiated earlier, with no PROBE round-trips (a
+ * replugged tracker, same firmware). Returns 0, or -1 if the device did
+ * not take it within timeout_ms (negotiate again with uvc_start()). */
+int uvc_commit(libusb_device_handle *d, const uvc_probe_t *p, unsigned timeout_ms);
+
+/* ── Capture engine ─────────────────────────────────────────────────── */
+
+/* Frame flag bits (frame_t.flags) */
+#define UVC_FRAME_EOF       0x01    /* ended on an EOF bit */
+#define UVC_FRAME_FID_FLIP  0x02    /* ended because the FID toggled */
+#define UVC_FRAME_FULL      0x04    /* ended because the buffer filled */
+#define UVC_FRAME_RAW       0x08    /* contains payload without a UVC header */
+#define UVC_FRAME_STITCHED  0x10    /* accumulated from several sub-frames */
+
+typedef struct {
+    int num_transfers;      /* bulk transfers kept in flight */
+    int transfer_size;      /* bytes per bulk transfer */
+    int num_frames;         /* slots in the engine's own pool */
+    int frame_size;         /* bytes per slot in the engine's own pool */
+    int queue_depth;        /* finished frames waiting (rounded to 2^n) */
+    frame_pool_t *pool;     /* shared pool to use instead (not owned) */
+
+    /* Called on the event thread with every finished frame, before it is
+     * queued for the consumer (e.g. recorder_tap). Must not block; the
+     * frame is only borrowed for the duration of the call. */
+    void (*tap)(void *arg, const frame_t *f);
+    void *tap_arg;
+
+    int cpu;                /* pin the event thread to this CPU, -1 = no */
+} uvc_capture_config_t;
+
+#define UVC_CAPTURE_DEFAULTS { 8, 65536, 8, MAX_FRAME_SIZE, 4, NULL, NULL, NULL, -1 }
+
+typedef struct {
+    uint64_t xfer_done;     /* transfer completions (any status) */
+    uint64_t xfer_errors;   /* completions with an error status */
+    uint64_t xfer_timeouts; /* completions that timed out */
+    uint64_t payload_errs;  /* payloads with the UVC ERR bit set */
+    uint64_t frames;        /* frames handed to the consumer */
+    uint64_t drop_nobuf;    /* frames lost: pool exhausted */
+    uint64_t drop_queue;    /* frames lost: consumer queue full */
+} uvc_capture_stats_t;
+
+typedef struct uvc_capture uvc_capture_t;
+
+/* Allocate buffers, submit the transfer ring and start the event thread.
+ * The device must already have IF1/IF2 claimed and the stream committed.
+ * With several trackers, give each its own libusb_context: the event
+ * thread handles every device on its context, so one context per tracker
+ * keeps each tracker's completions on its own (pinned) thread.
+ * cfg may be NULL for UVC_CAPTURE_DEFAULTS. Returns NULL on failure. */
+uvc_capture_t *uvc_capture_start(libusb_context *ctx, libusb_device_handle *dev,
+                                 const uvc_capture_config_t *cfg);
+
+/* Wait up to timeout_ms for the next finished frame (FIFO order). The
+ * caller owns the returned reference. Returns NULL on timeout or once the
+ * engine has stopped. */
+frame_t *uvc_capture_next(uvc_capture_t *cap, int timeout_ms);
+
+/* Stitch consecutive sub-frames into one slot until target_bytes have
+ * been collected (0 = off). Metadata headers are stripped from each
+ * fragment and header-only fragments are skipped, so the consumer gets a
+ * full frame without copying anything. Takes effect at the next frame. */
+void uvc_capture_set_accumulate(uvc_capture_t *cap, uint32_t target_bytes);
+
+/* Finished frames waiting for the consumer right now. */
+int uvc_capture_queue_depth(const uvc_capture_t *cap);
+
+/* Nonzero while the transfer ring is alive (goes 0 on device loss). */
+int uvc_capture_running(const uvc_capture_t *cap);
+
+void uvc_capture_get_stats(const uvc_capture_t *cap, uvc_capture_stats_t *out);
+
+/* Cancel all transfers, join the event thread and free everything.
+ * Drop all frame references first if the engine owns the pool. */
+void uvc_capture_stop(uvc_capture_t *cap);
+
+#endif /* SQUIG_UVC_CAPTURE_H */
@@ -0,0 +1,553 @@
+/*
+ * uvc_device.c — ET5 bring-up, probe cache and hot-replug around uvc_capture
+ *
+ * See uvc_device.h. The cache file is a state_file.h file: magic,
+ * version, size, bcdDevice, the probe as the 26 bytes that went over the
+ * wire, then the interval that was asked for (the device may have
+ * committed another), then the checksum.
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "uvc_device.h"
+#include "state_file.h"
+
+#define CACHE_MAGIC     0x43505153u     /* "SQPC" */
+#define CACHE_VERSION   2
+#define CACHE_BYTES     (4 + 2 + 2 + 2 + 2 + (int)sizeof(uvc_probe_t) + 4 + 4)
+#define CACHE_ASKED     (12 + (int)sizeof(uvc_probe_t))    /* offset of the requested interval */
+#define CACHE_DIR       "squig-headtrack"
+#define RESCAN_MS       500             /* away: look for the tracker this often */
+
+struct uvc_device {
+    libusb_context       *ctx;
+    uvc_device_config_t   cfg;
+    frame_pool_t         *own_pool;
+
+    /* Current bring-up (consumer thread) */
+    libusb_device_handle *h;
+    uvc_capture_t        *cap;
+    int                   detached[2];  /* IF1, IF2 had a kernel driver */
+    int                   claimed[2];
+    uvc_probe_t           probe;
+    uint32_t              accumulate;   /* applied; re-applied to every engine */
+    uint16_t              bcd;
+    uvc_frame_desc_t      frames[UVC_MAX_FRAMES];
+    int                   nframes;
+    uvc_demand_t          applied;      /* demand the running stream serves */
+    int                   done;         /* lost with replug off, or closed */
+    int64_t               next_scan_ns;
+
+    /* Hotplug (raised on whichever thread handles libusb events) */
+    int                   hotplug;
+    libusb_hotplug_callback_handle hp;
+    libusb_device        *usbdev;       /* the tracker in use, NULL while away */
+    int                   lost, arrived;
+
+    /* Requests (any thread) */
+    int                   subs[UVC_DEMAND_COUNT];   /* subscribers per level */
+    uint32_t              accum_req;
+
+    /* Stats: kept by the consumer, published as a snapshot */
+    uvc_device_stats_t    st;
+    uvc_capture_stats_t   retired;      /* engines already stopped */
+    int                   dirty;        /* lifecycle changed: publish now */
+    int64_t               next_snap_ns;
+    pthread_mutex_t       snap_lock;
+    uvc_device_stats_t    snap;
+};
+
+static int64_t mono_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/* ── Probe cache ────────────────────────────────────────────────────── */
+
+int uvc_device_cache_path(const char *serial, char *buf, size_t size)
+{
+    char key[64];
+    size_t k = 0;
+    for (const char *c = serial; *c && k < sizeof(key) - 1; c++) {
+        int ok = (*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') ||
+                 *c == '_' || *c == '-';
+        key[k++] = ok ? *c : '_';
+    }
+    key[k] = 0;
+    if (!k) return -1;
+
+    const char *dir = getenv("SQUIG_PROFILE_DIR"), *xdg = getenv("XDG_CACHE_HOME");
+    const char *home = getenv("HOME");
+    int n;
+    if (dir && *dir) n = snprintf(buf, size, "%s/uvc-%s.probe", dir, key);
+    else if (xdg && *xdg) n = snprintf(buf, size, "%s/" CACHE_DIR "/uvc-%s.probe", xdg, key);
+    else if (home && *home) n = snprintf(buf, size, "%s/.cache/" CACHE_DIR "/uvc-%s.probe", home, key);
+    else return -1;
+    return n > 0 && (size_t)n < size ? 0 : -1;
+}
+
+/* 0 = loaded, made for this firmware and for a request of interval
+ * asked; anything else = negotiate */
+static int cache_load(const char *serial, uint16_t bcd, uint32_t asked, uvc_probe_t *p)
+{
+    char path[512];
+    if (uvc_device_cache_path(serial, path, sizeof(path)) < 0) return -1;
+    FILE *f = fopen(path, "rb");
+    if (!f) return 1;
+    uint8_t b[CACHE_BYTES + 1];
+    size_t n = fread(b, 1, sizeof(b), f);
+    fclose(f);
+
+    uint32_t magic, sum;
+    uint16_t version, size, fw;
+    memcpy(&magic, b, 4);
+    memcpy(&version, b + 4, 2);
+    memcpy(&size, b + 6, 2);
+    memcpy(&fw, b + 8, 2);
+    memcpy(&sum, b + CACHE_BYTES - 4, 4);
+    if (n != CACHE_BYTES || magic != CACHE_MAGIC || version != CACHE_VERSION ||
+        size != CACHE_BYTES || sum != state_file_fnv1a(b, CACHE_BYTES - 4)) {
+        fprintf(stderr, "[USB] %s: not a version %d probe cache, ignored\n", path, CACHE_VERSION);
+        return -1;
+    }
+    uint32_t was_asked;
+    memcpy(&was_asked, b + CACHE_ASKED, 4);
+    if (fw != bcd) return 1;            /* firmware changed since */
+    if (was_asked != asked) return 1;   /* negotiated for another demand */
+    memcpy(p, b + 12, sizeof(*p));
+    return 0;
+}
+
+static void cache_save(const char *serial, uint16_t bcd, uint32_t asked, const uvc_probe_t *p)
+{
+    char path[512];
+    if (uvc_device_cache_path(serial, path, sizeof(path)) < 0) return;
+    uint8_t b[CACHE_BYTES] = { 0 };
+    uint32_t magic = CACHE_MAGIC;
+    uint16_t version = CACHE_VERSION, size = CACHE_BYTES;
+    memcpy(b, &magic, 4);
+    memcpy(b + 4, &version, 2);
+    memcpy(b + 6, &size, 2);
+    memcpy(b + 8, &bcd, 2);
+    memcpy(b + 12, p, sizeof(*p));
+    memcpy(b + CACHE_ASKED, &asked, 4);
+    uint32_t sum = state_file_fnv1a(b, CACHE_BYTES - 4);
+    memcpy(b + CACHE_BYTES - 4, &sum, 4);
+
+    if (state_file_write(path, b, sizeof(b)) < 0)
+        fprintf(stderr, "[USB] %s: cannot write the probe cache: %s\n", path, strerror(errno));
+}
+
+/* ── Bring-up / teardown (consumer thread) ──────────────────────────── */
+
+static void read_serial(libusb_device_handle *h, uint8_t index, char *out, size_t size)
+{
+    out[0] = 0;
+    if (index && libusb_get_string_descriptor_ascii(h, index, (unsigned char *)out, (int)size) < 0)
+        out[0] = 0;
+}
+
+/* The tracker to bring up: the known serial on any port, else the
+ * configured path, else the first one. NULL if it is not there. */
+static libusb_device_handle *find_tracker(uvc_device_t *ud, int quiet, char *serial, char *path,
+                                          uint16_t *bcd)
+{
+    libusb_device **list;
+    ssize_t cnt = libusb_get_device_list(ud->ctx, &list);
+    if (cnt < 0) return NULL;
+    libusb_device_handle *found = NULL;
+    for (ssize_t i = 0; i < cnt && !found; i++) {
+        struct libusb_device_descriptor desc;
+        if (libusb_get_device_descriptor(list[i], &desc) != 0 ||
+            desc.idVendor != TOBII_VID || desc.idProduct != TOBII_PID)
+            continue;
+        uint8_t ports[8];
+        int np = libusb_get_port_numbers(list[i], ports, (int)sizeof(ports));
+        int len = snprintf(path, UVC_PATH_MAX, "%u", libusb_get_bus_number(list[i]));
+        for (int k = 0; k < np && len < UVC_PATH_MAX; k++)
+            len += snprintf(path + len, UVC_PATH_MAX - len, "%c%u", k ? '.' : '-', ports[k]);
+        if (!ud->st.serial[0] && ud->cfg.path && *ud->cfg.path && strcmp(path, ud->cfg.path) != 0)
+            continue;
+
+        libusb_device_handle *h;
+        int r = libusb_open(list[i], &h);
+        if (r < 0) {
+            if (!quiet) fprintf(stderr, "[USB] Cannot open tracker at %s: %s\n", path, libusb_strerror(r));
+            continue;
+        }
+        read_serial(h, desc.iSerialNumber, serial, sizeof(ud->st.serial));
+        if (ud->st.serial[0] && strcmp(serial, ud->st.serial) != 0) {
+            libusb_close(h);
+            continue;
+        }
+        *bcd = desc.bcdDevice;
+        found = h;
+    }
+    libusb_free_device_list(list, 1);
+    if (!found && !quiet)
+        fprintf(stderr, "[USB] No Tobii ET5 (%04x:%04x)%s%s\n", TOBII_VID, TOBII_PID,
+                ud->cfg.path && *ud->cfg.path ? " at " : "", ud->cfg.path ? ud->cfg.path : "");
+    return found;
+}
+
+static void capture_stats_add(uvc_capture_stats_t *a, const uvc_capture_stats_t *b)
+{
+    a->xfer_done += b->xfer_done;
+    a->xfer_errors += b->xfer_errors;
+    a->xfer_timeouts += b->xfer_timeouts;
+    a->payload_errs += b->payload_errs;
+    a->frames += b->frames;
+    a->drop_nobuf += b->drop_nobuf;
+    a->drop_queue += b->drop_queue;
+}
+
+/* Stop the engine, keeping its counts */
+static void engine_stop(uvc_device_t *ud)
+{
+    if (!ud->cap) return;
+    uvc_capture_stats_t cs;
+    uvc_capture_get_stats(ud->cap, &cs);
+    capture_stats_add(&ud->retired, &cs);
+    uvc_capture_stop(ud->cap);
+    ud->cap = NULL;
+    ud->dirty = 1;
+}
+
+/* Publish st (and the engine's counts) for other threads */
+static void snapshot(uvc_device_t *ud, int64_t now)
+{
+    ud->st.capture = ud->retired;
+    ud->st.queue_depth = 0;
+    if (ud->cap) {
+        uvc_capture_stats_t cs;
+        uvc_capture_get_stats(ud->cap, &cs);
+        capture_stats_add(&ud->st.capture, &cs);
+        ud->st.queue_depth = uvc_capture_queue_depth(ud->cap);
+    }
+    ud->st.demand = ud->applied;
+    pthread_mutex_lock(&ud->snap_lock);
+    ud->snap = ud->st;
+    pthread_mutex_unlock(&ud->snap_lock);
+    ud->dirty = 0;
+    ud->next_snap_ns = now + UVC_DEVICE_SNAPSHOT_MS * 1000000LL;
+}
+
+/* reattach: give IF1/IF2 back to the kernel (close, not a loss) */
+static void release(uvc_device_t *ud, int reattach)
+{
+    __atomic_store_n(&ud->usbdev, NULL, __ATOMIC_RELAXED);
+    engine_stop(ud);
+    ud->dirty = 1;
+    if (!ud->h) return;
+    static const int ifs[2] = { IF_VIDEO_CONTROL, IF_VIDEO_STREAM };
+    for (int i = 1; i >= 0; i--) {
+        if (ud->claimed[i]) libusb_release_interface(ud->h, ifs[i]);
+        if (ud->detached[i] && reattach) libusb_attach_kernel_driver(ud->h, ifs[i]);
+        ud->claimed[i] = ud->detached[i] = 0;
+    }
+    libusb_close(ud->h);
+    ud->h = NULL;
+    ud->st.connected = 0;
+    ud->st.frame_interval = 0;
+    ud->applied = UVC_DEMAND_OFF;
+}
+
+static uvc_demand_t wanted(const uvc_device_t *ud)
+{
+    for (int d = UVC_DEMAND_COUNT - 1; d > UVC_DEMAND_OFF; d--)
+        if (__atomic_load_n(&ud->subs[d], __ATOMIC_ACQUIRE) > 0) return (uvc_demand_t)d;
+    return UVC_DEMAND_OFF;
+}
+
+/* Frame and interval for a demand: the tracker's first frame descriptor
+ * (the ET5 lists one), fastest rate for FULL, slowest for PREVIEW. No
+ * descriptors: format 1 / frame 1 at 24 fps, as before. */
+static uint32_t pick(const uvc_device_t *ud, uvc_demand_t want, const uvc_frame_desc_t **f)
+{
+    *f = ud->nframes > 0 ? &ud->frames[0] : NULL;
+    if (!*f) return 0;
+    return want == UVC_DEMAND_FULL ? (*f)->interval_min : (*f)->interval_max;
+}
+
+/* Commit a probe for want (cached if allowed and still right) and start
+ * the engine with transfers sized to the committed payload. */
+static int stream_on(uvc_device_t *ud, uvc_demand_t want, int use_cache, int *cached)
+{
+    const uvc_frame_desc_t *f;
+    uint32_t iv = pick(ud, want, &f);
+    const char *key = ud->st.serial[0] ? ud->st.serial : ud->st.path;
+    *cached = use_cache && ud->cfg.probe_cache && cache_load(key, ud->bcd, iv, &ud->probe) == 0 &&
+              uvc_commit(ud->h, &ud->probe, ud->cfg.commit_ms) == 0;
+    if (!*cached) {
+        memset(&ud->probe, 0, sizeof(ud->probe));
+        if (uvc_negotiate(ud->h, f, iv, &ud->probe) < 0)
+            fprintf(stderr, "[UVC] Negotiation failed — trying raw reads\n");
+        else if (use_cache && ud->cfg.probe_cache)
+            cache_save(key, ud->bcd, iv, &ud->probe);
+    }
+
+    uvc_capture_config_t ccfg = ud->cfg.capture;
+    ccfg.transfer_size = uvc_transfer_size(&ud->probe, ccfg.transfer_size);
+    ud->cap = uvc_capture_start(ud->ctx, ud->h, &ccfg);
+    if (!ud->cap) {
+        fprintf(stderr, "[CAPTURE] Cannot start capture engine\n");
+        return -1;
+    }
+    if (ud->accumulate) uvc_capture_set_accumulate(ud->cap, ud->accumulate);
+    ud->applied = want;
+    ud->st.frame_interval = ud->probe.dwFrameInterval;
+    ud->dirty = 1;
+    return 0;
+}
+
+static void stream_off(uvc_device_t *ud)
+{
+    engine_stop(ud);
+    uvc_stop_stream(ud->h);
+    ud->applied = UVC_DEMAND_OFF;
+    ud->st.frame_interval = 0;
+}
+
+/* Demand changed: stop, and restart at the new rate unless nobody wants
+ * frames. Runs between frames, so the consumer never sees a torn stream. */
+static int apply(uvc_device_t *ud, uvc_demand_t want)
+{
+    static const char *names[UVC_DEMAND_COUNT] = { "off", "preview", "full" };
+    int cached;
+    if (ud->cap) stream_off(ud);
+    ud->st.rate_changes++;
+    if (want != UVC_DEMAND_OFF && stream_on(ud, want, 0, &cached) < 0) return -1;
+    printf("[UVC] Demand %s%s\n", names[want], want == UVC_DEMAND_OFF ? " — streaming stopped" : "");
+    return 0;
+}
+
+static int bring_up(uvc_device_t *ud, int quiet)
+{
+    int64_t t0 = mono_ns();
+    char serial[sizeof(ud->st.serial)], path[UVC_PATH_MAX];
+    uint16_t bcd = 0;
+    libusb_device_handle *h = find_tracker(ud, quiet, serial, path, &bcd);
+    if (!h) return -1;
+    ud->h = h;
+
+    static const int ifs[2] = { IF_VIDEO_CONTROL, IF_VIDEO_STREAM };
+    for (int i = 0; i < 2; i++) {
+        if (libusb_kernel_driver_active(h, ifs[i]) == 1 && libusb_detach_kernel_driver(h, ifs[i]) == 0)
+            ud->detached[i] = 1;
+        if (libusb_claim_interface(h, ifs[i]) < 0) {
+            fprintf(stderr, "[USB] Cannot claim IF%d\n", ifs[i]);
+            release(ud, 1);
+            return -1;
+        }
+        ud->claimed[i] = 1;
+    }
+    ud->bcd = bcd;
+    memcpy(ud->st.serial, serial, sizeof(serial));
+    memcpy(ud->st.path, path, sizeof(path));
+    ud->nframes = uvc_list_frames(h, ud->frames, UVC_MAX_FRAMES);
+
+    /* Cached COMMIT, or the full PROBE/COMMIT negotiation */
+    __atomic_store_n(&ud->lost, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&ud->usbdev, libusb_get_device(h), __ATOMIC_RELAXED);
+    uvc_demand_t want = wanted(ud);
+    int cached = 0;
+    ud->applied = UVC_DEMAND_OFF;
+    if (want != UVC_DEMAND_OFF && stream_on(ud, want, 1, &cached) < 0) {
+        release(ud, 1);
+        return -1;
+    }
+
+    double ms = (mono_ns() - t0) / 1e6;
+    printf("[USB] %s tracker %s at %s in %.1f ms (%s)\n", ud->st.bringups ? "Re-armed" : "Opened",
+           serial[0] ? serial : "(no serial)", path, ms,
+           want == UVC_DEMAND_OFF ? "idle, nobody subscribed" : cached ? "cached probe" : "negotiated");
+    ud->st.bringups++;
+    if (cached) ud->st.cached++;
+    ud->st.last_bringup_ms = ms;
+    ud->st.connected = 1;
+    ud->dirty = 1;
+    return 0;
+}
+
+/* Let libusb deliver hotplug events for up to wait_ns (no event thread
+ * runs while the tracker is away or its stream is off). */
+static void pump(uvc_device_t *ud, int64_t wait_ns)
+{
+    if (wait_ns <= 0) return;
+    if (ud->hotplug) {
+        struct timeval tv = { (time_t)(wait_ns / 1000000000LL), (long)(wait_ns % 1000000000LL) / 1000 };
+        libusb_handle_events_timeout_completed(ud->ctx, &tv, NULL);
+    } else {
+        usleep((useconds_t)(wait_ns / 1000));
+    }
+}
+
+static int LIBUSB_CALL hotplug_cb(libusb_context *ctx, libusb_device *dev,
+                                  libusb_hotplug_event ev, void *user)
+{
+    (void)ctx;
+    uvc_device_t *ud = user;
+    if (ev == LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT) {
+        if (dev == __atomic_load_n(&ud->usbdev, __ATOMIC_RELAXED))
+            __atomic_store_n(&ud->lost, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_store_n(&ud->arrived, 1, __ATOMIC_RELAXED);
+    }
+    return 0;                           /* stay registered */
+}
+
+/* ── Public API ─────────────────────────────────────────────────────── */
+
+uvc_device_t *uvc_device_open(libusb_context *ctx, const uvc_device_config_t *cfg)
+{
+    static const uvc_device_config_t defaults = UVC_DEVICE_DEFAULTS;
+    uvc_device_t *ud = calloc(1, sizeof(*ud));
+    if (!ud) return NULL;
+    ud->ctx = ctx;
+    ud->cfg = cfg ? *cfg : defaults;
+    pthread_mutex_init(&ud->snap_lock, NULL);
+    uvc_device_subscribe(ud, ud->cfg.demand);
+    if (!ud->cfg.capture.pool) {
+        ud->own_pool = frame_pool_create(ud->cfg.capture.num_frames, (size_t)ud->cfg.capture.frame_size);
+        if (!ud->own_pool) { free(ud); return NULL; }
+        ud->cfg.capture.pool = ud->own_pool;
+    }
+    if (bring_up(ud, 0) < 0) {
+        frame_pool_destroy(ud->own_pool);
+        pthread_mutex_destroy(&ud->snap_lock);
+        free(ud);
+        return NULL;
+    }
+    snapshot(ud, mono_ns());
+    if (ud->cfg.replug && libusb_has_capability(LIBUSB_CAP_HAS_HOTPLUG) &&
+        libusb_hotplug_register_callback(ctx, LIBUSB_HOTPLUG_EVENT_DEVICE_ARRIVED |
+                                              LIBUSB_HOTPLUG_EVENT_DEVICE_LEFT,
+                                         LIBUSB_HOTPLUG_NO_FLAGS, TOBII_VID, TOBII_PID,
+                                         LIBUSB_HOTPLUG_MATCH_ANY, hotplug_cb, ud, &ud->hp) == 0)
+        ud->hotplug = 1;
+    return ud;
+}
+
+static frame_t *next_frame(uvc_device_t *ud, int timeout_ms)
+{
+    if (ud->done) {
+        usleep((useconds_t)timeout_ms * 1000);
+        return NULL;
+    }
+    if (ud->h) {
+        if (!__atomic_load_n(&ud->lost, __ATOMIC_RELAXED)) {
+            uvc_demand_t want = wanted(ud);
+            int ok = want == ud->applied || apply(ud, want) == 0;
+            if (ok && ud->cap) {
+                frame_t *f = uvc_capture_next(ud->cap, timeout_ms);
+                if (f) return f;
+                if (uvc_capture_running(ud->cap) && !__atomic_load_n(&ud->lost, __ATOMIC_RELAXED))
+                    return NULL;
+            } else if (ok) {
+                pump(ud, (int64_t)timeout_ms * 1000000LL);      /* idle: only watch for unplug */
+                if (!__atomic_load_n(&ud->lost, __ATOMIC_RELAXED)) return NULL;
+            }
+        }
+        release(ud, 0);
+        ud->st.losses++;
+        printf("[USB] Tracker %s lost%s\n", ud->st.serial[0] ? ud->st.serial : ud->st.path,
+               ud->cfg.replug ? ", waiting for it to come back" : "");
+        if (!ud->cfg.replug) ud->done = 1;
+        ud->next_scan_ns = 0;
+        return NULL;
+    }
+
+    /* Away. Nobody else handles libusb events now, so hotplug callbacks
+     * arrive in here; a periodic rescan covers missed or absent ones. */
+    int64_t deadline = mono_ns() + (int64_t)timeout_ms * 1000000LL;
+    for (;;) {
+        int64_t now = mono_ns();
+        if (__atomic_exchange_n(&ud->arrived, 0, __ATOMIC_RELAXED) || now >= ud->next_scan_ns) {
+            ud->next_scan_ns = now + RESCAN_MS * 1000000LL;
+            if (bring_up(ud, 1) == 0) return NULL;      /* frames from the next call */
+        }
+        int64_t left = deadline - now;
+        if (left <= 0) return NULL;
+        pump(ud, ud->next_scan_ns - now < left ? ud->next_scan_ns - now : left);
+    }
+}
+
+frame_t *uvc_device_next(uvc_device_t *ud, int timeout_ms)
+{
+    uint32_t acc = __atomic_load_n(&ud->accum_req, __ATOMIC_RELAXED);
+    if (acc != ud->accumulate) {
+        ud->accumulate = acc;
+        if (ud->cap) uvc_capture_set_accumulate(ud->cap, acc);
+    }
+    frame_t *f = next_frame(ud, timeout_ms);
+    int64_t now = mono_ns();
+    if (ud->dirty || now >= ud->next_snap_ns) snapshot(ud, now);
+    return f;
+}
+
+void uvc_device_subscribe(uvc_device_t *ud, uvc_demand_t level)
+{
+    if (level > UVC_DEMAND_OFF && level < UVC_DEMAND_COUNT)
+        __atomic_fetch_add(&ud->subs[level], 1, __ATOMIC_RELEASE);
+}
+
+void uvc_device_unsubscribe(uvc_device_t *ud, uvc_demand_t level)
+{
+    if (level > UVC_DEMAND_OFF && level < UVC_DEMAND_COUNT)
+        __atomic_fetch_sub(&ud->subs[level], 1, __ATOMIC_RELEASE);
+}
+
+uvc_demand_t uvc_device_demand(uvc_device_t *ud)
+{
+    pthread_mutex_lock(&ud->snap_lock);
+    uvc_demand_t d = ud->snap.demand;
+    pthread_mutex_unlock(&ud->snap_lock);
+    return d;
+}
+
+int uvc_device_running(const uvc_device_t *ud)
+{
+    return !ud->done;
+}
+
+const uvc_probe_t *uvc_device_probe(const uvc_device_t *ud)
+{
+    return &ud->probe;
+}
+
+uvc_capture_t *uvc_device_capture(const uvc_device_t *ud)
+{
+    return ud->cap;
+}
+
+void uvc_device_set_accumulate(uvc_device_t *ud, uint32_t target_bytes)
+{
+    __atomic_store_n(&ud->accum_req, target_bytes, __ATOMIC_RELAXED);
+}
+
+void uvc_device_get_stats(uvc_device_t *ud, uvc_device_stats_t *out)
+{
+    pthread_mutex_lock(&ud->snap_lock);
+    *out = ud->snap;
+    pthread_mutex_unlock(&ud->snap_lock);
+}
+
+void uvc_device_close(uvc_device_t *ud)
+{
+    if (!ud) return;
+    if (ud->hotplug) libusb_hotplug_deregister_callback(ud->ctx, ud->hp);
+    release(ud, 1);
+    frame_pool_destroy(ud->own_pool);
+    pthread_mutex_destroy(&ud->snap_lock);
+    free(ud);
+}
@@ -0,0 +1,150 @@
+/*
+ * uvc_device.h — ET5 bring-up, probe cache and hot-replug around uvc_capture
+ *
+ * Bringing a tracker up the long way is a kernel-driver detach, two
+ * interface claims and uvc_start(): GET_MAX, SET_CUR, GET_CUR and COMMIT
+ * on the probe control, each allowed 2 s. The negotiated probe only
+ * depends on the tracker, its firmware and the interval asked for, so
+ * after the first success it is cached per serial number with bcdDevice
+ * and that interval (a firmware update or another demand invalidates
+ * it; the committed interval may differ, the device has the last word)
+ * and later bring-ups send just the COMMIT with a short timeout. If the
+ * tracker does not take it, the full negotiation runs and the cache is
+ * rewritten.
+ *
+ * The device also outlives the tracker: a libusb hotplug listener (or,
+ * where libusb has no hotplug, a rescan every half second) notices
+ * unplug and replug. On loss the capture engine is stopped and the
+ * interfaces let go. When a tracker with the same serial arrives, on any
+ * port, it is re-armed from the cache and frames flow again through the
+ * same uvc_device_next() — the consumer, the frame pool and everything
+ * downstream (display state, calibration) never restart.
+ *
+ * What is negotiated follows the consumers. The frame descriptors of the
+ * streaming interface are read at bring-up, and each consumer subscribes
+ * at a demand level: the fastest interval offered while anyone needs full
+ * rate, the slowest for a preview, no stream at all (no bulk traffic, no
+ * event thread) while nobody subscribes. Bulk transfers are sized to the
+ * committed dwMaxPayloadTransferSize instead of a fixed 64 KB.
+ *
+ * All of the lifecycle runs on the consumer's thread, inside
+ * uvc_device_next(): nothing is torn down under a running consumer, and
+ * hotplug callbacks only raise flags (libusb forbids blocking I/O in
+ * them). That thread is also the only one that touches the capture
+ * engine, which it may stop and free on any call. Other threads
+ * subscribe, ask for accumulation and read a stats snapshot the
+ * consumer publishes (uvc_device_get_stats()); each request is applied
+ * at the consumer's next call.
+ *
+ *   uvc_device_config_t cfg = UVC_DEVICE_DEFAULTS;
+ *   cfg.capture.pool = pool;
+ *   uvc_device_t *ud = uvc_device_open(ctx, &cfg);
+ *   while (uvc_device_running(ud)) {
+ *       frame_t *f = uvc_device_next(ud, 500);   // NULL: timeout or replug wait
+ *       if (f) { ...; frame_unref(f); }
+ *   }
+ *   uvc_device_close(ud);
+ *
+ * Copyright (c) 2026 Squig-AI (squig-ai.com) — MIT License
+ * See LICENSE file for details.
+ */
+
+#ifndef SQUIG_UVC_DEVICE_H
+#define SQUIG_UVC_DEVICE_H
+
+#include <stdint.h>
+#include <libusb.h>
+#include "uvc_capture.h"
+
+/* What the consumers need the stream for. The device runs at the highest
+ * level anyone subscribes to: FULL at the fastest interval the tracker
+ * offers, PREVIEW at the slowest, and with no subscriber the stream is
+ * stopped altogether. In ir_viewer, recording, the dumps and --full-rate
+ * hold FULL from open and eye detection (E) while it is on; the window
+ * holds PREVIEW unless it is minimised. */
+typedef enum {
+    UVC_DEMAND_OFF,
+    UVC_DEMAND_PREVIEW,
+    UVC_DEMAND_FULL,
+    UVC_DEMAND_COUNT
+} uvc_demand_t;
+
+typedef struct {
+    const char *path;           /* USB path of the first bring-up, NULL = first tracker */
+    int         probe_cache;    /* reuse / store the committed probe per serial */
+    int         replug;         /* wait for the tracker after a loss (0 = stop running) */
+    unsigned    commit_ms;      /* timeout of the cached COMMIT */
+    uvc_demand_t demand;        /* subscription held from open (OFF = none) */
+    uvc_capture_config_t capture;   /* for every capture engine started (pool: shared) */
+} uvc_device_config_t;
+
+#define UVC_DEVICE_DEFAULTS { NULL, 1, 1, 250, UVC_DEMAND_FULL, UVC_CAPTURE_DEFAULTS }
+
+typedef struct {
+    uvc_capture_stats_t capture;    /* every engine so far, summed */
+    int      queue_depth;       /* frames waiting for the consumer (0 = stream off) */
+    uvc_demand_t demand;        /* level the stream runs at */
+    uint64_t bringups;          /* successful bring-ups, the first included */
+    uint64_t cached;            /* ... that committed the cached probe */
+    uint64_t losses;            /* unplug / reset / transfer ring died */
+    double   last_bringup_ms;   /* open to first transfer submitted */
+    uint64_t rate_changes;      /* restarts for a new demand */
+    uint32_t frame_interval;    /* committed, 100 ns units (0 = stream off) */
+    int      connected;
+    char     serial[64];        /* "" until the first bring-up */
+    char     path[UVC_PATH_MAX];
+} uvc_device_stats_t;
+
+typedef struct uvc_device uvc_device_t;
+
+/* First bring-up (fails if no tracker can be started). cfg may be NULL
+ * for UVC_DEVICE_DEFAULTS. Without cfg->capture.pool a pool is created
+ * and owned here, so frames stay valid across re-arms. */
+uvc_device_t *uvc_device_open(libusb_context *ctx, const uvc_device_config_t *cfg);
+
+/* Next frame, as uvc_capture_next(); also detects a loss, waits for the
+ * tracker and re-arms it, within timeout_ms per call. One thread. */
+frame_t *uvc_device_next(uvc_device_t *ud, int timeout_ms);
+
+/* Nonzero while frames flow or a replug is awaited. */
+int uvc_device_running(const uvc_device_t *ud);
+
+/* Probe committed by the current (or last) bring-up. Consumer thread. */
+const uvc_probe_t *uvc_device_probe(const uvc_device_t *ud);
+
+/* The running capture engine, NULL while the tracker is away or the
+ * stream is off. Consumer thread only: the next uvc_device_next() may
+ * free it. */
+uvc_capture_t *uvc_device_capture(const uvc_device_t *ud);
+
+/* Add / drop a subscriber at level (any thread). The stream is
+ * renegotiated for the new highest level on the consumer thread, inside
+ * the next uvc_device_next(). */
+void uvc_device_subscribe(uvc_device_t *ud, uvc_demand_t level);
+void uvc_device_unsubscribe(uvc_device_t *ud, uvc_demand_t level);
+
+/* Level the stream currently runs at (any thread, as of the snapshot). */
+uvc_demand_t uvc_device_demand(uvc_device_t *ud);
+
+/* uvc_capture_set_accumulate() on the running engine and on every
+ * engine re-armed later (0 = off). Any thread; the consumer applies it
+ * in its next uvc_device_next(). */
+void uvc_device_set_accumulate(uvc_device_t *ud, uint32_t target_bytes);
+
+/* The snapshot the consumer thread last published: on every bring-up,
+ * loss and demand change, and at least every UVC_DEVICE_SNAPSHOT_MS
+ * while it calls uvc_device_next(). Any thread. */
+#define UVC_DEVICE_SNAPSHOT_MS  100
+
+void uvc_device_get_stats(uvc_device_t *ud, uvc_device_stats_t *out);
+
+/* Stop capture, release the interfaces (kernel driver back) and free.
+ * Drop all frame references first if the pool is owned here. */
+void uvc_device_close(uvc_device_t *ud);
+
+/* Where the probe for a serial is cached: $SQUIG_PROFILE_DIR, else
+ * $XDG_CACHE_HOME/squig-headtrack, else ~/.cache/squig-headtrack.
+ * Returns 0, or -1 if there is no such place. */
+int uvc_device_cache_path(const char *serial, char *buf, size_t size);
+
+#endif /* SQUIG_UVC_DEVICE_H */